@@ -0,0 +1,309 @@
+/*
+ * sckbench times the main SourceCodeKit operations over a corpus of source
+ * files, and reports wall time and CPU time percentiles, the resident set size
+ * growth per call, how much each phase raised the peak resident set size, and 
+ * the peak resident set size of the process.
+ *
+ * Usage:
+ *
+ *   sckbench [-repetitions N] [-completionOffset N] [-ignoresIncludedSymbols YES]
+ *            path...
+ *
+ * Each path is either a source file or a directory that is crawled for the
+ * file extensions handled by SCKSourceCollection.
+ */
+#import <Foundation/Foundation.h>
+#import <Cocoa/Cocoa.h>
+#import <EtoileFoundation/EtoileFoundation.h>
+#import "SourceCodeKit.h"
+#include <sys/resource.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+@interface SCKClangSourceFile (SCKBenchmark)
+- (void)rebuildIndex;
+@end
+
+/**
+ * Samples collected for a single benchmarked phase.
+ */
+@interface SCKBenchmarkPhase : NSObject
+{
+	@public
+	NSString *name;
+	NSMutableArray *wallTimes;
+	NSMutableArray *cpuTimes;
+	/** Resident set size growth of each call in KB. */
+	NSMutableArray *rssDeltas;
+	/** Growth of the peak resident set size during the calls in KB. */
+	long peakRSSGrowth;
+}
+- (id)initWithName: (NSString*)aName;
+- (void)measure: (void (^)(void))aBlock;
+- (void)report;
+@end
+
+static double wallClock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpuClock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the peak resident set size of the process in KB.
+ */
+static long peakResidentSetSize(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	// Darwin reports bytes rather than KB
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+/**
+ * Returns the current resident set size in KB.
+ *
+ * Where /proc/self/statm is not available, returns the peak resident set size
+ * instead, so the growth per call only accounts for new peaks.
+ */
+static long residentSetSize(void)
+{
+	FILE *statm = fopen("/proc/self/statm", "r");
+	long pages = 0;
+
+	if (NULL != statm)
+	{
+		int matched = fscanf(statm, "%*ld %ld", &pages);
+
+		fclose(statm);
+		if (1 == matched)
+		{
+			return pages * (sysconf(_SC_PAGESIZE) / 1024);
+		}
+	}
+
+	return peakResidentSetSize();
+}
+
+static double percentile(NSArray *sortedSamples, double p)
+{
+	NSUInteger count = [sortedSamples count];
+
+	if (count == 0)
+	{
+		return 0;
+	}
+	NSUInteger i = (NSUInteger)(p * (count - 1) + 0.5);
+	return [[sortedSamples objectAtIndex: MIN(i, count - 1)] doubleValue];
+}
+
+@implementation SCKBenchmarkPhase
+
+- (id)initWithName: (NSString*)aName
+{
+	SUPERINIT;
+	name = aName;
+	wallTimes = [NSMutableArray new];
+	cpuTimes = [NSMutableArray new];
+	rssDeltas = [NSMutableArray new];
+	return self;
+}
+
+- (void)measure: (void (^)(void))aBlock
+{
+	long rss = residentSetSize();
+	long peakRSS = peakResidentSetSize();
+	double wall = wallClock();
+	double cpu = cpuClock();
+	aBlock();
+	[cpuTimes addObject: [NSNumber numberWithDouble: cpuClock() - cpu]];
+	[wallTimes addObject: [NSNumber numberWithDouble: wallClock() - wall]];
+	[rssDeltas addObject: [NSNumber numberWithLong: residentSetSize() - rss]];
+	peakRSSGrowth += peakResidentSetSize() - peakRSS;
+}
+
+- (void)report
+{
+	NSArray *wall = [wallTimes sortedArrayUsingSelector: @selector(compare:)];
+	NSArray *cpu = [cpuTimes sortedArrayUsingSelector: @selector(compare:)];
+	NSArray *rss = [rssDeltas sortedArrayUsingSelector: @selector(compare:)];
+
+	printf("%-24s %6lu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10ld %10ld %10ld\n",
+		[name UTF8String], (unsigned long)[wall count],
+		percentile(wall, 0.5) * 1000, percentile(wall, 0.95) * 1000,
+		percentile(wall, 0.99) * 1000, percentile(wall, 1) * 1000,
+		percentile(cpu, 0.5) * 1000, percentile(cpu, 0.95) * 1000,
+		percentile(cpu, 0.99) * 1000,
+		(long)percentile(rss, 0.5), (long)percentile(rss, 1), peakRSSGrowth);
+}
+
+@end
+
+static NSArray *corpusFilesForPaths(NSArray *paths)
+{
+	NSSet *extensions = S(@"m", @"h", @"c", @"cc", @"cpp");
+	NSFileManager *fm = [NSFileManager defaultManager];
+	NSMutableArray *files = [NSMutableArray array];
+
+	for (NSString *path in paths)
+	{
+		BOOL isDir = NO;
+
+		if (![fm fileExistsAtPath: path isDirectory: &isDir])
+		{
+			fprintf(stderr, "Skipping missing path %s\n", [path UTF8String]);
+			continue;
+		}
+		if (!isDir)
+		{
+			[files addObject: path];
+			continue;
+		}
+		for (NSString *subpath in [fm enumeratorAtPath: path])
+		{
+			if ([extensions containsObject: [subpath pathExtension]])
+			{
+				[files addObject: [path stringByAppendingPathComponent: subpath]];
+			}
+		}
+	}
+	return files;
+}
+
+/**
+ * Returns the arguments that are not -key value pairs (parsed by
+ * NSUserDefaults in the argument domain).
+ */
+static NSArray *corpusPathsFromArguments(NSArray *arguments)
+{
+	NSMutableArray *paths = [NSMutableArray array];
+
+	for (NSUInteger i = 1; i < [arguments count]; i++)
+	{
+		NSString *arg = [arguments objectAtIndex: i];
+
+		if ([arg hasPrefix: @"-"])
+		{
+			i++;
+			continue;
+		}
+		[paths addObject: arg];
+	}
+	return paths;
+}
+
+static NSUInteger defaultCompletionOffset(NSString *text)
+{
+	NSRange r = [text rangeOfString: @"[" options: NSBackwardsSearch];
+	return (r.location == NSNotFound ? [text length] : r.location + 1);
+}
+
+int main(int argc, char **argv)
+{
+	@autoreleasepool
+	{
+		NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+		NSInteger repetitions = MAX([defaults integerForKey: @"repetitions"], 1);
+		NSArray *files = corpusFilesForPaths(corpusPathsFromArguments([[NSProcessInfo processInfo] arguments]));
+
+		if ([files count] == 0)
+		{
+			fprintf(stderr, "Usage: sckbench [-repetitions N] [-completionOffset N] "
+				"[-ignoresIncludedSymbols YES] path...\n");
+			return 1;
+		}
+
+		SCKBenchmarkPhase *load = [[SCKBenchmarkPhase alloc] initWithName: @"sourceFileForPath:"];
+		SCKBenchmarkPhase *reparse = [[SCKBenchmarkPhase alloc] initWithName: @"reparse"];
+		SCKBenchmarkPhase *index = [[SCKBenchmarkPhase alloc] initWithName: @"rebuildIndex"];
+		SCKBenchmarkPhase *lexical = [[SCKBenchmarkPhase alloc] initWithName: @"lexicalHighlightFile"];
+		SCKBenchmarkPhase *syntax = [[SCKBenchmarkPhase alloc] initWithName: @"syntaxHighlightFile"];
+		SCKBenchmarkPhase *transform = [[SCKBenchmarkPhase alloc] initWithName: @"transformString:"];
+		SCKBenchmarkPhase *diagnostics = [[SCKBenchmarkPhase alloc] initWithName: @"collectDiagnostics"];
+		SCKBenchmarkPhase *completion = [[SCKBenchmarkPhase alloc] initWithName: @"completeAtLocation:"];
+		NSArray *phases = A(load, reparse, index, lexical, syntax, transform, diagnostics, completion);
+		SCKSourceCollection *collection = [SCKSourceCollection new];
+		SCKSyntaxHighlighter *highlighter = [SCKSyntaxHighlighter new];
+
+		[collection setIgnoresIncludedSymbols: [defaults boolForKey: @"ignoresIncludedSymbols"]];
+		// Time the loads of each repetition without reusing the files parsed by the previous one
+		[collection setKeepsFilesAcrossClear: NO];
+
+		for (NSInteger i = 0; i < repetitions; i++)
+		{
+			[collection clear];
+
+			for (NSString *path in files)
+			{
+				@autoreleasepool
+				{
+					NSString *text = [NSString stringWithContentsOfFile: path
+					                                           encoding: NSUTF8StringEncoding
+					                                              error: NULL];
+					__block SCKSourceFile *file = nil;
+
+					if (nil == text)
+					{
+						continue;
+					}
+
+					[load measure: ^ () { file = [collection sourceFileForPath: path]; }];
+					if (nil == file)
+					{
+						continue;
+					}
+					// Edit the parsed text, so the reparse can't skip the unchanged content
+					NSString *editedText = [text stringByAppendingFormat: @"\n// sckbench edit %ld\n", (long)i];
+
+					[file setSource: [[NSMutableAttributedString alloc] initWithString: editedText]];
+
+					[reparse measure: ^ () { [file reparse]; }];
+					if ([file respondsToSelector: @selector(rebuildIndex)])
+					{
+						[index measure: ^ () { [(SCKClangSourceFile*)file rebuildIndex]; }];
+					}
+					[lexical measure: ^ () { [file lexicalHighlightFile]; }];
+					[syntax measure: ^ () { [file syntaxHighlightFile]; }];
+					[diagnostics measure: ^ () { [file collectDiagnostics]; }];
+					[transform measure: ^ () { [highlighter transformString: [file source]]; }];
+
+					NSUInteger offset = ([defaults objectForKey: @"completionOffset"] != nil ?
+						(NSUInteger)[defaults integerForKey: @"completionOffset"] : defaultCompletionOffset(text));
+
+					offset = MIN(offset, [text length]);
+					if ([file respondsToSelector: @selector(cursorDidMoveToLocation:)])
+					{
+						// Discard the cached completion session to time libclang
+						[(SCKClangSourceFile*)file cursorDidMoveToLocation: NSNotFound];
+					}
+					[completion measure: ^ () { [file completeAtLocation: offset]; }];
+				}
+			}
+		}
+
+		printf("%lu files, %ld repetitions (times in ms, RSS growth per call and peak RSS "
+			"growth per phase in KB)\n\n", (unsigned long)[files count], (long)repetitions);
+		printf("%-24s %6s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "phase", "n",
+			"wall p50", "wall p95", "wall p99", "wall max", "cpu p50", "cpu p95", "cpu p99",
+			"RSS p50", "RSS max", "peak RSS");
+		for (SCKBenchmarkPhase *phase in phases)
+		{
+			[phase report];
+		}
+		printf("\nPeak RSS: %ld KB\n", peakResidentSetSize());
+	}
+	return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * sckindexworker parses and indexes source files on behalf of
+ * SCKIndexWorkerPool, so a libclang crash or a parse that uses too much
+ * memory only takes down the worker.
+ *
+ * Usage:
+ *
+ *   sckindexworker [-memoryLimit BYTES]
+ *
+ * Requests are read from the standard input and responses are written to the
+ * standard output, each prefixed with its length as a 32-bit integer in host
+ * byte order (see -[SCKClangSourceFile indexWorkerRequest] and
+ * +[SCKClangSourceFile indexWorkerResponseForRequest:inCollection:]). The
+ * worker exits when its standard input is closed.
+ */
+#import <Foundation/Foundation.h>
+#import <EtoileFoundation/EtoileFoundation.h>
+#import "SourceCodeKit.h"
+#include <sys/resource.h>
+#include <errno.h>
+#include <unistd.h>
+
+static BOOL readFully(int fd, void *bytes, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t count = read(fd, bytes, length);
+
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return NO;
+
+		bytes = (char *)bytes + count;
+		length -= count;
+	}
+	return YES;
+}
+
+static BOOL writeFully(int fd, const void *bytes, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t count = write(fd, bytes, length);
+
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count < 0)
+			return NO;
+
+		bytes = (const char *)bytes + count;
+		length -= count;
+	}
+	return YES;
+}
+
+int main(int argc, char **argv)
+{
+	@autoreleasepool
+	{
+		NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+		unsigned long long memoryLimit = [[defaults stringForKey: @"memoryLimit"] longLongValue];
+
+		if (memoryLimit > 0)
+		{
+			struct rlimit limit = { (rlim_t)memoryLimit, (rlim_t)memoryLimit };
+
+			if (setrlimit(RLIMIT_AS, &limit) != 0)
+			{
+				perror("sckindexworker: setrlimit");
+			}
+		}
+
+		// The program components are sent back rather than collected here
+		SCKSourceCollection *collection = [SCKSourceCollection new];
+
+		[collection clear];
+
+		while (YES)
+		{
+			@autoreleasepool
+			{
+				uint32_t length;
+
+				if (!readFully(STDIN_FILENO, &length, sizeof(length)))
+					break;
+
+				NSMutableData *request = [NSMutableData dataWithLength: length];
+
+				if (!readFully(STDIN_FILENO, [request mutableBytes], length))
+				{
+					fprintf(stderr, "sckindexworker: truncated request\n");
+					return 1;
+				}
+
+				NSData *response = [SCKClangSourceFile indexWorkerResponseForRequest: request
+				                                                        inCollection: collection];
+
+				if (nil == response)
+				{
+					fprintf(stderr, "sckindexworker: malformed request\n");
+					return 1;
+				}
+
+				uint32_t responseLength = (uint32_t)[response length];
+
+				if (!writeFully(STDOUT_FILENO, &responseLength, sizeof(responseLength))
+				 || !writeFully(STDOUT_FILENO, [response bytes], responseLength))
+				{
+					return 1;
+				}
+			}
+		}
+	}
+	return 0;
+}
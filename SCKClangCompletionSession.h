@@ -0,0 +1,57 @@
+#include <Foundation/NSObject.h>
+#include <Foundation/NSRange.h>
+#include <clang-c/Index.h>
+
+@class NSString;
+@class NSMutableArray;
+@class SCKCodeCompletionResult;
+
+/**
+ * A completion session keeps the libclang code completion results computed at
+ * a trigger point (the start of the identifier being completed), so that
+ * successive keystrokes inside the same identifier only re-filter the cached
+ * results instead of running a new semantic analysis pass.
+ *
+ * A session is owned by a SCKClangSourceFile and the libclang results are
+ * disposed when the session is deallocated.
+ */
+@interface SCKClangCompletionSession : NSObject
+{
+	/** libclang results, owned by the session. */
+	CXCodeCompleteResults *results;
+	/** Typed text of each result, used to filter by the typed prefix. */
+	NSMutableArray *typedTexts;
+	/** Completion strings built lazily from the results (NSNull if not built yet). */
+	NSMutableArray *completions;
+	NSString *fixitText;
+	NSRange fixitRange;
+}
+/**
+ * Runs libclang code completion at the given offset and returns a session
+ * that caches the results.
+ *
+ * The offset must be the start of the identifier token to be completed (or the
+ * insertion point just after a completion trigger such as '[' or '.'), and
+ * contents must be the current text of the file named aFileName.
+ */
+- (id)initWithTranslationUnit: (CXTranslationUnit)aTranslationUnit
+                         file: (CXFile)aFile
+                     fileName: (NSString*)aFileName
+                     contents: (NSString*)contents
+                     location: (NSUInteger)aLocation;
+/**
+ * The offset at which libclang was invoked.
+ */
+@property (nonatomic, readonly) NSUInteger location;
+/**
+ * The number of completions cached by the session.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+/**
+ * Returns the cached completions whose typed text starts with aPrefix, in the
+ * libclang sorting order.
+ *
+ * This never calls back into libclang.
+ */
+- (SCKCodeCompletionResult*)completionResultForPrefix: (NSString*)aPrefix;
+@end
@@ -0,0 +1,198 @@
+#import "SCKClangCompletionSession.h"
+#import "SCKCodeCompletionResult.h"
+#import <Cocoa/Cocoa.h>
+#import <EtoileFoundation/EtoileFoundation.h>
+
+NSRange NSRangeFromCXSourceRange(CXSourceRange sr);
+
+/**
+ * Builds the human-readable completion (with placeholders) corresponding to a
+ * libclang completion string.
+ */
+static NSMutableAttributedString *completionFromCXCompletionString(CXCompletionString cs)
+{
+	NSMutableAttributedString *completion = [NSMutableAttributedString new];
+	NSMutableString *s = [completion mutableString];
+	unsigned chunks = clang_getNumCompletionChunks(cs);
+	for (unsigned j=0 ; j<chunks ; j++)
+	{
+		switch (clang_getCompletionChunkKind(cs, j))
+		{
+			case CXCompletionChunk_Optional:
+			case CXCompletionChunk_TypedText:
+			case CXCompletionChunk_Text:
+			{
+				CXString str = clang_getCompletionChunkText(cs, j);
+				[s appendFormat: @"%s", clang_getCString(str)];
+				clang_disposeString(str);
+				break;
+			}
+			case CXCompletionChunk_Placeholder:
+			{
+				CXString str = clang_getCompletionChunkText(cs, j);
+				[s appendFormat: @"<# %s #>", clang_getCString(str)];
+				clang_disposeString(str);
+				break;
+			}
+			case CXCompletionChunk_Informative:
+			{
+				CXString str = clang_getCompletionChunkText(cs, j);
+				[s appendFormat: @"/* %s */", clang_getCString(str)];
+				clang_disposeString(str);
+				break;
+			}
+			case CXCompletionChunk_CurrentParameter:
+			case CXCompletionChunk_LeftParen:
+				[s appendString: @"("]; break;
+			case CXCompletionChunk_RightParen:
+				[s appendString: @")"]; break;
+			case CXCompletionChunk_LeftBracket:
+				[s appendString: @"["]; break;
+			case CXCompletionChunk_RightBracket:
+				[s appendString: @"]"]; break;
+			case CXCompletionChunk_LeftBrace:
+				[s appendString: @"{"]; break;
+			case CXCompletionChunk_RightBrace:
+				[s appendString: @"}"]; break;
+			case CXCompletionChunk_LeftAngle:
+				[s appendString: @"<"]; break;
+			case CXCompletionChunk_RightAngle:
+				[s appendString: @">"]; break;
+			case CXCompletionChunk_Comma:
+				[s appendString: @","]; break;
+			case CXCompletionChunk_ResultType:
+				break;
+			case CXCompletionChunk_Colon:
+				[s appendString: @":"]; break;
+			case CXCompletionChunk_SemiColon:
+				[s appendString: @";"]; break;
+			case CXCompletionChunk_Equal:
+				[s appendString: @"="]; break;
+			case CXCompletionChunk_HorizontalSpace:
+				[s appendString: @" "]; break;
+			case CXCompletionChunk_VerticalSpace:
+				[s appendString: @"\n"]; break;
+		}
+	}
+	return completion;
+}
+
+/**
+ * Returns the text the user has to type to select the completion.
+ */
+static NSString *typedTextFromCXCompletionString(CXCompletionString cs)
+{
+	unsigned chunks = clang_getNumCompletionChunks(cs);
+	for (unsigned j=0 ; j<chunks ; j++)
+	{
+		if (CXCompletionChunk_TypedText == clang_getCompletionChunkKind(cs, j))
+		{
+			CXString str = clang_getCompletionChunkText(cs, j);
+			NSString *typedText = [NSString stringWithUTF8String: clang_getCString(str)];
+			clang_disposeString(str);
+			return typedText;
+		}
+	}
+	return @"";
+}
+
+@implementation SCKClangCompletionSession
+
+@synthesize location;
+
+- (id)initWithTranslationUnit: (CXTranslationUnit)aTranslationUnit
+                         file: (CXFile)aFile
+                     fileName: (NSString*)aFileName
+                     contents: (NSString*)contents
+                     location: (NSUInteger)aLocation
+{
+	SUPERINIT;
+	location = aLocation;
+
+	const char *fn = [aFileName UTF8String];
+	const char *buffer = [contents UTF8String];
+	struct CXUnsavedFile unsavedFile = { fn, buffer, strlen(buffer) };
+
+	CXSourceLocation l = clang_getLocationForOffset(aTranslationUnit, aFile, (unsigned)location);
+	unsigned line, column;
+	clang_getInstantiationLocation(l, 0, &line, &column, 0);
+
+	int options = CXCompletionContext_AnyType |
+			CXCompletionContext_AnyValue |
+			CXCompletionContext_ObjCInterface;
+
+	results = clang_codeCompleteAt(aTranslationUnit, fn, line, column, &unsavedFile, 1, options);
+	if (NULL == results)
+	{
+		return nil;
+	}
+	for (unsigned i=0 ; i<clang_codeCompleteGetNumDiagnostics(results) ; i++)
+	{
+		CXDiagnostic d = clang_codeCompleteGetDiagnostic(results, i);
+		unsigned fixits = clang_getDiagnosticNumFixIts(d);
+		if (1 == fixits)
+		{
+			CXSourceRange r;
+			CXString str = clang_getDiagnosticFixIt(d, 0, &r);
+			fixitRange = NSRangeFromCXSourceRange(r);
+			fixitText = [[NSString alloc] initWithUTF8String: clang_getCString(str)];
+			clang_disposeString(str);
+			clang_disposeDiagnostic(d);
+			break;
+		}
+		clang_disposeDiagnostic(d);
+	}
+
+	clang_sortCodeCompletionResults(results->Results, results->NumResults);
+	typedTexts = [[NSMutableArray alloc] initWithCapacity: results->NumResults];
+	completions = [[NSMutableArray alloc] initWithCapacity: results->NumResults];
+	for (unsigned i=0 ; i<results->NumResults ; i++)
+	{
+		[typedTexts addObject: typedTextFromCXCompletionString(results->Results[i].CompletionString)];
+		[completions addObject: [NSNull null]];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	if (NULL != results)
+	{
+		clang_disposeCodeCompleteResults(results);
+	}
+}
+
+- (NSUInteger)count
+{
+	return [typedTexts count];
+}
+
+- (SCKCodeCompletionResult*)completionResultForPrefix: (NSString*)aPrefix
+{
+	SCKCodeCompletionResult *result = [SCKCodeCompletionResult new];
+	NSMutableArray *matches = [NSMutableArray new];
+	BOOL filters = ([aPrefix length] > 0);
+	NSUInteger i = 0;
+
+	for (NSString *typedText in typedTexts)
+	{
+		if (!filters || [typedText hasPrefix: aPrefix])
+		{
+			id completion = [completions objectAtIndex: i];
+
+			if ([NSNull null] == completion)
+			{
+				completion = completionFromCXCompletionString(results->Results[i].CompletionString);
+				[completions replaceObjectAtIndex: i withObject: completion];
+			}
+			[matches addObject: completion];
+		}
+		i++;
+	}
+	result.fixitText = fixitText;
+	result.fixitRange = fixitRange;
+	result.completions = matches;
+	return result;
+}
+
+@end
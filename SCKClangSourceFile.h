@@ -3,6 +3,9 @@
 #include <clang-c/Index.h>
 
 @class SCKClangIndex;
+@class SCKClangCompletionSession;
+@class SCKDiagnosticSet;
+@class SCKIndexRecorder;
 @class NSMutableArray;
 @class NSMutableAttributedString;
 
@@ -12,7 +15,7 @@
  */
 @interface SCKClangSourceFile : SCKSourceFile
 {
-	/** Compiler arguments */
+	/** Compiler arguments, or nil to use the index default arguments. */
 	NSMutableArray *args;
 	/** Index shared between code files */
 	SCKClangIndex *idx;
@@ -23,11 +26,136 @@
 	NSMutableDictionary *enumerations;
 	NSMutableDictionary *enumerationValues;
 	NSMutableDictionary *macros;
+	/** Classes, functions and globals whose locations are in this file by name. */
+	NSMutableDictionary *declaredClasses;
+	NSMutableDictionary *declaredFunctions;
+	NSMutableDictionary *declaredGlobals;
+	/** Completion results cached for the identifier being typed. */
+	SCKClangCompletionSession *completionSession;
+	/** Translation unit version completionSession was computed against. */
+	NSUInteger completionSessionVersion;
+	/** Lowest location edited since completionSession was computed, or NSNotFound. */
+	NSUInteger completionSessionEditLocation;
+	/** Incremented each time the translation unit is reparsed. */
+	NSUInteger translationUnitVersion;
+	/** Serializes translation unit accesses with background completion. */
+	NSRecursiveLock *translationUnitLock;
+	/** Queue running speculative completions. */
+	NSOperationQueue *completionQueue;
+	/** Completion session computed in the background at a trigger point. */
+	SCKClangCompletionSession *speculativeSession;
+	/** Translation unit version speculativeSession was computed against. */
+	NSUInteger speculativeSessionVersion;
+	/** Incremented each time a speculative completion is started. */
+	NSUInteger speculationCount;
+	/** The speculationCount of the completion that computed speculativeSession. */
+	NSUInteger speculativeSessionCount;
+	/** Lowest location edited since the last speculative completion started, or NSNotFound. */
+	NSUInteger speculationEditLocation;
+	BOOL completesSpeculatively;
+	/** Diagnostics collected for the current translation unit version. */
+	SCKDiagnosticSet *diagnosticSet;
+	/** Diagnostics currently applied as kSCKDiagnostic attributes. */
+	SCKDiagnosticSet *appliedDiagnosticSet;
+	/** 
+	 * SCKParsedFileState structs in NSMutableData by path for the files 
+	 * included by the last parse. 
+	 */
+	NSMutableDictionary *parsedFileStates;
+	/** Hash of the main file contents used by the last parse. */
+	uint64_t mainFileContentHash;
+	/** Whether -reparse must collect the program components again. */
+	BOOL needsIndexing;
+	uint64_t interfaceFingerprint;
+	/** 
+	 * Recorder the program components are written to instead of being 
+	 * collected, when the receiver is parsed in an index worker process.
+	 */
+	SCKIndexRecorder *indexRecorder;
+	/** Occurrences recorded by the indexing in progress. */
+	NSMutableArray *pendingOccurrences;
+	/** Names, USRs and paths shared by pendingOccurrences. */
+	NSMutableSet *occurrenceStrings;
+	SCKOccurrenceIndex *occurrenceIndex;
 }
 
 @property (nonatomic, readonly) NSDictionary *functions;
 @property (nonatomic, readonly) NSDictionary *enumerations;
 @property (nonatomic, readonly) NSDictionary *enumerationValues;
 @property (nonatomic, readonly) NSDictionary *macros;
+/**
+ * The completion session started by the last -completeAtLocation: call, or nil
+ * if the insertion point has left the completed identifier since then.
+ *
+ * The session is reused while the identifier is typed, until the file is 
+ * reparsed or the text before the identifier is edited.  Edits are only 
+ * noticed when -source is a NSTextStorage, so a new session is computed on 
+ * each completion otherwise.
+ */
+@property (nonatomic, readonly) SCKClangCompletionSession *completionSession;
+/**
+ * Tells the receiver the insertion point has moved.
+ *
+ * If the location is outside the identifier the current completion session was
+ * started for, the session and its libclang results are disposed.
+ */
+- (void)cursorDidMoveToLocation: (NSUInteger)location;
+/**
+ * The number of times the translation unit has been (re)parsed.
+ *
+ * Results computed against an older version are discarded.
+ */
+@property (nonatomic, readonly) NSUInteger translationUnitVersion;
+/**
+ * Whether -textDidChangeAtLocation: starts code completion in the background
+ * when a completion trigger has just been typed.
+ *
+ * By default, returns NO.
+ */
+@property (nonatomic, assign) BOOL completesSpeculatively;
+/**
+ * Tells the receiver the user typed text ending at the given location.
+ *
+ * When -completesSpeculatively is YES and the text ends with a completion
+ * trigger ('[', '.', '->' or a space after a message receiver), code
+ * completion starts on a background thread, so the results are ready when
+ * -completeAtLocation: is called for the same location.  The speculative
+ * results are discarded if the file is reparsed or the text before the 
+ * location is edited in the meantime.  Speculative completion requires -source 
+ * to be a NSTextStorage, whose edits are notified.
+ *
+ * No speculative completion is started when -completionSession is still valid 
+ * at the location, since -completeAtLocation: reuses it.
+ *
+ * Returns whether a speculative completion was started.
+ */
+- (BOOL)textDidChangeAtLocation: (NSUInteger)location;
+/**
+ * Returns a request to parse the receiver in an index worker process.
+ *
+ * The request contains the file name, the compiler arguments and the unsaved 
+ * contents of the other files in the collection. See SCKIndexWorkerPool.
+ */
+- (NSData *)indexWorkerRequest;
+/**
+ * Parses the file described by the request in the current process, and 
+ * returns a response that contains the program components and the parsed file 
+ * states encoded as records.
+ *
+ * The components are not added to the given collection.
+ *
+ * Returns nil if the request is malformed.
+ */
++ (NSData *)indexWorkerResponseForRequest: (NSData *)aRequest
+                             inCollection: (SCKSourceCollection *)aCollection;
+/**
+ * Collects the program components and the parsed file states from a response 
+ * returned by +indexWorkerResponseForRequest:inCollection:, as -reparse would 
+ * do after parsing the file in the current process.
+ *
+ * A nil response means the worker crashed or was killed while parsing, the 
+ * program components are kept and the next -reparse parses the file again.
+ */
+- (void)reparseWithIndexWorkerResponse: (NSData *)aResponse;
 
 @end
@@ -1,7 +1,10 @@
 #import "SCKClangSourceFile.h"
+#import "SCKClangCompletionSession.h"
+#import "SCKIndexRecords.h"
 #import "SourceCodeKit.h"
 #import <Cocoa/Cocoa.h>
 #import <EtoileFoundation/EtoileFoundation.h>
+#include <sys/stat.h>
 #include <time.h>
 
 //#define NSLog(...)
@@ -152,6 +155,11 @@ NSArray *GNUstepIncludeDirectories()
 @property (readonly) CXIndex clangIndex;
 //FIXME: We should have different default arguments for C, C++ and ObjC.
 @property (nonatomic, copy) NSMutableArray *defaultArguments;
+/**
+ * Whether the threads created by libclang to parse files run at background
+ * priority.
+ */
+@property (nonatomic, assign) BOOL usesBackgroundPriority;
 @end
 
 
@@ -197,14 +205,34 @@ NSArray *GNUstepIncludeDirectories()
 {
 	clang_disposeIndex(clangIndex);
 }
+- (BOOL)usesBackgroundPriority
+{
+	return (clang_CXIndex_getGlobalOptions(clangIndex) & CXGlobalOpt_ThreadBackgroundPriorityForIndexing) != 0;
+}
+- (void)setUsesBackgroundPriority: (BOOL)flag
+{
+	unsigned options = clang_CXIndex_getGlobalOptions(clangIndex);
+
+	if (flag)
+	{
+		options |= CXGlobalOpt_ThreadBackgroundPriorityForIndexing;
+	}
+	else
+	{
+		options &= ~CXGlobalOpt_ThreadBackgroundPriorityForIndexing;
+	}
+	clang_CXIndex_setGlobalOptions(clangIndex, options);
+}
 @end
-@interface SCKClangSourceFile ()
+@interface SCKClangSourceFile () <SCKDocumentationSource, SCKIndexSink>
 - (void)highlightRange: (CXSourceRange)r syntax: (BOOL)highightSyntax;
+- (void)applyDiagnosticChanges: (SCKDiagnosticSet*)changes;
 @end
 
 @implementation SCKClangSourceFile
 
-@synthesize functions, enumerations, enumerationValues, macros;
+@synthesize functions, enumerations, enumerationValues, macros, completionSession,
+	translationUnitVersion, completesSpeculatively;
 
 /*
 static enum CXChildVisitResult findClass(CXCursor cursor, CXCursor parent, CXClientData client_data)
@@ -254,18 +282,22 @@ static BOOL isIBOutletFromPropertyOrIvar(CXCursor cursor)
 	return isIBOutlet;
 }
 
-- (void) setLocation: (SCKSourceLocation*)aLocation
-            forClass: (NSString*)aClassName
-      withSuperclass: (NSString*)aSuperclassName
-        isDefinition: (BOOL)isDefinition
-isForwardDeclaration: (BOOL)isForwardDeclaration
+- (SCKClass*)setLocation: (SCKSourceLocation*)aLocation
+                forClass: (NSString*)aClassName
+          withSuperclass: (NSString*)aSuperclassName
+            isDefinition: (BOOL)isDefinition
+    isForwardDeclaration: (BOOL)isForwardDeclaration
 {
 	SCKClass *class = [[self collection] classForName: aClassName];
 
 	if (isForwardDeclaration)
 	{
 		ETAssert(aSuperclassName == nil && isDefinition == NO);
-		return;
+		return nil;
+	}
+	if ([[aLocation file] isEqualToString: fileName])
+	{
+		[declaredClasses setObject: class forKey: aClassName];
 	}
 
 	// If we are parsing the definition, the superclass name is nil
@@ -282,12 +314,13 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	{
 		[class setDeclaration: aLocation];
 	}
+	return class;
 }
 
-- (void)setLocation: (SCKSourceLocation*)aLocation
-        forCategory: (NSString*)aCategoryName
-       isDefinition: (BOOL)isDefinition
-            ofClass: (NSString*)aClassName
+- (SCKCategory*)setLocation: (SCKSourceLocation*)aLocation
+                forCategory: (NSString*)aCategoryName
+               isDefinition: (BOOL)isDefinition
+                    ofClass: (NSString*)aClassName
 {
 	SCKClass *class = [[self collection] classForName: aClassName];
 	SCKCategory *category = [[class categories] objectForKey: aCategoryName];
@@ -309,18 +342,19 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	{
 		[category setDeclaration: aLocation];
 	}
+	return category;
 }
 
-- (void)setLocation: (SCKSourceLocation*)aLocation
-          forMethod: (NSString*)methodName
-   withTypeEncoding: (NSString*)typeEncoding
-      isClassMethod: (BOOL)isClassMethod
-       isDefinition: (BOOL)isDefinition
-            inClass: (NSString*)className
-           category: (NSString*)categoryName
+- (SCKMethod*)setLocation: (SCKSourceLocation*)aLocation
+                forMethod: (NSString*)methodName
+         withTypeEncoding: (NSString*)typeEncoding
+            isClassMethod: (BOOL)isClassMethod
+             isDefinition: (BOOL)isDefinition
+                  inClass: (NSString*)className
+                 category: (NSString*)categoryName
 {
 	SCKClass *cls = [[self collection] classForName: className];
-	NSMutableDictionary *methods = cls.methods;
+	SCKMethodDictionary *methods = cls.methods;
 	SCKCategory *cat = nil;
 
 	if (nil != categoryName)
@@ -337,22 +371,30 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	{
 		m = [SCKMethod new];
 		[m setName: methodName];
-		[m setTypeEncoding: typeEncoding];
+		[[[self collection] typeTable] setTypeEncoding: typeEncoding ofComponent: m];
 		[m setIsClassMethod: isClassMethod];
 		[m setParent: cls];
 		
 		[[cat methods] setObject: m forKey: methodName];
 		[[cls methods] setObject: m forKey: methodName];
+		[[self collection] addImplementor: (nil != cat ? (SCKProgramComponent *)cat : cls)
+		                       ofSelector: methodName];
+		[cls invalidateResolvedMethods];
 	}
 
 	if (isDefinition)
 	{
 		m.definition = aLocation;
+		[[cat methods] didParseDefinitionOfMethod: m];
+		[[cls methods] didParseDefinitionOfMethod: m];
 	}
 	else
 	{
 		m.declaration = aLocation;
+		[[cat methods] didParseDeclarationOfMethod: m];
+		[[cls methods] didParseDeclarationOfMethod: m];
 	}
+	return m;
 }
 
 - (SCKFunction*)functionForName: (NSString*)aName
@@ -370,23 +412,27 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	return function;
 }
 
-- (void)setLocation: (SCKSourceLocation*)l
-        forFunction: (NSString*)name
-   withTypeEncoding: (NSString*)type
-           isStatic: (BOOL)isStatic
-       isDefinition: (BOOL)isDefinition
+- (SCKFunction*)setLocation: (SCKSourceLocation*)l
+                forFunction: (NSString*)name
+           withTypeEncoding: (NSString*)type
+                   isStatic: (BOOL)isStatic
+               isDefinition: (BOOL)isDefinition
 {
 	BOOL isIncludedFunction = (![[l file] isEqualToString: [self fileName]]);
 
 	if (isIncludedFunction && [[self collection] ignoresIncludedSymbols])
 	{
-		return;
+		return nil;
 	}
 
 	id owner = (isStatic ? self : [self collection]);
 	SCKFunction *function = [owner functionForName: name];
 
-	[function setTypeEncoding: type];
+	[[[self collection] typeTable] setTypeEncoding: type ofComponent: function];
+	if (!isIncludedFunction)
+	{
+		[declaredFunctions setObject: function forKey: name];
+	}
 
 	if (isDefinition)
 	{
@@ -398,16 +444,21 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	}
 
 	//NSLog(@"Found %@ function %@ (%@) %@ at %@", (isStatic ? @"static" : @"global"), [function name], [function typeEncoding], (isDefinition ? @"defined" : @"declared"), l);
+	return function;
 }
 
-- (void)setLocation: (SCKSourceLocation*)l
-        forVariable: (NSString*)name
-   withTypeEncoding: (NSString*)type
-       isDefinition: (BOOL)isDefinition
+- (SCKGlobal*)setLocation: (SCKSourceLocation*)l
+              forVariable: (NSString*)name
+         withTypeEncoding: (NSString*)type
+             isDefinition: (BOOL)isDefinition
 {
 	SCKGlobal *variable = [[self collection] globalForName: name];
 
-	[variable setTypeEncoding: type];
+	[[[self collection] typeTable] setTypeEncoding: type ofComponent: variable];
+	if ([[l file] isEqualToString: fileName])
+	{
+		[declaredGlobals setObject: variable forKey: name];
+	}
 
 	if (isDefinition)
 	{
@@ -419,18 +470,15 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	}
 
 	//NSLog(@"Found %@ variable %@ (%@) %@ at %@", (isStatic ? @"static" : @"global"), [variable name], [variable typeEncoding], (isDefinition ? @"defined" : @"declared"), l);
+	return variable;
 }
 
-#if CINDEX_VERSION < 21
-#define CXObjCPropertyAttrKind int
-#endif
-
-- (void)setLocation: (SCKSourceLocation*)sourceLocation
-        forProperty: (NSString*)propertyName
-   withTypeEncoding: (NSString*)typeEncoding
-         attributes: (CXObjCPropertyAttrKind)propertyAttributes
-         isIBOutlet: (BOOL)isIBOutlet
-            inClass: (NSString *)className
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)propertyAttributes
+                 isIBOutlet: (BOOL)isIBOutlet
+                    inClass: (NSString *)className
 {
 	SCKClass *class = [[self collection] classForName: className];
 	SCKProperty *property = [class propertyForName: propertyName];
@@ -445,13 +493,14 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	}
 
 	// TODO: Convert CXObjCPropertyAttrKind into a SCK equivalent enum
-	[property setTypeEncoding: typeEncoding];
+	[[[self collection] typeTable] setTypeEncoding: typeEncoding ofComponent: property];
 	[property setIsIBOutlet: isIBOutlet];
 	[property setDeclaration: sourceLocation];
+	return property;
 }
 
-- (void)setLocation: (SCKSourceLocation*)sourceLocation
-           forMacro: (NSString*)macroName
+- (SCKMacro*)setLocation: (SCKSourceLocation*)sourceLocation
+                forMacro: (NSString*)macroName
 {
 	SCKMacro *macro = [macros objectForKey: macroName];
 	if (nil == macro)
@@ -463,13 +512,14 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
     
 	[macro setDefinition: sourceLocation];
 	[macro setDeclaration: sourceLocation];
+	return macro;
 }
 
-- (void)setLocation: (SCKSourceLocation*)sourceLocation
-            forIvar: (NSString*)ivarName
-   withTypeEncoding: (NSString*)typeEncoding
-         isIBOutlet: (BOOL)isIBOutlet
-            inClass: (NSString*)className
+- (SCKIvar*)setLocation: (SCKSourceLocation*)sourceLocation
+                forIvar: (NSString*)ivarName
+       withTypeEncoding: (NSString*)typeEncoding
+             isIBOutlet: (BOOL)isIBOutlet
+                inClass: (NSString*)className
 {
 	SCKClass *class = [[self collection] classForName: className];
 	SCKIvar *ivar = [class ivarForName: ivarName];
@@ -478,7 +528,7 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	{
 		ivar = [SCKIvar new];
 		[ivar setName: ivarName];
-		[ivar setTypeEncoding: typeEncoding];
+		[[[self collection] typeTable] setTypeEncoding: typeEncoding ofComponent: ivar];
 		[ivar setIsIBOutlet: isIBOutlet];
 		[ivar setParent: class];
 		
@@ -486,77 +536,155 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	}
 	
 	[ivar setDeclaration: sourceLocation];
+	return ivar;
 }
 
-- (void) setLocation: (SCKSourceLocation*)sourceLocation
-         forProtocol: (NSString*)protocolName
-isForwardDeclaration: (BOOL)isForwardDeclaration
+- (SCKProtocol*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProtocol: (NSString*)protocolName
+       isForwardDeclaration: (BOOL)isForwardDeclaration
 {
 	SCKProtocol *protocol = [[self collection] protocolForName: protocolName];
 
 	if (isForwardDeclaration)
 	{
-		return;
+		return nil;
 	}
 	[protocol setDeclaration: sourceLocation];
 	[protocol setDefinition: sourceLocation];
+	return protocol;
 }
 
-- (void)setLocation: (SCKSourceLocation*)sourceLocation
-          forMethod: (NSString*)methodName
-   withTypeEncoding: (NSString*)typeEncoding
-      isClassMethod: (BOOL)isClassMethod
-		 isRequired: (BOOL)isRequired
-       isDefinition: (BOOL)isDefinition
-         inProtocol: (NSString*)protocolName
+- (NSArray*)protocolsForNames: (NSArray*)protocolNames
 {
-	SCKProtocol *protocol = [[self collection] protocolForName: protocolName];
-	SCKMethod *method = nil;
-	
-	if (isRequired)
+	NSMutableArray *protocols = [NSMutableArray arrayWithCapacity: [protocolNames count]];
+
+	for (NSString *protocolName in protocolNames)
+	{
+		[protocols addObject: [[self collection] protocolForName: protocolName]];
+	}
+	return protocols;
+}
+
+- (void)setAdoptedProtocols: (NSArray*)protocolNames
+                   forClass: (NSString*)className
+                   category: (NSString*)categoryName
+{
+	SCKClass *class = [[self collection] classForName: className];
+
+	if (nil == categoryName)
 	{
-		method = [[protocol requiredMethods] objectForKey: methodName];
+		[class setAdoptedProtocols: [self protocolsForNames: protocolNames]];
 	}
 	else
 	{
-		method = [[protocol optionalMethods] objectForKey: methodName];
+		[[[class categories] objectForKey: categoryName]
+			setAdoptedProtocols: [self protocolsForNames: protocolNames]];
+	}
+}
+
+- (void)setAdoptedProtocols: (NSArray*)protocolNames
+                forProtocol: (NSString*)protocolName
+{
+	[[[self collection] protocolForName: protocolName]
+		setAdoptedProtocols: [self protocolsForNames: protocolNames]];
+}
+
+- (NSString*)internedOccurrenceString: (NSString*)aString
+{
+	if (nil == aString)
+	{
+		return nil;
+	}
+
+	NSString *interned = [occurrenceStrings member: aString];
+
+	if (nil == interned)
+	{
+		[occurrenceStrings addObject: aString];
+		interned = aString;
 	}
+	return interned;
+}
+
+- (void)recordOccurrenceWithRange: (NSRange)aRange
+                             kind: (SCKOccurrenceKind)aKind
+                             name: (NSString*)aName
+                              USR: (NSString*)aUSR
+                      declaration: (SCKSourceLocation*)aDeclaration
+                       definition: (SCKSourceLocation*)aDefinition
+{
+	[aDeclaration setFile: [self internedOccurrenceString: [aDeclaration file]]];
+	[aDefinition setFile: [self internedOccurrenceString: [aDefinition file]]];
+
+	SCKSymbolOccurrence *occurrence =
+		[[SCKSymbolOccurrence alloc] initWithRange: aRange
+		                                      kind: aKind
+		                                      name: [self internedOccurrenceString: aName]
+		                                       USR: [self internedOccurrenceString: aUSR]
+		                               declaration: aDeclaration
+		                                definition: aDefinition];
+
+	[pendingOccurrences addObject: occurrence];
+}
+
+- (void)startCollectingOccurrences
+{
+	pendingOccurrences = [NSMutableArray new];
+	occurrenceStrings = [NSMutableSet new];
+}
+
+- (void)finishCollectingOccurrences
+{
+	occurrenceIndex = [[SCKOccurrenceIndex alloc] initWithOccurrences: pendingOccurrences];
+	pendingOccurrences = nil;
+	occurrenceStrings = nil;
+}
+
+- (SCKMethod*)setLocation: (SCKSourceLocation*)sourceLocation
+                forMethod: (NSString*)methodName
+         withTypeEncoding: (NSString*)typeEncoding
+            isClassMethod: (BOOL)isClassMethod
+               isRequired: (BOOL)isRequired
+             isDefinition: (BOOL)isDefinition
+               inProtocol: (NSString*)protocolName
+{
+	SCKProtocol *protocol = [[self collection] protocolForName: protocolName];
+	SCKMethodDictionary *methods =
+		(isRequired ? [protocol requiredMethods] : [protocol optionalMethods]);
+	SCKMethod *method = [methods objectForKey: methodName];
 	
 	if (nil == method)
 	{
 		method = [SCKMethod new];
 		[method setName: methodName];
-		[method setTypeEncoding: typeEncoding];
+		[[[self collection] typeTable] setTypeEncoding: typeEncoding ofComponent: method];
 		[method setIsClassMethod: isClassMethod];
 		[method setParent: protocol];
 		
-		if (isRequired)
-		{
-			[[protocol requiredMethods] setObject: method forKey: methodName];
-		}
-		else
-		{
-			[[protocol optionalMethods] setObject: method forKey: methodName];
-		}
+		[methods setObject: method forKey: methodName];
+		[[self collection] addImplementor: protocol ofSelector: methodName];
 	}
 	
 	if (isDefinition)
 	{
 		[method setDefinition: sourceLocation];
+		[methods didParseDefinitionOfMethod: method];
 	}
 	else
 	{
 		[method setDeclaration: sourceLocation];
+		[methods didParseDeclarationOfMethod: method];
 	}
+	return method;
 }
 
-- (void)setLocation: (SCKSourceLocation*)sourceLocation
-        forProperty: (NSString*)propertyName
-   withTypeEncoding: (NSString*)typeEncoding
-         attributes: (CXObjCPropertyAttrKind)attributes
-         isIBOutlet: (BOOL)isIBOutlet
-		 isRequired: (BOOL)isRequired
-         inProtocol: (NSString*)protocolName
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)attributes
+                 isIBOutlet: (BOOL)isIBOutlet
+                 isRequired: (BOOL)isRequired
+                 inProtocol: (NSString*)protocolName
 {
 	SCKProtocol *protocol = [[self collection] protocolForName: protocolName];
 	SCKProperty *property = nil;
@@ -574,7 +702,7 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	{
 		property = [SCKProperty new];
 		[property setName: propertyName];
-		[property setTypeEncoding: typeEncoding];
+		[[[self collection] typeTable] setTypeEncoding: typeEncoding ofComponent: property];
 		[property setParent: protocol];
 		
 		if (isRequired)
@@ -588,15 +716,16 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	}
 	
 	[property setDeclaration: sourceLocation];
+	return property;
 }
 
-- (void)setLocation: (SCKSourceLocation*)sourceLocation
-        forProperty: (NSString*)propertyName
-   withTypeEncoding: (NSString*)typeEncoding
-         attributes: (CXObjCPropertyAttrKind)attributes
-       isDefinition: (BOOL)isDefinition
-            inClass: (NSString*)className
-           category: (NSString*)categoryName
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)attributes
+               isDefinition: (BOOL)isDefinition
+                    inClass: (NSString*)className
+                   category: (NSString*)categoryName
 {
 	SCKClass *class = [[self collection] classForName: className];
 	SCKCategory *category = nil; 
@@ -613,7 +742,7 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	{
 		property = [SCKProperty new];
 		[property setName: propertyName];
-		[property setTypeEncoding: typeEncoding];
+		[[[self collection] typeTable] setTypeEncoding: typeEncoding ofComponent: property];
 		[property setParent: class];
 		
 		[[category properties] addObject: property];
@@ -629,14 +758,350 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	{
 		[property setDeclaration: sourceLocation];
 	}
+	return property;
+}
+
+- (SCKEnumeration*)setLocation: (SCKSourceLocation*)sourceLocation
+                forEnumeration: (NSString*)enumName
+{
+	SCKEnumeration *e = [enumerations objectForKey: enumName];
+
+	if (nil == e)
+	{
+		e = [SCKEnumeration new];
+		e.name = enumName;
+		e.declaration = sourceLocation;
+		[enumerations setObject: e forKey: enumName];
+		[[self collection] addEnumeration: e];
+	}
+	return e;
+}
+
+- (SCKEnumerationValue*)setLocation: (SCKSourceLocation*)sourceLocation
+                forEnumerationValue: (NSString*)valueName
+                   withTypeEncoding: (NSString*)typeEncoding
+                              value: (long long)aValue
+                      inEnumeration: (NSString*)enumName
+{
+	SCKEnumeration *e = [enumerations objectForKey: enumName];
+
+	if (nil == e.typeEncoding)
+	{
+		[[[self collection] typeTable] setTypeEncoding: typeEncoding ofComponent: e];
+	}
+
+	SCKEnumerationValue *v = [e.values objectForKey: valueName];
+
+	if (nil == v)
+	{
+		v = [SCKEnumerationValue new];
+		v.name = valueName;
+		v.declaration = sourceLocation;
+		v.longLongValue = aValue;
+		[e.values setObject: v forKey: valueName];
+	}
+
+	SCKEnumerationValue *ev = [enumerationValues objectForKey: valueName];
+
+	if (ev)
+	{
+		if (ev.longLongValue != v.longLongValue)
+		{
+			[enumerationValues setObject: [NSMutableArray arrayWithObjects: v, ev, nil]
+			                      forKey: valueName];
+		}
+	}
+	else
+	{
+		[enumerationValues setObject: v
+		                      forKey: valueName];
+		[[self collection] addEnumerationValue: v];
+	}
+	return v;
+}
+
+/**
+ * Returns the byte offsets of the comment range start and end, and the file 
+ * that contains the comment.
+ */
+static void getCommentOffsets(CXSourceRange range, CXFile *commentFile, unsigned *start, unsigned *end)
+{
+	clang_getInstantiationLocation(clang_getRangeStart(range), commentFile, 0, 0, start);
+	clang_getInstantiationLocation(clang_getRangeEnd(range), 0, 0, 0, end);
+}
+
+/**
+ * Records the location of the documentation comment attached to the cursor 
+ * declaration. The comment is only parsed if the component documentation is 
+ * requested (see -documentationForCommentAtLocation:length:declaration:).
+ */
+- (void)recordCommentOfCursor: (CXCursor)cursor forComponent: (SCKProgramComponent*)aComponent
+{
+	if (nil == aComponent)
+	{
+		return;
+	}
+
+	CXSourceRange range = clang_Cursor_getCommentRange(cursor);
+
+	// Most declarations have no comment and nothing to remove
+	if (clang_Range_isNull(range) && nil == [aComponent commentLocation])
+	{
+		return;
+	}
+
+	SCKSourceLocation *declaration = [[SCKSourceLocation alloc]
+		initWithClangSourceLocation: clang_getCursorLocation(cursor)];
+
+	if (clang_Range_isNull(range))
+	{
+		[self recordCommentAtLocation: nil length: 0 declaration: declaration forComponent: aComponent];
+		return;
+	}
+
+	CXFile commentFile;
+	unsigned start, end;
+
+	getCommentOffsets(range, &commentFile, &start, &end);
+
+	[self recordCommentAtLocation: [[SCKSourceLocation alloc] initWithClangSourceLocation: clang_getRangeStart(range)]
+	                       length: end - start
+	                  declaration: declaration
+	                 forComponent: aComponent];
+}
+
+/**
+ * Records the comment location for the component, or removes the recorded one
+ * when the comment location is nil.
+ */
+- (void)recordCommentAtLocation: (SCKSourceLocation*)aCommentLocation
+                         length: (NSUInteger)aLength
+                    declaration: (SCKSourceLocation*)aDeclarationLocation
+                   forComponent: (SCKProgramComponent*)aComponent
+{
+	if (nil == aComponent)
+	{
+		return;
+	}
+
+	if (nil == aCommentLocation)
+	{
+		/* The comment was removed, unless it is attached to a redeclaration
+		   in another file */
+		if ([[[aComponent commentLocation] file] isEqualToString: [aDeclarationLocation file]])
+		{
+			[aComponent setCommentLocation: nil length: 0 declaration: nil source: nil];
+		}
+		return;
+	}
+
+	[aComponent setCommentLocation: aCommentLocation
+	                        length: aLength
+	                   declaration: aDeclarationLocation
+	                        source: self];
+}
+
+- (NSData *)contentsOfFile: (NSString *)aPath
+{
+	if (nil != source && [aPath isEqualToString: fileName])
+	{
+		return [self sourceContents];
+	}
+	return [[[[self collection] files] objectForKey: [aPath stringByStandardizingPath]] sourceContents];
+}
+
+- (NSAttributedString *)documentationForCommentAtLocation: (SCKSourceLocation *)aCommentLocation
+                                                   length: (NSUInteger)aLength
+                                              declaration: (SCKSourceLocation *)aDeclarationLocation
+{
+	NSString *html = nil;
+
+	[translationUnitLock lock];
+	CXFile declarationFile = (translationUnit != 0 ?
+		clang_getFile(translationUnit, [[aDeclarationLocation file] UTF8String]) : NULL);
+
+	if (NULL != declarationFile)
+	{
+		CXCursor cursor = clang_getCursor(translationUnit, clang_getLocationForOffset(translationUnit,
+			declarationFile, (unsigned)[aDeclarationLocation offset]));
+		CXFile commentFile = NULL;
+		unsigned start = 0, end = 0;
+
+		getCommentOffsets(clang_Cursor_getCommentRange(cursor), &commentFile, &start, &end);
+
+		/* The translation unit can have been reparsed after editing since the 
+		   comment was recorded */
+		SCOPED_STR(commentFileName, clang_getFileName(commentFile));
+		BOOL isRecordedComment = (commentFileName != NULL && start == [aCommentLocation offset]
+			&& end - start == aLength && strcmp(commentFileName, [[aCommentLocation file] UTF8String]) == 0);
+
+		if (isRecordedComment)
+		{
+			SCOPED_STR(htmlString, clang_FullComment_getAsHTML(clang_Cursor_getParsedComment(cursor)));
+
+			if (htmlString != NULL && *htmlString != '\0')
+			{
+				html = [NSString stringWithUTF8String: htmlString];
+			}
+		}
+	}
+	[translationUnitLock unlock];
+
+	if (nil == html)
+	{
+		return nil;
+	}
+	return [[NSAttributedString alloc] initWithHTML: [html dataUsingEncoding: NSUTF8StringEncoding]
+	                             documentAttributes: NULL];
+}
+
+/**
+ * Returns the location of the cursor, or nil for a cursor that is not in a 
+ * file (e.g. a builtin type).
+ */
+static SCKSourceLocation *locationOfCursor(CXCursor cursor)
+{
+	CXFile locationFile = NULL;
+
+	clang_getInstantiationLocation(clang_getCursorLocation(cursor), &locationFile, 0, 0, 0);
+	if (NULL == locationFile)
+	{
+		return nil;
+	}
+	return [[SCKSourceLocation alloc] initWithClangSourceLocation: clang_getCursorLocation(cursor)];
+}
+
+/**
+ * Records the occurrence of the cursor when it is a declaration or a
+ * reference, and returns whether its extent starts in the main file.
+ *
+ * The locations of the referenced symbols are computed once per USR, then
+ * shared by the occurrences through the given dictionary.
+ */
+static BOOL recordOccurrenceOfCursor(CXCursor cursor, CXFile mainFile,
+	id <SCKIndexSink> sink, NSMutableDictionary *locationsByUSR)
+{
+	CXSourceRange extent = clang_getCursorExtent(cursor);
+	CXFile cursorFile = NULL;
+	unsigned start = 0, end = 0;
+
+	clang_getInstantiationLocation(clang_getRangeStart(extent), &cursorFile, 0, 0, &start);
+	if (cursorFile != mainFile)
+	{
+		return NO;
+	}
+	clang_getInstantiationLocation(clang_getRangeEnd(extent), 0, 0, 0, &end);
+
+	enum CXCursorKind kind = clang_getCursorKind(cursor);
+	BOOL isDeclaration = clang_isDeclaration(kind);
+	BOOL isReference = (clang_isReference(kind)
+		|| CXCursor_DeclRefExpr == kind || CXCursor_MemberRefExpr == kind
+		|| CXCursor_ObjCMessageExpr == kind);
+	CXCursor referenced = (isDeclaration ? cursor : clang_getCursorReferenced(cursor));
+
+	if ((!isDeclaration && !isReference) || end <= start || clang_Cursor_isNull(referenced))
+	{
+		return YES;
+	}
+
+	SCOPED_STR(name, clang_getCursorSpelling(referenced));
+	SCOPED_STR(usr, clang_getCursorUSR(referenced));
+	NSString *USR = ((NULL != usr && '\0' != usr[0]) ? [NSString stringWithUTF8String: usr] : nil);
+	NSArray *locations = (nil != USR ? [locationsByUSR objectForKey: USR] : nil);
+	SCKOccurrenceKind occurrenceKind = SCKOccurrenceKindReference;
+
+	if (NULL == name || '\0' == name[0])
+	{
+		return YES;
+	}
+	if (nil == locations)
+	{
+		CXCursor definition = clang_getCursorDefinition(referenced);
+		id declarationLocation = locationOfCursor(referenced);
+		id definitionLocation = (clang_Cursor_isNull(definition) ? nil : locationOfCursor(definition));
+
+		locations = A((nil != declarationLocation ? declarationLocation : [NSNull null]),
+		              (nil != definitionLocation ? definitionLocation : [NSNull null]));
+		if (nil != USR)
+		{
+			[locationsByUSR setObject: locations forKey: USR];
+		}
+	}
+	if (isDeclaration)
+	{
+		occurrenceKind = (clang_isCursorDefinition(cursor) ?
+			SCKOccurrenceKindDefinition : SCKOccurrenceKindDeclaration);
+	}
+
+	id declaration = [locations objectAtIndex: 0];
+	id definition = [locations objectAtIndex: 1];
+
+	[sink recordOccurrenceWithRange: NSMakeRange(start, end - start)
+	                           kind: occurrenceKind
+	                           name: [NSString stringWithUTF8String: name]
+	                            USR: USR
+	                    declaration: (declaration != [NSNull null] ? declaration : nil)
+	                     definition: (definition != [NSNull null] ? definition : nil)];
+	return YES;
+}
+
+/**
+ * Records the declarations and references of the cursor and its descendants
+ * whose extent starts in the file, along with the symbol they declare or
+ * refer to.
+ *
+ * The declarations in the included files are skipped with their children.
+ */
+- (void)recordOccurrencesOfCursor: (CXCursor)aCursor
+                         withSink: (id <SCKIndexSink>)sink
+                        locations: (NSMutableDictionary*)locationsByUSR
+{
+	CXFile mainFile = file;
+
+	if (NULL == mainFile || !recordOccurrenceOfCursor(aCursor, mainFile, sink, locationsByUSR))
+	{
+		return;
+	}
+	clang_visitChildrenWithBlock(aCursor,
+		^ enum CXChildVisitResult (CXCursor cursor, CXCursor parent)
+		{
+			return (recordOccurrenceOfCursor(cursor, mainFile, sink, locationsByUSR) ?
+				CXChildVisit_Recurse : CXChildVisit_Continue);
+		});
 }
 
 - (void)rebuildIndex
 {
+	[declaredClasses removeAllObjects];
+	[declaredFunctions removeAllObjects];
+	[declaredGlobals removeAllObjects];
+
 	if (0 == translationUnit) { return; }
+	/* The worker processes record the program components to collect them in
+	   the process that requested the parse.  In process, they are recorded 
+	   too and replayed once the translation unit has been walked, so snapshot 
+	   readers are only locked out during the replay. */
+	SCKIndexRecordWriter *writer = nil;
+	id <SCKIndexSink> sink = indexRecorder;
+
+	if (nil == sink)
+	{
+		writer = [SCKIndexRecordWriter new];
+		sink = [[SCKIndexRecorder alloc] initWithWriter: writer];
+	}
+	// The occurrences belong to the receiver, so they don't need to be replayed
+	id <SCKIndexSink> occurrenceSink = (nil != indexRecorder ? (id <SCKIndexSink>)indexRecorder : self);
+	NSMutableDictionary *occurrenceLocations = [NSMutableDictionary new];
+
+	[self startCollectingOccurrences];
 	clang_visitChildrenWithBlock(clang_getTranslationUnitCursor(translationUnit),
 		^ enum CXChildVisitResult (CXCursor cursor, CXCursor parent)
 		{
+			// The occurrences are collected in the same pass as the components
+			[self recordOccurrencesOfCursor: cursor
+			                       withSink: occurrenceSink
+			                      locations: occurrenceLocations];
+
 			switch(cursor.kind)
 			{
 				default:
@@ -654,6 +1119,7 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 						initWithClangSourceLocation: clang_getCursorLocation(cursor)];
 					SCOPED_STR(className, clang_getCursorSpelling(cursor));
 					NSString __block *superclassName = nil;
+					NSMutableArray *protocolNames = [NSMutableArray array];
 					BOOL __block isForwardDeclaration = NO;
 
 					clang_visitChildrenWithBlock(cursor,
@@ -672,6 +1138,12 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 								superclassName = [NSString stringWithUTF8String: name];
 								break;
 							}
+							case CXCursor_ObjCProtocolRef:
+							{
+								SCOPED_STR(name, clang_getCursorSpelling(classCursor));
+								[protocolNames addObject: [NSString stringWithUTF8String: name]];
+								break;
+							}
 							case CXCursor_ObjCIvarDecl:
 							{
 								SCOPED_STR(name, clang_getCursorSpelling(classCursor));
@@ -679,11 +1151,12 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 								SCKSourceLocation *sourceLocation = [[SCKSourceLocation alloc]
 									initWithClangSourceLocation: clang_getCursorLocation(classCursor)];
 									
-								[self setLocation: sourceLocation
-								          forIvar: [NSString stringWithUTF8String: name]
-								 withTypeEncoding: [NSString stringWithUTF8String: typeEncoding]
-								       isIBOutlet: isIBOutletFromPropertyOrIvar(classCursor)
-								          inClass: [NSString stringWithUTF8String: className]];
+								SCKIvar *ivar = [sink setLocation: sourceLocation
+								                          forIvar: [NSString stringWithUTF8String: name]
+								                 withTypeEncoding: [NSString stringWithUTF8String: typeEncoding]
+								                       isIBOutlet: isIBOutletFromPropertyOrIvar(classCursor)
+								                          inClass: [NSString stringWithUTF8String: className]];
+								[sink recordCommentOfCursor: classCursor forComponent: ivar];
 								break;
 							}
 							case CXCursor_ObjCPropertyDecl:
@@ -697,12 +1170,13 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 								attributes = clang_Cursor_getObjCPropertyAttributes(classCursor, 0);
 #endif
 
-								[self setLocation: sourceLocation
-								      forProperty: [NSString stringWithUTF8String: name]
-								 withTypeEncoding: [NSString stringWithUTF8String: type]
-								       attributes: attributes
-								       isIBOutlet: isIBOutletFromPropertyOrIvar(classCursor)
-								          inClass: [NSString stringWithUTF8String: className]];
+								SCKProperty *property = [sink setLocation: sourceLocation
+								                              forProperty: [NSString stringWithUTF8String: name]
+								                         withTypeEncoding: [NSString stringWithUTF8String: type]
+								                               attributes: attributes
+								                               isIBOutlet: isIBOutletFromPropertyOrIvar(classCursor)
+								                                  inClass: [NSString stringWithUTF8String: className]];
+								[sink recordCommentOfCursor: classCursor forComponent: property];
 								break;
 							}
 							case CXCursor_ObjCInstanceMethodDecl:
@@ -713,13 +1187,14 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 								SCKSourceLocation *sourceLocation = [[SCKSourceLocation alloc]
 									initWithClangSourceLocation: clang_getCursorLocation(classCursor)];
 								
-								[self setLocation: sourceLocation
-								        forMethod: [NSString stringWithUTF8String: name]
-								 withTypeEncoding: [NSString stringWithUTF8String: type]
-								    isClassMethod: (classCursor.kind == CXCursor_ObjCClassMethodDecl)
-								     isDefinition: clang_isCursorDefinition(classCursor)
-								          inClass: [NSString stringWithUTF8String: className]
-								         category: nil];
+								SCKMethod *method = [sink setLocation: sourceLocation
+								                            forMethod: [NSString stringWithUTF8String: name]
+								                     withTypeEncoding: [NSString stringWithUTF8String: type]
+								                        isClassMethod: (classCursor.kind == CXCursor_ObjCClassMethodDecl)
+								                         isDefinition: clang_isCursorDefinition(classCursor)
+								                              inClass: [NSString stringWithUTF8String: className]
+								                             category: nil];
+								[sink recordCommentOfCursor: classCursor forComponent: method];
 								break;
 							}
 							default:
@@ -732,11 +1207,18 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 					   CXCursor_ObjCInterfaceDecl refers to a @interface or 
 					   @class declaration, and also to get the superclass and 
 					   protocol references. */
-					[self setLocation: classLoc
-					         forClass: [NSString stringWithUTF8String: className]
-					   withSuperclass: superclassName
-					     isDefinition: clang_isCursorDefinition(cursor)
-						isForwardDeclaration: isForwardDeclaration];
+					SCKClass *class = [sink setLocation: classLoc
+					                           forClass: [NSString stringWithUTF8String: className]
+					                     withSuperclass: superclassName
+					                       isDefinition: clang_isCursorDefinition(cursor)
+					               isForwardDeclaration: isForwardDeclaration];
+					[sink recordCommentOfCursor: cursor forComponent: class];
+					if (!isForwardDeclaration)
+					{
+						[sink setAdoptedProtocols: protocolNames
+						                 forClass: [NSString stringWithUTF8String: className]
+						                 category: nil];
+					}
 					break;
 				}
 				case CXCursor_ObjCImplementationDecl:
@@ -745,11 +1227,12 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 						initWithClangSourceLocation: clang_getCursorLocation(cursor)];
 					SCOPED_STR(className, clang_getCursorSpelling(cursor));
 
-					[self setLocation: classLoc
-					         forClass: [NSString stringWithUTF8String: className]
-					   withSuperclass: nil
-					     isDefinition: clang_isCursorDefinition(cursor)
-						 isForwardDeclaration: NO];
+					SCKClass *class = [sink setLocation: classLoc
+					                           forClass: [NSString stringWithUTF8String: className]
+					                     withSuperclass: nil
+					                       isDefinition: clang_isCursorDefinition(cursor)
+					               isForwardDeclaration: NO];
+					[sink recordCommentOfCursor: cursor forComponent: class];
 					
 					clang_visitChildrenWithBlock(cursor,
 						^ enum CXChildVisitResult (CXCursor classCursor, CXCursor parent)
@@ -765,13 +1248,14 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 							SCKSourceLocation *l = [[SCKSourceLocation alloc]
 								initWithClangSourceLocation: clang_getCursorLocation(classCursor)];
 
-							[self setLocation: l
-							        forMethod: [NSString stringWithUTF8String: methodName]
-							 withTypeEncoding: [NSString stringWithUTF8String: type]
-							    isClassMethod: (classCursor.kind == CXCursor_ObjCClassMethodDecl)
-							     isDefinition: clang_isCursorDefinition(classCursor)
-							          inClass: [NSString stringWithUTF8String: className]
-							         category: nil];
+							SCKMethod *method = [sink setLocation: l
+							                            forMethod: [NSString stringWithUTF8String: methodName]
+							                     withTypeEncoding: [NSString stringWithUTF8String: type]
+							                        isClassMethod: (classCursor.kind == CXCursor_ObjCClassMethodDecl)
+							                         isDefinition: clang_isCursorDefinition(classCursor)
+							                              inClass: [NSString stringWithUTF8String: className]
+							                             category: nil];
+							[sink recordCommentOfCursor: classCursor forComponent: method];
 						}
 						return CXChildVisit_Continue;
 					});
@@ -785,16 +1269,25 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 					SCOPED_STR(categoryName, clang_getCursorSpelling(cursor));
 					NSString *className = classNameFromCategory(cursor);
 
-					[self setLocation: categoryLoc
-					      forCategory: [NSString stringWithUTF8String: categoryName]
-					     isDefinition: clang_isCursorDefinition(cursor)
-					          ofClass: className];
+					SCKCategory *category = [sink setLocation: categoryLoc
+					                              forCategory: [NSString stringWithUTF8String: categoryName]
+					                             isDefinition: clang_isCursorDefinition(cursor)
+					                                  ofClass: className];
+					[sink recordCommentOfCursor: cursor forComponent: category];
+
+					NSMutableArray *protocolNames = [NSMutableArray array];
 
 					clang_visitChildrenWithBlock(cursor,
 						^ enum CXChildVisitResult (CXCursor categoryCursor, CXCursor parent)
 					{
 						switch (categoryCursor.kind)
 						{
+							case CXCursor_ObjCProtocolRef:
+							{
+								SCOPED_STR(name, clang_getCursorSpelling(categoryCursor));
+								[protocolNames addObject: [NSString stringWithUTF8String: name]];
+								break;
+							}
 							case CXCursor_ObjCInstanceMethodDecl:
 							case CXCursor_ObjCClassMethodDecl:
 							{
@@ -803,13 +1296,14 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 								SCOPED_STR(name, clang_getCursorSpelling(categoryCursor));
 								SCOPED_STR(type, clang_getDeclObjCTypeEncoding(categoryCursor));
 
-								[self setLocation: sourceLocation
-								        forMethod: [NSString stringWithUTF8String: name]
-								 withTypeEncoding: [NSString stringWithUTF8String: type]
-								    isClassMethod: (CXCursor_ObjCClassMethodDecl == categoryCursor.kind)
-						    		     isDefinition: clang_isCursorDefinition(cursor)
-								          inClass: className
-							  	         category: [NSString stringWithUTF8String: categoryName]];
+								SCKMethod *method = [sink setLocation: sourceLocation
+								                            forMethod: [NSString stringWithUTF8String: name]
+								                     withTypeEncoding: [NSString stringWithUTF8String: type]
+								                        isClassMethod: (CXCursor_ObjCClassMethodDecl == categoryCursor.kind)
+								                         isDefinition: clang_isCursorDefinition(cursor)
+								                              inClass: className
+								                             category: [NSString stringWithUTF8String: categoryName]];
+								[sink recordCommentOfCursor: categoryCursor forComponent: method];
 								
 								break;
 							}
@@ -824,13 +1318,14 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 #if CINDEX_VERSION >= 21
 								attributes = clang_Cursor_getObjCPropertyAttributes(categoryCursor, 0);
 #endif
-								[self setLocation: sourceLocation
-								      forProperty: [NSString stringWithUTF8String: name]
-								 withTypeEncoding: [NSString stringWithUTF8String: type]
-								       attributes: attributes
-								     isDefinition: clang_isCursorDefinition(cursor)
-								          inClass: className
-								         category: [NSString stringWithUTF8String: categoryName]];
+								SCKProperty *property = [sink setLocation: sourceLocation
+								                              forProperty: [NSString stringWithUTF8String: name]
+								                         withTypeEncoding: [NSString stringWithUTF8String: type]
+								                               attributes: attributes
+								                             isDefinition: clang_isCursorDefinition(cursor)
+								                                  inClass: className
+								                                 category: [NSString stringWithUTF8String: categoryName]];
+								[sink recordCommentOfCursor: categoryCursor forComponent: property];
 								break;
 
 							}
@@ -839,6 +1334,13 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
  						}
 						return CXChildVisit_Continue;
 					});
+					// Only the category interface lists the adopted protocols
+					if (CXCursor_ObjCCategoryDecl == cursor.kind)
+					{
+						[sink setAdoptedProtocols: protocolNames
+						                 forClass: className
+						                 category: [NSString stringWithUTF8String: categoryName]];
+					}
 					break;
 				}
 				case CXCursor_ObjCProtocolDecl:
@@ -850,10 +1352,13 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 
 					// NOTE: We could use CXCursor_ObjCProtocolDecl to parse protocol
 					// forward declarations as we do with CXCursor_ObjCClassDecl
-					[self setLocation: sourceLocation
-					      forProtocol: [NSString stringWithUTF8String: protocolName]
-						isForwardDeclaration: (clang_isCursorDefinition(cursor) == NO)];
+					SCKProtocol *protocol = [sink setLocation: sourceLocation
+					                              forProtocol: [NSString stringWithUTF8String: protocolName]
+					                     isForwardDeclaration: (clang_isCursorDefinition(cursor) == NO)];
+					[sink recordCommentOfCursor: cursor forComponent: protocol];
 					
+					NSMutableArray *protocolNames = [NSMutableArray array];
+
 					clang_visitChildrenWithBlock(cursor,
 						^enum CXChildVisitResult(CXCursor protocolCursor, CXCursor parent)
 					{
@@ -865,6 +1370,15 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 								
 						switch (protocolCursor.kind)
 						{
+							case CXCursor_ObjCProtocolRef:
+							{
+								// Protocol references in method types are visited too
+								if (clang_equalCursors(parent, cursor))
+								{
+									[protocolNames addObject: [NSString stringWithUTF8String: name]];
+								}
+								break;
+							}
 							case CXCursor_ObjCPropertyDecl:
 							{
 								CXObjCPropertyAttrKind attributes = 0;
@@ -874,13 +1388,14 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 #else
 #warning Your libclang does not support checking for optional property declarations
 #endif
-								[self setLocation: location
-								      forProperty: [NSString stringWithUTF8String: name]
-								 withTypeEncoding: [NSString stringWithUTF8String: type]
-								       attributes: attributes
-								       isIBOutlet: (CXCursor_IBOutletAttr == protocolCursor.kind)
-									   isRequired: isRequired
-								       inProtocol: [NSString stringWithUTF8String: protocolName]];
+								SCKProperty *property = [sink setLocation: location
+								                              forProperty: [NSString stringWithUTF8String: name]
+								                         withTypeEncoding: [NSString stringWithUTF8String: type]
+								                               attributes: attributes
+								                               isIBOutlet: (CXCursor_IBOutletAttr == protocolCursor.kind)
+								                               isRequired: isRequired
+								                               inProtocol: [NSString stringWithUTF8String: protocolName]];
+								[sink recordCommentOfCursor: protocolCursor forComponent: property];
 
 								break;
 							}
@@ -892,13 +1407,14 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 #else
 #warning Your libclang does not support checking for optional method declarations
 #endif
-								[self setLocation: location
-								        forMethod: [NSString stringWithUTF8String: name]
-								 withTypeEncoding: [NSString stringWithUTF8String: type]
-								    isClassMethod: (CXCursor_ObjCClassMethodDecl == protocolCursor.kind)
-									   isRequired: isRequired
-								     isDefinition: clang_isCursorDefinition(protocolCursor)
-								       inProtocol: [NSString stringWithUTF8String: protocolName]];
+								SCKMethod *method = [sink setLocation: location
+								                            forMethod: [NSString stringWithUTF8String: name]
+								                     withTypeEncoding: [NSString stringWithUTF8String: type]
+								                        isClassMethod: (CXCursor_ObjCClassMethodDecl == protocolCursor.kind)
+								                           isRequired: isRequired
+								                         isDefinition: clang_isCursorDefinition(protocolCursor)
+								                           inProtocol: [NSString stringWithUTF8String: protocolName]];
+								[sink recordCommentOfCursor: protocolCursor forComponent: method];
 										
 								break;
 							}
@@ -907,6 +1423,11 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 						}
 						return CXChildVisit_Recurse;
 					});
+					if (clang_isCursorDefinition(cursor))
+					{
+						[sink setAdoptedProtocols: protocolNames
+						              forProtocol: [NSString stringWithUTF8String: protocolName]];
+					}
 					break;
 				}
 				case CXCursor_FunctionDecl:
@@ -924,11 +1445,12 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 						break;
 					}
 
-					[self setLocation: l
-					      forFunction: [NSString stringWithUTF8String: name]
-					 withTypeEncoding: [NSString stringWithUTF8String: type]
-					         isStatic: (linkage == CXLinkage_Internal)
-					     isDefinition: clang_isCursorDefinition(cursor)];
+					SCKFunction *function = [sink setLocation: l
+					                              forFunction: [NSString stringWithUTF8String: name]
+					                         withTypeEncoding: [NSString stringWithUTF8String: type]
+					                                 isStatic: (linkage == CXLinkage_Internal)
+					                             isDefinition: clang_isCursorDefinition(cursor)];
+					[sink recordCommentOfCursor: cursor forComponent: function];
 					break;
 				}
 				case CXCursor_VarDecl:
@@ -944,10 +1466,11 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 						STACK_SCOPED SCKSourceLocation *l = [[SCKSourceLocation alloc]
 							initWithClangSourceLocation: clang_getCursorLocation(cursor)];
 
-						[self setLocation: l
-						      forVariable: [NSString stringWithUTF8String: name]
-						 withTypeEncoding: [NSString stringWithUTF8String: type]
-						     isDefinition: clang_isCursorDefinition(cursor)];
+						SCKGlobal *global = [sink setLocation: l
+						                          forVariable: [NSString stringWithUTF8String: name]
+						                     withTypeEncoding: [NSString stringWithUTF8String: type]
+						                         isDefinition: clang_isCursorDefinition(cursor)];
+						[sink recordCommentOfCursor: cursor forComponent: global];
 					}
 					break;
 				}
@@ -958,66 +1481,42 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 					SCKSourceLocation *sourceLocation = [[SCKSourceLocation alloc]
 						initWithClangSourceLocation:clang_getCursorLocation(cursor)];
 
-					[self setLocation: sourceLocation
-					         forMacro: [NSString stringWithUTF8String: macroName]];
+					SCKMacro *macro = [sink setLocation: sourceLocation
+					                           forMacro: [NSString stringWithUTF8String: macroName]];
+					[sink recordCommentOfCursor: cursor forComponent: macro];
 					break;
 				}
 				case CXCursor_EnumDecl:
 				{
 					SCOPED_STR(enumName, clang_getCursorSpelling(cursor));
 					NSString *name = [NSString stringWithUTF8String: enumName];
-					SCKEnumeration *e = [enumerations objectForKey: name];
-					__block BOOL foundType;
-					if (e == nil)
-					{
-						e = [SCKEnumeration new];
-						foundType = NO;
-						e.name = name;
-						e.declaration = [[SCKSourceLocation alloc] initWithClangSourceLocation: clang_getCursorLocation(cursor)];
-						[enumerations setObject: e forKey: name];
-						[[self collection] addEnumeration: e];
-					}
-					else
-					{
-						foundType = e.typeEncoding != nil;
-					}
+					SCKSourceLocation *l = [[SCKSourceLocation alloc]
+						initWithClangSourceLocation: clang_getCursorLocation(cursor)];
+					__block NSString *type = nil;
+
+					SCKEnumeration *e = [sink setLocation: l forEnumeration: name];
+					[sink recordCommentOfCursor: cursor forComponent: e];
 					clang_visitChildrenWithBlock(cursor,
 						^ enum CXChildVisitResult (CXCursor enumCursor, CXCursor parent)
 					{
 						if (enumCursor.kind == CXCursor_EnumConstantDecl)
 						{
-							if (!foundType)
+							// The enumeration type is taken from its first value
+							if (nil == type)
 							{
-								SCOPED_STR(type, clang_getDeclObjCTypeEncoding(enumCursor));
-								foundType = YES;
-								e.typeEncoding = [NSString stringWithUTF8String: type];
+								SCOPED_STR(typeEncoding, clang_getDeclObjCTypeEncoding(enumCursor));
+								type = [NSString stringWithUTF8String: typeEncoding];
 							}
 							SCOPED_STR(valName, clang_getCursorSpelling(enumCursor));
-							NSString *vName = [NSString stringWithUTF8String: valName];
-							SCKEnumerationValue *v = [e.values objectForKey: vName];
-							if (nil == v)
-							{
-								v = [SCKEnumerationValue new];
-								v.name = vName;
-								v.declaration = [[SCKSourceLocation alloc] initWithClangSourceLocation: clang_getCursorLocation(enumCursor)];
-								v.longLongValue = clang_getEnumConstantDeclValue(enumCursor);
-								[e.values setObject: v forKey: vName];
-							}
-							SCKEnumerationValue *ev = [enumerationValues objectForKey: vName];
-							if (ev)
-							{
-								if (ev.longLongValue != v.longLongValue)
-								{
-									[enumerationValues setObject: [NSMutableArray arrayWithObjects: v, ev, nil]
-									                      forKey: vName];
-								}
-							}
-							else
-							{
-								[enumerationValues setObject: v
-								                      forKey: vName];
-								[[self collection] addEnumerationValue: v];
-							}
+							SCKSourceLocation *valueLoc = [[SCKSourceLocation alloc]
+								initWithClangSourceLocation: clang_getCursorLocation(enumCursor)];
+
+							SCKEnumerationValue *v = [sink setLocation: valueLoc
+							                       forEnumerationValue: [NSString stringWithUTF8String: valName]
+							                          withTypeEncoding: type
+							                                     value: clang_getEnumConstantDeclValue(enumCursor)
+							                             inEnumeration: name];
+							[sink recordCommentOfCursor: enumCursor forComponent: v];
 						}
 						return CXChildVisit_Continue;
 					});
@@ -1034,30 +1533,134 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 			//return CXChildVisit_Recurse;
 			return CXChildVisit_Continue;
 		});
+	[self finishCollectingOccurrences];
+
+	if (nil == writer)
+		return;
+
+	SCKIndexRecordReader *reader = [[SCKIndexRecordReader alloc] initWithData: [writer data]];
+
+	// Snapshot readers must not see the components half updated
+	[[self collection] lockComponents];
+	BOOL isValid = [self replayIndexRecordsOfReader: reader parsedFileStates: nil isParsed: NULL];
+	[[self collection] unlockComponents];
+
+	if (!isValid)
+	{
+		NSLog(@"WARNING: malformed index records for %@", fileName);
+	}
 }
 - (id)initUsingIndex: (SCKIndex*)anIndex
 {
 	idx = (SCKClangIndex*)anIndex;
 	NSAssert([idx isKindOfClass: [SCKClangIndex class]],
 			@"Initializing SCKClangSourceFile with incorrect kind of index");
-	args = [idx.defaultArguments mutableCopy];
 	functions = [NSMutableDictionary new];
 	macros = [NSMutableDictionary new];
 	enumerations = [NSMutableDictionary new];
 	enumerationValues = [NSMutableDictionary new];
+	declaredClasses = [NSMutableDictionary new];
+	declaredFunctions = [NSMutableDictionary new];
+	declaredGlobals = [NSMutableDictionary new];
+	translationUnitLock = [NSRecursiveLock new];
 	return self;
 }
 - (void)addIncludePath: (NSString*)includePath
 {
+	if (nil == args)
+	{
+		args = [idx.defaultArguments mutableCopy];
+	}
 	[args addObject: [NSString stringWithFormat: @"-I%@", includePath]];
 	// After we've added an include path, we may change how the file is parsed,
 	// so parse it again, if required
+	[translationUnitLock lock];
+	BOOL wasParsed = (NULL != translationUnit || nil != parsedFileStates);
+
+	[self disposeTranslationUnit];
+	parsedFileStates = nil;
+	if (wasParsed)
+	{
+		[self reparse];
+	}
+	[translationUnitLock unlock];
+}
+
+/**
+ * Disposes the translation unit and the libclang results computed against it.
+ *
+ * The program components and the parsed file states are kept.
+ */
+- (void)disposeTranslationUnit
+{
+	[translationUnitLock lock];
+	completionSession = nil;
+	speculativeSession = nil;
 	if (NULL != translationUnit)
 	{
 		clang_disposeTranslationUnit(translationUnit);
 		translationUnit = NULL;
-		[self reparse];
 	}
+	file = NULL;
+	[translationUnitLock unlock];
+}
+
+- (void)setIsIndexOnly: (BOOL)indexOnly
+{
+	INVALIDARG_EXCEPTION_TEST(indexOnly, !indexOnly || nil == source);
+
+	[translationUnitLock lock];
+	isIndexOnly = indexOnly;
+	if (isIndexOnly)
+	{
+		[self disposeTranslationUnit];
+	}
+	[translationUnitLock unlock];
+}
+
+- (void)setSource: (NSMutableAttributedString *)aSource
+{
+	if (nil != aSource)
+	{
+		[self setIsIndexOnly: NO];
+	}
+	[super setSource: aSource];
+	// The new source has no diagnostic attributes
+	appliedDiagnosticSet = nil;
+}
+
+- (SCKMemoryUsage*)memoryUsage
+{
+	SCKMemoryUsage *usage = [super memoryUsage];
+	NSUInteger symbolsSize = 0;
+
+	for (NSDictionary *symbols in A(functions, enumerations, macros))
+	{
+		for (SCKProgramComponent *component in [symbols objectEnumerator])
+		{
+			symbolsSize += [component estimatedMemoryUsage];
+		}
+	}
+	symbolsSize += [occurrenceIndex estimatedMemoryUsage];
+	[usage addBytes: symbolsSize forCategory: SCKMemoryUsageSymbolsCategory];
+
+	[translationUnitLock lock];
+	if (NULL != translationUnit)
+	{
+		CXTUResourceUsage tuUsage = clang_getCXTUResourceUsage(translationUnit);
+
+		for (unsigned i=0 ; i<tuUsage.numEntries ; i++)
+		{
+			CXTUResourceUsageEntry entry = tuUsage.entries[i];
+			NSString *category = [NSString stringWithFormat: @"libclang: %s",
+				clang_getTUResourceUsageName(entry.kind)];
+
+			[usage addBytes: entry.amount forCategory: category];
+		}
+		clang_disposeCXTUResourceUsage(tuUsage);
+	}
+	[translationUnitLock unlock];
+	return usage;
 }
 
 - (void)dealloc
@@ -1068,16 +1671,374 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	}
 }
 
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+
+/**
+ * Mixes bytes into a FNV-1a hash.
+ */
+static uint64_t mixBytes(uint64_t hash, const void *bytes, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= ((const unsigned char *)bytes)[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+ * FNV-1a hash.  0 is reserved to mean 'not hashed'.
+ */
+static uint64_t hashBytes(const char *bytes, size_t length)
+{
+	uint64_t hash = mixBytes(FNV_OFFSET_BASIS, bytes, length);
+
+	return (hash == 0 ? 1 : hash);
+}
+
+static uint64_t hashFileAtPath(NSString *aPath)
+{
+	NSData *data = [NSData dataWithContentsOfFile: aPath
+	                                      options: NSDataReadingMappedIfSafe
+	                                        error: NULL];
+	return (nil == data ? 0 : hashBytes([data bytes], [data length]));
+}
+
+/**
+ * State of a file read by the last parse, to tell whether it changed since.
+ */
+struct SCKParsedFileState
+{
+	unsigned long long device;
+	unsigned long long inode;
+	time_t modificationTime;
+	/**
+	 * When the parse started (or the file was last hashed).  Modification 
+	 * times are in seconds, so a file modified during that second could still 
+	 * change without its modification time changing.
+	 */
+	time_t parseTime;
+	/** Content hash, or 0 for system headers that are not hashed. */
+	uint64_t contentHash;
+};
+
+static void recordParsedFileState(CXFile includedFile,
+                                  CXSourceLocation *inclusionStack,
+                                  unsigned inclusionStackLength,
+                                  CXClientData clientData)
+{
+	NSMutableDictionary *states = (__bridge NSMutableDictionary *)clientData;
+	CXFileUniqueID uniqueID;
+
+	if (clang_getFileUniqueID(includedFile, &uniqueID) != 0)
+		return;
+
+	SCOPED_STR(name, clang_getFileName(includedFile));
+	// Standardized as the collection paths the unsaved contents are keyed by
+	NSString *path = [[NSString stringWithUTF8String: name] stringByStandardizingPath];
+	struct SCKParsedFileState state = { uniqueID.data[0], uniqueID.data[1],
+		clang_getFileTime(includedFile), 0, 0 };
+	BOOL isSystemHeader = (inclusionStackLength > 0
+		&& clang_Location_isInSystemHeader(inclusionStack[0]));
+	struct stat st;
+
+	// Don't record a hash for contents that are newer than the parsed ones
+	if (!isSystemHeader && stat(name, &st) == 0 && st.st_mtime == state.modificationTime)
+	{
+		state.contentHash = hashFileAtPath(path);
+	}
+	[states setObject: [NSData dataWithBytes: &state length: sizeof(state)] forKey: path];
+}
+
+/**
+ * Returns whether the file is the same as when it was parsed.
+ *
+ * The modification time is only trusted when it is older than the parse, 
+ * otherwise the file could have been modified again in the same second, and 
+ * the contents are hashed.
+ *
+ * When the file was touched but its contents didn't change, the state is 
+ * updated, so the file is not hashed again by the next check.
+ */
+static BOOL isFileUnchanged(NSString *aPath, NSMutableData *stateData)
+{
+	struct SCKParsedFileState *state = [stateData mutableBytes];
+	time_t now = time(NULL);
+	struct stat st;
+
+	if (stat([aPath fileSystemRepresentation], &st) != 0)
+		return NO;
+
+	if (st.st_dev == state->device && st.st_ino == state->inode
+	 && st.st_mtime == state->modificationTime && st.st_mtime < state->parseTime)
+	{
+		return YES;
+	}
+	if (state->contentHash == 0 || hashFileAtPath(aPath) != state->contentHash)
+		return NO;
+
+	state->device = st.st_dev;
+	state->inode = st.st_ino;
+	state->modificationTime = st.st_mtime;
+	state->parseTime = now;
+	return YES;
+}
+
+/**
+ * Records the state of the main file and of the included files, once the 
+ * translation unit has been parsed from the given main file contents and 
+ * unsaved included file contents, then updates the collection include graph.
+ *
+ * aParseTime is the time before the files were read by the parse.
+ *
+ * For the included files parsed from unsaved contents, the recorded state
+ * only contains the content hash.
+ */
+- (void)recordParsedFileStatesWithMainFileContents: (NSData *)contents
+                                   unsavedContents: (NSDictionary *)unsavedContents
+                                         parseTime: (time_t)aParseTime
+{
+	NSMutableDictionary *states = [NSMutableDictionary new];
+
+	clang_getInclusions(translationUnit, recordParsedFileState, (__bridge void *)states);
+	// The main file is checked against its contents and the header wrapper is 
+	// generated from the file name
+	[states removeObjectForKey: [fileName stringByStandardizingPath]];
+	[states removeObjectForKey: @"/tmp/foo.m"];
+
+	parsedFileStates = [NSMutableDictionary new];
+	for (NSString *path in states)
+	{
+		NSMutableData *stateData = [[states objectForKey: path] mutableCopy];
+		NSData *buffer = [unsavedContents objectForKey: path];
+
+		((struct SCKParsedFileState *)[stateData mutableBytes])->parseTime = aParseTime;
+		if (nil != buffer)
+		{
+			struct SCKParsedFileState *state = [stateData mutableBytes];
+
+			state->modificationTime = -1;
+			state->contentHash = hashBytes([buffer bytes], [buffer length]);
+		}
+		[parsedFileStates setObject: stateData forKey: path];
+	}
+	mainFileContentHash = hashBytes([contents bytes], [contents length]);
+
+	[[self collection] setIncludedFiles: [NSSet setWithArray: [parsedFileStates allKeys]]
+	                            forFile: fileName];
+}
+
+/**
+ * Returns whether the main file contents (-source or the file on disk) and the
+ * included files (unsaved contents or on disk) are the same as for the last 
+ * parse.
+ */
+- (BOOL)isParsedFileUnchangedWithUnsavedContents: (NSDictionary *)unsavedContents
+{
+	// Index-only files dispose the translation unit after each parse
+	if ((NULL == translationUnit && !isIndexOnly) || nil == parsedFileStates)
+		return NO;
+
+	NSData *contents = [self sourceContents];
+	uint64_t contentHash = (nil != source ?
+		hashBytes([contents bytes], [contents length]) : hashFileAtPath(fileName));
+
+	if (contentHash != mainFileContentHash)
+		return NO;
+
+	for (NSString *path in parsedFileStates)
+	{
+		NSMutableData *stateData = [parsedFileStates objectForKey: path];
+		NSData *buffer = [unsavedContents objectForKey: path];
+
+		if (nil != buffer)
+		{
+			const struct SCKParsedFileState *state = [stateData bytes];
+
+			if (hashBytes([buffer bytes], [buffer length]) != state->contentHash)
+				return NO;
+		}
+		else if (!isFileUnchanged(path, stateData))
+		{
+			return NO;
+		}
+	}
+	return YES;
+}
+
+/**
+ * Mixes the declarations of the main file into the interface fingerprint.
+ *
+ * Cursor kinds, names, types and enumeration values are taken into account, 
+ * but not locations, so comments and whitespace are ignored.  Function and 
+ * method bodies are skipped.
+ *
+ * The translation unit is parsed without a detailed preprocessing record, so 
+ * macro definitions and inclusion directives have no cursors.  Instead the 
+ * tokens of every preprocessor directive line in <em>contents</em> (the main 
+ * file as parsed), minus comments, are mixed in.
+ */
+- (void)computeInterfaceFingerprintWithContents: (NSData *)contents
+{
+	if (NULL == translationUnit || NULL == file)
+	{
+		interfaceFingerprint = 0;
+		return;
+	}
+
+	CXTranslationUnit tu = translationUnit;
+	CXFile mainFile = file;
+	uint64_t __block hash = FNV_OFFSET_BASIS;
+	void (^mixString)(CXString) = ^ (CXString str)
+	{
+		const char *cString = clang_getCString(str);
+
+		if (NULL != cString)
+		{
+			hash = mixBytes(hash, cString, strlen(cString) + 1);
+		}
+		clang_disposeString(str);
+	};
+
+	clang_visitChildrenWithBlock(clang_getTranslationUnitCursor(tu),
+		^ enum CXChildVisitResult (CXCursor cursor, CXCursor parent)
+	{
+		CXFile cursorFile;
+		enum CXCursorKind kind = clang_getCursorKind(cursor);
+
+		clang_getInstantiationLocation(clang_getCursorLocation(cursor), &cursorFile, 0, 0, 0);
+
+		if (cursorFile != mainFile || kind == CXCursor_CompoundStmt)
+		{
+			return CXChildVisit_Continue;
+		}
+
+		hash = mixBytes(hash, &kind, sizeof(kind));
+		mixString(clang_getCursorSpelling(cursor));
+
+		if (clang_isDeclaration(kind))
+		{
+			mixString(clang_getDeclObjCTypeEncoding(cursor));
+			mixString(clang_getTypeSpelling(clang_getCursorType(cursor)));
+		}
+		if (kind == CXCursor_EnumConstantDecl)
+		{
+			long long value = clang_getEnumConstantDeclValue(cursor);
+
+			hash = mixBytes(hash, &value, sizeof(value));
+		}
+		return CXChildVisit_Recurse;
+	});
+
+	const char *bytes = [contents bytes];
+	NSUInteger length = [contents length];
+	NSUInteger lineStart = 0;
+
+	while (lineStart < length)
+	{
+		NSUInteger i = lineStart;
+
+		while (i < length && (bytes[i] == ' ' || bytes[i] == '\t'))
+		{
+			i++;
+		}
+
+		BOOL isDirective = (i < length && bytes[i] == '#');
+		NSUInteger directiveStart = i;
+
+		// Find the end of the line, following backslash continuations
+		while (i < length && (bytes[i] != '\n' || (i > lineStart && bytes[i - 1] == '\\')))
+		{
+			i++;
+		}
+		if (isDirective)
+		{
+			CXSourceRange range = clang_getRange(
+				clang_getLocationForOffset(tu, mainFile, (unsigned)directiveStart),
+				clang_getLocationForOffset(tu, mainFile, (unsigned)i));
+			CXToken *tokens;
+			unsigned tokenCount;
+
+			clang_tokenize(tu, range, &tokens, &tokenCount);
+			for (unsigned j = 0; j < tokenCount; j++)
+			{
+				if (clang_getTokenKind(tokens[j]) != CXToken_Comment)
+				{
+					mixString(clang_getTokenSpelling(tu, tokens[j]));
+				}
+			}
+			clang_disposeTokens(tu, tokens, tokenCount);
+		}
+		lineStart = i + 1;
+	}
+	interfaceFingerprint = (hash == 0 ? 1 : hash);
+}
+
+- (void)invalidateIndex
+{
+	needsIndexing = YES;
+}
+
 - (void)reparse
 {
-	//NSLog(@" ---> Parsing %@", [fileName lastPathComponent]);
+	[self reparseWithUnsavedContents: [[self collection] unsavedFileContents]];
+}
+
+/**
+ * Parses the file, reading the files it includes from the given unsaved 
+ * contents when they are present, unless neither the file nor its includes 
+ * changed since the last parse.
+ *
+ * Index-only files are parsed in a worker process when the collection has an 
+ * index worker pool.
+ */
+- (void)reparseWithUnsavedContents: (NSDictionary *)someUnsavedContents
+{
+	[translationUnitLock lock];
+	double start = SCKMetricsNow();
+	SCKMetrics *metrics = [[self collection] metrics];
+	SCKIndexWorkerPool *workerPool = [[self collection] indexWorkerPool];
+	NSMutableDictionary *unsavedContents = [someUnsavedContents mutableCopy];
+
+	[unsavedContents removeObjectForKey: fileName];
+
+	/* Collecting the program components again requires a translation unit, 
+	   which index-only files don't keep */
+	if ([self isParsedFileUnchangedWithUnsavedContents: unsavedContents]
+	 && (!needsIndexing || NULL != translationUnit))
+	{
+		if (needsIndexing)
+		{
+			[[self collection] setIncludedFiles: [NSSet setWithArray: [parsedFileStates allKeys]]
+			                            forFile: fileName];
+			[self rebuildIndex];
+			needsIndexing = NO;
+			[metrics recordDuration: SCKMetricsNow() - start forPhase: SCKMetricPhaseIndex file: fileName];
+			[[self collection] publishSymbolSnapshot];
+		}
+		[translationUnitLock unlock];
+		return;
+	}
+	if (isIndexOnly && nil != workerPool)
+	{
+		[translationUnitLock unlock];
+		[workerPool reparseFiles: [NSArray arrayWithObject: self]];
+		return;
+	}
 
 	const char *fn = [fileName UTF8String];
-	struct CXUnsavedFile unsaved[] = {
-		{fn, [[source string] UTF8String], [source length]},
-		{NULL, NULL, 0}};
-	int unsavedCount = (source == nil) ? 0 : 1;
+	time_t parseTime = time(NULL);
+	NSData *contents = (source == nil ? [NSData dataWithContentsOfFile: fileName] : [self sourceContents]);
+	struct CXUnsavedFile unsaved[[unsavedContents count] + 2];
+	int unsavedCount = 0;
 	const char *mainFile = fn;
+	if (nil != source)
+	{
+		unsaved[unsavedCount].Filename = fn;
+		unsaved[unsavedCount].Contents = [contents bytes];
+		unsaved[unsavedCount].Length = [contents length];
+		unsavedCount++;
+	}
 	if ([@"h" isEqualToString: [fileName pathExtension]])
 	{
 		unsaved[unsavedCount].Filename = "/tmp/foo.m";
@@ -1086,28 +2047,43 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 		mainFile = unsaved[unsavedCount].Filename;
 		unsavedCount++;
 	}
+	// Headers being edited in other files must be seen by this translation unit
+	for (NSString *path in unsavedContents)
+	{
+		NSData *buffer = [unsavedContents objectForKey: path];
+
+		unsaved[unsavedCount].Filename = [path UTF8String];
+		unsaved[unsavedCount].Contents = [buffer bytes];
+		unsaved[unsavedCount].Length = [buffer length];
+		unsavedCount++;
+	}
 	file = NULL;
 	if (NULL == translationUnit)
 	{
-		unsigned argc = (unsigned)[args count];
+		NSArray *arguments = (nil != args ? args : idx.defaultArguments);
+		unsigned argc = (unsigned)[arguments count];
 		const char *argv[argc];
 		int i=0;
-		for (NSString *arg in args)
+		for (NSString *arg in arguments)
 		{
 			argv[i++] = [arg UTF8String];
 		}
+		/* The precompiled preamble and the cached completion results only 
+		   speed up the next reparses and completions */
+		unsigned options = (isIndexOnly ? clang_defaultEditingTranslationUnitOptions()
+			& ~(CXTranslationUnit_PrecompiledPreamble | CXTranslationUnit_CacheCompletionResults)
+			: clang_defaultEditingTranslationUnitOptions());
+
 		translationUnit =
 			//clang_createTranslationUnitFromSourceFile(idx.clangIndex, fn, argc, argv, 0, unsaved);
 			clang_parseTranslationUnit(idx.clangIndex, mainFile, argv, argc, unsaved,
 					unsavedCount,
-					clang_defaultEditingTranslationUnitOptions());
+					options);
 					//CXTranslationUnit_Incomplete);
 		file = clang_getFile(translationUnit, fn);
 	}
 	else
 	{
-		clock_t c1 = clock();
-		//NSLog(@"Reparsing translation unit");
 		if (0 != clang_reparseTranslationUnit(translationUnit, unsavedCount, unsaved, clang_defaultReparseOptions(translationUnit)))
 		{
 			clang_disposeTranslationUnit(translationUnit);
@@ -1117,17 +2093,273 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 		{
 			file = clang_getFile(translationUnit, fn);
 		}
-		clock_t c2 = clock();
-		//NSLog(@"Reparsing took %f seconds.",((double)c2 - (double)c1) / (double)CLOCKS_PER_SEC);
 	}
+	translationUnitVersion++;
+	parsedFileStates = nil;
+	if (NULL != translationUnit)
+	{
+		[self recordParsedFileStatesWithMainFileContents: contents
+		                                 unsavedContents: unsavedContents
+		                                       parseTime: parseTime];
+	}
+
+	double parsed = SCKMetricsNow();
+
+	[metrics recordDuration: parsed - start forPhase: SCKMetricPhaseParse file: fileName];
 	[self rebuildIndex];
+	[self computeInterfaceFingerprintWithContents: contents];
+	needsIndexing = NO;
+	if (isIndexOnly)
+	{
+		[self disposeTranslationUnit];
+	}
+	[metrics recordDuration: SCKMetricsNow() - parsed forPhase: SCKMetricPhaseIndex file: fileName];
+	[translationUnitLock unlock];
+
+	[[self collection] publishSymbolSnapshot];
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: SCKSourceFileDidReparseNotification object: self];
+}
+
+- (NSData *)indexWorkerRequest
+{
+	SCKIndexRecordWriter *writer = [SCKIndexRecordWriter new];
+	NSMutableDictionary *unsavedContents = [[[self collection] unsavedFileContents] mutableCopy];
+
+	[unsavedContents removeObjectForKey: fileName];
+
+	[writer writeString: fileName];
+	// No arguments means the index default arguments
+	[writer writeUnsigned: [args count]];
+	for (NSString *arg in args)
+	{
+		[writer writeString: arg];
+	}
+	[writer writeUnsigned: [unsavedContents count]];
+	for (NSString *path in unsavedContents)
+	{
+		[writer writeString: path];
+		[writer writeData: [unsavedContents objectForKey: path]];
+	}
+	return [writer data];
 }
 
-- (void)lexicalHighlightFile
++ (NSData *)indexWorkerResponseForRequest: (NSData *)aRequest
+                             inCollection: (SCKSourceCollection *)aCollection
 {
-	CXSourceLocation start = clang_getLocation(translationUnit, file, 1, 1);
-	CXSourceLocation end = clang_getLocationForOffset(translationUnit, file, (unsigned int)[source length]);
-	[self highlightRange: clang_getRange(start, end) syntax: NO];
+	SCKIndexRecordReader *reader = [[SCKIndexRecordReader alloc] initWithData: aRequest];
+	NSString *path = [reader readString];
+	NSUInteger argCount = (NSUInteger)[reader readUnsigned];
+	NSMutableArray *arguments = (argCount > 0 ? [NSMutableArray array] : nil);
+
+	for (NSUInteger i = 0; i < argCount && [reader isValid]; i++)
+	{
+		NSString *arg = [reader readString];
+
+		if (nil != arg)
+		{
+			[arguments addObject: arg];
+		}
+	}
+
+	NSUInteger unsavedCount = (NSUInteger)[reader readUnsigned];
+	NSMutableDictionary *unsavedContents = [NSMutableDictionary dictionary];
+
+	for (NSUInteger i = 0; i < unsavedCount && [reader isValid]; i++)
+	{
+		NSString *unsavedPath = [reader readString];
+		NSData *contents = [reader readData];
+
+		if (nil != unsavedPath && nil != contents)
+		{
+			[unsavedContents setObject: contents forKey: unsavedPath];
+		}
+	}
+
+	if (![reader isValid] || nil == path)
+	{
+		return nil;
+	}
+
+	SCKIndexRecordWriter *writer = [SCKIndexRecordWriter new];
+	SCKClangSourceFile *sourceFile = (SCKClangSourceFile *)[self fileUsingIndex:
+		[aCollection indexForFileExtension: [path pathExtension]]];
+
+	[sourceFile setFileName: path];
+	[sourceFile setCollection: aCollection];
+	[sourceFile setIsIndexOnly: YES];
+	sourceFile->args = arguments;
+	sourceFile->indexRecorder = [[SCKIndexRecorder alloc] initWithWriter: writer];
+	[sourceFile reparseWithUnsavedContents: unsavedContents];
+
+	// A failed parse is reported by omitting the parsed file record
+	if (nil != sourceFile->parsedFileStates)
+	{
+		for (NSString *includedPath in sourceFile->parsedFileStates)
+		{
+			[writer writeKind: SCKIndexRecordIncludedFile];
+			[writer writeString: includedPath];
+			[writer writeData: [sourceFile->parsedFileStates objectForKey: includedPath]];
+		}
+		[writer writeKind: SCKIndexRecordParsedFile];
+		[writer writeUnsigned: sourceFile->mainFileContentHash];
+		[writer writeUnsigned: sourceFile->interfaceFingerprint];
+	}
+	// The include graph is tracked by the requesting collection, so a 
+	// long-lived worker collection must not accumulate it
+	[aCollection setIncludedFiles: [NSSet set] forFile: path];
+	return [writer data];
+}
+
+/**
+ * Replays index records written by an SCKIndexRecorder into the receiver, and 
+ * returns NO if they are malformed.
+ *
+ * The states of the included files are added to someStates, and isParsed (if 
+ * not NULL) is set to YES when the parsed file record is found.  These 
+ * records are only written by index workers.
+ *
+ * The components must be locked by the caller.
+ */
+- (BOOL)replayIndexRecordsOfReader: (SCKIndexRecordReader*)reader
+                  parsedFileStates: (NSMutableDictionary*)someStates
+                          isParsed: (BOOL*)isParsed
+{
+	/* Comment records apply to the component of the previous record */
+	SCKProgramComponent *component = nil;
+
+	while (![reader isAtEnd])
+	{
+		enum SCKIndexRecordKind kind = [reader readKind];
+
+		// Program components are collected by the same methods as in-process
+		if ([reader replayRecordOfKind: kind intoSink: self component: &component])
+			continue;
+
+		switch (kind)
+		{
+			case SCKIndexRecordComment:
+			{
+				SCKSourceLocation *commentLocation = [reader readLocation];
+				NSUInteger length = (NSUInteger)[reader readUnsigned];
+				SCKSourceLocation *declaration = [reader readLocation];
+
+				if (![reader isValid])
+					break;
+
+				[self recordCommentAtLocation: commentLocation
+				                       length: length
+				                  declaration: declaration
+				                 forComponent: component];
+				break;
+			}
+			case SCKIndexRecordIncludedFile:
+			{
+				NSString *path = [reader readString];
+				NSData *state = [reader readData];
+
+				if (nil != path && [state length] == sizeof(struct SCKParsedFileState))
+				{
+					[someStates setObject: [state mutableCopy] forKey: path];
+				}
+				break;
+			}
+			case SCKIndexRecordParsedFile:
+			{
+				mainFileContentHash = [reader readUnsigned];
+				interfaceFingerprint = [reader readUnsigned];
+				if (NULL != isParsed)
+				{
+					*isParsed = YES;
+				}
+				break;
+			}
+			default:
+				return NO;
+		}
+	}
+	return [reader isValid];
+}
+
+- (void)reparseWithIndexWorkerResponse: (NSData *)aResponse
+{
+	if (nil == aResponse)
+	{
+		NSLog(@"WARNING: the index worker failed to parse %@", fileName);
+		[translationUnitLock lock];
+		parsedFileStates = nil;
+		[translationUnitLock unlock];
+		return;
+	}
+
+	[translationUnitLock lock];
+	double start = SCKMetricsNow();
+	SCKIndexRecordReader *reader = [[SCKIndexRecordReader alloc] initWithData: aResponse];
+	NSMutableDictionary *states = [NSMutableDictionary new];
+	BOOL isParsed = NO;
+
+	[declaredClasses removeAllObjects];
+	[declaredFunctions removeAllObjects];
+	[declaredGlobals removeAllObjects];
+	[self startCollectingOccurrences];
+	[[self collection] lockComponents];
+	BOOL isMalformed = ![self replayIndexRecordsOfReader: reader
+	                                    parsedFileStates: states
+	                                            isParsed: &isParsed];
+	[[self collection] unlockComponents];
+	[self finishCollectingOccurrences];
+
+	if (isMalformed)
+	{
+		NSLog(@"WARNING: malformed index worker response for %@", fileName);
+		isParsed = NO;
+	}
+	if (!isParsed)
+	{
+		mainFileContentHash = 0;
+		interfaceFingerprint = 0;
+	}
+	translationUnitVersion++;
+	parsedFileStates = (isParsed ? states : nil);
+	needsIndexing = NO;
+	if (isParsed)
+	{
+		[[self collection] setIncludedFiles: [NSSet setWithArray: [parsedFileStates allKeys]]
+		                            forFile: fileName];
+	}
+	[[[self collection] metrics] recordDuration: SCKMetricsNow() - start
+	                                   forPhase: SCKMetricPhaseIndex
+	                                       file: fileName];
+	[translationUnitLock unlock];
+
+	[[self collection] publishSymbolSnapshot];
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: SCKSourceFileDidReparseNotification object: self];
+}
+
+- (NSArray*)declaredClasses
+{
+	return [declaredClasses allValues];
+}
+
+- (NSArray*)declaredFunctions
+{
+	return [declaredFunctions allValues];
+}
+
+- (NSArray*)declaredGlobals
+{
+	return [declaredGlobals allValues];
+}
+
+- (SCKOccurrenceIndex*)occurrenceIndex
+{
+	return occurrenceIndex;
+}
+
+- (unsigned long long)interfaceFingerprint
+{
+	return interfaceFingerprint;
 }
 
 - (void)highlightRange: (CXSourceRange)r syntax: (BOOL)highightSyntax;
@@ -1142,6 +2374,7 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 	}
 	CXToken *tokens;
 	unsigned tokenCount;
+	[translationUnitLock lock];
 	clang_tokenize(translationUnit, r , &tokens, &tokenCount);
 	//NSLog(@"Found %d tokens", tokenCount);
 	if (tokenCount > 0)
@@ -1207,6 +2440,7 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 		clang_disposeTokens(translationUnit, tokens, tokenCount);
 		free(cursors);
 	}
+	[translationUnitLock unlock];
 }
 - (void)syntaxHighlightRange: (NSRange)r
 {
@@ -1214,170 +2448,471 @@ isForwardDeclaration: (BOOL)isForwardDeclaration
 		clang_getLocationForOffset(translationUnit, file, (unsigned int)r.location);
 	CXSourceLocation end = clang_getLocationForOffset(translationUnit, file,
 		(unsigned int)(r.location + r.length));
-	clock_t c1 = clock();
+	double startTime = SCKMetricsNow();
 	[self highlightRange: clang_getRange(start, end) syntax: YES];
-	clock_t c2 = clock();
-	//NSLog(@"Highlighting took %f seconds.", ((double)c2 - (double)c1) / (double)CLOCKS_PER_SEC);
+	[[[self collection] metrics] recordDuration: SCKMetricsNow() - startTime
+	                                   forPhase: SCKMetricPhaseSyntaxHighlight
+	                                       file: fileName];
 }
 - (void)syntaxHighlightFile
 {
 	[self syntaxHighlightRange: NSMakeRange(0, [source length])];
 }
-- (void)collectDiagnostics
+- (SCKDiagnosticSet*)diagnosticSet
 {
-	// NSLog(@"Collecting diagnostics");
+	[translationUnitLock lock];
+	if (nil != diagnosticSet && [diagnosticSet version] == translationUnitVersion)
+	{
+		[translationUnitLock unlock];
+		return diagnosticSet;
+	}
+
 	unsigned diagnosticCount = clang_getNumDiagnostics(translationUnit);
-	// unsigned opts = clang_defaultDiagnosticDisplayOptions();
-	// NSLog(@"%d diagnostics found", diagnosticCount);
+	NSMutableArray *diagnostics = [NSMutableArray arrayWithCapacity: diagnosticCount];
+
 	for (unsigned i=0 ; i<diagnosticCount ; i++)
 	{
 		CXDiagnostic d = clang_getDiagnostic(translationUnit, i);
 		unsigned s = clang_getDiagnosticSeverity(d);
-		if (s > 0)
+
+		if (s == CXDiagnostic_Ignored)
 		{
-			CXString str = clang_getDiagnosticSpelling(d);
-			CXSourceLocation loc = clang_getDiagnosticLocation(d);
-			unsigned rangeCount = clang_getDiagnosticNumRanges(d);
-			// NSLog(@"%d ranges for diagnostic", rangeCount);
-			if (rangeCount == 0) {
-				//FIXME: probably somewhat redundant
-				SCKSourceLocation* sloc = [[SCKSourceLocation alloc] 
-					 initWithClangSourceLocation: loc];
-				NSDictionary *attr = D([NSNumber numberWithInt: (int)s], kSCKDiagnosticSeverity,
-					 [NSString stringWithUTF8String: clang_getCString(str)], kSCKDiagnosticText);
-				// NSRange r = NSRangeFromCXSourceRange(clang_getDiagnosticRange(d, 0));
-				NSRange r = NSMakeRange(sloc->offset, 1);
-				// NSLog(@"diagnostic: %@ %d, %d loc %d", attr, r.location, r.length, sloc->offset);
-				[source addAttribute: kSCKDiagnostic
-				               value: attr
-				               range: r];
-			}
-			for (unsigned j=0 ; j<rangeCount ; j++)
-			{
-				NSRange r = NSRangeFromCXSourceRange(clang_getDiagnosticRange(d, j));
-				NSDictionary *attr = D([NSNumber numberWithInt: (int)s], kSCKDiagnosticSeverity,
-					 [NSString stringWithUTF8String: clang_getCString(str)], kSCKDiagnosticText);
-				// NSLog(@"Added diagnostic %@ for range: %@", attr, NSStringFromRange(r));
-				[source addAttribute: kSCKDiagnostic
-				               value: attr
-				               range: r];
-			}
-			clang_disposeString(str);
+			clang_disposeDiagnostic(d);
+			continue;
 		}
+
+		SCOPED_STR(text, clang_getDiagnosticSpelling(d));
+		SCOPED_STR(category, clang_getDiagnosticCategoryText(d));
+		SCKSourceLocation *loc = [[SCKSourceLocation alloc]
+			initWithClangSourceLocation: clang_getDiagnosticLocation(d)];
+		unsigned column = 0;
+
+		clang_getInstantiationLocation(clang_getDiagnosticLocation(d), 0, 0, &column, 0);
+		unsigned rangeCount = clang_getDiagnosticNumRanges(d);
+		unsigned fixItCount = clang_getDiagnosticNumFixIts(d);
+		NSMutableArray *ranges = [NSMutableArray arrayWithCapacity: MAX(rangeCount, 1)];
+		NSMutableArray *fixIts = [NSMutableArray arrayWithCapacity: fixItCount];
+
+		if (rangeCount == 0)
+		{
+			[ranges addObject: [NSValue valueWithRange: NSMakeRange(loc->offset, 1)]];
+		}
+		for (unsigned j=0 ; j<rangeCount ; j++)
+		{
+			NSRange r = NSRangeFromCXSourceRange(clang_getDiagnosticRange(d, j));
+			[ranges addObject: [NSValue valueWithRange: r]];
+		}
+		for (unsigned j=0 ; j<fixItCount ; j++)
+		{
+			CXSourceRange r;
+			SCOPED_STR(replacement, clang_getDiagnosticFixIt(d, j, &r));
+			[fixIts addObject: [[SCKDiagnosticFixIt alloc]
+				initWithRange: NSRangeFromCXSourceRange(r)
+				replacementText: [NSString stringWithUTF8String: replacement]]];
+		}
+		[diagnostics addObject: [[SCKDiagnostic alloc]
+			initWithSeverity: s
+			        category: [NSString stringWithUTF8String: category]
+			            text: [NSString stringWithUTF8String: text]
+			        location: loc
+			          column: column
+			          ranges: ranges
+			          fixIts: fixIts]];
+		clang_disposeDiagnostic(d);
 	}
+
+	diagnosticSet = [[SCKDiagnosticSet alloc] initWithDiagnostics: diagnostics
+	                                                       version: translationUnitVersion
+	                                                   previousSet: diagnosticSet];
+	SCKDiagnosticSet *result = diagnosticSet;
+	[translationUnitLock unlock];
+	return result;
 }
-- (SCKCodeCompletionResult*)completeAtLocation: (NSUInteger)location
+
+/**
+ * Returns the diagnostic ranges clamped to the source length.
+ */
+static NSArray *sourceRangesForDiagnostic(SCKDiagnostic *diagnostic, NSUInteger length)
 {
-	SCKCodeCompletionResult *result = [SCKCodeCompletionResult new];
+	NSMutableArray *ranges = [NSMutableArray array];
+
+	for (NSValue *value in [diagnostic ranges])
+	{
+		NSRange r = NSIntersectionRange([value rangeValue], NSMakeRange(0, length));
 
-	struct CXUnsavedFile unsavedFile;
-	unsavedFile.Filename = [fileName UTF8String];
-	unsavedFile.Contents = [[source string] UTF8String];
-	unsavedFile.Length = [[source string] length];
+		if (r.length > 0)
+		{
+			[ranges addObject: [NSValue valueWithRange: r]];
+		}
+	}
+	return ranges;
+}
 
-	CXSourceLocation l = clang_getLocationForOffset(translationUnit, file, (unsigned)location);
-	unsigned line, column;
-	clang_getInstantiationLocation(l, file, &line, &column, 0);
-	clock_t c1 = clock();
+- (void)collectDiagnostics
+{
+	double start = SCKMetricsNow();
+	SCKDiagnosticSet *current = [self diagnosticSet];
+	SCKDiagnosticSet *changes = [[SCKDiagnosticSet alloc] initWithDiagnostics: [current diagnostics]
+	                                                                   version: [current version]
+	                                                               previousSet: appliedDiagnosticSet];
+	appliedDiagnosticSet = changes;
+
+	if ([changes hasChanges])
+	{
+		[self applyDiagnosticChanges: changes];
+	}
+	[[[self collection] metrics] recordDuration: SCKMetricsNow() - start
+	                                   forPhase: SCKMetricPhaseDiagnostics
+	                                       file: fileName];
+}
 
-	int options = CXCompletionContext_AnyType |
-			CXCompletionContext_AnyValue |
-			CXCompletionContext_ObjCInterface;
+- (void)applyDiagnosticChanges: (SCKDiagnosticSet*)changes
+{
+	NSUInteger length = [source length];
+	SCOPED_STR(mainFile, clang_getFileName(file));
+	NSString *mainFileName = (NULL != mainFile ? [NSString stringWithUTF8String: mainFile] : nil);
+	NSMutableSet *removedTokens = [NSMutableSet set];
+	NSMutableSet *appliedTokens = [NSMutableSet set];
+	NSMutableArray *removedRanges = [NSMutableArray array];
+
+	for (SCKDiagnostic *diagnostic in [changes removedDiagnostics])
+	{
+		[removedTokens addObject: [[diagnostic attributeValue] objectForKey: kSCKDiagnosticToken]];
+		[removedRanges addObjectsFromArray: sourceRangesForDiagnostic(diagnostic, length)];
+	}
 
-	CXCodeCompleteResults *cr = clang_codeCompleteAt(translationUnit, [fileName UTF8String], line, column, &unsavedFile, 1, options);
-	clock_t c2 = clock();
-	NSLog(@"Complete time: %f\n", 
-	((double)c2 - (double)c1) / (double)CLOCKS_PER_SEC);
-	for (unsigned i=0 ; i<clang_codeCompleteGetNumDiagnostics(cr) ; i++)
+	/* The attributes of removed diagnostics have moved with the edits since 
+	   they were applied, so we look them up by token rather than by their 
+	   recorded ranges. Only the runs that belong to removed diagnostics are 
+	   touched. */
+	if ([removedTokens count] > 0)
 	{
-		CXDiagnostic d = clang_codeCompleteGetDiagnostic(cr, i);
-		unsigned fixits = clang_getDiagnosticNumFixIts(d);
-		printf("Found %d fixits\n", fixits);
-		if (1 == fixits)
+		NSMutableArray *staleRanges = [NSMutableArray array];
+
+		[source enumerateAttribute: kSCKDiagnostic
+		                   inRange: NSMakeRange(0, length)
+		                   options: 0
+		                usingBlock: ^ (id value, NSRange r, BOOL *stop)
 		{
-			CXSourceRange r;
-			CXString str = clang_getDiagnosticFixIt(d, 0, &r);
-			result.fixitRange = NSRangeFromCXSourceRange(r);
-			result.fixitText = [[NSString alloc] initWithUTF8String: clang_getCString(str)];
-			clang_disposeString(str);
-			break;
+			id token = [value objectForKey: kSCKDiagnosticToken];
+
+			if (nil == token)
+				return;
+
+			if ([removedTokens containsObject: token])
+			{
+				[staleRanges addObject: [NSValue valueWithRange: r]];
+			}
+			else
+			{
+				[appliedTokens addObject: token];
+			}
+		}];
+		for (NSValue *r in staleRanges)
+		{
+			[source removeAttribute: kSCKDiagnostic range: [r rangeValue]];
 		}
-		clang_disposeDiagnostic(d);
 	}
-	NSMutableArray *completions = [NSMutableArray new];
-	clang_sortCodeCompletionResults(cr->Results, cr->NumResults);
-	//NSLog(@"we have %d results", cr->NumResults);
-	for (unsigned i=0 ; i<cr->NumResults ; i++)
+
+	NSMutableArray *diagnosticsToApply = [[changes addedDiagnostics] mutableCopy];
+
+	/* Restore unchanged diagnostics that were hidden by a removed one, or 
+	   whose text was deleted while an equal diagnostic took their place */
+	if ([removedRanges count] > 0)
 	{
-		CXCompletionString cs = cr->Results[i].CompletionString;
-		NSMutableAttributedString *completion = [NSMutableAttributedString new];
-		NSMutableString *s = [completion mutableString];
-		unsigned chunks = clang_getNumCompletionChunks(cs);
-		for (unsigned j=0 ; j<chunks ; j++)
+		for (SCKDiagnostic *diagnostic in [changes diagnostics])
 		{
-			switch (clang_getCompletionChunkKind(cs, j))
+			if ([diagnosticsToApply containsObject: diagnostic])
 			{
-				case CXCompletionChunk_Optional:
-				case CXCompletionChunk_TypedText:
-				case CXCompletionChunk_Text:
-				{
-					CXString str = clang_getCompletionChunkText(cs, j);
-					[s appendFormat: @"%s", clang_getCString(str)];
-					clang_disposeString(str);
-					break;
-				}
-				case CXCompletionChunk_Placeholder: 
+				continue;
+			}
+			if (![appliedTokens containsObject: [[diagnostic attributeValue] objectForKey: kSCKDiagnosticToken]])
+			{
+				[diagnosticsToApply addObject: diagnostic];
+				continue;
+			}
+			for (NSValue *range in sourceRangesForDiagnostic(diagnostic, length))
+			{
+				BOOL isOverlapping = NO;
+
+				for (NSValue *removedRange in removedRanges)
 				{
-					CXString str = clang_getCompletionChunkText(cs, j);
-					[s appendFormat: @"<# %s #>", clang_getCString(str)];
-					clang_disposeString(str);
-					break;
+					if (NSIntersectionRange([range rangeValue], [removedRange rangeValue]).length > 0)
+					{
+						isOverlapping = YES;
+						break;
+					}
 				}
-				case CXCompletionChunk_Informative:
+				if (isOverlapping)
 				{
-					CXString str = clang_getCompletionChunkText(cs, j);
-					[s appendFormat: @"/* %s */", clang_getCString(str)];
-					clang_disposeString(str);
+					[diagnosticsToApply addObject: diagnostic];
 					break;
 				}
-				case CXCompletionChunk_CurrentParameter:
-				case CXCompletionChunk_LeftParen:
-					[s appendString: @"("]; break;
-				case CXCompletionChunk_RightParen: 
-					[s appendString: @")"]; break;
-				case CXCompletionChunk_LeftBracket:
-					[s appendString: @"["]; break;
-				case CXCompletionChunk_RightBracket:
-					[s appendString: @"]"]; break;
-				case CXCompletionChunk_LeftBrace:
-					[s appendString: @"{"]; break;
-				case CXCompletionChunk_RightBrace: 
-					[s appendString: @"}"]; break;
-				case CXCompletionChunk_LeftAngle:
-					[s appendString: @"<"]; break;
-				case CXCompletionChunk_RightAngle:
-					[s appendString: @">"]; break;
-				case CXCompletionChunk_Comma:
-					[s appendString: @","]; break;
-				case CXCompletionChunk_ResultType: 
-					break;
-				case CXCompletionChunk_Colon:
-					[s appendString: @":"]; break;
-				case CXCompletionChunk_SemiColon:
-					[s appendString: @";"]; break;
-				case CXCompletionChunk_Equal:
-					[s appendString: @"="]; break;
-				case CXCompletionChunk_HorizontalSpace: 
-					[s appendString: @" "]; break;
-				case CXCompletionChunk_VerticalSpace:
-					[s appendString: @"\n"]; break;
 			}
 		}
-		[completions addObject: completion];
 	}
-	result.completions = completions;
-	clang_disposeCodeCompleteResults(cr);
-	return result;
+
+	for (SCKDiagnostic *diagnostic in diagnosticsToApply)
+	{
+		// Diagnostics reported in included headers don't apply to this buffer
+		if (![[[diagnostic location] file] isEqualToString: mainFileName])
+		{
+			continue;
+		}
+		for (NSValue *range in sourceRangesForDiagnostic(diagnostic, length))
+		{
+			[source addAttribute: kSCKDiagnostic
+			               value: [diagnostic attributeValue]
+			               range: [range rangeValue]];
+		}
+	}
 }
-@end
+static inline BOOL isIdentifierCharacter(unichar c)
+{
+	return (c == '_' || c == '$' || (c >= 'a' && c <= 'z')
+		|| (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'));
+}
+
+/**
+ * Returns the start offset of the identifier that ends at location, or
+ * location itself if the preceding character is not part of an identifier.
+ */
+static NSUInteger identifierStartForLocation(NSString *text, NSUInteger location)
+{
+	NSUInteger start = MIN(location, [text length]);
+	while (start > 0 && isIdentifierCharacter([text characterAtIndex: start - 1]))
+	{
+		start--;
+	}
+	return start;
+}
+
+/**
+ * Returns whether location is still inside (or at the end of) the identifier
+ * that starts at tokenStart.
+ */
+static BOOL isLocationInIdentifierStartingAt(NSString *text, NSUInteger location, NSUInteger tokenStart)
+{
+	if (location < tokenStart || location > [text length])
+	{
+		return NO;
+	}
+	return (identifierStartForLocation(text, location) == tokenStart);
+}
+
+- (void)sourceDidProcessEditing: (NSNotification *)aNotification
+{
+	[super sourceDidProcessEditing: aNotification];
+
+	NSTextStorage *storage = (NSTextStorage *)source;
+
+	if (([storage editedMask] & NSTextStorageEditedCharacters) == 0)
+	{
+		return;
+	}
+	// Completion results only depend on the text before their location, so 
+	// typing the completed identifier keeps them valid
+	NSUInteger editLocation = [storage editedRange].location;
+
+	completionSessionEditLocation = MIN(completionSessionEditLocation, editLocation);
+	speculationEditLocation = MIN(speculationEditLocation, editLocation);
+}
+
+- (void)cursorDidMoveToLocation: (NSUInteger)location
+{
+	if (nil == completionSession)
+	{
+		return;
+	}
+	[translationUnitLock lock];
+	if (!isLocationInIdentifierStartingAt([source string], location, [completionSession location]))
+	{
+		completionSession = nil;
+	}
+	[translationUnitLock unlock];
+}
+
+/**
+ * Returns whether the text before location ends with a completion trigger:
+ * '[', '.', '->' or a space after the receiver of an unterminated message
+ * send (e.g. '[receiver ').
+ */
+static BOOL isCompletionTriggerBeforeLocation(NSString *text, NSUInteger location)
+{
+	if (location == 0 || location > [text length])
+	{
+		return NO;
+	}
+	unichar last = [text characterAtIndex: location - 1];
+
+	if (last == '[' || last == '.')
+	{
+		return YES;
+	}
+	if (last == '>')
+	{
+		return (location > 1 && [text characterAtIndex: location - 2] == '-');
+	}
+	if (last != ' ' || location < 2)
+	{
+		return NO;
+	}
+
+	unichar receiverEnd = [text characterAtIndex: location - 2];
+
+	if (!isIdentifierCharacter(receiverEnd) && receiverEnd != ']' && receiverEnd != ')')
+	{
+		return NO;
+	}
 
+	/* Look for the unmatched '[' that opens the message send on the same 
+	   line, e.g. '[[self foo] ' or '[anObject ' */
+	NSInteger depth = 0;
+	for (NSUInteger i = location - 1; i > 0; i--)
+	{
+		unichar c = [text characterAtIndex: i - 1];
+
+		if (c == '\n' || c == ';' || c == '{' || c == '}')
+		{
+			return NO;
+		}
+		if (c == ']' || c == ')')
+		{
+			depth++;
+		}
+		else if (c == '(')
+		{
+			depth--;
+		}
+		else if (c == '[')
+		{
+			if (depth == 0)
+			{
+				return YES;
+			}
+			depth--;
+		}
+		if (depth < 0)
+		{
+			return NO;
+		}
+	}
+	return NO;
+}
+
+/**
+ * Returns whether completionSession was computed at tokenStart against the
+ * current translation unit and text, so its results can be reused.
+ */
+- (BOOL)isCompletionSessionValidAtLocation: (NSUInteger)tokenStart
+{
+	SCKClangCompletionSession *session = completionSession;
+
+	// Without edit notifications, we can't tell whether a session is stale
+	return ([source isKindOfClass: [NSTextStorage class]] && nil != session
+		&& [session location] == tokenStart
+		&& completionSessionVersion == translationUnitVersion
+		&& completionSessionEditLocation >= tokenStart);
+}
+
+- (BOOL)textDidChangeAtLocation: (NSUInteger)location
+{
+	if (!completesSpeculatively || ![source isKindOfClass: [NSTextStorage class]])
+	{
+		return NO;
+	}
+
+	NSString *text = [[source string] copy];
+
+	// The current session would be reused rather than the speculative one
+	if (!isCompletionTriggerBeforeLocation(text, location)
+		|| [self isCompletionSessionValidAtLocation: location])
+	{
+		return NO;
+	}
+	if (nil == completionQueue)
+	{
+		completionQueue = [NSOperationQueue new];
+		[completionQueue setMaxConcurrentOperationCount: 1];
+	}
+
+	NSUInteger version = translationUnitVersion;
+	NSUInteger count = ++speculationCount;
+
+	speculationEditLocation = NSNotFound;
+
+	[completionQueue addOperationWithBlock: ^ ()
+	{
+		[translationUnitLock lock];
+		BOOL isStale = (version != translationUnitVersion || NULL == translationUnit);
+
+		if (!isStale)
+		{
+			speculativeSession = [[SCKClangCompletionSession alloc] initWithTranslationUnit: translationUnit
+			                                                                           file: file
+			                                                                       fileName: fileName
+			                                                                       contents: text
+			                                                                       location: location];
+			speculativeSessionVersion = version;
+			speculativeSessionCount = count;
+		}
+		[translationUnitLock unlock];
+	}];
+	return YES;
+}
+
+- (SCKCodeCompletionResult*)completeAtLocation: (NSUInteger)location
+{
+	NSString *text = [source string];
+	location = MIN(location, [text length]);
+	NSUInteger tokenStart = identifierStartForLocation(text, location);
+
+	double start = SCKMetricsNow();
+	SCKMetricPhase phase = SCKMetricPhaseCompletionFiltering;
+
+	/* A speculative completion not started yet would compute a session we 
+	   compute below anyway, and the lock waits for the one that is running */
+	[completionQueue cancelAllOperations];
+	[translationUnitLock lock];
+
+	if (nil != speculativeSession)
+	{
+		BOOL isValid = (speculativeSessionVersion == translationUnitVersion
+			&& [speculativeSession location] == tokenStart
+			&& speculativeSessionCount == speculationCount
+			&& speculationEditLocation >= tokenStart);
+
+		if (isValid)
+		{
+			completionSession = speculativeSession;
+			completionSessionVersion = speculativeSessionVersion;
+			completionSessionEditLocation = speculationEditLocation;
+		}
+		speculativeSession = nil;
+	}
+
+	// While the user keeps typing the same identifier, reuse the results
+	// computed at the trigger point rather than running libclang again, unless
+	// the file was reparsed or edited before the identifier since.
+	if (![self isCompletionSessionValidAtLocation: tokenStart])
+	{
+		phase = SCKMetricPhaseCompletion;
+		completionSessionVersion = translationUnitVersion;
+		completionSessionEditLocation = NSNotFound;
+		completionSession = [[SCKClangCompletionSession alloc] initWithTranslationUnit: translationUnit
+		                                                                          file: file
+		                                                                      fileName: fileName
+		                                                                      contents: text
+		                                                                      location: tokenStart];
+	}
+	[translationUnitLock unlock];
+
+	NSString *prefix = [text substringWithRange: NSMakeRange(tokenStart, location - tokenStart)];
+	SCKCodeCompletionResult *result = [completionSession completionResultForPrefix: prefix];
+
+	[[[self collection] metrics] recordDuration: SCKMetricsNow() - start
+	                                   forPhase: phase
+	                                       file: fileName];
+	return (nil != result ? result : [SCKCodeCompletionResult new]);
+}
+@end
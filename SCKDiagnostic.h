@@ -0,0 +1,96 @@
+#import <Foundation/NSObject.h>
+#import <Foundation/NSRange.h>
+
+@class NSString, NSArray, NSDictionary, NSSet;
+@class SCKSourceLocation;
+
+/**
+ * A replacement suggested by the compiler to fix a diagnostic.
+ */
+@interface SCKDiagnosticFixIt : NSObject
+- (id)initWithRange: (NSRange)aRange replacementText: (NSString*)aText;
+/** The range to replace, in the file containing the diagnostic. */
+@property (nonatomic, readonly) NSRange range;
+/** The text to insert in place of -range. */
+@property (nonatomic, readonly) NSString *replacementText;
+@end
+
+/**
+ * An immutable compiler diagnostic (error, warning, note etc.).
+ *
+ * Two diagnostics are equal when they report the same text, with the same
+ * severity, in the same file at the same column, and their ranges and fix-its
+ * are at the same positions relative to their location. So a diagnostic 
+ * moved by an edit on the lines above it is unchanged.
+ */
+@interface SCKDiagnostic : NSObject
+/**
+ * <init />
+ * The column is the position of the location in its line, starting at 1.
+ */
+- (id)initWithSeverity: (NSUInteger)aSeverity
+              category: (NSString*)aCategory
+                  text: (NSString*)aText
+              location: (SCKSourceLocation*)aLocation
+                column: (NSUInteger)aColumn
+                ranges: (NSArray*)someRanges
+                fixIts: (NSArray*)someFixIts;
+/**
+ * The severity of the diagnostic.  From 1 (note) to 4 (fatal error), see
+ * kSCKDiagnosticSeverity.
+ */
+@property (nonatomic, readonly) NSUInteger severity;
+/** The diagnostic category, e.g. 'Semantic Issue'. */
+@property (nonatomic, readonly) NSString *category;
+/** A human-readable text suitable for display. */
+@property (nonatomic, readonly) NSString *text;
+/** The location where the diagnostic was reported. */
+@property (nonatomic, readonly) SCKSourceLocation *location;
+/** The column of -location, starting at 1. */
+@property (nonatomic, readonly) NSUInteger column;
+/**
+ * The ranges highlighted by the diagnostic, as NSValue objects.  When the
+ * diagnostic has no range, contains a single one character range at -location.
+ */
+@property (nonatomic, readonly) NSArray *ranges;
+/** The SCKDiagnosticFixIt objects suggested for the diagnostic. */
+@property (nonatomic, readonly) NSArray *fixIts;
+/**
+ * The kSCKDiagnostic attribute value set in the source attributed string.
+ *
+ * The same instance is returned on each call, and shared with the equal
+ * diagnostics of the next snapshots (see SCKDiagnosticSet). Its 
+ * kSCKDiagnosticToken value is unique to the diagnostic, so the attributes 
+ * applied for a diagnostic can be recognized even when another diagnostic 
+ * has the same severity and text.
+ */
+@property (nonatomic, readonly) NSDictionary *attributeValue;
+@end
+
+/**
+ * A snapshot of the diagnostics reported by parsing a source file, along with
+ * the changes since the previous snapshot.
+ */
+@interface SCKDiagnosticSet : NSObject
+/**
+ * Initializes a snapshot for the given parse version.
+ *
+ * The diagnostics that are equal to some diagnostics in the previous set are
+ * unchanged. They are replaced by the previous instances when they are at the
+ * same location, and otherwise share the -attributeValue of the previous 
+ * instances, so their applied attributes can still be recognized.
+ */
+- (id)initWithDiagnostics: (NSArray*)someDiagnostics
+                  version: (NSUInteger)aVersion
+              previousSet: (SCKDiagnosticSet*)aPreviousSet;
+/** The parse version the diagnostics were collected from. */
+@property (nonatomic, readonly) NSUInteger version;
+/** The SCKDiagnostic objects in the order reported by the compiler. */
+@property (nonatomic, readonly) NSArray *diagnostics;
+/** The diagnostics that were not present in the previous snapshot. */
+@property (nonatomic, readonly) NSArray *addedDiagnostics;
+/** The diagnostics of the previous snapshot that are not present anymore. */
+@property (nonatomic, readonly) NSArray *removedDiagnostics;
+/** Returns whether the diagnostics differ from the previous snapshot. */
+@property (nonatomic, readonly) BOOL hasChanges;
+@end
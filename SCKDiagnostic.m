@@ -0,0 +1,242 @@
+#import "SCKDiagnostic.h"
+#import "SCKSourceFile.h"
+#import "SCKTextTypes.h"
+#import <EtoileFoundation/EtoileFoundation.h>
+
+@implementation SCKDiagnosticFixIt
+
+@synthesize range, replacementText;
+
+- (id)initWithRange: (NSRange)aRange replacementText: (NSString*)aText
+{
+	SUPERINIT;
+	range = aRange;
+	replacementText = [aText copy];
+	return self;
+}
+
+- (BOOL)isEqual: (id)anObject
+{
+	if (![anObject isKindOfClass: [SCKDiagnosticFixIt class]])
+	{
+		return NO;
+	}
+	return NSEqualRanges(range, [anObject range])
+		&& [replacementText isEqualToString: [anObject replacementText]];
+}
+
+- (NSUInteger)hash
+{
+	return [replacementText hash] ^ range.location;
+}
+
+- (NSString*)description
+{
+	return [NSString stringWithFormat: @"%@ -> %@", NSStringFromRange(range), replacementText];
+}
+
+@end
+
+/** The last kSCKDiagnosticToken value. */
+static volatile uint64_t lastDiagnosticToken;
+
+@implementation SCKDiagnostic
+
+@synthesize severity, category, text, location, column, ranges, fixIts, attributeValue;
+
+- (id)initWithSeverity: (NSUInteger)aSeverity
+              category: (NSString*)aCategory
+                  text: (NSString*)aText
+              location: (SCKSourceLocation*)aLocation
+                column: (NSUInteger)aColumn
+                ranges: (NSArray*)someRanges
+                fixIts: (NSArray*)someFixIts
+{
+	SUPERINIT;
+	severity = aSeverity;
+	category = [aCategory copy];
+	text = [aText copy];
+	location = aLocation;
+	column = aColumn;
+	ranges = [someRanges copy];
+	fixIts = [someFixIts copy];
+	attributeValue = D([NSNumber numberWithInt: (int)severity], kSCKDiagnosticSeverity,
+		text, kSCKDiagnosticText,
+		[NSNumber numberWithUnsignedLongLong: __sync_add_and_fetch(&lastDiagnosticToken, 1)], kSCKDiagnosticToken);
+	return self;
+}
+
+/**
+ * Returns a copy of the diagnostic that uses the given attribute value.
+ */
+- (SCKDiagnostic*)diagnosticWithAttributeValue: (NSDictionary*)aValue
+{
+	SCKDiagnostic *diagnostic = [[SCKDiagnostic alloc] initWithSeverity: severity
+	                                                           category: category
+	                                                               text: text
+	                                                           location: location
+	                                                             column: column
+	                                                             ranges: ranges
+	                                                             fixIts: fixIts];
+	diagnostic->attributeValue = aValue;
+	return diagnostic;
+}
+
+/**
+ * Returns whether the ranges are at the same positions relative to the 
+ * given offsets.
+ */
+static BOOL areRangesEqualRelativeToOffsets(NSArray *ranges, NSUInteger offset,
+	NSArray *otherRanges, NSUInteger otherOffset)
+{
+	if ([ranges count] != [otherRanges count])
+	{
+		return NO;
+	}
+	for (NSUInteger i = 0; i < [ranges count]; i++)
+	{
+		NSRange r = [[ranges objectAtIndex: i] rangeValue];
+		NSRange other = [[otherRanges objectAtIndex: i] rangeValue];
+
+		if (r.length != other.length
+		 || (NSInteger)(r.location - offset) != (NSInteger)(other.location - otherOffset))
+		{
+			return NO;
+		}
+	}
+	return YES;
+}
+
+static NSArray *rangesOfFixIts(NSArray *someFixIts)
+{
+	NSMutableArray *fixItRanges = [NSMutableArray arrayWithCapacity: [someFixIts count]];
+
+	for (SCKDiagnosticFixIt *fixIt in someFixIts)
+	{
+		[fixItRanges addObject: [NSValue valueWithRange: [fixIt range]]];
+	}
+	return fixItRanges;
+}
+
+- (BOOL)isEqual: (id)anObject
+{
+	if (self == anObject)
+	{
+		return YES;
+	}
+	if (![anObject isKindOfClass: [SCKDiagnostic class]])
+	{
+		return NO;
+	}
+	SCKDiagnostic *other = anObject;
+	NSUInteger offset = [location offset];
+	NSUInteger otherOffset = [[other location] offset];
+
+	if (severity != [other severity] || column != [other column]
+	 || ![text isEqualToString: [other text]]
+	 || ![[location file] isEqualToString: [[other location] file]]
+	 || ![[fixIts valueForKey: @"replacementText"] isEqual: [[other fixIts] valueForKey: @"replacementText"]])
+	{
+		return NO;
+	}
+	return areRangesEqualRelativeToOffsets(ranges, offset, [other ranges], otherOffset)
+		&& areRangesEqualRelativeToOffsets(rangesOfFixIts(fixIts), offset,
+			rangesOfFixIts([other fixIts]), otherOffset);
+}
+
+- (NSUInteger)hash
+{
+	return [text hash] ^ (column << 8) ^ severity;
+}
+
+- (NSString*)description
+{
+	return [NSString stringWithFormat: @"%@: %@", location, text];
+}
+
+@end
+
+@implementation SCKDiagnosticSet
+
+@synthesize version, diagnostics, addedDiagnostics, removedDiagnostics;
+
+- (id)initWithDiagnostics: (NSArray*)someDiagnostics
+                  version: (NSUInteger)aVersion
+              previousSet: (SCKDiagnosticSet*)aPreviousSet
+{
+	SUPERINIT;
+	version = aVersion;
+
+	/* Equal diagnostics (e.g. the same error on two lines) are matched in 
+	   order with the previous ones */
+	NSMapTable *previousByDiagnostic = [NSMapTable strongToStrongObjectsMapTable];
+
+	for (SCKDiagnostic *diagnostic in [aPreviousSet diagnostics])
+	{
+		NSMutableArray *equalDiagnostics = [previousByDiagnostic objectForKey: diagnostic];
+
+		if (nil == equalDiagnostics)
+		{
+			equalDiagnostics = [NSMutableArray array];
+			[previousByDiagnostic setObject: equalDiagnostics forKey: diagnostic];
+		}
+		[equalDiagnostics addObject: diagnostic];
+	}
+
+	NSMutableArray *current = [NSMutableArray arrayWithCapacity: [someDiagnostics count]];
+	NSMutableArray *added = [NSMutableArray array];
+	NSHashTable *unchanged = [NSHashTable hashTableWithOptions: NSPointerFunctionsObjectPointerPersonality];
+
+	for (SCKDiagnostic *diagnostic in someDiagnostics)
+	{
+		NSMutableArray *equalDiagnostics = [previousByDiagnostic objectForKey: diagnostic];
+		SCKDiagnostic *previous = [equalDiagnostics firstObject];
+
+		if (nil == previous)
+		{
+			[current addObject: diagnostic];
+			[added addObject: diagnostic];
+			continue;
+		}
+
+		[equalDiagnostics removeObjectAtIndex: 0];
+		[unchanged addObject: previous];
+
+		if ([[previous location] offset] == [[diagnostic location] offset])
+		{
+			[current addObject: previous];
+		}
+		else
+		{
+			[current addObject: [diagnostic diagnosticWithAttributeValue: [previous attributeValue]]];
+		}
+	}
+
+	NSMutableArray *removed = [NSMutableArray array];
+
+	for (SCKDiagnostic *diagnostic in [aPreviousSet diagnostics])
+	{
+		if (![unchanged containsObject: diagnostic])
+		{
+			[removed addObject: diagnostic];
+		}
+	}
+
+	diagnostics = [current copy];
+	addedDiagnostics = [added copy];
+	removedDiagnostics = [removed copy];
+	return self;
+}
+- (BOOL)hasChanges
+{
+	return ([addedDiagnostics count] > 0 || [removedDiagnostics count] > 0);
+}
+
+- (NSString*)description
+{
+	return [NSString stringWithFormat: @"%@ version %lu (+%lu -%lu)\n%@",
+		[super description], (unsigned long)version, (unsigned long)[addedDiagnostics count],
+		(unsigned long)[removedDiagnostics count], diagnostics];
+}
+
+@end
@@ -0,0 +1,216 @@
+#import <Foundation/Foundation.h>
+#include <clang-c/Index.h>
+#import "SCKOccurrenceIndex.h"
+
+@class SCKSourceLocation, SCKProgramComponent, SCKClass, SCKCategory, SCKMethod;
+@class SCKFunction, SCKGlobal, SCKProperty, SCKMacro, SCKIvar, SCKProtocol;
+@class SCKEnumeration, SCKEnumerationValue;
+
+#if CINDEX_VERSION < 21
+#define CXObjCPropertyAttrKind int
+#endif
+
+/**
+ * Kinds of the records that describe the result of an out-of-process parse
+ * (see SCKIndexWorkerPool).
+ *
+ * Each record starts with its kind, followed by the arguments of the
+ * SCKIndexSink method it corresponds to, in the same order.
+ */
+enum SCKIndexRecordKind
+{
+	SCKIndexRecordClass = 1,
+	SCKIndexRecordCategory,
+	SCKIndexRecordMethod,
+	SCKIndexRecordFunction,
+	SCKIndexRecordVariable,
+	SCKIndexRecordClassProperty,
+	SCKIndexRecordMacro,
+	SCKIndexRecordIvar,
+	SCKIndexRecordProtocol,
+	SCKIndexRecordProtocolMethod,
+	SCKIndexRecordProtocolProperty,
+	SCKIndexRecordCategoryProperty,
+	SCKIndexRecordEnumeration,
+	SCKIndexRecordEnumerationValue,
+	SCKIndexRecordAdoptedProtocols,
+	SCKIndexRecordInheritedProtocols,
+	/** Comment attached to the component of the previous record. */
+	SCKIndexRecordComment,
+	/** Path and state of a file included by the parsed translation unit. */
+	SCKIndexRecordIncludedFile,
+	/** Main file content hash and interface fingerprint of a successful parse. */
+	SCKIndexRecordParsedFile,
+	/** Added last, so the kinds above keep their values. */
+	SCKIndexRecordOccurrence
+};
+
+/**
+ * Receiver of the program components found while walking a translation unit.
+ *
+ * SCKClangSourceFile collects them into its source collection, while
+ * SCKIndexRecorder encodes them so they can be collected in another process.
+ *
+ * The methods return the component that was updated, or nil if the location
+ * was ignored or recorded for later.
+ */
+@protocol SCKIndexSink
+- (SCKClass*)setLocation: (SCKSourceLocation*)aLocation
+                forClass: (NSString*)aClassName
+          withSuperclass: (NSString*)aSuperclassName
+            isDefinition: (BOOL)isDefinition
+    isForwardDeclaration: (BOOL)isForwardDeclaration;
+- (SCKCategory*)setLocation: (SCKSourceLocation*)aLocation
+                forCategory: (NSString*)aCategoryName
+               isDefinition: (BOOL)isDefinition
+                    ofClass: (NSString*)aClassName;
+- (SCKMethod*)setLocation: (SCKSourceLocation*)aLocation
+                forMethod: (NSString*)methodName
+         withTypeEncoding: (NSString*)typeEncoding
+            isClassMethod: (BOOL)isClassMethod
+             isDefinition: (BOOL)isDefinition
+                  inClass: (NSString*)className
+                 category: (NSString*)categoryName;
+- (SCKFunction*)setLocation: (SCKSourceLocation*)l
+                forFunction: (NSString*)name
+           withTypeEncoding: (NSString*)type
+                   isStatic: (BOOL)isStatic
+               isDefinition: (BOOL)isDefinition;
+- (SCKGlobal*)setLocation: (SCKSourceLocation*)l
+              forVariable: (NSString*)name
+         withTypeEncoding: (NSString*)type
+             isDefinition: (BOOL)isDefinition;
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)propertyAttributes
+                 isIBOutlet: (BOOL)isIBOutlet
+                    inClass: (NSString *)className;
+- (SCKMacro*)setLocation: (SCKSourceLocation*)sourceLocation
+                forMacro: (NSString*)macroName;
+- (SCKIvar*)setLocation: (SCKSourceLocation*)sourceLocation
+                forIvar: (NSString*)ivarName
+       withTypeEncoding: (NSString*)typeEncoding
+             isIBOutlet: (BOOL)isIBOutlet
+                inClass: (NSString*)className;
+- (SCKProtocol*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProtocol: (NSString*)protocolName
+       isForwardDeclaration: (BOOL)isForwardDeclaration;
+- (SCKMethod*)setLocation: (SCKSourceLocation*)sourceLocation
+                forMethod: (NSString*)methodName
+         withTypeEncoding: (NSString*)typeEncoding
+            isClassMethod: (BOOL)isClassMethod
+               isRequired: (BOOL)isRequired
+             isDefinition: (BOOL)isDefinition
+               inProtocol: (NSString*)protocolName;
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)attributes
+                 isIBOutlet: (BOOL)isIBOutlet
+                 isRequired: (BOOL)isRequired
+                 inProtocol: (NSString*)protocolName;
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)attributes
+               isDefinition: (BOOL)isDefinition
+                    inClass: (NSString*)className
+                   category: (NSString*)categoryName;
+- (SCKEnumeration*)setLocation: (SCKSourceLocation*)sourceLocation
+                forEnumeration: (NSString*)enumName;
+- (SCKEnumerationValue*)setLocation: (SCKSourceLocation*)sourceLocation
+                forEnumerationValue: (NSString*)valueName
+                   withTypeEncoding: (NSString*)typeEncoding
+                              value: (long long)aValue
+                      inEnumeration: (NSString*)enumName;
+/**
+ * Replaces the protocols adopted by the class interface, or by the category
+ * interface if the category name is not nil.
+ */
+- (void)setAdoptedProtocols: (NSArray*)protocolNames
+                   forClass: (NSString*)className
+                   category: (NSString*)categoryName;
+/**
+ * Replaces the protocols inherited by the protocol.
+ */
+- (void)setAdoptedProtocols: (NSArray*)protocolNames
+                forProtocol: (NSString*)protocolName;
+/**
+ * Records a declaration or a reference whose extent is in the parsed file, 
+ * for -[SCKSourceFile occurrenceIndex].
+ */
+- (void)recordOccurrenceWithRange: (NSRange)aRange
+                             kind: (SCKOccurrenceKind)aKind
+                             name: (NSString*)aName
+                              USR: (NSString*)aUSR
+                      declaration: (SCKSourceLocation*)aDeclaration
+                       definition: (SCKSourceLocation*)aDefinition;
+/**
+ * Records the documentation comment attached to the cursor declaration, for
+ * the component returned by the last setLocation: call.
+ */
+- (void)recordCommentOfCursor: (CXCursor)cursor forComponent: (SCKProgramComponent*)aComponent;
+@end
+
+/**
+ * Encodes integers, strings and source locations into a compact binary
+ * stream.
+ *
+ * Integers are encoded as variable-length integers (7 bits per byte) and
+ * strings are written once, later occurrences being encoded as an index into
+ * the strings written previously, so file paths cost a few bytes per location.
+ */
+@interface SCKIndexRecordWriter : NSObject
+@property (nonatomic, readonly) NSMutableData *data;
+- (void)writeKind: (enum SCKIndexRecordKind)aKind;
+- (void)writeUnsigned: (unsigned long long)aValue;
+- (void)writeSigned: (long long)aValue;
+- (void)writeBool: (BOOL)aFlag;
+/** Writes a string that can be nil. */
+- (void)writeString: (NSString*)aString;
+/** Writes the count and the strings of an array of strings. */
+- (void)writeStrings: (NSArray*)strings;
+- (void)writeData: (NSData*)someData;
+/** Writes a location that can be nil. */
+- (void)writeLocation: (SCKSourceLocation*)aLocation;
+@end
+
+/**
+ * Decodes a stream written by SCKIndexRecordWriter.
+ *
+ * Reading past the end or a malformed value makes the reader invalid, and
+ * every read returns 0 or nil from then on.
+ */
+@interface SCKIndexRecordReader : NSObject
+- (id)initWithData: (NSData*)someData;
+@property (nonatomic, readonly) BOOL isAtEnd;
+@property (nonatomic, readonly) BOOL isValid;
+- (enum SCKIndexRecordKind)readKind;
+- (unsigned long long)readUnsigned;
+- (long long)readSigned;
+- (BOOL)readBool;
+- (NSString*)readString;
+- (NSArray*)readStrings;
+- (NSData*)readData;
+- (SCKSourceLocation*)readLocation;
+/**
+ * Reads a record that corresponds to a SCKIndexSink method, calls this method 
+ * on the sink with the decoded arguments, and returns YES. For the other 
+ * record kinds, reads nothing and returns NO.
+ *
+ * For the setLocation: records, the component returned by the sink is set in 
+ * aComponent. When the record is malformed, the sink is not called.
+ */
+- (BOOL)replayRecordOfKind: (enum SCKIndexRecordKind)aKind
+                  intoSink: (id <SCKIndexSink>)aSink
+                 component: (SCKProgramComponent **)aComponent;
+@end
+
+/**
+ * Index sink that writes the program components as records, to replay them
+ * in another process with -[SCKClangSourceFile reparseWithIndexWorkerResponse:].
+ */
+@interface SCKIndexRecorder : NSObject <SCKIndexSink>
+- (id)initWithWriter: (SCKIndexRecordWriter*)aWriter;
+@end
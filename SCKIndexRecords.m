@@ -0,0 +1,761 @@
+#import "SCKIndexRecords.h"
+#import "SCKSourceFile.h"
+#import <EtoileFoundation/EtoileFoundation.h>
+
+@interface SCKSourceLocation (SCKClangSourceLocation)
+- (id)initWithClangSourceLocation: (CXSourceLocation)l;
+@end
+
+@implementation SCKIndexRecordWriter
+{
+	NSMutableData *data;
+	/** Indexes of the strings already written by string. */
+	NSMutableDictionary *stringIndexes;
+}
+
+@synthesize data;
+
+- (id)init
+{
+	SUPERINIT;
+	data = [NSMutableData new];
+	stringIndexes = [NSMutableDictionary new];
+	return self;
+}
+
+- (void)writeKind: (enum SCKIndexRecordKind)aKind
+{
+	[self writeUnsigned: aKind];
+}
+
+- (void)writeUnsigned: (unsigned long long)aValue
+{
+	uint8_t bytes[10];
+	NSUInteger length = 0;
+
+	do
+	{
+		bytes[length] = (aValue & 0x7F) | (aValue > 0x7F ? 0x80 : 0);
+		aValue >>= 7;
+		length++;
+	} while (aValue != 0);
+
+	[data appendBytes: bytes length: length];
+}
+
+- (void)writeSigned: (long long)aValue
+{
+	// Zigzag encoding keeps small negative values short
+	[self writeUnsigned: ((unsigned long long)aValue << 1) ^ (unsigned long long)(aValue >> 63)];
+}
+
+- (void)writeBool: (BOOL)aFlag
+{
+	[self writeUnsigned: (aFlag ? 1 : 0)];
+}
+
+/*
+ * Strings are encoded as 0 for nil, 1 followed by the UTF-8 length and bytes
+ * for a new string, or the index of a string already written plus 2.
+ */
+- (void)writeString: (NSString*)aString
+{
+	if (nil == aString)
+	{
+		[self writeUnsigned: 0];
+		return;
+	}
+
+	NSNumber *index = [stringIndexes objectForKey: aString];
+
+	if (nil != index)
+	{
+		[self writeUnsigned: [index unsignedLongLongValue] + 2];
+		return;
+	}
+
+	const char *utf8 = [aString UTF8String];
+	size_t length = strlen(utf8);
+
+	[stringIndexes setObject: [NSNumber numberWithUnsignedInteger: [stringIndexes count]]
+	                  forKey: aString];
+	[self writeUnsigned: 1];
+	[self writeUnsigned: length];
+	[data appendBytes: utf8 length: length];
+}
+
+- (void)writeStrings: (NSArray*)strings
+{
+	[self writeUnsigned: [strings count]];
+	for (NSString *string in strings)
+	{
+		[self writeString: string];
+	}
+}
+
+- (void)writeData: (NSData*)someData
+{
+	[self writeUnsigned: [someData length]];
+	[data appendData: someData];
+}
+
+- (void)writeLocation: (SCKSourceLocation*)aLocation
+{
+	[self writeString: [aLocation file]];
+	if (nil != aLocation)
+	{
+		[self writeUnsigned: [aLocation offset]];
+	}
+}
+
+@end
+
+@implementation SCKIndexRecordReader
+{
+	NSData *data;
+	const uint8_t *bytes;
+	NSUInteger length;
+	NSUInteger position;
+	BOOL isValid;
+	/** Strings already read, in the order they were written. */
+	NSMutableArray *strings;
+}
+
+@synthesize isValid;
+
+- (id)initWithData: (NSData*)someData
+{
+	NILARG_EXCEPTION_TEST(someData);
+	SUPERINIT;
+	data = someData;
+	bytes = [data bytes];
+	length = [data length];
+	isValid = YES;
+	strings = [NSMutableArray new];
+	return self;
+}
+
+- (BOOL)isAtEnd
+{
+	return (position >= length || !isValid);
+}
+
+- (enum SCKIndexRecordKind)readKind
+{
+	return (enum SCKIndexRecordKind)[self readUnsigned];
+}
+
+- (unsigned long long)readUnsigned
+{
+	unsigned long long value = 0;
+
+	for (unsigned shift = 0; isValid && shift < 64; shift += 7)
+	{
+		if (position >= length)
+			break;
+
+		uint8_t byte = bytes[position++];
+
+		value |= (unsigned long long)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+	isValid = NO;
+	return 0;
+}
+
+- (long long)readSigned
+{
+	unsigned long long value = [self readUnsigned];
+
+	return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+- (BOOL)readBool
+{
+	return ([self readUnsigned] != 0);
+}
+
+- (NSString*)readString
+{
+	unsigned long long tag = [self readUnsigned];
+
+	if (!isValid || 0 == tag)
+		return nil;
+
+	if (tag >= 2)
+	{
+		if (tag - 2 >= [strings count])
+		{
+			isValid = NO;
+			return nil;
+		}
+		return [strings objectAtIndex: (NSUInteger)(tag - 2)];
+	}
+
+	unsigned long long stringLength = [self readUnsigned];
+
+	if (!isValid || stringLength > length - position)
+	{
+		isValid = NO;
+		return nil;
+	}
+
+	NSString *string = [[NSString alloc] initWithBytes: bytes + position
+	                                            length: (NSUInteger)stringLength
+	                                          encoding: NSUTF8StringEncoding];
+
+	position += (NSUInteger)stringLength;
+	if (nil == string)
+	{
+		isValid = NO;
+		return nil;
+	}
+	[strings addObject: string];
+	return string;
+}
+
+- (NSArray*)readStrings
+{
+	unsigned long long count = [self readUnsigned];
+
+	// Each string takes at least one byte
+	if (!isValid || count > length - position)
+	{
+		isValid = NO;
+		return nil;
+	}
+
+	NSMutableArray *array = [NSMutableArray arrayWithCapacity: (NSUInteger)count];
+
+	for (unsigned long long i = 0; i < count && isValid; i++)
+	{
+		NSString *string = [self readString];
+
+		if (nil != string)
+		{
+			[array addObject: string];
+		}
+	}
+	return (isValid ? array : nil);
+}
+
+- (NSData*)readData
+{
+	unsigned long long dataLength = [self readUnsigned];
+
+	if (!isValid || dataLength > length - position)
+	{
+		isValid = NO;
+		return nil;
+	}
+
+	NSData *subdata = [data subdataWithRange: NSMakeRange(position, (NSUInteger)dataLength)];
+
+	position += (NSUInteger)dataLength;
+	return subdata;
+}
+
+- (SCKSourceLocation*)readLocation
+{
+	NSString *file = [self readString];
+
+	if (nil == file)
+		return nil;
+
+	SCKSourceLocation *location = [SCKSourceLocation new];
+
+	location->file = file;
+	location->offset = (NSUInteger)[self readUnsigned];
+	return location;
+}
+
+/**
+ * The arguments of the records that correspond to a SCKIndexSink method, in 
+ * the order SCKIndexRecorder writes them: a location ('l'), a string ('s'), 
+ * an array of strings ('a'), a BOOL ('b'), an unsigned ('u') or a signed 
+ * ('i') integer.
+ */
+static const char *const sinkRecordArguments[] =
+{
+	[SCKIndexRecordClass] = "lssbb",
+	[SCKIndexRecordCategory] = "lsbs",
+	[SCKIndexRecordMethod] = "lssbbss",
+	[SCKIndexRecordFunction] = "lssbb",
+	[SCKIndexRecordVariable] = "lssb",
+	[SCKIndexRecordClassProperty] = "lssubs",
+	[SCKIndexRecordMacro] = "ls",
+	[SCKIndexRecordIvar] = "lssbs",
+	[SCKIndexRecordProtocol] = "lsb",
+	[SCKIndexRecordProtocolMethod] = "lssbbbs",
+	[SCKIndexRecordProtocolProperty] = "lssubbs",
+	[SCKIndexRecordCategoryProperty] = "lssubss",
+	[SCKIndexRecordEnumeration] = "ls",
+	[SCKIndexRecordEnumerationValue] = "lssis",
+	[SCKIndexRecordAdoptedProtocols] = "ass",
+	[SCKIndexRecordInheritedProtocols] = "as",
+	// The comment, included file and parsed file records are replayed by the caller
+	[SCKIndexRecordOccurrence] = "uuussll"
+};
+
+#define SINK_RECORD_MAX_ARGUMENTS 7
+
+- (BOOL)replayRecordOfKind: (enum SCKIndexRecordKind)aKind
+                  intoSink: (id <SCKIndexSink>)aSink
+                 component: (SCKProgramComponent **)aComponent
+{
+	const char *arguments = ((NSUInteger)aKind < sizeof(sinkRecordArguments) / sizeof(*sinkRecordArguments) ?
+		sinkRecordArguments[aKind] : NULL);
+
+	if (NULL == arguments)
+		return NO;
+
+	id o[SINK_RECORD_MAX_ARGUMENTS];
+	unsigned long long n[SINK_RECORD_MAX_ARGUMENTS] = { 0 };
+
+	for (int i = 0; '\0' != arguments[i]; i++)
+	{
+		switch (arguments[i])
+		{
+			case 'l': o[i] = [self readLocation]; break;
+			case 's': o[i] = [self readString]; break;
+			case 'a': o[i] = [self readStrings]; break;
+			case 'b': n[i] = [self readBool]; break;
+			case 'i': n[i] = (unsigned long long)[self readSigned]; break;
+			default: n[i] = [self readUnsigned]; break;
+		}
+	}
+	if (!isValid)
+		return YES;
+
+	switch (aKind)
+	{
+		case SCKIndexRecordClass:
+			*aComponent = [aSink setLocation: o[0]
+			                        forClass: o[1]
+			                  withSuperclass: o[2]
+			                    isDefinition: n[3]
+			            isForwardDeclaration: n[4]];
+			break;
+		case SCKIndexRecordCategory:
+			*aComponent = [aSink setLocation: o[0]
+			                     forCategory: o[1]
+			                    isDefinition: n[2]
+			                         ofClass: o[3]];
+			break;
+		case SCKIndexRecordMethod:
+			*aComponent = [aSink setLocation: o[0]
+			                       forMethod: o[1]
+			                withTypeEncoding: o[2]
+			                   isClassMethod: n[3]
+			                    isDefinition: n[4]
+			                         inClass: o[5]
+			                        category: o[6]];
+			break;
+		case SCKIndexRecordFunction:
+			*aComponent = [aSink setLocation: o[0]
+			                     forFunction: o[1]
+			                withTypeEncoding: o[2]
+			                        isStatic: n[3]
+			                    isDefinition: n[4]];
+			break;
+		case SCKIndexRecordVariable:
+			*aComponent = [aSink setLocation: o[0]
+			                     forVariable: o[1]
+			                withTypeEncoding: o[2]
+			                    isDefinition: n[3]];
+			break;
+		case SCKIndexRecordClassProperty:
+			*aComponent = [aSink setLocation: o[0]
+			                     forProperty: o[1]
+			                withTypeEncoding: o[2]
+			                      attributes: (CXObjCPropertyAttrKind)n[3]
+			                      isIBOutlet: n[4]
+			                         inClass: o[5]];
+			break;
+		case SCKIndexRecordMacro:
+			*aComponent = [aSink setLocation: o[0] forMacro: o[1]];
+			break;
+		case SCKIndexRecordIvar:
+			*aComponent = [aSink setLocation: o[0]
+			                         forIvar: o[1]
+			                withTypeEncoding: o[2]
+			                      isIBOutlet: n[3]
+			                         inClass: o[4]];
+			break;
+		case SCKIndexRecordProtocol:
+			*aComponent = [aSink setLocation: o[0]
+			                     forProtocol: o[1]
+			            isForwardDeclaration: n[2]];
+			break;
+		case SCKIndexRecordProtocolMethod:
+			*aComponent = [aSink setLocation: o[0]
+			                       forMethod: o[1]
+			                withTypeEncoding: o[2]
+			                   isClassMethod: n[3]
+			                      isRequired: n[4]
+			                    isDefinition: n[5]
+			                      inProtocol: o[6]];
+			break;
+		case SCKIndexRecordProtocolProperty:
+			*aComponent = [aSink setLocation: o[0]
+			                     forProperty: o[1]
+			                withTypeEncoding: o[2]
+			                      attributes: (CXObjCPropertyAttrKind)n[3]
+			                      isIBOutlet: n[4]
+			                      isRequired: n[5]
+			                      inProtocol: o[6]];
+			break;
+		case SCKIndexRecordCategoryProperty:
+			*aComponent = [aSink setLocation: o[0]
+			                     forProperty: o[1]
+			                withTypeEncoding: o[2]
+			                      attributes: (CXObjCPropertyAttrKind)n[3]
+			                    isDefinition: n[4]
+			                         inClass: o[5]
+			                        category: o[6]];
+			break;
+		case SCKIndexRecordEnumeration:
+			*aComponent = [aSink setLocation: o[0] forEnumeration: o[1]];
+			break;
+		case SCKIndexRecordEnumerationValue:
+			*aComponent = [aSink setLocation: o[0]
+			             forEnumerationValue: o[1]
+			                withTypeEncoding: o[2]
+			                           value: (long long)n[3]
+			                   inEnumeration: o[4]];
+			break;
+		case SCKIndexRecordAdoptedProtocols:
+			[aSink setAdoptedProtocols: o[0]
+			                  forClass: o[1]
+			                  category: o[2]];
+			break;
+		case SCKIndexRecordInheritedProtocols:
+			[aSink setAdoptedProtocols: o[0] forProtocol: o[1]];
+			break;
+		case SCKIndexRecordOccurrence:
+			if (n[2] > SCKOccurrenceKindReference)
+			{
+				isValid = NO;
+				break;
+			}
+			[aSink recordOccurrenceWithRange: NSMakeRange((NSUInteger)n[0], (NSUInteger)n[1])
+			                            kind: (SCKOccurrenceKind)n[2]
+			                            name: o[3]
+			                             USR: o[4]
+			                     declaration: o[5]
+			                      definition: o[6]];
+			break;
+		default:
+			break;
+	}
+	return YES;
+}
+
+@end
+
+@implementation SCKIndexRecorder
+{
+	SCKIndexRecordWriter *writer;
+	/** The file of the last declaration without comment, and its name. */
+	CXFile lastDeclarationFile;
+	NSString *lastDeclarationFileName;
+}
+
+- (id)initWithWriter: (SCKIndexRecordWriter*)aWriter
+{
+	NILARG_EXCEPTION_TEST(aWriter);
+	SUPERINIT;
+	writer = aWriter;
+	return self;
+}
+
+- (SCKClass*)setLocation: (SCKSourceLocation*)aLocation
+                forClass: (NSString*)aClassName
+          withSuperclass: (NSString*)aSuperclassName
+            isDefinition: (BOOL)isDefinition
+    isForwardDeclaration: (BOOL)isForwardDeclaration
+{
+	[writer writeKind: SCKIndexRecordClass];
+	[writer writeLocation: aLocation];
+	[writer writeString: aClassName];
+	[writer writeString: aSuperclassName];
+	[writer writeBool: isDefinition];
+	[writer writeBool: isForwardDeclaration];
+	return nil;
+}
+
+- (SCKCategory*)setLocation: (SCKSourceLocation*)aLocation
+                forCategory: (NSString*)aCategoryName
+               isDefinition: (BOOL)isDefinition
+                    ofClass: (NSString*)aClassName
+{
+	[writer writeKind: SCKIndexRecordCategory];
+	[writer writeLocation: aLocation];
+	[writer writeString: aCategoryName];
+	[writer writeBool: isDefinition];
+	[writer writeString: aClassName];
+	return nil;
+}
+
+- (SCKMethod*)setLocation: (SCKSourceLocation*)aLocation
+                forMethod: (NSString*)methodName
+         withTypeEncoding: (NSString*)typeEncoding
+            isClassMethod: (BOOL)isClassMethod
+             isDefinition: (BOOL)isDefinition
+                  inClass: (NSString*)className
+                 category: (NSString*)categoryName
+{
+	[writer writeKind: SCKIndexRecordMethod];
+	[writer writeLocation: aLocation];
+	[writer writeString: methodName];
+	[writer writeString: typeEncoding];
+	[writer writeBool: isClassMethod];
+	[writer writeBool: isDefinition];
+	[writer writeString: className];
+	[writer writeString: categoryName];
+	return nil;
+}
+
+- (SCKFunction*)setLocation: (SCKSourceLocation*)l
+                forFunction: (NSString*)name
+           withTypeEncoding: (NSString*)type
+                   isStatic: (BOOL)isStatic
+               isDefinition: (BOOL)isDefinition
+{
+	[writer writeKind: SCKIndexRecordFunction];
+	[writer writeLocation: l];
+	[writer writeString: name];
+	[writer writeString: type];
+	[writer writeBool: isStatic];
+	[writer writeBool: isDefinition];
+	return nil;
+}
+
+- (SCKGlobal*)setLocation: (SCKSourceLocation*)l
+              forVariable: (NSString*)name
+         withTypeEncoding: (NSString*)type
+             isDefinition: (BOOL)isDefinition
+{
+	[writer writeKind: SCKIndexRecordVariable];
+	[writer writeLocation: l];
+	[writer writeString: name];
+	[writer writeString: type];
+	[writer writeBool: isDefinition];
+	return nil;
+}
+
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)propertyAttributes
+                 isIBOutlet: (BOOL)isIBOutlet
+                    inClass: (NSString *)className
+{
+	[writer writeKind: SCKIndexRecordClassProperty];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: propertyName];
+	[writer writeString: typeEncoding];
+	[writer writeUnsigned: propertyAttributes];
+	[writer writeBool: isIBOutlet];
+	[writer writeString: className];
+	return nil;
+}
+
+- (SCKMacro*)setLocation: (SCKSourceLocation*)sourceLocation
+                forMacro: (NSString*)macroName
+{
+	[writer writeKind: SCKIndexRecordMacro];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: macroName];
+	return nil;
+}
+
+- (SCKIvar*)setLocation: (SCKSourceLocation*)sourceLocation
+                forIvar: (NSString*)ivarName
+       withTypeEncoding: (NSString*)typeEncoding
+             isIBOutlet: (BOOL)isIBOutlet
+                inClass: (NSString*)className
+{
+	[writer writeKind: SCKIndexRecordIvar];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: ivarName];
+	[writer writeString: typeEncoding];
+	[writer writeBool: isIBOutlet];
+	[writer writeString: className];
+	return nil;
+}
+
+- (SCKProtocol*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProtocol: (NSString*)protocolName
+       isForwardDeclaration: (BOOL)isForwardDeclaration
+{
+	[writer writeKind: SCKIndexRecordProtocol];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: protocolName];
+	[writer writeBool: isForwardDeclaration];
+	return nil;
+}
+
+- (SCKMethod*)setLocation: (SCKSourceLocation*)sourceLocation
+                forMethod: (NSString*)methodName
+         withTypeEncoding: (NSString*)typeEncoding
+            isClassMethod: (BOOL)isClassMethod
+               isRequired: (BOOL)isRequired
+             isDefinition: (BOOL)isDefinition
+               inProtocol: (NSString*)protocolName
+{
+	[writer writeKind: SCKIndexRecordProtocolMethod];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: methodName];
+	[writer writeString: typeEncoding];
+	[writer writeBool: isClassMethod];
+	[writer writeBool: isRequired];
+	[writer writeBool: isDefinition];
+	[writer writeString: protocolName];
+	return nil;
+}
+
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)attributes
+                 isIBOutlet: (BOOL)isIBOutlet
+                 isRequired: (BOOL)isRequired
+                 inProtocol: (NSString*)protocolName
+{
+	[writer writeKind: SCKIndexRecordProtocolProperty];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: propertyName];
+	[writer writeString: typeEncoding];
+	[writer writeUnsigned: attributes];
+	[writer writeBool: isIBOutlet];
+	[writer writeBool: isRequired];
+	[writer writeString: protocolName];
+	return nil;
+}
+
+- (SCKProperty*)setLocation: (SCKSourceLocation*)sourceLocation
+                forProperty: (NSString*)propertyName
+           withTypeEncoding: (NSString*)typeEncoding
+                 attributes: (CXObjCPropertyAttrKind)attributes
+               isDefinition: (BOOL)isDefinition
+                    inClass: (NSString*)className
+                   category: (NSString*)categoryName
+{
+	[writer writeKind: SCKIndexRecordCategoryProperty];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: propertyName];
+	[writer writeString: typeEncoding];
+	[writer writeUnsigned: attributes];
+	[writer writeBool: isDefinition];
+	[writer writeString: className];
+	[writer writeString: categoryName];
+	return nil;
+}
+
+- (SCKEnumeration*)setLocation: (SCKSourceLocation*)sourceLocation
+                forEnumeration: (NSString*)enumName
+{
+	[writer writeKind: SCKIndexRecordEnumeration];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: enumName];
+	return nil;
+}
+
+- (SCKEnumerationValue*)setLocation: (SCKSourceLocation*)sourceLocation
+                forEnumerationValue: (NSString*)valueName
+                   withTypeEncoding: (NSString*)typeEncoding
+                              value: (long long)aValue
+                      inEnumeration: (NSString*)enumName
+{
+	[writer writeKind: SCKIndexRecordEnumerationValue];
+	[writer writeLocation: sourceLocation];
+	[writer writeString: valueName];
+	[writer writeString: typeEncoding];
+	[writer writeSigned: aValue];
+	[writer writeString: enumName];
+	return nil;
+}
+
+- (void)setAdoptedProtocols: (NSArray*)protocolNames
+                   forClass: (NSString*)className
+                   category: (NSString*)categoryName
+{
+	[writer writeKind: SCKIndexRecordAdoptedProtocols];
+	[writer writeStrings: protocolNames];
+	[writer writeString: className];
+	[writer writeString: categoryName];
+}
+
+- (void)setAdoptedProtocols: (NSArray*)protocolNames
+                forProtocol: (NSString*)protocolName
+{
+	[writer writeKind: SCKIndexRecordInheritedProtocols];
+	[writer writeStrings: protocolNames];
+	[writer writeString: protocolName];
+}
+
+- (void)recordOccurrenceWithRange: (NSRange)aRange
+                             kind: (SCKOccurrenceKind)aKind
+                             name: (NSString*)aName
+                              USR: (NSString*)aUSR
+                      declaration: (SCKSourceLocation*)aDeclaration
+                       definition: (SCKSourceLocation*)aDefinition
+{
+	[writer writeKind: SCKIndexRecordOccurrence];
+	[writer writeUnsigned: aRange.location];
+	[writer writeUnsigned: aRange.length];
+	[writer writeUnsigned: aKind];
+	[writer writeString: aName];
+	[writer writeString: aUSR];
+	[writer writeLocation: aDeclaration];
+	[writer writeLocation: aDefinition];
+}
+
+- (void)recordCommentOfCursor: (CXCursor)cursor forComponent: (SCKProgramComponent*)aComponent
+{
+	CXSourceRange range = clang_Cursor_getCommentRange(cursor);
+
+	/* Most declarations have no comment, the record is only replayed to 
+	   remove a previous comment recorded from the declaration file, so the 
+	   declaration location is written without creating a SCKSourceLocation */
+	if (clang_Range_isNull(range))
+	{
+		CXFile declarationFile = NULL;
+		unsigned offset = 0;
+
+		clang_getInstantiationLocation(clang_getCursorLocation(cursor), &declarationFile, 0, 0, &offset);
+		if (declarationFile != lastDeclarationFile || nil == lastDeclarationFileName)
+		{
+			CXString fileName = clang_getFileName(declarationFile);
+			const char *cFileName = clang_getCString(fileName);
+
+			lastDeclarationFile = declarationFile;
+			lastDeclarationFileName = (NULL != cFileName ? [NSString stringWithUTF8String: cFileName] : nil);
+			clang_disposeString(fileName);
+		}
+		[writer writeKind: SCKIndexRecordComment];
+		[writer writeLocation: nil];
+		[writer writeUnsigned: 0];
+		[writer writeString: lastDeclarationFileName];
+		if (nil != lastDeclarationFileName)
+		{
+			[writer writeUnsigned: offset];
+		}
+		return;
+	}
+
+	unsigned start = 0, end = 0;
+
+	clang_getInstantiationLocation(clang_getRangeStart(range), 0, 0, 0, &start);
+	clang_getInstantiationLocation(clang_getRangeEnd(range), 0, 0, 0, &end);
+
+	[writer writeKind: SCKIndexRecordComment];
+	[writer writeLocation: [[SCKSourceLocation alloc] initWithClangSourceLocation: clang_getRangeStart(range)]];
+	[writer writeUnsigned: end - start];
+	[writer writeLocation: [[SCKSourceLocation alloc]
+		initWithClangSourceLocation: clang_getCursorLocation(cursor)]];
+}
+
+@end
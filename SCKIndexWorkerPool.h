@@ -0,0 +1,96 @@
+#import <Foundation/NSObject.h>
+
+@class NSArray, NSString;
+
+/**
+ * A pool of worker processes that parse and index source files on behalf of
+ * a source collection.
+ *
+ * libclang crash recovery is disabled (it is not reliable with the blocks
+ * based visitors), so a libclang crash on pathological code would take down
+ * the whole process. Parsing in worker processes isolates such crashes, caps
+ * the memory used by each parse, and spreads bulk indexing over several
+ * processors.
+ *
+ * The worker executable is the sckindexworker tool (built with
+ * 'make worker=yes'). Each worker parses one file at a time, and sends back
+ * the program components as a compact binary record stream, which is replayed
+ * in the current process, so the resulting SCKSourceFile objects are the same
+ * as for an in-process parse.
+ *
+ * The pool is used for the index-only files of the collections it is set on
+ * (see -[SCKSourceCollection setIndexWorkerPool:]). Files whose -source is set
+ * are parsed in the current process, since they keep their parser state for
+ * highlighting and completion.
+ *
+ * A pool must be used on a single thread, usually the one where the
+ * collection indexes files. Sending a request to a worker that died doesn't 
+ * raise SIGPIPE, and the SIGPIPE handler of the process is left unchanged.
+ */
+@interface SCKIndexWorkerPool : NSObject
+
+/**
+ * <init />
+ * Initializes and returns a pool that runs up to the given number of worker
+ * processes launched from the executable at the given path.
+ *
+ * The workers are launched the first time they are needed.
+ *
+ * When the path is nil or the count is zero, raises a
+ * NSInvalidArgumentException.
+ */
+- (id)initWithWorkerPath: (NSString *)aPath workerCount: (NSUInteger)aCount;
+
+/**
+ * The path of the worker executable.
+ */
+@property (nonatomic, readonly) NSString *workerPath;
+/**
+ * The maximum number of worker processes running concurrently.
+ */
+@property (nonatomic, readonly) NSUInteger workerCount;
+/**
+ * The maximum address space of each worker process in bytes, or 0 for no
+ * limit.
+ *
+ * A worker that reaches the limit fails to allocate memory and exits, like a
+ * worker that crashed.
+ *
+ * Only applies to the workers launched after it was set.
+ */
+@property (nonatomic, assign) unsigned long long memoryLimit;
+/**
+ * The maximum time in seconds a worker can spend parsing a file, or 0 for no
+ * limit. 60 seconds by default.
+ *
+ * A worker that doesn't respond in time is killed with SIGKILL, like a worker
+ * that crashed.
+ */
+@property (nonatomic, assign) NSTimeInterval parseTimeout;
+/**
+ * The number of parses that failed because a worker crashed, timed out, was
+ * killed or could not be launched.
+ */
+@property (nonatomic, readonly) NSUInteger failureCount;
+
+/**
+ * Parses the given SCKClangSourceFile objects in the worker processes, and
+ * collects their program components in the current thread as each worker
+ * responds.
+ *
+ * Files are parsed concurrently by up to -workerCount workers. The files are
+ * parsed even if they didn't change since their last parse.
+ *
+ * A worker that crashes or times out is relaunched for the next file, the program
+ * components of the file it was parsing are kept as they were, and the file
+ * is parsed again by its next -reparse.
+ */
+- (void)reparseFiles: (NSArray *)sourceFiles;
+/**
+ * Terminates the worker processes.
+ *
+ * The workers are launched again by the next -reparseFiles:.
+ */
+- (void)terminateWorkers;
+
+@end
@@ -0,0 +1,378 @@
+#import "SCKIndexWorkerPool.h"
+#import "SCKClangSourceFile.h"
+#import "SCKMetrics.h"
+#import <EtoileFoundation/EtoileFoundation.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/*
+ * Requests and responses are sent through the worker standard input and
+ * output. Each one is prefixed with its length as a 32-bit integer in host
+ * byte order.
+ *
+ * The standard input is a socket rather than a pipe, so writing to a worker
+ * that exited fails with EPIPE instead of raising SIGPIPE, without changing
+ * the SIGPIPE handler of the process.
+ */
+
+#ifdef MSG_NOSIGNAL
+#	define SEND_FLAGS MSG_NOSIGNAL
+#else
+#	define SEND_FLAGS 0
+#endif
+
+static BOOL sendFully(int fd, const void *bytes, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = send(fd, bytes, length, SEND_FLAGS);
+
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return NO;
+		}
+		bytes = (const char *)bytes + written;
+		length -= written;
+	}
+	return YES;
+}
+
+/**
+ * A worker process and the file it is parsing.
+ */
+@interface SCKIndexWorker : NSObject
+{
+	@public
+	/** Worker process, or -1 when not launched. */
+	pid_t pid;
+	/** Write end of the worker standard input. */
+	int requestFD;
+	/** Read end of the worker standard output. */
+	int responseFD;
+	/** Index of the file being parsed, or NSNotFound when idle. */
+	NSUInteger fileIndex;
+	/** SCKMetricsNow() time when the parse times out, or 0 for no limit. */
+	double deadline;
+	/** Bytes of the response received so far. */
+	NSMutableData *response;
+}
+- (BOOL)launchWithPath: (NSString *)aPath memoryLimit: (unsigned long long)aLimit;
+- (BOOL)sendRequest: (NSData *)aRequest;
+- (NSData *)readResponseIsClosed: (BOOL *)isClosed;
+- (void)terminate;
+@end
+
+@implementation SCKIndexWorker
+
+- (id)init
+{
+	SUPERINIT;
+	pid = -1;
+	requestFD = -1;
+	responseFD = -1;
+	fileIndex = NSNotFound;
+	response = [NSMutableData new];
+	return self;
+}
+
+- (void)dealloc
+{
+	[self terminate];
+}
+
+- (BOOL)launchWithPath: (NSString *)aPath memoryLimit: (unsigned long long)aLimit
+{
+	int requestSockets[2];
+	int responsePipe[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, requestSockets) != 0)
+		return NO;
+#ifdef SO_NOSIGPIPE
+	int noSigPipe = 1;
+
+	setsockopt(requestSockets[1], SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+	if (pipe(responsePipe) != 0)
+	{
+		close(requestSockets[0]);
+		close(requestSockets[1]);
+		return NO;
+	}
+	// Other workers must not inherit the sockets and pipes, or they would never see EOF
+	for (int i = 0; i < 2; i++)
+	{
+		fcntl(requestSockets[i], F_SETFD, FD_CLOEXEC);
+		fcntl(responsePipe[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	posix_spawn_file_actions_t actions;
+	const char *path = [aPath fileSystemRepresentation];
+	const char *limit = [[NSString stringWithFormat: @"%llu", aLimit] UTF8String];
+	char *argv[] = { (char *)path, (char *)"-memoryLimit", (char *)limit, NULL };
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, requestSockets[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, responsePipe[1], STDOUT_FILENO);
+
+	int error = posix_spawn(&pid, path, &actions, NULL, argv, environ);
+
+	posix_spawn_file_actions_destroy(&actions);
+	close(requestSockets[0]);
+	close(responsePipe[1]);
+
+	if (error != 0)
+	{
+		NSLog(@"WARNING: failed to launch the index worker %@: %s", aPath, strerror(error));
+		close(requestSockets[1]);
+		close(responsePipe[0]);
+		pid = -1;
+		return NO;
+	}
+	requestFD = requestSockets[1];
+	responseFD = responsePipe[0];
+	return YES;
+}
+
+- (BOOL)sendRequest: (NSData *)aRequest
+{
+	uint32_t length = (uint32_t)[aRequest length];
+
+	return (sendFully(requestFD, &length, sizeof(length))
+		&& sendFully(requestFD, [aRequest bytes], length));
+}
+
+/**
+ * Reads the bytes available from the worker, and returns the response once
+ * it is complete, otherwise returns nil.
+ *
+ * isClosed is set to YES when the worker exited before responding.
+ */
+- (NSData *)readResponseIsClosed: (BOOL *)isClosed
+{
+	char buffer[65536];
+	ssize_t count = read(responseFD, buffer, sizeof(buffer));
+	uint32_t length = 0;
+
+	*isClosed = NO;
+	if (count < 0 && errno == EINTR)
+		return nil;
+
+	if (count <= 0)
+	{
+		*isClosed = YES;
+		return nil;
+	}
+	[response appendBytes: buffer length: count];
+
+	if ([response length] < sizeof(length))
+		return nil;
+
+	memcpy(&length, [response bytes], sizeof(length));
+	if ([response length] < sizeof(length) + length)
+		return nil;
+
+	NSData *payload = [response subdataWithRange: NSMakeRange(sizeof(length), length)];
+
+	[response setLength: 0];
+	return payload;
+}
+
+- (void)terminate
+{
+	if (requestFD >= 0)
+	{
+		close(requestFD);
+		requestFD = -1;
+	}
+	if (responseFD >= 0)
+	{
+		close(responseFD);
+		responseFD = -1;
+	}
+	if (pid > 0)
+	{
+		// Closing the standard input lets an idle worker exit by itself
+		if (fileIndex != NSNotFound)
+		{
+			kill(pid, SIGKILL);
+		}
+		waitpid(pid, NULL, 0);
+		pid = -1;
+	}
+	fileIndex = NSNotFound;
+	deadline = 0;
+	[response setLength: 0];
+}
+
+@end
+
+@implementation SCKIndexWorkerPool
+{
+	NSString *workerPath;
+	NSUInteger workerCount;
+	unsigned long long memoryLimit;
+	NSUInteger failureCount;
+	NSTimeInterval parseTimeout;
+	/** SCKIndexWorker objects, whose processes are launched lazily. */
+	NSMutableArray *workers;
+}
+
+@synthesize workerPath, workerCount, memoryLimit, failureCount, parseTimeout;
+
+- (id)initWithWorkerPath: (NSString *)aPath workerCount: (NSUInteger)aCount
+{
+	NILARG_EXCEPTION_TEST(aPath);
+	INVALIDARG_EXCEPTION_TEST(aCount, aCount > 0);
+	SUPERINIT;
+	workerPath = [aPath copy];
+	workerCount = aCount;
+	parseTimeout = 60;
+	workers = [NSMutableArray new];
+	for (NSUInteger i = 0; i < workerCount; i++)
+	{
+		[workers addObject: [SCKIndexWorker new]];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self terminateWorkers];
+}
+
+- (void)terminateWorkers
+{
+	for (SCKIndexWorker *worker in workers)
+	{
+		[worker terminate];
+	}
+}
+
+- (void)failParseOfFile: (SCKClangSourceFile *)aFile byWorker: (SCKIndexWorker *)aWorker
+{
+	failureCount++;
+	[aWorker terminate];
+	[aFile reparseWithIndexWorkerResponse: nil];
+}
+
+- (void)reparseFiles: (NSArray *)sourceFiles
+{
+	NSUInteger count = [sourceFiles count];
+	NSUInteger nextIndex = 0;
+	NSUInteger completedCount = 0;
+	struct pollfd fds[workerCount];
+	__unsafe_unretained SCKIndexWorker *polledWorkers[workerCount];
+
+	while (completedCount < count)
+	{
+		nfds_t pollCount = 0;
+		double nextDeadline = 0;
+
+		for (SCKIndexWorker *worker in workers)
+		{
+			while (worker->fileIndex == NSNotFound && nextIndex < count)
+			{
+				SCKClangSourceFile *file = [sourceFiles objectAtIndex: nextIndex];
+				BOOL isLaunched = (worker->pid > 0
+					|| [worker launchWithPath: workerPath memoryLimit: memoryLimit]);
+
+				if (isLaunched && [worker sendRequest: [file indexWorkerRequest]])
+				{
+					worker->fileIndex = nextIndex;
+					worker->deadline = (parseTimeout > 0 ? SCKMetricsNow() + parseTimeout : 0);
+				}
+				else
+				{
+					[self failParseOfFile: file byWorker: worker];
+					completedCount++;
+				}
+				nextIndex++;
+			}
+			if (worker->fileIndex != NSNotFound)
+			{
+				fds[pollCount].fd = worker->responseFD;
+				fds[pollCount].events = POLLIN;
+				fds[pollCount].revents = 0;
+				polledWorkers[pollCount] = worker;
+				pollCount++;
+				if (worker->deadline > 0 && (0 == nextDeadline || worker->deadline < nextDeadline))
+				{
+					nextDeadline = worker->deadline;
+				}
+			}
+		}
+
+		if (0 == pollCount)
+			continue;
+
+		int timeout = -1;
+
+		if (nextDeadline > 0)
+		{
+			timeout = (int)MAX(0, ceil((nextDeadline - SCKMetricsNow()) * 1000));
+		}
+		if (poll(fds, pollCount, timeout) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			[NSException raise: NSInternalInconsistencyException
+			            format: @"Failed to wait for the index workers: %s", strerror(errno)];
+		}
+
+		for (nfds_t i = 0; i < pollCount; i++)
+		{
+			if (0 == fds[i].revents)
+				continue;
+
+			SCKIndexWorker *worker = polledWorkers[i];
+			SCKClangSourceFile *file = [sourceFiles objectAtIndex: worker->fileIndex];
+			BOOL isClosed = NO;
+			NSData *response = [worker readResponseIsClosed: &isClosed];
+
+			if (nil != response)
+			{
+				worker->fileIndex = NSNotFound;
+				[file reparseWithIndexWorkerResponse: response];
+				completedCount++;
+			}
+			else if (isClosed)
+			{
+				[self failParseOfFile: file byWorker: worker];
+				completedCount++;
+			}
+		}
+
+		double now = SCKMetricsNow();
+
+		for (nfds_t i = 0; i < pollCount; i++)
+		{
+			SCKIndexWorker *worker = polledWorkers[i];
+
+			if (worker->fileIndex == NSNotFound || 0 == worker->deadline || now < worker->deadline)
+				continue;
+
+			SCKClangSourceFile *file = [sourceFiles objectAtIndex: worker->fileIndex];
+
+			NSLog(@"WARNING: the index worker timed out parsing %@", [file fileName]);
+			// Terminating a busy worker kills it
+			[self failParseOfFile: file byWorker: worker];
+			completedCount++;
+		}
+	}
+}
+
+@end
@@ -0,0 +1,168 @@
+#import <Foundation/NSObject.h>
+
+@class NSArray, NSString, SCKSourceCollection, SCKSourceFile;
+
+/**
+ * Posted each time a scheduler indexed some of the files it was given.
+ *
+ * The notification object is the scheduler. The user info contains the paths
+ * of the indexed files under SCKIndexedPathsKey.
+ */
+extern NSString * const SCKIndexingSchedulerDidIndexFilesNotification;
+/** Key for the standardized paths of the indexed files (as a NSArray). */
+extern NSString * const SCKIndexedPathsKey;
+
+/**
+ * The priorities of the files waiting to be indexed, from the most urgent
+ * to the least urgent one.
+ */
+typedef enum
+{
+	/** Files open in an editor. */
+	SCKIndexingPriorityOpenFile,
+	/**
+	 * Files related to an open file: its companions (e.g. the header of an
+	 * implementation file), the files it includes and the files that include
+	 * it.
+	 */
+	SCKIndexingPriorityRelatedFile,
+	/** The other files of a project, indexed at background priority. */
+	SCKIndexingPriorityBackground,
+	SCKIndexingPriorityCount
+} SCKIndexingPriority;
+
+/**
+ * Orders the parsing and indexing of the files of a source collection, so
+ * the file the user just opened doesn't wait behind thousands of files
+ * indexed in the background.
+ *
+ * Files are queued with a priority, and indexed in the priority order, then
+ * in the order they were queued. A file queued again with a more urgent
+ * priority moves to the more urgent queue.
+ *
+ * The queued files are indexed in short slices on a background indexing
+ * thread, so parsing never blocks the thread that called -start (usually the
+ * main thread). The slices are started, and
+ * SCKIndexingSchedulerDidIndexFilesNotification is posted, from the run loop
+ * of the thread that called -start in the default mode, so indexing is
+ * suspended while the run loop runs in another mode (e.g. event tracking).
+ *
+ * The collection is single-threaded, so while the scheduler is running, the
+ * collection must only be used in -performBlockAndWait: (the symbols can
+ * also be read through -[SCKSourceCollection symbolSnapshot]). Such blocks
+ * run between two batches of files, so they wait for one file (or one batch)
+ * at most. The files with the background priority are parsed with
+ * -[SCKSourceCollection parsesWithBackgroundPriority] set, which lowers the
+ * priority of the libclang parsing threads. The indexing thread priority is 
+ * restored after each slice, so the blocks and the opened files someone waits 
+ * for run with the normal priority.
+ *
+ * The source files reparsed on the indexing thread post 
+ * SCKSourceFileDidReparseNotification on this thread, so their observers 
+ * must not assume they run on the main thread.
+ *
+ * When the collection has an index worker pool and creates index-only files,
+ * the files are indexed in batches of -[SCKIndexWorkerPool workerCount] files.
+ */
+@interface SCKIndexingScheduler : NSObject
+
+/**
+ * <init />
+ * Initializes and returns a stopped scheduler that indexes files with the
+ * given source collection.
+ *
+ * When the collection is nil, raises a NSInvalidArgumentException.
+ */
+- (id)initWithSourceCollection: (SCKSourceCollection *)aCollection;
+
+@property (nonatomic, readonly) SCKSourceCollection *sourceCollection;
+/**
+ * The maximum time spent indexing files in a slice, before returning to the
+ * run loop, in seconds.
+ *
+ * A slice indexes at least one file (or one batch of files), so a slice can
+ * take longer to parse a large file.
+ *
+ * By default, returns 0.05.
+ */
+@property (nonatomic, assign) NSTimeInterval sliceDuration;
+/**
+ * Whether -start was called and -stop wasn't called since then.
+ */
+@property (nonatomic, readonly) BOOL isRunning;
+/**
+ * The number of queued files waiting to be indexed, including the files being
+ * indexed whose SCKIndexingSchedulerDidIndexFilesNotification wasn't posted 
+ * yet.
+ */
+@property (nonatomic, readonly) NSUInteger pendingFileCount;
+
+/**
+ * Queues the file at the given path to be indexed with the given priority.
+ *
+ * If the file is already queued with a more urgent priority, does nothing.
+ *
+ * When the path is nil, raises a NSInvalidArgumentException.
+ */
+- (void)scheduleFileAtPath: (NSString *)aPath priority: (SCKIndexingPriority)aPriority;
+/**
+ * Returns the standardized paths of the files queued with the given priority,
+ * in the order they will be indexed.
+ */
+- (NSArray *)pendingPathsWithPriority: (SCKIndexingPriority)aPriority;
+/**
+ * Indexes the file at the given path right away (unless it was already
+ * indexed), and returns its source file, or nil if it couldn't be created.
+ *
+ * Call this method when a file is opened in an editor. Its companions (the
+ * files with the same name and another supported extension, in the same
+ * directory), and the queued files that it includes or that include it are
+ * queued with SCKIndexingPriorityRelatedFile, so they are indexed before
+ * the background files.
+ *
+ * The file is indexed on the indexing thread, while the caller waits, and 
+ * SCKIndexingSchedulerDidIndexFilesNotification is posted on the calling 
+ * thread.
+ *
+ * When the path is nil, raises a NSInvalidArgumentException.
+ */
+- (SCKSourceFile *)indexOpenedFileAtPath: (NSString *)aPath;
+/**
+ * Runs the block on the indexing thread, and returns once it ran.
+ *
+ * The running slice (if any) stops after the file it is indexing, so the 
+ * block doesn't wait behind the background files. Blocks can be nested.
+ *
+ * When the block is nil, raises a NSInvalidArgumentException.
+ */
+- (void)performBlockAndWait: (void (^)(void))aBlock;
+
+/**
+ * Starts indexing the queued files in slices on the indexing thread, and 
+ * posting the notifications on the current thread.
+ *
+ * The files queued later are indexed too, until -stop is called.
+ */
+- (void)start;
+/**
+ * Stops indexing the queued files.
+ *
+ * The files that are still queued are kept, and indexed after the next
+ * -start.
+ */
+- (void)stop;
+/**
+ * Indexes the queued files until they are all indexed or -sliceDuration is
+ * elapsed, and posts SCKIndexingSchedulerDidIndexFilesNotification if some
+ * files were indexed.
+ *
+ * Returns whether queued files remain.
+ *
+ * The scheduler runs slices on the indexing thread when it is running, but
+ * this method can be called directly, e.g. to index the queued files 
+ * synchronously. The slice runs on the indexing thread while the caller 
+ * waits, and the notification is posted on the calling thread.
+ */
+- (BOOL)indexNextSlice;
+
+@end
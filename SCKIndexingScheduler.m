@@ -0,0 +1,432 @@
+#import "SCKIndexingScheduler.h"
+#import "SCKIndexWorkerPool.h"
+#import "SCKMetrics.h"
+#import "SCKSourceCollection.h"
+#import "SCKSourceFile.h"
+#import <EtoileFoundation/EtoileFoundation.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+NSString * const SCKIndexingSchedulerDidIndexFilesNotification = @"SCKIndexingSchedulerDidIndexFilesNotification";
+NSString * const SCKIndexedPathsKey = @"SCKIndexedPathsKey";
+
+/**
+ * Restores the scheduling of the current thread, which libclang lowers and 
+ * doesn't restore when it parses with 
+ * CXGlobalOpt_ThreadBackgroundPriorityForIndexing.
+ */
+static void restoreThreadScheduling(int aPolicy, const struct sched_param *aParam)
+{
+	pthread_setschedparam(pthread_self(), aPolicy, aParam);
+#ifdef PRIO_DARWIN_THREAD
+	setpriority(PRIO_DARWIN_THREAD, 0, 0);
+#endif
+}
+
+@implementation SCKIndexingScheduler
+{
+	SCKSourceCollection *sourceCollection;
+	NSTimeInterval sliceDuration;
+	/** Serial queue that runs the slices and the blocks that use the collection. */
+	NSOperationQueue *indexingQueue;
+	/**
+	 * Protects the ivars below, which are used both by the indexing thread 
+	 * and the thread that called -start.
+	 */
+	NSLock *queueLock;
+	BOOL isRunning;
+	/** Whether -runSlice is scheduled, queued or running on the indexing queue. */
+	BOOL isSliceScheduled;
+	/**
+	 * Thread that called -start, whose run loop starts the slices and posts 
+	 * their notifications.
+	 */
+	NSThread *notificationThread;
+	/** Queued paths (as a NSMutableOrderedSet) by priority. */
+	NSArray *queues;
+	/** Priorities of the queued paths (as a NSNumber) by path. */
+	NSMutableDictionary *priorities;
+	/** Dequeued paths whose notification wasn't posted yet. */
+	NSUInteger indexingPathCount;
+	/** Number of -performBlockAndWait: callers waiting for the indexing queue. */
+	NSUInteger waitingBlockCount;
+}
+
+@synthesize sourceCollection, sliceDuration;
+
+- (id)initWithSourceCollection: (SCKSourceCollection *)aCollection
+{
+	NILARG_EXCEPTION_TEST(aCollection);
+	SUPERINIT;
+	ASSIGN(sourceCollection, aCollection);
+	sliceDuration = 0.05;
+	indexingQueue = [NSOperationQueue new];
+	[indexingQueue setMaxConcurrentOperationCount: 1];
+	queueLock = [NSLock new];
+
+	NSMutableArray *newQueues = [NSMutableArray arrayWithCapacity: SCKIndexingPriorityCount];
+
+	for (int i = 0; i < SCKIndexingPriorityCount; i++)
+	{
+		[newQueues addObject: [NSMutableOrderedSet new]];
+	}
+	queues = [newQueues copy];
+	priorities = [NSMutableDictionary new];
+	return self;
+}
+
+- (BOOL)isRunning
+{
+	[queueLock lock];
+	BOOL running = isRunning;
+	[queueLock unlock];
+	return running;
+}
+
+- (NSUInteger)pendingFileCount
+{
+	[queueLock lock];
+	NSUInteger count = [priorities count] + indexingPathCount;
+	[queueLock unlock];
+	return count;
+}
+
+- (NSArray *)pendingPathsWithPriority: (SCKIndexingPriority)aPriority
+{
+	INVALIDARG_EXCEPTION_TEST(aPriority, aPriority < SCKIndexingPriorityCount);
+	[queueLock lock];
+	NSArray *paths = [[queues objectAtIndex: aPriority] array];
+	[queueLock unlock];
+	return paths;
+}
+
+- (void)scheduleSliceIfNeeded
+{
+	[queueLock lock];
+	BOOL isNeeded = (isRunning && !isSliceScheduled && [priorities count] > 0);
+	NSThread *thread = notificationThread;
+
+	if (isNeeded)
+	{
+		isSliceScheduled = YES;
+	}
+	[queueLock unlock];
+
+	if (isNeeded)
+	{
+		// Not started in the event tracking modes, so scrolling or menus are not slowed down
+		[self performSelector: @selector(enqueueSlice)
+		             onThread: thread
+		           withObject: nil
+		        waitUntilDone: NO
+		                modes: A(NSDefaultRunLoopMode)];
+	}
+}
+
+- (void)enqueueSlice
+{
+	[indexingQueue addOperationWithBlock: ^ () { [self runSlice]; }];
+}
+
+/**
+ * Must be called with queueLock held.
+ */
+- (void)schedulePath: (NSString *)path priority: (SCKIndexingPriority)aPriority
+{
+	NSNumber *queuedPriority = [priorities objectForKey: path];
+
+	if (nil != queuedPriority)
+	{
+		if ([queuedPriority intValue] <= aPriority)
+			return;
+
+		[[queues objectAtIndex: [queuedPriority intValue]] removeObject: path];
+	}
+	[[queues objectAtIndex: aPriority] addObject: path];
+	[priorities setObject: [NSNumber numberWithInt: aPriority] forKey: path];
+}
+
+- (void)scheduleFileAtPath: (NSString *)aPath priority: (SCKIndexingPriority)aPriority
+{
+	NILARG_EXCEPTION_TEST(aPath);
+	INVALIDARG_EXCEPTION_TEST(aPriority, aPriority < SCKIndexingPriorityCount);
+	[queueLock lock];
+	[self schedulePath: [aPath stringByStandardizingIntoAbsolutePath] priority: aPriority];
+	[queueLock unlock];
+	[self scheduleSliceIfNeeded];
+}
+
+/**
+ * Must be called with queueLock held.
+ */
+- (void)unschedulePath: (NSString *)path
+{
+	NSNumber *queuedPriority = [priorities objectForKey: path];
+
+	if (nil == queuedPriority)
+		return;
+
+	[[queues objectAtIndex: [queuedPriority intValue]] removeObject: path];
+	[priorities removeObjectForKey: path];
+}
+
+- (void)postDidIndexFilesAtPaths: (NSArray *)paths
+{
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: SCKIndexingSchedulerDidIndexFilesNotification
+		              object: self
+		            userInfo: D(paths, SCKIndexedPathsKey)];
+}
+
+/**
+ * Posts the notification for paths dequeued by a slice, which are no longer 
+ * pending once it is posted.
+ */
+- (void)postDidIndexDequeuedFilesAtPaths: (NSArray *)paths
+{
+	[queueLock lock];
+	indexingPathCount -= [paths count];
+	[queueLock unlock];
+	[self postDidIndexFilesAtPaths: paths];
+}
+
+- (void)performBlockAndWait: (void (^)(void))aBlock
+{
+	NILARG_EXCEPTION_TEST(aBlock);
+
+	if ([NSOperationQueue currentQueue] == indexingQueue)
+	{
+		aBlock();
+		return;
+	}
+
+	NSOperation *operation = [NSBlockOperation blockOperationWithBlock: aBlock];
+
+	[queueLock lock];
+	waitingBlockCount++;
+	[queueLock unlock];
+
+	[indexingQueue addOperation: operation];
+	[operation waitUntilFinished];
+
+	[queueLock lock];
+	waitingBlockCount--;
+	[queueLock unlock];
+}
+
+/**
+ * Returns the paths of the files with the same name and another supported
+ * extension in the same directory, that exist on disk.
+ */
+- (NSArray *)companionPathsForPath: (NSString *)path
+{
+	NSFileManager *fileManager = [NSFileManager defaultManager];
+	NSString *basePath = [path stringByDeletingPathExtension];
+	NSMutableArray *companions = [NSMutableArray array];
+
+	for (NSString *extension in [SCKSourceCollection supportedFileExtensions])
+	{
+		NSString *companion = [basePath stringByAppendingPathExtension: extension];
+
+		if (![companion isEqual: path] && [fileManager fileExistsAtPath: companion])
+		{
+			[companions addObject: companion];
+		}
+	}
+	return [companions sortedArrayUsingSelector: @selector(compare:)];
+}
+
+- (SCKSourceFile *)indexOpenedFileAtPath: (NSString *)aPath
+{
+	NILARG_EXCEPTION_TEST(aPath);
+	NSString *path = [aPath stringByStandardizingIntoAbsolutePath];
+	__block SCKSourceFile *file = nil;
+
+	[queueLock lock];
+	[self unschedulePath: path];
+	[queueLock unlock];
+
+	// Someone waits for this file, so it is not parsed with the background priority
+	[self performBlockAndWait: ^ ()
+	{
+		file = [sourceCollection sourceFileForPath: path];
+
+		NSArray *companions = [self companionPathsForPath: path];
+		// Only the queued files are promoted, the other ones are already indexed
+		// or don't belong to the files to index (e.g. system headers)
+		NSMutableArray *relatedPaths =
+			[[[sourceCollection includedFilesForFile: path] allObjects] mutableCopy];
+
+		[relatedPaths sortUsingSelector: @selector(compare:)];
+		for (SCKSourceFile *dependent in [sourceCollection filesIncludingFile: path])
+		{
+			[relatedPaths addObject: [dependent fileName]];
+		}
+
+		[queueLock lock];
+		for (NSString *companion in companions)
+		{
+			if (nil == [[sourceCollection files] objectForKey: companion])
+			{
+				[self schedulePath: companion priority: SCKIndexingPriorityRelatedFile];
+			}
+		}
+		for (NSString *relatedPath in relatedPaths)
+		{
+			if (nil != [priorities objectForKey: relatedPath])
+			{
+				[self schedulePath: relatedPath priority: SCKIndexingPriorityRelatedFile];
+			}
+		}
+		[queueLock unlock];
+	}];
+
+	[self postDidIndexFilesAtPaths: A(path)];
+	[self scheduleSliceIfNeeded];
+	return file;
+}
+
+/**
+ * Dequeues the next paths to index, that share the most urgent priority.
+ *
+ * Must be called with queueLock held.
+ */
+- (NSArray *)dequeueBatchWithPriority: (SCKIndexingPriority *)aPriority
+{
+	SCKIndexWorkerPool *pool = [sourceCollection indexWorkerPool];
+	NSUInteger batchSize = ((nil != pool && [sourceCollection createsIndexOnlyFiles]) ?
+		[pool workerCount] : 1);
+
+	for (int i = 0; i < SCKIndexingPriorityCount; i++)
+	{
+		NSMutableOrderedSet *queue = [queues objectAtIndex: i];
+		NSUInteger count = MIN(batchSize, [queue count]);
+
+		if (0 == count)
+			continue;
+
+		NSArray *batch = [[queue array] subarrayWithRange: NSMakeRange(0, count)];
+
+		[queue removeObjectsInRange: NSMakeRange(0, count)];
+		[priorities removeObjectsForKeys: batch];
+		*aPriority = i;
+		return batch;
+	}
+	return [NSArray array];
+}
+
+/**
+ * Indexes the queued files until they are all indexed, -sliceDuration is 
+ * elapsed or a -performBlockAndWait: caller is waiting, and returns the 
+ * indexed paths, which remain counted by -pendingFileCount until their 
+ * notification is posted.
+ *
+ * Must be called on the indexing queue.
+ */
+- (NSArray *)indexSlice
+{
+	double deadline = SCKMetricsNow() + sliceDuration;
+	NSMutableArray *indexedPaths = [NSMutableArray array];
+	BOOL parsedInBackground = NO;
+	int policy;
+	struct sched_param param;
+
+	pthread_getschedparam(pthread_self(), &policy, &param);
+
+	// Publish a single symbol snapshot per slice
+	[sourceCollection beginSymbolUpdates];
+	while (YES)
+	{
+		SCKIndexingPriority priority = SCKIndexingPriorityBackground;
+
+		[queueLock lock];
+		NSArray *batch = [self dequeueBatchWithPriority: &priority];
+		indexingPathCount += [batch count];
+		[queueLock unlock];
+
+		if ([batch count] == 0)
+			break;
+
+		parsedInBackground = (parsedInBackground || priority == SCKIndexingPriorityBackground);
+		[sourceCollection setParsesWithBackgroundPriority: (priority == SCKIndexingPriorityBackground)];
+		[sourceCollection sourceFilesForPaths: batch];
+		[indexedPaths addObjectsFromArray: batch];
+
+		[queueLock lock];
+		BOOL isBlockWaiting = (waitingBlockCount > 0);
+		[queueLock unlock];
+
+		if (SCKMetricsNow() >= deadline || isBlockWaiting)
+			break;
+	}
+	[sourceCollection setParsesWithBackgroundPriority: NO];
+	// The next blocks and opened files must not run at the background priority
+	if (parsedInBackground)
+	{
+		restoreThreadScheduling(policy, &param);
+	}
+	[sourceCollection endSymbolUpdates];
+	return indexedPaths;
+}
+
+- (BOOL)indexNextSlice
+{
+	__block NSArray *indexedPaths = nil;
+
+	[self performBlockAndWait: ^ () { indexedPaths = [self indexSlice]; }];
+
+	if ([indexedPaths count] > 0)
+	{
+		[self postDidIndexDequeuedFilesAtPaths: indexedPaths];
+	}
+	[queueLock lock];
+	BOOL remains = ([priorities count] > 0);
+	[queueLock unlock];
+	return remains;
+}
+
+/**
+ * Runs a slice on the indexing queue, and schedules the next one.
+ */
+- (void)runSlice
+{
+	[queueLock lock];
+	BOOL running = isRunning;
+	NSThread *thread = notificationThread;
+	[queueLock unlock];
+
+	NSArray *indexedPaths = (running ? [self indexSlice] : [NSArray array]);
+
+	if ([indexedPaths count] > 0)
+	{
+		[self performSelector: @selector(postDidIndexDequeuedFilesAtPaths:)
+		             onThread: thread
+		           withObject: indexedPaths
+		        waitUntilDone: NO
+		                modes: A(NSDefaultRunLoopMode)];
+	}
+
+	[queueLock lock];
+	isSliceScheduled = NO;
+	[queueLock unlock];
+	[self scheduleSliceIfNeeded];
+}
+
+- (void)start
+{
+	[queueLock lock];
+	isRunning = YES;
+	notificationThread = [NSThread currentThread];
+	[queueLock unlock];
+	[self scheduleSliceIfNeeded];
+}
+
+- (void)stop
+{
+	// A slice already running finishes, but no new one is started
+	[queueLock lock];
+	isRunning = NO;
+	[queueLock unlock];
+}
+
+@end
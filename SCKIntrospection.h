@@ -1,11 +1,39 @@
 #import <Foundation/NSObject.h>
+#import <Foundation/NSDictionary.h>
 
 @class NSString;
 @class NSAttributedString;
 @class SCKSourceLocation;
 @class NSMutableArray;
 @class NSMutableDictionary;
-@class SCKIvar, SCKProperty;
+@class SCKIvar, SCKProperty, SCKMethod, SCKTypeTable, SCKTypeSignature;
+
+/**
+ * Protocol to which objects that extract the documentation of program 
+ * components on demand must conform to.
+ *
+ * See -[SCKProgramComponent setCommentLocation:length:declaration:source:].
+ */
+@protocol SCKDocumentationSource
+/**
+ * Returns the documentation built from the comment that starts at the given 
+ * location, and is attached to the declaration at the other given location.
+ *
+ * Can return nil if the comment cannot be parsed anymore, in this case the 
+ * program component falls back on the raw comment text.
+ */
+- (NSAttributedString *)documentationForCommentAtLocation: (SCKSourceLocation *)aCommentLocation
+                                                   length: (NSUInteger)aLength
+                                              declaration: (SCKSourceLocation *)aDeclarationLocation;
+@optional
+/**
+ * Returns the contents of the given file when they are held in memory (e.g. 
+ * the file is being edited), otherwise nil.
+ *
+ * The raw comment text is read from these contents rather than from the disk.
+ */
+- (NSData *)contentsOfFile: (NSString *)aPath;
+@end
 
 /**
  * SCKProgramComponent is an abstract class representing properties of some
@@ -32,8 +60,37 @@
 /**
  * Documentation associated with this object.  This may be generated by an IDE,
  * extracted from headers, or read from some external source.
+ *
+ * When no documentation was set explicitly, the documentation is extracted 
+ * from the comment recorded with 
+ * -setCommentLocation:length:declaration:source: the first time this property 
+ * is read, then cached.
  */
 @property (nonatomic, retain) NSAttributedString *documentation;
+/**
+ * The location where the documentation comment attached to the component 
+ * starts, or nil if the component has no comment.
+ */
+@property (nonatomic, readonly) SCKSourceLocation *commentLocation;
+/**
+ * The length in bytes of the documentation comment.
+ */
+@property (nonatomic, readonly) NSUInteger commentLength;
+/**
+ * Records the documentation comment attached to the component declaration at 
+ * the given location, without parsing it.
+ *
+ * The comment is parsed by the documentation source when -documentation is 
+ * first read. The source is not retained, if it is deallocated in the 
+ * meantime, -documentation returns the raw comment text read from the file.
+ *
+ * The cached documentation is discarded, unless the comment location and 
+ * length are unchanged.
+ */
+- (void)setCommentLocation: (SCKSourceLocation *)aCommentLocation
+                    length: (NSUInteger)aLength
+               declaration: (SCKSourceLocation *)aDeclarationLocation
+                    source: (id <SCKDocumentationSource>)aSource;
 /**
  * The parent of this component.  
  */
@@ -43,6 +100,12 @@
  * declaration in the source code.
  */
 @property (nonatomic, readonly, assign) BOOL isForwardDeclaration;
+/**
+ * Returns an estimation of the memory in bytes used by the component, its 
+ * strings and locations, and the components it contains (e.g. the methods of 
+ * a class).
+ */
+@property (nonatomic, readonly) NSUInteger estimatedMemoryUsage;
 @end
 
 /**
@@ -51,6 +114,21 @@
 @interface SCKTypedProgramComponent : SCKProgramComponent
 /** Objective-C type encoding of the component. */
 @property (retain, nonatomic) NSString *typeEncoding;
+/**
+ * The table that interns the type encoding, set by 
+ * -[SCKTypeTable setTypeEncoding:ofComponent:] for parsed components.
+ */
+@property (retain, nonatomic) SCKTypeTable *typeTable;
+/**
+ * Returns the decoded type encoding, or nil if the component has no type 
+ * encoding.
+ *
+ * The signature is decoded by -typeTable the first time an encoding is 
+ * requested, then shared by all the components with the same encoding. 
+ * Without a type table, the encoding is decoded by a table shared by all the 
+ * components that have none.
+ */
+- (SCKTypeSignature*)typeSignature;
 @end
 
 @interface SCKBundle : SCKProgramComponent
@@ -61,30 +139,167 @@
 @property (retain, nonatomic) NSMutableArray *functions;
 @end
 
+/**
+ * Method dictionary that stores the methods of a class, category or protocol 
+ * in one ordered slot array, where each slot also records the position of 
+ * the method declaration and definition in the parsing order.
+ *
+ * The NSDictionary API is supported to look up the methods by selector name. 
+ * Enumerating the keys or values (e.g. with -allValues or fast enumeration) 
+ * returns them in the order they were inserted.
+ *
+ * For small containers, the lookups are linear searches in the slot array. 
+ * Past a few methods, the slot array allocation also holds a selector hash, 
+ * so lookups remain constant-time. Removing a method leaves its slot empty 
+ * until the array is reallocated.
+ */
+@interface SCKMethodDictionary : NSMutableDictionary
+/**
+ * The methods in the order they were inserted.
+ */
+@property (nonatomic, readonly) NSArray *orderedMethods;
+/**
+ * The methods whose declaration was parsed, in the order of their 
+ * declarations in the source code.
+ *
+ * See -didParseDeclarationOfMethod:.
+ */
+@property (nonatomic, readonly) NSArray *methodsInDeclarationOrder;
+/**
+ * The methods whose definition was parsed, in the order of their definitions 
+ * in the source code.
+ *
+ * See -didParseDefinitionOfMethod:.
+ */
+@property (nonatomic, readonly) NSArray *methodsInDefinitionOrder;
+/**
+ * Tells the receiver the declaration of a method it contains was parsed.
+ *
+ * The first call for a method appends it to -methodsInDeclarationOrder, later 
+ * calls and methods not in the receiver are ignored.
+ */
+- (void)didParseDeclarationOfMethod: (SCKMethod *)aMethod;
+/**
+ * Tells the receiver the definition of a method it contains was parsed.
+ *
+ * The first call for a method appends it to -methodsInDefinitionOrder, later 
+ * calls and methods not in the receiver are ignored.
+ */
+- (void)didParseDefinitionOfMethod: (SCKMethod *)aMethod;
+@end
+
 @interface SCKClass : SCKProgramComponent
+/**
+ * The superclass.
+ *
+ * Setting the superclass moves the receiver from the -subclasses of the old 
+ * superclass to the ones of the new superclass.
+ */
 @property (nonatomic, unsafe_unretained) SCKClass *superclass;
+/**
+ * The direct subclasses, kept up-to-date by -setSuperclass:.
+ */
 @property (nonatomic, readonly, retain) NSMutableArray *subclasses;
 @property (nonatomic, readonly, retain) NSMutableDictionary *categories;
-@property (nonatomic, readonly, retain) NSMutableDictionary *methods;
+@property (nonatomic, readonly, retain) SCKMethodDictionary *methods;
 @property (nonatomic, readonly, retain) NSMutableArray *ivars;
 @property (nonatomic, readonly, retain) NSMutableArray *properties;
+/**
+ * The SCKProtocol objects listed in the class interface.
+ *
+ * Setting the protocols updates -[SCKProtocol adoptingComponents].
+ */
+@property (nonatomic, copy) NSArray *adoptedProtocols;
 - (SCKIvar*)ivarForName: (NSString *)name;
 - (SCKProperty*)propertyForName: (NSString *)aProperty;
 - (id) initWithClass: (Class)cls;
+/**
+ * Returns the direct and indirect subclasses, breadth-first.
+ *
+ * The cost is proportional to the number of subclasses returned.
+ */
+- (NSArray*)allSubclasses;
+/**
+ * Returns the protocols the class conforms to: the protocols adopted by the 
+ * class, its categories and its superclasses, and the protocols they inherit.
+ */
+- (NSArray*)allAdoptedProtocols;
+/**
+ * Returns the method that a message with the given selector sent to an 
+ * instance of the class would dispatch to, or nil if no class in the 
+ * superclass chain has such a method.
+ *
+ * The category methods of a class take precedence over its own methods, and 
+ * a class methods over the ones of its superclasses. If several categories 
+ * of a class define the same method, which one is returned is undefined (as 
+ * at runtime).
+ *
+ * Results are cached per selector until -invalidateResolvedMethods is called 
+ * on the receiver or one of its superclasses.
+ */
+- (SCKMethod*)resolvedMethodForSelector: (NSString*)aSelector;
+/**
+ * Returns the class method (when isClassMethod is YES) or the instance method 
+ * that a message with the given selector would dispatch to, like 
+ * -resolvedMethodForSelector:.
+ *
+ * Instance and class methods are cached separately.
+ */
+- (SCKMethod*)resolvedMethodForSelector: (NSString*)aSelector isClassMethod: (BOOL)isClassMethod;
+/**
+ * Discards the methods resolved by the receiver and its subclasses.
+ *
+ * Invalidating is cheap: the subclasses are not walked, but discard their 
+ * caches lazily, when they find an invalidation newer than their cache along 
+ * their superclass chain.  Unrelated classes keep their resolved methods.
+ *
+ * Must be called after adding or removing methods in -methods or in the 
+ * categories. Source files call it when they parse new methods, and 
+ * -setSuperclass: calls it.
+ */
+- (void)invalidateResolvedMethods;
 @end
 
 @interface SCKProtocol : SCKProgramComponent
-@property (nonatomic, readonly, retain) NSMutableDictionary *requiredMethods;
-@property (nonatomic, readonly, retain) NSMutableDictionary *optionalMethods;
+@property (nonatomic, readonly, retain) SCKMethodDictionary *requiredMethods;
+@property (nonatomic, readonly, retain) SCKMethodDictionary *optionalMethods;
 @property (nonatomic, readonly, retain) NSMutableArray *requiredProperties;
 @property (nonatomic, readonly, retain) NSMutableArray *optionalProperties;
+/**
+ * The SCKProtocol objects listed in the protocol declaration, that the 
+ * receiver inherits.
+ */
+@property (nonatomic, copy) NSArray *adoptedProtocols;
+/**
+ * The classes, categories and protocols whose -adoptedProtocols contain the 
+ * receiver, in no particular order.
+ *
+ * The components are not retained.
+ */
+@property (nonatomic, readonly) NSArray *adoptingComponents;
 - (SCKProperty*)requiredPropertyForName: (NSString *)aProperty;
 - (SCKProperty*)optionalPropertyForName: (NSString *)aProperty;
+/**
+ * Returns the classes that conform to the receiver: the classes that adopt 
+ * it directly, in a category or through a protocol that inherits it, and 
+ * their subclasses.
+ *
+ * The cost is proportional to the number of classes and protocols returned.
+ */
+- (NSArray*)allConformingClasses;
+/**
+ * Returns the protocols the receiver inherits directly or indirectly.
+ */
+- (NSArray*)allAdoptedProtocols;
 @end
 
 @interface SCKCategory : SCKProgramComponent
-@property (nonatomic, readonly, retain) NSMutableDictionary *methods;
+@property (nonatomic, readonly, retain) SCKMethodDictionary *methods;
 @property (nonatomic, readonly, retain) NSMutableArray *properties;
+/**
+ * The SCKProtocol objects listed in the category interface.
+ */
+@property (nonatomic, copy) NSArray *adoptedProtocols;
 - (SCKProperty*)propertyForName: (NSString *)aProperty;
 @end
 
@@ -1,16 +1,157 @@
 #import "SCKIntrospection.h"
 #import "SCKClangSourceFile.h"
+#import "SCKTypeTable.h"
 #import <EtoileFoundation/EtoileFoundation.h>
 #include <objc/runtime.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+static NSUInteger estimatedMemoryUsageOfString(NSString *aString)
+{
+	if (nil == aString)
+	{
+		return 0;
+	}
+	return class_getInstanceSize([aString class]) + [aString length] * sizeof(unichar);
+}
+
+static NSUInteger estimatedMemoryUsageOfLocation(SCKSourceLocation *aLocation)
+{
+	if (nil == aLocation)
+	{
+		return 0;
+	}
+	return class_getInstanceSize([aLocation class]) + estimatedMemoryUsageOfString([aLocation file]);
+}
+
+/**
+ * Returns the memory used by the collection storage and the program components 
+ * it contains.
+ */
+static NSUInteger estimatedMemoryUsageOfComponents(id aCollection)
+{
+	NSUInteger size = class_getInstanceSize([aCollection class]) + [aCollection count] * 2 * sizeof(id);
+
+	for (SCKProgramComponent *component in ([aCollection isKindOfClass: [NSDictionary class]]
+		? [aCollection objectEnumerator] : aCollection))
+	{
+		size += [component estimatedMemoryUsage];
+	}
+	return size;
+}
+
+/**
+ * Returns the comment text between the given byte offsets of the file 
+ * contents, without the comment delimiters and the leading asterisks.
+ */
+static NSString *rawCommentText(NSData *data, NSUInteger offset, NSUInteger length)
+{
+	if (nil == data || offset + length > [data length])
+	{
+		return nil;
+	}
+
+	NSString *comment = [[NSString alloc] initWithData: [data subdataWithRange: NSMakeRange(offset, length)]
+	                                          encoding: NSUTF8StringEncoding];
+	NSMutableArray *lines = [NSMutableArray array];
+	NSCharacterSet *markers = [NSCharacterSet characterSetWithCharactersInString: @"/*!<"];
+
+	for (NSString *line in [comment componentsSeparatedByString: @"\n"])
+	{
+		NSString *text = [line stringByTrimmingCharactersInSet: [NSCharacterSet whitespaceCharacterSet]];
+
+		text = [text stringByTrimmingCharactersInSet: markers];
+		text = [text stringByTrimmingCharactersInSet: [NSCharacterSet whitespaceCharacterSet]];
+		if ([text length] > 0 || [lines count] > 0)
+		{
+			[lines addObject: text];
+		}
+	}
+	while ([[lines lastObject] length] == 0 && [lines count] > 0)
+	{
+		[lines removeLastObject];
+	}
+	return [lines componentsJoinedByString: @"\n"];
+}
 
 @implementation SCKProgramComponent
-@synthesize parent, declaration, definition, documentation, name;
+{
+	/** The declaration the comment is attached to. */
+	SCKSourceLocation *commentedDeclaration;
+	__weak id <SCKDocumentationSource> documentationSource;
+}
+
+@synthesize parent, declaration, definition, documentation, name, commentLocation, commentLength;
 
 - (BOOL)isForwardDeclaration
 {
 	return (declaration == nil);
 }
 
+- (void)setCommentLocation: (SCKSourceLocation *)aCommentLocation
+                    length: (NSUInteger)aLength
+               declaration: (SCKSourceLocation *)aDeclarationLocation
+                    source: (id <SCKDocumentationSource>)aSource
+{
+	BOOL isSameComment = ([aCommentLocation offset] == [commentLocation offset]
+		&& aLength == commentLength && [[aCommentLocation file] isEqualToString: [commentLocation file]]);
+
+	if (!isSameComment)
+	{
+		documentation = nil;
+	}
+	commentLocation = aCommentLocation;
+	commentLength = aLength;
+	commentedDeclaration = aDeclarationLocation;
+	documentationSource = aSource;
+}
+
+- (NSAttributedString *)documentation
+{
+	if (nil != documentation || nil == commentLocation)
+	{
+		return documentation;
+	}
+
+	id <SCKDocumentationSource> source = documentationSource;
+
+	documentation = [source documentationForCommentAtLocation: commentLocation
+	                                                   length: commentLength
+	                                              declaration: commentedDeclaration];
+	if (nil == documentation)
+	{
+		NSData *contents = nil;
+
+		if ([source respondsToSelector: @selector(contentsOfFile:)])
+		{
+			contents = [source contentsOfFile: [commentLocation file]];
+		}
+		if (nil == contents)
+		{
+			contents = [NSData dataWithContentsOfFile: [commentLocation file]
+			                                  options: NSDataReadingMappedIfSafe
+			                                    error: NULL];
+		}
+
+		NSString *text = rawCommentText(contents, [commentLocation offset], commentLength);
+
+		if (nil != text)
+		{
+			documentation = [[NSAttributedString alloc] initWithString: text];
+		}
+	}
+	return documentation;
+}
+
+- (NSUInteger)estimatedMemoryUsage
+{
+	return class_getInstanceSize([self class]) + estimatedMemoryUsageOfString(name)
+		+ estimatedMemoryUsageOfLocation(declaration)
+		+ (declaration != definition ? estimatedMemoryUsageOfLocation(definition) : 0)
+		+ estimatedMemoryUsageOfLocation(commentLocation)
+		+ estimatedMemoryUsageOfString([documentation string]);
+}
+
 - (NSString*)description
 {
 	return name;
@@ -41,8 +182,457 @@
 }
 @end
 
+/** Number of methods below which lookups don't use the selector hash. */
+static const NSUInteger SCKMethodDictionaryLinearSearchLimit = 8;
+
+typedef struct
+{
+	/** The retained key and method, or NULL for a removed slot. */
+	void *key;
+	void *method;
+	/** The positions + 1 in the declaration and definition orders, or 0. */
+	uint32_t declarationPosition;
+	uint32_t definitionPosition;
+} SCKMethodSlot;
+
+@implementation SCKMethodDictionary
+{
+	/**
+	 * The slots in insertion order, followed by the selector hash whose 
+	 * buckets contain a slot index + 1, or 0 when empty. 
+	 *
+	 * A single allocation, and small dictionaries have no hash.
+	 */
+	SCKMethodSlot *slots;
+	uint32_t *buckets;
+	NSUInteger bucketCount;
+	/** The slots in use, including the removed ones. */
+	NSUInteger slotCount;
+	NSUInteger slotCapacity;
+	NSUInteger count;
+	uint32_t declarationCount;
+	uint32_t definitionCount;
+	unsigned long mutationCount;
+}
+
+static NSUInteger bucketCountForCapacity(NSUInteger aCapacity)
+{
+	NSUInteger buckets = 16;
+
+	if (aCapacity <= SCKMethodDictionaryLinearSearchLimit)
+		return 0;
+
+	while (buckets < aCapacity * 2)
+		buckets *= 2;
+
+	return buckets;
+}
+
+/**
+ * Inserts the slot into the hash, at the first bucket that is empty or 
+ * refers to a removed slot.
+ */
+- (void)insertSlotInHash: (NSUInteger)aSlot
+{
+	NSUInteger bucket = [(__bridge id)slots[aSlot].key hash] & (bucketCount - 1);
+
+	while (buckets[bucket] != 0 && slots[buckets[bucket] - 1].key != NULL)
+	{
+		bucket = (bucket + 1) & (bucketCount - 1);
+	}
+	buckets[bucket] = (uint32_t)(aSlot + 1);
+}
+
+/**
+ * Moves the slots to a new allocation with the given capacity, drops the 
+ * removed slots and rebuilds the hash.
+ */
+- (void)reallocateSlotsWithCapacity: (NSUInteger)aCapacity
+{
+	NSUInteger newBucketCount = bucketCountForCapacity(aCapacity);
+	SCKMethodSlot *newSlots = calloc(1, aCapacity * sizeof(SCKMethodSlot) + newBucketCount * sizeof(uint32_t));
+	NSUInteger newSlotCount = 0;
+
+	for (NSUInteger i = 0; i < slotCount; i++)
+	{
+		if (NULL != slots[i].key)
+		{
+			newSlots[newSlotCount++] = slots[i];
+		}
+	}
+	free(slots);
+	slots = newSlots;
+	slotCount = newSlotCount;
+	slotCapacity = aCapacity;
+	buckets = (uint32_t *)(slots + aCapacity);
+	bucketCount = newBucketCount;
+	for (NSUInteger i = 0; bucketCount > 0 && i < slotCount; i++)
+	{
+		[self insertSlotInHash: i];
+	}
+}
+
+- (id)initWithObjects: (const id [])objects forKeys: (const id <NSCopying> [])someKeys count: (NSUInteger)aCount
+{
+	/* -[NSDictionary init] calls this initializer on GNUstep, so it doesn't
+	   call the superclass one */
+	[self reallocateSlotsWithCapacity: MAX(aCount, 4)];
+	for (NSUInteger i = 0; i < aCount; i++)
+	{
+		[self setObject: objects[i] forKey: someKeys[i]];
+	}
+	return self;
+}
+
+- (id)initWithCapacity: (NSUInteger)aCapacity
+{
+	if (nil == (self = [self initWithObjects: NULL forKeys: NULL count: 0])) { return nil; }
+
+	if (aCapacity > slotCapacity)
+	{
+		[self reallocateSlotsWithCapacity: aCapacity];
+	}
+	return self;
+}
+
+- (id)init
+{
+	return [self initWithObjects: NULL forKeys: NULL count: 0];
+}
+
+- (void)dealloc
+{
+	for (NSUInteger i = 0; i < slotCount; i++)
+	{
+		if (NULL != slots[i].key)
+		{
+			(void)(__bridge_transfer id)slots[i].key;
+			(void)(__bridge_transfer id)slots[i].method;
+		}
+	}
+	free(slots);
+}
+
+- (NSUInteger)count
+{
+	return count;
+}
+
+- (NSUInteger)slotForKey: (id)aKey
+{
+	if (nil == aKey)
+		return NSNotFound;
+
+	if (0 == bucketCount)
+	{
+		for (NSUInteger i = 0; i < slotCount; i++)
+		{
+			if (NULL != slots[i].key && [(__bridge id)slots[i].key isEqual: aKey])
+			{
+				return i;
+			}
+		}
+		return NSNotFound;
+	}
+
+	NSUInteger bucket = [aKey hash] & (bucketCount - 1);
+
+	// Buckets that refer to a removed slot don't end the probe sequence
+	while (buckets[bucket] != 0)
+	{
+		SCKMethodSlot *slot = &slots[buckets[bucket] - 1];
+
+		if (NULL != slot->key && [(__bridge id)slot->key isEqual: aKey])
+		{
+			return buckets[bucket] - 1;
+		}
+		bucket = (bucket + 1) & (bucketCount - 1);
+	}
+	return NSNotFound;
+}
+
+- (id)objectForKey: (id)aKey
+{
+	NSUInteger slot = [self slotForKey: aKey];
+	return (slot == NSNotFound ? nil : (__bridge id)slots[slot].method);
+}
+
+- (NSArray *)allKeys
+{
+	NSMutableArray *keys = [NSMutableArray arrayWithCapacity: count];
+
+	for (NSUInteger i = 0; i < slotCount; i++)
+	{
+		if (NULL != slots[i].key)
+		{
+			[keys addObject: (__bridge id)slots[i].key];
+		}
+	}
+	return keys;
+}
+
+- (NSArray *)allValues
+{
+	NSMutableArray *methods = [NSMutableArray arrayWithCapacity: count];
+
+	for (NSUInteger i = 0; i < slotCount; i++)
+	{
+		if (NULL != slots[i].key)
+		{
+			[methods addObject: (__bridge id)slots[i].method];
+		}
+	}
+	return methods;
+}
+
+- (NSEnumerator *)keyEnumerator
+{
+	return [[self allKeys] objectEnumerator];
+}
+
+- (NSEnumerator *)objectEnumerator
+{
+	return [[self allValues] objectEnumerator];
+}
+
+- (NSUInteger)countByEnumeratingWithState: (NSFastEnumerationState *)state 
+                                  objects: (__unsafe_unretained id [])buffer
+                                    count: (NSUInteger)len
+{
+	NSUInteger n = 0;
+	NSUInteger i = state->state;
+
+	for (; i < slotCount && n < len; i++)
+	{
+		if (NULL != slots[i].key)
+		{
+			buffer[n++] = (__bridge id)slots[i].key;
+		}
+	}
+	state->state = i;
+	state->itemsPtr = buffer;
+	state->mutationsPtr = &mutationCount;
+	return n;
+}
+
+- (void)setObject: (id)aMethod forKey: (id <NSCopying>)aKey
+{
+	NILARG_EXCEPTION_TEST(aMethod);
+	NILARG_EXCEPTION_TEST(aKey);
+	NSUInteger slot = [self slotForKey: aKey];
+
+	mutationCount++;
+	if (slot != NSNotFound)
+	{
+		(void)(__bridge_transfer id)slots[slot].method;
+		slots[slot].method = (__bridge_retained void *)aMethod;
+		slots[slot].declarationPosition = 0;
+		slots[slot].definitionPosition = 0;
+		return;
+	}
+
+	if (slotCount == slotCapacity)
+	{
+		// Compacting is enough when most slots were removed
+		[self reallocateSlotsWithCapacity: (count < slotCapacity / 2 ? slotCapacity : slotCapacity * 2)];
+	}
+	slot = slotCount++;
+	slots[slot].key = (__bridge_retained void *)[(id)aKey copyWithZone: NULL];
+	slots[slot].method = (__bridge_retained void *)aMethod;
+	slots[slot].declarationPosition = 0;
+	slots[slot].definitionPosition = 0;
+	count++;
+	if (bucketCount > 0)
+	{
+		[self insertSlotInHash: slot];
+	}
+}
+
+- (void)removeObjectForKey: (id)aKey
+{
+	NILARG_EXCEPTION_TEST(aKey);
+	NSUInteger slot = [self slotForKey: aKey];
+
+	if (slot == NSNotFound)
+	{
+		return;
+	}
+
+	/* The slot is left empty, the next reallocation drops it, so the other 
+	   slots and the hash don't change */
+	mutationCount++;
+	(void)(__bridge_transfer id)slots[slot].key;
+	(void)(__bridge_transfer id)slots[slot].method;
+	slots[slot].key = NULL;
+	slots[slot].method = NULL;
+	count--;
+}
+
+- (void)removeAllObjects
+{
+	for (NSUInteger i = 0; i < slotCount; i++)
+	{
+		if (NULL != slots[i].key)
+		{
+			(void)(__bridge_transfer id)slots[i].key;
+			(void)(__bridge_transfer id)slots[i].method;
+			slots[i].key = NULL;
+			slots[i].method = NULL;
+		}
+	}
+	mutationCount++;
+	count = 0;
+	declarationCount = 0;
+	definitionCount = 0;
+	[self reallocateSlotsWithCapacity: 4];
+}
+
+- (NSArray *)orderedMethods
+{
+	return [self allValues];
+}
+
+/**
+ * Returns the methods whose position at the given offset in their slot is 
+ * set, sorted by this position.
+ *
+ * The positions are unique and at most aPositionCount, so they index the 
+ * methods directly.
+ */
+- (NSArray *)methodsOrderedByPositionAtOffset: (size_t)anOffset count: (uint32_t)aPositionCount
+{
+	NSMutableArray *methods = [NSMutableArray arrayWithCapacity: aPositionCount];
+	NSUInteger *slotsByPosition = calloc(aPositionCount + 1, sizeof(NSUInteger));
+
+	for (NSUInteger i = 0; i < slotCount; i++)
+	{
+		uint32_t position = *(uint32_t *)((char *)&slots[i] + anOffset);
+
+		if (NULL != slots[i].key && position != 0)
+		{
+			slotsByPosition[position] = i + 1;
+		}
+	}
+	for (uint32_t position = 1; position <= aPositionCount; position++)
+	{
+		if (slotsByPosition[position] != 0)
+		{
+			[methods addObject: (__bridge id)slots[slotsByPosition[position] - 1].method];
+		}
+	}
+	free(slotsByPosition);
+	return methods;
+}
+
+- (NSArray *)methodsInDeclarationOrder
+{
+	return [self methodsOrderedByPositionAtOffset: offsetof(SCKMethodSlot, declarationPosition)
+	                                        count: declarationCount];
+}
+
+- (NSArray *)methodsInDefinitionOrder
+{
+	return [self methodsOrderedByPositionAtOffset: offsetof(SCKMethodSlot, definitionPosition)
+	                                        count: definitionCount];
+}
+
+/**
+ * Returns the slot of the method, or NULL if the receiver doesn't contain it 
+ * (e.g. a category method replaced in the class method dictionary by a method 
+ * with the same selector).
+ */
+- (SCKMethodSlot *)slotOfMethod: (SCKMethod *)aMethod
+{
+	NSUInteger slot = [self slotForKey: [aMethod name]];
+
+	if (slot == NSNotFound || (__bridge id)slots[slot].method != aMethod)
+	{
+		return NULL;
+	}
+	return &slots[slot];
+}
+
+- (void)didParseDeclarationOfMethod: (SCKMethod *)aMethod
+{
+	SCKMethodSlot *slot = [self slotOfMethod: aMethod];
+
+	if (NULL != slot && 0 == slot->declarationPosition)
+	{
+		slot->declarationPosition = ++declarationCount;
+	}
+}
+
+- (void)didParseDefinitionOfMethod: (SCKMethod *)aMethod
+{
+	SCKMethodSlot *slot = [self slotOfMethod: aMethod];
+
+	if (NULL != slot && 0 == slot->definitionPosition)
+	{
+		slot->definitionPosition = ++definitionCount;
+	}
+}
+
+@end
+
+@interface SCKProtocol ()
+- (void)addAdoptingComponent: (SCKProgramComponent *)aComponent;
+- (void)removeAdoptingComponent: (SCKProgramComponent *)aComponent;
+@end
+
+/**
+ * Updates the adopting components of the protocols added to or removed from 
+ * the protocols adopted by a class, category or protocol.
+ */
+static void replaceAdoptedProtocols(SCKProgramComponent *anAdopter, NSArray *oldProtocols, NSArray *newProtocols)
+{
+	for (SCKProtocol *protocol in oldProtocols)
+	{
+		if (![newProtocols containsObject: protocol])
+		{
+			[protocol removeAdoptingComponent: anAdopter];
+		}
+	}
+	for (SCKProtocol *protocol in newProtocols)
+	{
+		if (![oldProtocols containsObject: protocol])
+		{
+			[protocol addAdoptingComponent: anAdopter];
+		}
+	}
+}
+
+/**
+ * Adds the protocols inherited by the protocols in the given set to the set.
+ */
+static void addInheritedProtocols(NSMutableOrderedSet *protocols)
+{
+	for (NSUInteger i = 0; i < [protocols count]; i++)
+	{
+		[protocols addObjectsFromArray: [[protocols objectAtIndex: i] adoptedProtocols]];
+	}
+}
+
+/**
+ * Incremented by -[SCKClass invalidateResolvedMethods], and by each class 
+ * filling its resolved methods, to stamp caches and invalidations in order.
+ */
+static volatile uint64_t resolvedMethodsGeneration = 1;
+
 @implementation SCKClass
-@synthesize subclasses, superclass, categories, methods, ivars, properties;
+{
+	/** Resolved instance methods (or NSNull when not found) by selector, or nil. */
+	NSMutableDictionary *resolvedInstanceMethods;
+	/** Resolved class methods (or NSNull when not found) by selector, or nil. */
+	NSMutableDictionary *resolvedClassMethods;
+	/** The resolvedMethodsGeneration the resolved methods were cached in. */
+	uint64_t resolvedMethodsCacheGeneration;
+	/** The resolvedMethodsGeneration the receiver was last invalidated in. */
+	volatile uint64_t invalidationGeneration;
+	/** Whether the receiver is resolving a method, to detect hierarchy cycles. */
+	BOOL isResolvingMethod;
+}
+
+@synthesize subclasses, superclass, categories, methods, ivars, properties, adoptedProtocols;
 - (NSString*)description
 {
 	NSMutableString *str = [self.name mutableCopy];
@@ -65,11 +655,19 @@
 	SUPERINIT;
 	subclasses = [NSMutableArray new];
 	categories = [NSMutableDictionary new];
-	methods = [NSMutableDictionary new];
+	methods = [SCKMethodDictionary new];
 	ivars = [NSMutableArray new];
 	properties = [NSMutableArray new];
 	return self;
 }
+- (void)dealloc
+{
+	replaceAdoptedProtocols(self, adoptedProtocols, nil);
+	for (SCKClass *subclass in subclasses)
+	{
+		subclass->superclass = nil;
+	}
+}
 - (id)initWithClass: (Class)cls
 {
 	if (nil == (self = [self init])) { return nil; }
@@ -122,6 +720,176 @@
 	return self;
 }
 
+- (NSUInteger)estimatedMemoryUsage
+{
+	NSUInteger size = [super estimatedMemoryUsage]
+		+ estimatedMemoryUsageOfComponents(ivars)
+		+ estimatedMemoryUsageOfComponents(properties)
+		+ class_getInstanceSize([subclasses class]) + [subclasses count] * sizeof(id);
+
+	/* Category methods are also present in the class method dictionary, so we 
+	   only count them once. */
+	for (SCKCategory *category in [categories objectEnumerator])
+	{
+		size += class_getInstanceSize([category class]) + estimatedMemoryUsageOfString([category name])
+			+ class_getInstanceSize([[category methods] class]) + [[category methods] count] * 2 * sizeof(id)
+			+ estimatedMemoryUsageOfLocation([category declaration])
+			+ estimatedMemoryUsageOfLocation([category definition]);
+	}
+	return size + estimatedMemoryUsageOfComponents(methods);
+}
+
+- (void)setSuperclass: (SCKClass*)aClass
+{
+	if (aClass == superclass)
+		return;
+
+	[[superclass subclasses] removeObjectIdenticalTo: self];
+	superclass = aClass;
+	[[aClass subclasses] addObject: self];
+	[self invalidateResolvedMethods];
+}
+
+- (SCKMethod*)resolvedMethodForSelector: (NSString*)aSelector
+{
+	return [self resolvedMethodForSelector: aSelector isClassMethod: NO];
+}
+
+/**
+ * Returns the method of the given kind in the method dictionary, or nil.
+ *
+ * Class and instance methods with the same selector share the key.
+ */
+static inline SCKMethod *methodOfKind(NSDictionary *someMethods, NSString *aSelector, BOOL isClassMethod)
+{
+	SCKMethod *method = [someMethods objectForKey: aSelector];
+
+	return ([method isClassMethod] == isClassMethod ? method : nil);
+}
+
+- (SCKMethod*)resolvedMethodForSelector: (NSString*)aSelector isClassMethod: (BOOL)isClassMethod
+{
+	if (![self isResolvedMethodsCacheValid])
+	{
+		resolvedInstanceMethods = nil;
+		resolvedClassMethods = nil;
+		resolvedMethodsCacheGeneration = __sync_add_and_fetch(&resolvedMethodsGeneration, 1);
+	}
+
+	NSMutableDictionary *resolvedMethods = (isClassMethod ? resolvedClassMethods : resolvedInstanceMethods);
+	id method = [resolvedMethods objectForKey: aSelector];
+
+	if (nil != method)
+	{
+		return (method == [NSNull null] ? nil : method);
+	}
+	if (isResolvingMethod)
+	{
+		return nil;
+	}
+
+	for (SCKCategory *category in [categories objectEnumerator])
+	{
+		method = methodOfKind([category methods], aSelector, isClassMethod);
+		if (nil != method)
+			break;
+	}
+	if (nil == method)
+	{
+		method = methodOfKind(methods, aSelector, isClassMethod);
+	}
+	if (nil == method)
+	{
+		isResolvingMethod = YES;
+		method = [superclass resolvedMethodForSelector: aSelector isClassMethod: isClassMethod];
+		isResolvingMethod = NO;
+	}
+
+	if (nil == resolvedMethods)
+	{
+		resolvedMethods = [NSMutableDictionary new];
+		if (isClassMethod)
+		{
+			resolvedClassMethods = resolvedMethods;
+		}
+		else
+		{
+			resolvedInstanceMethods = resolvedMethods;
+		}
+	}
+	[resolvedMethods setObject: (nil != method ? method : [NSNull null])
+	                    forKey: aSelector];
+	return method;
+}
+
+/**
+ * Returns whether neither the receiver nor its superclasses were invalidated 
+ * since the resolved methods were cached.
+ *
+ * The superclass chain is walked at the same time at half speed, to stop on 
+ * hierarchy cycles.
+ */
+- (BOOL)isResolvedMethodsCacheValid
+{
+	SCKClass *cycleCheck = self;
+	NSUInteger depth = 0;
+
+	for (SCKClass *cls = self; nil != cls; cls = cls->superclass, depth++)
+	{
+		if (__sync_fetch_and_add(&cls->invalidationGeneration, 0) > resolvedMethodsCacheGeneration)
+			return NO;
+
+		if (depth % 2 == 1)
+		{
+			cycleCheck = cycleCheck->superclass;
+			if (cycleCheck == cls->superclass)
+				break;
+		}
+	}
+	return YES;
+}
+
+- (void)invalidateResolvedMethods
+{
+	invalidationGeneration = __sync_add_and_fetch(&resolvedMethodsGeneration, 1);
+}
+
+- (void)setAdoptedProtocols: (NSArray*)protocols
+{
+	replaceAdoptedProtocols(self, adoptedProtocols, protocols);
+	adoptedProtocols = [protocols copy];
+}
+
+- (NSArray*)allSubclasses
+{
+	NSMutableOrderedSet *allSubclasses = [NSMutableOrderedSet orderedSetWithArray: subclasses];
+
+	for (NSUInteger i = 0; i < [allSubclasses count]; i++)
+	{
+		[allSubclasses addObjectsFromArray: [[allSubclasses objectAtIndex: i] subclasses]];
+	}
+	return [allSubclasses array];
+}
+
+- (NSArray*)allAdoptedProtocols
+{
+	NSMutableOrderedSet *protocols = [NSMutableOrderedSet orderedSet];
+	NSMutableSet *visitedClasses = [NSMutableSet set];
+
+	// A malformed hierarchy can contain a cycle
+	for (SCKClass *class = self; nil != class && ![visitedClasses containsObject: class]; class = [class superclass])
+	{
+		[visitedClasses addObject: class];
+		[protocols addObjectsFromArray: [class adoptedProtocols]];
+		for (SCKCategory *category in [[class categories] objectEnumerator])
+		{
+			[protocols addObjectsFromArray: [category adoptedProtocols]];
+		}
+	}
+	addInheritedProtocols(protocols);
+	return [protocols array];
+}
+
 - (SCKIvar*)ivarForName: (NSString*)name
 {
 	return [[ivars filteredCollectionWithBlock: ^ (SCKIvar *ivar) 
@@ -141,18 +909,102 @@
 @end
 
 @implementation SCKProtocol
-@synthesize requiredMethods, optionalMethods, requiredProperties, optionalProperties;
+{
+	/** Adopting components, not retained. */
+	NSHashTable *adopters;
+}
+
+@synthesize requiredMethods, optionalMethods, requiredProperties, optionalProperties, adoptedProtocols;
 
 - (id)init
 {
 	SUPERINIT;
-	optionalMethods = [NSMutableDictionary new];
-	requiredMethods = [NSMutableDictionary new];
+	optionalMethods = [SCKMethodDictionary new];
+	requiredMethods = [SCKMethodDictionary new];
 	optionalProperties = [NSMutableArray new];
 	requiredProperties = [NSMutableArray new];
+	adopters = [[NSHashTable alloc] initWithOptions: NSPointerFunctionsOpaqueMemory | NSPointerFunctionsObjectPointerPersonality
+	                                       capacity: 0];
 	return self;
 }
 
+- (void)dealloc
+{
+	replaceAdoptedProtocols(self, adoptedProtocols, nil);
+}
+
+- (void)setAdoptedProtocols: (NSArray*)protocols
+{
+	replaceAdoptedProtocols(self, adoptedProtocols, protocols);
+	adoptedProtocols = [protocols copy];
+}
+
+- (void)addAdoptingComponent: (SCKProgramComponent *)aComponent
+{
+	[adopters addObject: aComponent];
+}
+
+- (void)removeAdoptingComponent: (SCKProgramComponent *)aComponent
+{
+	[adopters removeObject: aComponent];
+}
+
+- (NSArray*)adoptingComponents
+{
+	return [adopters allObjects];
+}
+
+- (NSArray*)allConformingClasses
+{
+	NSMutableOrderedSet *protocols = [NSMutableOrderedSet orderedSetWithObject: self];
+	NSMutableOrderedSet *classes = [NSMutableOrderedSet orderedSet];
+
+	for (NSUInteger i = 0; i < [protocols count]; i++)
+	{
+		for (SCKProgramComponent *adopter in [[protocols objectAtIndex: i] adoptingComponents])
+		{
+			if ([adopter isKindOfClass: [SCKProtocol class]])
+			{
+				[protocols addObject: adopter];
+			}
+			else if ([adopter isKindOfClass: [SCKCategory class]])
+			{
+				if (nil != [adopter parent])
+				{
+					[classes addObject: [adopter parent]];
+				}
+			}
+			else
+			{
+				[classes addObject: adopter];
+			}
+		}
+	}
+	for (NSUInteger i = 0; i < [classes count]; i++)
+	{
+		[classes addObjectsFromArray: [[classes objectAtIndex: i] subclasses]];
+	}
+	return [classes array];
+}
+
+- (NSArray*)allAdoptedProtocols
+{
+	NSMutableOrderedSet *protocols = [NSMutableOrderedSet orderedSetWithArray: adoptedProtocols];
+
+	addInheritedProtocols(protocols);
+	[protocols removeObject: self];
+	return [protocols array];
+}
+
+- (NSUInteger)estimatedMemoryUsage
+{
+	return [super estimatedMemoryUsage]
+		+ estimatedMemoryUsageOfComponents(requiredMethods)
+		+ estimatedMemoryUsageOfComponents(optionalMethods)
+		+ estimatedMemoryUsageOfComponents(requiredProperties)
+		+ estimatedMemoryUsageOfComponents(optionalProperties);
+}
+
 - (SCKProperty*)requiredPropertyForName: (NSString*)name
 {
 	return [[requiredProperties filteredCollectionWithBlock: ^ (SCKProperty *prop) 
@@ -172,14 +1024,23 @@
 @end
 
 @implementation SCKCategory : SCKProgramComponent
-@synthesize methods, properties;
+@synthesize methods, properties, adoptedProtocols;
 - (id)init
 {
 	SUPERINIT;
-	methods = [NSMutableDictionary new];
+	methods = [SCKMethodDictionary new];
 	properties = [NSMutableArray new];
 	return self;
 }
+- (void)dealloc
+{
+	replaceAdoptedProtocols(self, adoptedProtocols, nil);
+}
+- (void)setAdoptedProtocols: (NSArray*)protocols
+{
+	replaceAdoptedProtocols(self, adoptedProtocols, protocols);
+	adoptedProtocols = [protocols copy];
+}
 - (NSString*)description
 {
 	NSMutableString *str = [NSMutableString stringWithFormat: @"%@ (%@)", self.parent.name, self.name];
@@ -208,8 +1069,39 @@
 }
 @end
 
+/** The table that decodes the encodings of the components without a table. */
+static SCKTypeTable *sharedTypeTable;
+
 @implementation SCKTypedProgramComponent
-@synthesize typeEncoding;
+@synthesize typeEncoding, typeTable;
++ (void)initialize
+{
+	if (self == [SCKTypedProgramComponent class])
+	{
+		sharedTypeTable = [SCKTypeTable new];
+	}
+}
+- (NSUInteger)estimatedMemoryUsage
+{
+	// Interned encodings are accounted by the type table
+	if (nil != typeTable)
+	{
+		return [super estimatedMemoryUsage];
+	}
+	return [super estimatedMemoryUsage] + estimatedMemoryUsageOfString(typeEncoding);
+}
+- (SCKTypeSignature*)typeSignature
+{
+	if (nil == typeEncoding)
+	{
+		return nil;
+	}
+	if (nil == typeTable)
+	{
+		return [sharedTypeTable signatureForEncoding: typeEncoding];
+	}
+	return [typeTable signatureForEncoding: typeEncoding];
+}
 @end
 
 @implementation SCKIvar
@@ -223,6 +1115,10 @@
 @implementation SCKMacro @end
 @implementation SCKEnumeration
 @synthesize values;
+- (NSUInteger)estimatedMemoryUsage
+{
+	return [super estimatedMemoryUsage] + estimatedMemoryUsageOfComponents(values);
+}
 @end
 @implementation SCKEnumerationValue
 @synthesize longLongValue, enumerationName;
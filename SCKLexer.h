@@ -0,0 +1,80 @@
+#import <Foundation/NSObject.h>
+#import <Foundation/NSRange.h>
+
+@class NSString, NSMutableAttributedString;
+
+/**
+ * The kinds of tokens recognized by SCKLexer, in the same order as the libclang
+ * CXTokenKind.
+ */
+typedef enum
+{
+	SCKTokenKindPunctuation,
+	SCKTokenKindKeyword,
+	SCKTokenKindIdentifier,
+	SCKTokenKindLiteral,
+	SCKTokenKindComment
+} SCKTokenKind;
+
+/**
+ * A token returned by -[SCKLexer nextToken:].
+ */
+typedef struct
+{
+	SCKTokenKind kind;
+	/** The range of the token in the lexed string, in unichars. */
+	NSRange range;
+} SCKToken;
+
+/**
+ * Returns the SCKTextTokenType constant (e.g. SCKTextTokenTypeKeyword) that
+ * corresponds to the token kind.
+ */
+NSString *SCKTextTokenTypeForTokenKind(SCKTokenKind aKind);
+
+/**
+ * A lexer for C, Objective-C and C++ that works on the raw text, without a
+ * parser or a translation unit, so a file can be highlighted as soon as it
+ * is opened.
+ *
+ * The tokens are classified as libclang does, except the lexer doesn't run
+ * the preprocessor, so macros are identifiers and the code disabled by #if is
+ * lexed too. A token prefixed with '@' (e.g. <code>@interface</code> or
+ * <code>@"string"</code>) includes the '@', and a header name that follows
+ * #import or #include is a literal.
+ *
+ * The keywords are looked up in a perfect hash table computed in advance, and
+ * comments and string literals are scanned several characters at a time.
+ */
+@interface SCKLexer : NSObject
+/**
+ * <init />
+ * Initializes and returns a lexer that returns the tokens of a copy of the
+ * given string.
+ *
+ * When the string is nil, raises a NSInvalidArgumentException.
+ */
+- (id)initWithString: (NSString *)aString;
+/**
+ * Whether the C++ keywords (e.g. <code>class</code> or <code>template</code>)
+ * are recognized, and the C++ raw string literals.
+ *
+ * By default, returns NO.
+ */
+@property (nonatomic, assign) BOOL lexesCPlusPlus;
+/**
+ * Sets the given token to the next token, and returns YES, or returns NO at
+ * the end of the string.
+ */
+- (BOOL)nextToken: (SCKToken *)aToken;
+/**
+ * Replaces the kSCKTextTokenType attributes of the given string with the ones
+ * of its tokens.
+ *
+ * Contiguous tokens of the same kind (e.g. <code>);</code>) share an attribute
+ * range. The ranges whose token type didn't change are left untouched, so
+ * highlighting an edited string again only modifies the edited runs.
+ */
++ (void)lexicalHighlightString: (NSMutableAttributedString *)aSource
+                     cPlusPlus: (BOOL)isCPlusPlus;
+@end
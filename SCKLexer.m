@@ -0,0 +1,844 @@
+#import "SCKLexer.h"
+#import "SCKTextTypes.h"
+#import <Foundation/Foundation.h>
+#import <EtoileFoundation/EtoileFoundation.h>
+#include <stdint.h>
+#include <string.h>
+
+NSString *SCKTextTokenTypeForTokenKind(SCKTokenKind aKind)
+{
+	switch (aKind)
+	{
+		case SCKTokenKindPunctuation: return SCKTextTokenTypePunctuation;
+		case SCKTokenKindKeyword: return SCKTextTokenTypeKeyword;
+		case SCKTokenKindIdentifier: return SCKTextTokenTypeIdentifier;
+		case SCKTokenKindLiteral: return SCKTextTokenTypeLiteral;
+		case SCKTokenKindComment: return SCKTextTokenTypeComment;
+	}
+	return nil;
+}
+
+/**
+ * The languages in which a word is a keyword.
+ */
+enum
+{
+	SCKKeywordC = 1,
+	/** Objective-C keywords, that follow '@'. */
+	SCKKeywordObjC = 2,
+	SCKKeywordCXX = 4
+};
+
+typedef struct
+{
+	const char *name;
+	uint8_t length;
+	uint8_t languages;
+} SCKKeyword;
+
+#define SCK_KEYWORD_MAX_LENGTH 19
+
+static const SCKKeyword keywords[] =
+{
+	/* C and the extensions of GCC, Clang and Objective-C */
+	{ "_Alignas", 8, SCKKeywordC },
+	{ "_Alignof", 8, SCKKeywordC },
+	{ "_Atomic", 7, SCKKeywordC },
+	{ "_Bool", 5, SCKKeywordC },
+	{ "_Complex", 8, SCKKeywordC },
+	{ "_Generic", 8, SCKKeywordC },
+	{ "_Imaginary", 10, SCKKeywordC },
+	{ "_Nonnull", 8, SCKKeywordC },
+	{ "_Noreturn", 9, SCKKeywordC },
+	{ "_Null_unspecified", 17, SCKKeywordC },
+	{ "_Nullable", 9, SCKKeywordC },
+	{ "_Static_assert", 14, SCKKeywordC },
+	{ "_Thread_local", 13, SCKKeywordC },
+	{ "__asm__", 7, SCKKeywordC },
+	{ "__attribute__", 13, SCKKeywordC },
+	{ "__autoreleasing", 15, SCKKeywordC },
+	{ "__block", 7, SCKKeywordC },
+	{ "__bridge", 8, SCKKeywordC },
+	{ "__bridge_retained", 17, SCKKeywordC },
+	{ "__bridge_transfer", 17, SCKKeywordC },
+	{ "__const", 7, SCKKeywordC },
+	{ "__extension__", 13, SCKKeywordC },
+	{ "__inline", 8, SCKKeywordC },
+	{ "__inline__", 10, SCKKeywordC },
+	{ "__kindof", 8, SCKKeywordC },
+	{ "__nonnull", 9, SCKKeywordC },
+	{ "__null_unspecified", 18, SCKKeywordC },
+	{ "__nullable", 10, SCKKeywordC },
+	{ "__restrict", 10, SCKKeywordC },
+	{ "__restrict__", 12, SCKKeywordC },
+	{ "__strong", 8, SCKKeywordC },
+	{ "__typeof__", 10, SCKKeywordC },
+	{ "__unsafe_unretained", 19, SCKKeywordC },
+	{ "__volatile__", 12, SCKKeywordC },
+	{ "__weak", 6, SCKKeywordC },
+	{ "asm", 3, SCKKeywordC },
+	{ "auto", 4, SCKKeywordC },
+	{ "break", 5, SCKKeywordC },
+	{ "case", 4, SCKKeywordC },
+	{ "char", 4, SCKKeywordC },
+	{ "const", 5, SCKKeywordC },
+	{ "continue", 8, SCKKeywordC },
+	{ "default", 7, SCKKeywordC },
+	{ "do", 2, SCKKeywordC },
+	{ "double", 6, SCKKeywordC },
+	{ "else", 4, SCKKeywordC },
+	{ "enum", 4, SCKKeywordC },
+	{ "extern", 6, SCKKeywordC },
+	{ "float", 5, SCKKeywordC },
+	{ "for", 3, SCKKeywordC },
+	{ "goto", 4, SCKKeywordC },
+	{ "if", 2, SCKKeywordC },
+	{ "inline", 6, SCKKeywordC },
+	{ "int", 3, SCKKeywordC },
+	{ "long", 4, SCKKeywordC },
+	{ "register", 8, SCKKeywordC },
+	{ "restrict", 8, SCKKeywordC },
+	{ "return", 6, SCKKeywordC },
+	{ "short", 5, SCKKeywordC },
+	{ "signed", 6, SCKKeywordC },
+	{ "sizeof", 6, SCKKeywordC },
+	{ "static", 6, SCKKeywordC },
+	{ "struct", 6, SCKKeywordC },
+	{ "switch", 6, SCKKeywordC },
+	{ "typedef", 7, SCKKeywordC },
+	{ "typeof", 6, SCKKeywordC },
+	{ "union", 5, SCKKeywordC },
+	{ "unsigned", 8, SCKKeywordC },
+	{ "void", 4, SCKKeywordC },
+	{ "volatile", 8, SCKKeywordC },
+	{ "while", 5, SCKKeywordC },
+	/* Objective-C, after '@' */
+	{ "autoreleasepool", 15, SCKKeywordObjC },
+	{ "available", 9, SCKKeywordObjC },
+	{ "compatibility_alias", 19, SCKKeywordObjC },
+	{ "defs", 4, SCKKeywordObjC },
+	{ "dynamic", 7, SCKKeywordObjC },
+	{ "encode", 6, SCKKeywordObjC },
+	{ "end", 3, SCKKeywordObjC },
+	{ "finally", 7, SCKKeywordObjC },
+	{ "implementation", 14, SCKKeywordObjC },
+	{ "import", 6, SCKKeywordObjC },
+	{ "interface", 9, SCKKeywordObjC },
+	{ "optional", 8, SCKKeywordObjC },
+	{ "package", 7, SCKKeywordObjC },
+	{ "property", 8, SCKKeywordObjC },
+	{ "protocol", 8, SCKKeywordObjC },
+	{ "required", 8, SCKKeywordObjC },
+	{ "selector", 8, SCKKeywordObjC },
+	{ "synchronized", 12, SCKKeywordObjC },
+	{ "synthesize", 10, SCKKeywordObjC },
+	/* C++ */
+	{ "alignas", 7, SCKKeywordCXX },
+	{ "alignof", 7, SCKKeywordCXX },
+	{ "and", 3, SCKKeywordCXX },
+	{ "and_eq", 6, SCKKeywordCXX },
+	{ "bitand", 6, SCKKeywordCXX },
+	{ "bitor", 5, SCKKeywordCXX },
+	{ "bool", 4, SCKKeywordCXX },
+	{ "char16_t", 8, SCKKeywordCXX },
+	{ "char32_t", 8, SCKKeywordCXX },
+	{ "char8_t", 7, SCKKeywordCXX },
+	{ "co_await", 8, SCKKeywordCXX },
+	{ "co_return", 9, SCKKeywordCXX },
+	{ "co_yield", 8, SCKKeywordCXX },
+	{ "compl", 5, SCKKeywordCXX },
+	{ "concept", 7, SCKKeywordCXX },
+	{ "const_cast", 10, SCKKeywordCXX },
+	{ "consteval", 9, SCKKeywordCXX },
+	{ "constexpr", 9, SCKKeywordCXX },
+	{ "constinit", 9, SCKKeywordCXX },
+	{ "decltype", 8, SCKKeywordCXX },
+	{ "delete", 6, SCKKeywordCXX },
+	{ "dynamic_cast", 12, SCKKeywordCXX },
+	{ "explicit", 8, SCKKeywordCXX },
+	{ "export", 6, SCKKeywordCXX },
+	{ "false", 5, SCKKeywordCXX },
+	{ "friend", 6, SCKKeywordCXX },
+	{ "mutable", 7, SCKKeywordCXX },
+	{ "namespace", 9, SCKKeywordCXX },
+	{ "new", 3, SCKKeywordCXX },
+	{ "noexcept", 8, SCKKeywordCXX },
+	{ "not", 3, SCKKeywordCXX },
+	{ "not_eq", 6, SCKKeywordCXX },
+	{ "nullptr", 7, SCKKeywordCXX },
+	{ "operator", 8, SCKKeywordCXX },
+	{ "or", 2, SCKKeywordCXX },
+	{ "or_eq", 5, SCKKeywordCXX },
+	{ "reinterpret_cast", 16, SCKKeywordCXX },
+	{ "requires", 8, SCKKeywordCXX },
+	{ "static_assert", 13, SCKKeywordCXX },
+	{ "static_cast", 11, SCKKeywordCXX },
+	{ "template", 8, SCKKeywordCXX },
+	{ "this", 4, SCKKeywordCXX },
+	{ "thread_local", 12, SCKKeywordCXX },
+	{ "true", 4, SCKKeywordCXX },
+	{ "typeid", 6, SCKKeywordCXX },
+	{ "typename", 8, SCKKeywordCXX },
+	{ "using", 5, SCKKeywordCXX },
+	{ "virtual", 7, SCKKeywordCXX },
+	{ "wchar_t", 7, SCKKeywordCXX },
+	{ "xor", 3, SCKKeywordCXX },
+	{ "xor_eq", 6, SCKKeywordCXX },
+	/* Objective-C after '@', and C++ */
+	{ "catch", 5, SCKKeywordObjC | SCKKeywordCXX },
+	{ "class", 5, SCKKeywordObjC | SCKKeywordCXX },
+	{ "private", 7, SCKKeywordObjC | SCKKeywordCXX },
+	{ "protected", 9, SCKKeywordObjC | SCKKeywordCXX },
+	{ "public", 6, SCKKeywordObjC | SCKKeywordCXX },
+	{ "throw", 5, SCKKeywordObjC | SCKKeywordCXX },
+	{ "try", 3, SCKKeywordObjC | SCKKeywordCXX },
+};
+
+/* The keyword table is a perfect hash table built with the 'hash and 
+   displace' method: the FNV-1a hash of a keyword selects a bucket, whose 
+   displacement is mixed into the hash to compute the keyword slot. The 
+   displacements are searched at initialization, so that no two keywords 
+   share a slot. */
+
+#define SCK_KEYWORD_BUCKET_COUNT 64
+#define SCK_KEYWORD_SLOT_COUNT 256
+
+static uint8_t keywordDisplacements[SCK_KEYWORD_BUCKET_COUNT];
+static SCKKeyword keywordTable[SCK_KEYWORD_SLOT_COUNT];
+
+static uint32_t keywordHash(const unichar *chars, NSUInteger length)
+{
+	uint32_t hash = 0x811c9dc5;
+
+	for (NSUInteger i = 0; i < length; i++)
+	{
+		hash = (hash ^ chars[i]) * 0x01000193;
+	}
+	return hash;
+}
+
+static inline NSUInteger keywordSlot(uint32_t hash, uint32_t displacement)
+{
+	return ((hash ^ (displacement * 0x9E3779B9)) * 0x85EBCA6B) >> 24;
+}
+
+static void initKeywordTable(void)
+{
+	NSUInteger keywordCount = sizeof(keywords) / sizeof(SCKKeyword);
+	uint32_t hashes[keywordCount];
+	NSUInteger bucketSizes[SCK_KEYWORD_BUCKET_COUNT] = { 0 };
+
+	for (NSUInteger i = 0; i < keywordCount; i++)
+	{
+		unichar chars[SCK_KEYWORD_MAX_LENGTH];
+
+		for (NSUInteger j = 0; j < keywords[i].length; j++)
+		{
+			chars[j] = keywords[i].name[j];
+		}
+		hashes[i] = keywordHash(chars, keywords[i].length);
+		bucketSizes[hashes[i] % SCK_KEYWORD_BUCKET_COUNT]++;
+	}
+
+	/* The buckets with the most keywords are the hardest to place, so they 
+	   are placed first */
+	for (NSUInteger size = keywordCount; size > 0; size--)
+	{
+		for (NSUInteger bucket = 0; bucket < SCK_KEYWORD_BUCKET_COUNT; bucket++)
+		{
+			if (bucketSizes[bucket] != size)
+			{
+				continue;
+			}
+
+			BOOL isPlaced = NO;
+
+			for (uint32_t displacement = 0; displacement <= UINT8_MAX && !isPlaced; displacement++)
+			{
+				NSUInteger slots[size];
+				NSUInteger slotCount = 0;
+
+				isPlaced = YES;
+				for (NSUInteger i = 0; i < keywordCount && isPlaced; i++)
+				{
+					if (hashes[i] % SCK_KEYWORD_BUCKET_COUNT != bucket)
+					{
+						continue;
+					}
+
+					NSUInteger slot = keywordSlot(hashes[i], displacement);
+
+					// The empty slots have a zero length
+					isPlaced = (0 == keywordTable[slot].length);
+					for (NSUInteger j = 0; j < slotCount && isPlaced; j++)
+					{
+						isPlaced = (slots[j] != slot);
+					}
+					slots[slotCount++] = slot;
+				}
+				if (!isPlaced)
+				{
+					continue;
+				}
+				keywordDisplacements[bucket] = displacement;
+				for (NSUInteger i = 0; i < keywordCount; i++)
+				{
+					if (hashes[i] % SCK_KEYWORD_BUCKET_COUNT == bucket)
+					{
+						keywordTable[keywordSlot(hashes[i], displacement)] = keywords[i];
+					}
+				}
+			}
+			NSCAssert(isPlaced, @"No displacement places the keywords of bucket %lu", (unsigned long)bucket);
+		}
+	}
+}
+
+/**
+ * Returns the languages in which the characters are a keyword, or 0 if they
+ * are not a keyword.
+ */
+static uint8_t keywordLanguages(const unichar *chars, NSUInteger length)
+{
+	if (length < 2 || length > SCK_KEYWORD_MAX_LENGTH)
+	{
+		return 0;
+	}
+
+	for (NSUInteger i = 0; i < length; i++)
+	{
+		if (chars[i] >= 0x80)
+		{
+			return 0;
+		}
+	}
+
+	uint32_t hash = keywordHash(chars, length);
+	uint32_t displacement = keywordDisplacements[hash % SCK_KEYWORD_BUCKET_COUNT];
+	const SCKKeyword *keyword = &keywordTable[keywordSlot(hash, displacement)];
+
+	// The empty slots have a zero length
+	if (keyword->length != length)
+	{
+		return 0;
+	}
+	for (NSUInteger i = 0; i < length; i++)
+	{
+		if (keyword->name[i] != chars[i])
+		{
+			return 0;
+		}
+	}
+	return keyword->languages;
+}
+
+/**
+ * ASCII character classes.
+ */
+enum
+{
+	SCKCharacterSpace = 1,
+	SCKCharacterIdentifierStart = 2,
+	SCKCharacterIdentifierBody = 4,
+	SCKCharacterDigit = 8
+};
+
+static uint8_t characterClasses[128];
+
+static void initCharacterClasses(void)
+{
+	for (unichar c = 0; c < 128; c++)
+	{
+		uint8_t class = 0;
+
+		if (' ' == c || '\t' == c || '\n' == c || '\r' == c || '\f' == c || '\v' == c)
+		{
+			class = SCKCharacterSpace;
+		}
+		else if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || '_' == c || '$' == c)
+		{
+			class = SCKCharacterIdentifierStart | SCKCharacterIdentifierBody;
+		}
+		else if ('0' <= c && c <= '9')
+		{
+			class = SCKCharacterDigit | SCKCharacterIdentifierBody;
+		}
+		characterClasses[c] = class;
+	}
+}
+
+/**
+ * Returns whether the character belongs to the class. The non-ASCII 
+ * characters can appear in identifiers.
+ */
+static inline BOOL isCharacterOfClass(unichar c, uint8_t aClass)
+{
+	if (c >= 128)
+	{
+		return (0 != (aClass & (SCKCharacterIdentifierStart | SCKCharacterIdentifierBody)));
+	}
+	return (0 != (characterClasses[c] & aClass));
+}
+
+/**
+ * Returns the index of the first character at or after the start index that is 
+ * one of the three given characters, or the length if there is none.
+ *
+ * Four characters are tested at once with 64-bit words until one matches.
+ */
+static NSUInteger scanUntilCharacters(const unichar *chars, NSUInteger start, NSUInteger length,
+	unichar c1, unichar c2, unichar c3)
+{
+	const uint64_t ones = 0x0001000100010001ULL;
+	const uint64_t highBits = 0x8000800080008000ULL;
+	const uint64_t pattern1 = c1 * ones;
+	const uint64_t pattern2 = c2 * ones;
+	const uint64_t pattern3 = c3 * ones;
+	NSUInteger i = start;
+
+	while (i + 4 <= length)
+	{
+		uint64_t word;
+
+		memcpy(&word, chars + i, sizeof(word));
+
+		uint64_t x1 = word ^ pattern1;
+		uint64_t x2 = word ^ pattern2;
+		uint64_t x3 = word ^ pattern3;
+
+		// A lane of x1, x2 or x3 is zero if the character matches
+		if (0 != ((((x1 - ones) & ~x1) | ((x2 - ones) & ~x2) | ((x3 - ones) & ~x3)) & highBits))
+		{
+			break;
+		}
+		i += 4;
+	}
+	while (i < length && chars[i] != c1 && chars[i] != c2 && chars[i] != c3)
+	{
+		i++;
+	}
+	return MIN(i, length);
+}
+
+/**
+ * Returns the index after the quoted literal whose content starts at the given 
+ * index, or the end of the line if the literal is not terminated.
+ */
+static NSUInteger scanQuoted(const unichar *chars, NSUInteger start, NSUInteger length, unichar quote)
+{
+	NSUInteger i = start;
+
+	while (i < length)
+	{
+		i = scanUntilCharacters(chars, i, length, quote, '\\', '\n');
+
+		if (i >= length || '\n' == chars[i])
+		{
+			return i;
+		}
+		if (quote == chars[i])
+		{
+			return i + 1;
+		}
+		// An escape sequence or a line continuation
+		i += ((i + 2 < length && '\r' == chars[i + 1] && '\n' == chars[i + 2]) ? 3 : 2);
+	}
+	return length;
+}
+
+/**
+ * Returns the index after the C++ raw string literal whose delimiter starts 
+ * at the given index, or the end of the line if it is malformed.
+ */
+static NSUInteger scanRawString(const unichar *chars, NSUInteger start, NSUInteger length)
+{
+	NSUInteger delimiterLength = 0;
+
+	// A delimiter is at most 16 characters
+	while (delimiterLength <= 16 && start + delimiterLength < length
+	 && '(' != chars[start + delimiterLength] && '\n' != chars[start + delimiterLength])
+	{
+		delimiterLength++;
+	}
+	if (delimiterLength > 16 || start + delimiterLength >= length || '(' != chars[start + delimiterLength])
+	{
+		return scanUntilCharacters(chars, start, length, '\n', '\n', '\n');
+	}
+
+	const unichar *delimiter = chars + start;
+	NSUInteger i = start + delimiterLength + 1;
+
+	while (i < length)
+	{
+		i = scanUntilCharacters(chars, i, length, ')', ')', ')');
+
+		BOOL isEnd = (i + delimiterLength + 1 < length
+			&& 0 == memcmp(chars + i + 1, delimiter, delimiterLength * sizeof(unichar))
+			&& '"' == chars[i + delimiterLength + 1]);
+
+		if (isEnd)
+		{
+			return i + delimiterLength + 2;
+		}
+		i++;
+	}
+	return length;
+}
+
+/**
+ * Returns the index after the comment that starts at the given index with 
+ * two slashes or a slash and a star.
+ */
+static NSUInteger scanComment(const unichar *chars, NSUInteger start, NSUInteger length)
+{
+	NSUInteger i = start + 2;
+
+	if ('/' == chars[start + 1])
+	{
+		while (i < length)
+		{
+			i = scanUntilCharacters(chars, i, length, '\n', '\n', '\n');
+
+			// A backslash at the end of the line continues the comment
+			BOOL isContinued = (i < length && ((i >= 1 && '\\' == chars[i - 1])
+				|| (i >= 2 && '\r' == chars[i - 1] && '\\' == chars[i - 2])));
+
+			if (!isContinued)
+			{
+				return i;
+			}
+			i++;
+		}
+		return length;
+	}
+
+	while (i < length)
+	{
+		i = scanUntilCharacters(chars, i, length, '*', '*', '*');
+
+		if (i + 1 >= length)
+		{
+			return length;
+		}
+		if ('/' == chars[i + 1])
+		{
+			return i + 2;
+		}
+		i++;
+	}
+	return length;
+}
+
+/**
+ * Returns the index after the preprocessing number that starts at the given
+ * index (e.g. 0x1Fu, 1.5e-3f or 1'000 in C++).
+ */
+static NSUInteger scanNumber(const unichar *chars, NSUInteger start, NSUInteger length, BOOL isCPlusPlus)
+{
+	NSUInteger i = start + 1;
+
+	while (i < length)
+	{
+		unichar c = chars[i];
+		unichar previous = chars[i - 1];
+		BOOL isExponentSign = (('+' == c || '-' == c)
+			&& ('e' == previous || 'E' == previous || 'p' == previous || 'P' == previous));
+		BOOL isDigitSeparator = (isCPlusPlus && '\'' == c && i + 1 < length
+			&& isCharacterOfClass(chars[i + 1], SCKCharacterIdentifierBody));
+
+		if (!isCharacterOfClass(c, SCKCharacterIdentifierBody) && '.' != c && !isExponentSign && !isDigitSeparator)
+		{
+			break;
+		}
+		i++;
+	}
+	return i;
+}
+
+/**
+ * Returns whether the identifier is a string or character literal prefix 
+ * (e.g. L in L"string"), and whether it starts a raw string literal.
+ */
+static BOOL isLiteralPrefix(const unichar *chars, NSUInteger length, BOOL isCPlusPlus, BOOL *isRaw)
+{
+	*isRaw = (isCPlusPlus && length > 0 && 'R' == chars[length - 1]);
+
+	NSUInteger encodingLength = (*isRaw ? length - 1 : length);
+
+	switch (encodingLength)
+	{
+		case 0:
+			return *isRaw;
+		case 1:
+			return ('L' == chars[0] || 'u' == chars[0] || 'U' == chars[0]);
+		case 2:
+			return ('u' == chars[0] && '8' == chars[1]);
+		default:
+			return NO;
+	}
+}
+
+/**
+ * The preprocessor directive state of the lexer.
+ */
+typedef enum
+{
+	SCKDirectiveNone,
+	/** After a '#' that starts a line. */
+	SCKDirectiveName,
+	/** After #import, #include or #include_next. */
+	SCKDirectiveHeaderName
+} SCKDirectiveState;
+
+static BOOL isIncludeDirective(const unichar *chars, NSUInteger length)
+{
+	static const char *directives[] = { "import", "include", "include_next" };
+
+	for (unsigned i = 0; i < sizeof(directives) / sizeof(directives[0]); i++)
+	{
+		NSUInteger j = 0;
+
+		while (j < length && '\0' != directives[i][j] && directives[i][j] == chars[j])
+		{
+			j++;
+		}
+		if (j == length && '\0' == directives[i][j])
+		{
+			return YES;
+		}
+	}
+	return NO;
+}
+
+@implementation SCKLexer
+{
+	NSUInteger length;
+	unichar *chars;
+	NSUInteger position;
+	/** Whether only whitespace precedes the position on its line. */
+	BOOL isLineStart;
+	SCKDirectiveState directive;
+}
+
+@synthesize lexesCPlusPlus;
+
++ (void)initialize
+{
+	if (self != [SCKLexer class])
+		return;
+
+	initCharacterClasses();
+	initKeywordTable();
+}
+
+- (id)initWithString: (NSString *)aString
+{
+	NILARG_EXCEPTION_TEST(aString);
+	SUPERINIT;
+	length = [aString length];
+	chars = malloc(MAX(length, 1) * sizeof(unichar));
+	[aString getCharacters: chars range: NSMakeRange(0, length)];
+	isLineStart = YES;
+	return self;
+}
+
+- (id)init
+{
+	return [self initWithString: nil];
+}
+
+- (void)dealloc
+{
+	free(chars);
+}
+
+- (BOOL)nextToken: (SCKToken *)aToken
+{
+	NSUInteger i = position;
+
+	while (i < length && isCharacterOfClass(chars[i], SCKCharacterSpace))
+	{
+		if ('\n' == chars[i])
+		{
+			isLineStart = YES;
+			directive = SCKDirectiveNone;
+		}
+		i++;
+	}
+	if (i >= length)
+	{
+		position = length;
+		return NO;
+	}
+
+	NSUInteger start = i;
+	SCKDirectiveState previousDirective = directive;
+	BOOL isDirectiveStart = isLineStart;
+	SCKTokenKind kind = SCKTokenKindPunctuation;
+	BOOL isObjCKeywordAllowed = NO;
+
+	isLineStart = NO;
+	directive = SCKDirectiveNone;
+
+	/* As in -[SCKClangSourceFile highlightRange:syntax:], the '@' is part of 
+	   the token it prefixes */
+	if ('@' == chars[i] && i + 1 < length && !isCharacterOfClass(chars[i + 1], SCKCharacterSpace))
+	{
+		isObjCKeywordAllowed = YES;
+		i++;
+	}
+
+	unichar c = chars[i];
+	unichar next = (i + 1 < length ? chars[i + 1] : 0);
+
+	if (isCharacterOfClass(c, SCKCharacterIdentifierStart))
+	{
+		NSUInteger wordStart = i;
+
+		i++;
+		while (i < length && isCharacterOfClass(chars[i], SCKCharacterIdentifierBody))
+		{
+			i++;
+		}
+
+		BOOL isRaw = NO;
+		BOOL isQuoted = (i < length && ('"' == chars[i] || '\'' == chars[i]));
+
+		if (isQuoted && isLiteralPrefix(chars + wordStart, i - wordStart, lexesCPlusPlus, &isRaw))
+		{
+			kind = SCKTokenKindLiteral;
+			i = ((isRaw && '"' == chars[i]) ?
+				scanRawString(chars, i + 1, length) : scanQuoted(chars, i + 1, length, chars[i]));
+		}
+		else
+		{
+			uint8_t languages = keywordLanguages(chars + wordStart, i - wordStart);
+			uint8_t allowedLanguages = SCKKeywordC
+				| (lexesCPlusPlus ? SCKKeywordCXX : 0) | (isObjCKeywordAllowed ? SCKKeywordObjC : 0);
+
+			kind = (0 != (languages & allowedLanguages) ? SCKTokenKindKeyword : SCKTokenKindIdentifier);
+
+			if (SCKDirectiveName == previousDirective && isIncludeDirective(chars + wordStart, i - wordStart))
+			{
+				directive = SCKDirectiveHeaderName;
+			}
+		}
+	}
+	else if (isCharacterOfClass(c, SCKCharacterDigit)
+	      || ('.' == c && isCharacterOfClass(next, SCKCharacterDigit)))
+	{
+		kind = SCKTokenKindLiteral;
+		i = scanNumber(chars, i, length, lexesCPlusPlus);
+	}
+	else if ('"' == c || '\'' == c)
+	{
+		kind = SCKTokenKindLiteral;
+		i = scanQuoted(chars, i + 1, length, c);
+	}
+	else if ('/' == c && ('/' == next || '*' == next))
+	{
+		kind = SCKTokenKindComment;
+		i = scanComment(chars, i, length);
+		// A comment is whitespace for the preprocessor, e.g. /* x */ #import <a.h>
+		isLineStart = isDirectiveStart;
+		directive = previousDirective;
+	}
+	else if ('<' == c && SCKDirectiveHeaderName == previousDirective)
+	{
+		NSUInteger end = scanUntilCharacters(chars, i + 1, length, '>', '\n', '\n');
+
+		if (end < length && '>' == chars[end])
+		{
+			kind = SCKTokenKindLiteral;
+			i = end + 1;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	else
+	{
+		if ('#' == c && isDirectiveStart && !isObjCKeywordAllowed)
+		{
+			directive = SCKDirectiveName;
+		}
+		i++;
+	}
+
+	position = i;
+	aToken->kind = kind;
+	aToken->range = NSMakeRange(start, i - start);
+	return YES;
+}
+
+/**
+ * Sets the token type of the given range of the string, unless the whole
+ * range already has it. A nil type removes the attribute.
+ */
+static void setTokenTypeOfRange(NSMutableAttributedString *aString, NSString *aType, NSRange aRange)
+{
+	if (0 == aRange.length)
+		return;
+
+	NSRange existingRange;
+	id existingType = [aString attribute: kSCKTextTokenType
+	                             atIndex: aRange.location
+	               longestEffectiveRange: &existingRange
+	                             inRange: aRange];
+
+	if (existingType == aType && NSEqualRanges(existingRange, aRange))
+		return;
+
+	if (nil == aType)
+	{
+		[aString removeAttribute: kSCKTextTokenType range: aRange];
+	}
+	else
+	{
+		[aString addAttribute: kSCKTextTokenType value: aType range: aRange];
+	}
+}
+
++ (void)lexicalHighlightString: (NSMutableAttributedString *)aSource
+                     cPlusPlus: (BOOL)isCPlusPlus
+{
+	SCKLexer *lexer = [[self alloc] initWithString: [aSource string]];
+	SCKToken token;
+	NSRange run = NSMakeRange(NSNotFound, 0);
+	SCKTokenKind runKind = SCKTokenKindPunctuation;
+	/* The end of the part already highlighted. The string is updated in a 
+	   single pass, where the runs get their type and the whitespace between 
+	   them loses it, and the ranges that didn't change are left untouched. */
+	NSUInteger highlightedEnd = 0;
+	BOOL hasToken;
+
+	[lexer setLexesCPlusPlus: isCPlusPlus];
+
+	[aSource beginEditing];
+	do
+	{
+		hasToken = [lexer nextToken: &token];
+		if (hasToken && NSNotFound != run.location && token.kind == runKind
+		 && NSMaxRange(run) == token.range.location)
+		{
+			run.length += token.range.length;
+			continue;
+		}
+		if (NSNotFound != run.location)
+		{
+			setTokenTypeOfRange(aSource, nil, NSMakeRange(highlightedEnd, run.location - highlightedEnd));
+			setTokenTypeOfRange(aSource, SCKTextTokenTypeForTokenKind(runKind), run);
+			highlightedEnd = NSMaxRange(run);
+		}
+		if (hasToken)
+		{
+			run = token.range;
+			runKind = token.kind;
+		}
+	} while (hasToken);
+	setTokenTypeOfRange(aSource, nil, NSMakeRange(highlightedEnd, [aSource length] - highlightedEnd));
+	[aSource endEditing];
+}
+
+@end
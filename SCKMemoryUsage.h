@@ -0,0 +1,53 @@
+#import <Foundation/NSObject.h>
+
+@class NSString, NSDictionary, NSMutableDictionary;
+@class NSAttributedString;
+
+/**
+ * Memory category for the program components (SCKClass, SCKMethod etc.)
+ * collected by SourceCodeKit.
+ */
+extern NSString * const SCKMemoryUsageSymbolsCategory;
+/**
+ * Memory category for the program components collected by runtime
+ * introspection.
+ */
+extern NSString * const SCKMemoryUsageRuntimeSymbolsCategory;
+/**
+ * Memory category for the source attributed strings (characters and
+ * attribute runs).
+ */
+extern NSString * const SCKMemoryUsageSourceTextCategory;
+
+/**
+ * Memory used by some source files, broken down by category.
+ *
+ * libclang categories are named after clang_getTUResourceUsageName() and
+ * prefixed with 'libclang: ' (e.g. 'libclang: AST: ASTContext (memory)').
+ * Amounts are estimations in bytes.
+ */
+@interface SCKMemoryUsage : NSObject
+{
+	@private
+	NSMutableDictionary *bytesByCategory;
+}
+/**
+ * Number of bytes by category name.
+ */
+@property (nonatomic, readonly) NSDictionary *bytesByCategory;
+/**
+ * The sum of the bytes across all categories.
+ */
+@property (nonatomic, readonly) NSUInteger totalBytes;
+- (void)addBytes: (NSUInteger)bytes forCategory: (NSString*)aCategory;
+/**
+ * Adds the amounts of another memory usage, category by category.
+ */
+- (void)addMemoryUsage: (SCKMemoryUsage*)aMemoryUsage;
+@end
+
+/**
+ * Returns an estimation of the memory used by an attributed string, including
+ * its attribute runs.
+ */
+NSUInteger SCKEstimatedMemoryUsageOfAttributedString(NSAttributedString *aString);
@@ -0,0 +1,83 @@
+#import "SCKMemoryUsage.h"
+#import <Foundation/Foundation.h>
+#import <EtoileFoundation/EtoileFoundation.h>
+
+NSString * const SCKMemoryUsageSymbolsCategory = @"SourceCodeKit: symbols";
+NSString * const SCKMemoryUsageRuntimeSymbolsCategory = @"SourceCodeKit: runtime symbols";
+NSString * const SCKMemoryUsageSourceTextCategory = @"SourceCodeKit: source text";
+
+/** Rough size of an attribute run in NSAttributedString implementations. */
+#define ATTRIBUTE_RUN_SIZE 48
+
+NSUInteger SCKEstimatedMemoryUsageOfAttributedString(NSAttributedString *aString)
+{
+	NSUInteger length = [aString length];
+	NSUInteger runCount = 0;
+	NSRange r = NSMakeRange(0, 0);
+
+	while (NSMaxRange(r) < length)
+	{
+		[aString attributesAtIndex: NSMaxRange(r) effectiveRange: &r];
+		runCount++;
+	}
+	return length * sizeof(unichar) + runCount * ATTRIBUTE_RUN_SIZE;
+}
+
+@implementation SCKMemoryUsage
+
+- (id)init
+{
+	SUPERINIT;
+	bytesByCategory = [NSMutableDictionary new];
+	return self;
+}
+
+- (NSDictionary*)bytesByCategory
+{
+	return [bytesByCategory copy];
+}
+
+- (NSUInteger)totalBytes
+{
+	NSUInteger total = 0;
+
+	for (NSNumber *bytes in [bytesByCategory objectEnumerator])
+	{
+		total += [bytes unsignedIntegerValue];
+	}
+	return total;
+}
+
+- (void)addBytes: (NSUInteger)bytes forCategory: (NSString*)aCategory
+{
+	NILARG_EXCEPTION_TEST(aCategory);
+	NSUInteger current = [[bytesByCategory objectForKey: aCategory] unsignedIntegerValue];
+
+	[bytesByCategory setObject: [NSNumber numberWithUnsignedInteger: current + bytes]
+	                    forKey: aCategory];
+}
+
+- (void)addMemoryUsage: (SCKMemoryUsage*)aMemoryUsage
+{
+	NSDictionary *otherBytes = [aMemoryUsage bytesByCategory];
+
+	for (NSString *category in otherBytes)
+	{
+		[self addBytes: [[otherBytes objectForKey: category] unsignedIntegerValue]
+		   forCategory: category];
+	}
+}
+
+- (NSString*)description
+{
+	NSMutableString *str = [NSMutableString stringWithFormat: @"%@ %lu bytes",
+		[super description], (unsigned long)[self totalBytes]];
+
+	for (NSString *category in [[bytesByCategory allKeys] sortedArrayUsingSelector: @selector(compare:)])
+	{
+		[str appendFormat: @"\n\t%@: %@", category, [bytesByCategory objectForKey: category]];
+	}
+	return str;
+}
+
+@end
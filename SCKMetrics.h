@@ -0,0 +1,103 @@
+#import <Foundation/NSObject.h>
+
+@class NSString, NSArray, NSDictionary, NSLock, NSMutableDictionary;
+
+/**
+ * The operations timed by SCKMetrics.
+ */
+typedef enum
+{
+	/** Parsing or reparsing a translation unit (-[SCKSourceFile reparse]). */
+	SCKMetricPhaseParse,
+	/** Collecting the program components of a parsed file. */
+	SCKMetricPhaseIndex,
+	/** -[SCKSourceFile lexicalHighlightFile]. */
+	SCKMetricPhaseLexicalHighlight,
+	/** -[SCKSourceFile syntaxHighlightRange:]. */
+	SCKMetricPhaseSyntaxHighlight,
+	/** -[SCKSyntaxHighlighter transformString:]. */
+	SCKMetricPhasePresentation,
+	/** Collecting diagnostics. */
+	SCKMetricPhaseDiagnostics,
+	/** Code completion requests answered from a new libclang invocation. */
+	SCKMetricPhaseCompletion,
+	/** Code completion requests answered from a cached completion session. */
+	SCKMetricPhaseCompletionFiltering,
+	SCKMetricPhaseCount
+} SCKMetricPhase;
+
+/**
+ * Returns a human-readable name for the phase.
+ */
+NSString *NSStringFromSCKMetricPhase(SCKMetricPhase aPhase);
+
+/**
+ * Returns the value of a monotonic clock in seconds, to measure durations to
+ * pass to -[SCKMetrics recordDuration:forPhase:file:].
+ */
+double SCKMetricsNow(void);
+
+/**
+ * Immutable statistics about the calls recorded for a phase.
+ *
+ * All the durations are in seconds.
+ */
+@interface SCKPhaseStatistics : NSObject
+@property (nonatomic, readonly) SCKMetricPhase phase;
+@property (nonatomic, readonly) NSUInteger callCount;
+@property (nonatomic, readonly) double totalTime;
+@property (nonatomic, readonly) double maxTime;
+@property (nonatomic, readonly) double meanTime;
+/**
+ * Latency percentiles estimated from a logarithmic histogram (about 10%
+ * precision).
+ *
+ * Per-file statistics don't keep histograms, their percentiles are computed
+ * from the durations of the last 32 calls.
+ */
+@property (nonatomic, readonly) double p50;
+@property (nonatomic, readonly) double p95;
+@property (nonatomic, readonly) double p99;
+@end
+
+/**
+ * Always-on, low-overhead counters and latency histograms for the main
+ * SourceCodeKit operations.
+ *
+ * Each SCKSourceCollection owns a SCKMetrics instance that its source files
+ * report to.  Recording a duration is thread-safe and doesn't allocate memory
+ * once a file has been seen.
+ */
+@interface SCKMetrics : NSObject
+{
+	@private
+	NSLock *lock;
+	/** Per-phase latency histograms. */
+	struct SCKPhaseHistogram *histograms;
+	/** Per-file counters as NSMutableData by file name. */
+	NSMutableDictionary *fileCounters;
+}
+/**
+ * Records the duration of a call for the given phase.  aFileName can be nil.
+ */
+- (void)recordDuration: (double)seconds
+              forPhase: (SCKMetricPhase)aPhase
+                  file: (NSString*)aFileName;
+/**
+ * Returns the statistics for the phase across all files.
+ */
+- (SCKPhaseStatistics*)statisticsForPhase: (SCKMetricPhase)aPhase;
+/**
+ * Returns the statistics for the phase, restricted to the given file.
+ */
+- (SCKPhaseStatistics*)statisticsForPhase: (SCKMetricPhase)aPhase
+                                     file: (NSString*)aFileName;
+/**
+ * The names of the files for which some durations have been recorded.
+ */
+@property (nonatomic, readonly) NSArray *fileNames;
+/**
+ * Discards all recorded durations and counters.
+ */
+- (void)reset;
+@end
@@ -0,0 +1,296 @@
+#import "SCKMetrics.h"
+#import <Foundation/Foundation.h>
+#import <EtoileFoundation/EtoileFoundation.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Number of histogram buckets per doubling of the duration. */
+#define BUCKETS_PER_DOUBLING 8
+/** Histogram buckets, covering durations from 1ns to about 137s. */
+#define BUCKET_COUNT (37 * BUCKETS_PER_DOUBLING)
+
+struct SCKPhaseHistogram
+{
+	NSUInteger callCount;
+	double totalTime;
+	double maxTime;
+	uint32_t buckets[BUCKET_COUNT];
+};
+
+/** Number of recent durations kept per file and phase. */
+#define RECENT_SAMPLE_COUNT 32
+
+/**
+ * Per-file counters (no histogram, to keep them small).
+ */
+struct SCKPhaseCounters
+{
+	NSUInteger callCount;
+	double totalTime;
+	double maxTime;
+	/** The last durations, as a ring buffer indexed by callCount. */
+	float recentTimes[RECENT_SAMPLE_COUNT];
+};
+
+NSString *NSStringFromSCKMetricPhase(SCKMetricPhase aPhase)
+{
+	switch (aPhase)
+	{
+		case SCKMetricPhaseParse: return @"parse";
+		case SCKMetricPhaseIndex: return @"index";
+		case SCKMetricPhaseLexicalHighlight: return @"lexical highlight";
+		case SCKMetricPhaseSyntaxHighlight: return @"syntax highlight";
+		case SCKMetricPhasePresentation: return @"presentation";
+		case SCKMetricPhaseDiagnostics: return @"diagnostics";
+		case SCKMetricPhaseCompletion: return @"completion";
+		case SCKMetricPhaseCompletionFiltering: return @"completion filtering";
+		default: return nil;
+	}
+}
+
+double SCKMetricsNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline NSUInteger bucketForDuration(double seconds)
+{
+	double ns = seconds * 1e9;
+
+	if (ns <= 1)
+	{
+		return 0;
+	}
+	return MIN((NSUInteger)(log2(ns) * BUCKETS_PER_DOUBLING), BUCKET_COUNT - 1);
+}
+
+static inline double durationForBucket(NSUInteger bucket)
+{
+	return exp2((bucket + 0.5) / BUCKETS_PER_DOUBLING) / 1e9;
+}
+
+static double percentileFromHistogram(struct SCKPhaseHistogram *h, double p)
+{
+	if (h->callCount == 0)
+	{
+		return 0;
+	}
+	NSUInteger rank = (NSUInteger)ceil(p * h->callCount);
+	NSUInteger seen = 0;
+
+	for (NSUInteger i = 0; i < BUCKET_COUNT; i++)
+	{
+		seen += h->buckets[i];
+		if (seen >= rank)
+		{
+			return MIN(durationForBucket(i), h->maxTime);
+		}
+	}
+	return h->maxTime;
+}
+
+static int compareDurations(const void *lhs, const void *rhs)
+{
+	float d1 = *(const float *)lhs;
+	float d2 = *(const float *)rhs;
+
+	return (d1 < d2 ? -1 : (d1 > d2 ? 1 : 0));
+}
+
+/**
+ * Computes the percentiles of the recent durations of the counters.
+ */
+static void percentilesFromCounters(const struct SCKPhaseCounters *c, double *p50, double *p95, double *p99)
+{
+	NSUInteger count = MIN(c->callCount, RECENT_SAMPLE_COUNT);
+	float sorted[RECENT_SAMPLE_COUNT];
+
+	if (count == 0)
+	{
+		*p50 = *p95 = *p99 = 0;
+		return;
+	}
+	memcpy(sorted, c->recentTimes, count * sizeof(float));
+	qsort(sorted, count, sizeof(float), compareDurations);
+
+	*p50 = sorted[(NSUInteger)ceil(0.50 * count) - 1];
+	*p95 = sorted[(NSUInteger)ceil(0.95 * count) - 1];
+	*p99 = sorted[(NSUInteger)ceil(0.99 * count) - 1];
+}
+
+@interface SCKPhaseStatistics ()
+- (id)initWithPhase: (SCKMetricPhase)aPhase
+          callCount: (NSUInteger)aCount
+          totalTime: (double)aTotal
+            maxTime: (double)aMax
+                p50: (double)aP50
+                p95: (double)aP95
+                p99: (double)aP99;
+@end
+
+@implementation SCKPhaseStatistics
+
+@synthesize phase, callCount, totalTime, maxTime, p50, p95, p99;
+
+- (id)initWithPhase: (SCKMetricPhase)aPhase
+          callCount: (NSUInteger)aCount
+          totalTime: (double)aTotal
+            maxTime: (double)aMax
+                p50: (double)aP50
+                p95: (double)aP95
+                p99: (double)aP99
+{
+	SUPERINIT;
+	phase = aPhase;
+	callCount = aCount;
+	totalTime = aTotal;
+	maxTime = aMax;
+	p50 = aP50;
+	p95 = aP95;
+	p99 = aP99;
+	return self;
+}
+
+- (double)meanTime
+{
+	return (callCount == 0 ? 0 : totalTime / callCount);
+}
+
+- (NSString*)description
+{
+	return [NSString stringWithFormat: @"%@: %lu calls, %.3fms total, mean %.3fms, "
+		"p50 %.3fms, p95 %.3fms, p99 %.3fms, max %.3fms",
+		NSStringFromSCKMetricPhase(phase), (unsigned long)callCount, totalTime * 1000,
+		[self meanTime] * 1000, p50 * 1000, p95 * 1000, p99 * 1000, maxTime * 1000];
+}
+
+@end
+
+@implementation SCKMetrics
+
+- (id)init
+{
+	SUPERINIT;
+	lock = [NSLock new];
+	histograms = calloc(SCKMetricPhaseCount, sizeof(struct SCKPhaseHistogram));
+	fileCounters = [NSMutableDictionary new];
+	return self;
+}
+
+- (void)dealloc
+{
+	free(histograms);
+}
+
+- (void)recordDuration: (double)seconds
+              forPhase: (SCKMetricPhase)aPhase
+                  file: (NSString*)aFileName
+{
+	NSParameterAssert(aPhase < SCKMetricPhaseCount);
+
+	[lock lock];
+	struct SCKPhaseHistogram *h = &histograms[aPhase];
+
+	h->callCount++;
+	h->totalTime += seconds;
+	h->maxTime = MAX(h->maxTime, seconds);
+	h->buckets[bucketForDuration(seconds)]++;
+
+	if (nil != aFileName)
+	{
+		NSMutableData *data = [fileCounters objectForKey: aFileName];
+
+		if (nil == data)
+		{
+			data = [NSMutableData dataWithLength: SCKMetricPhaseCount * sizeof(struct SCKPhaseCounters)];
+			[fileCounters setObject: data forKey: aFileName];
+		}
+		struct SCKPhaseCounters *c = &((struct SCKPhaseCounters *)[data mutableBytes])[aPhase];
+
+		c->recentTimes[c->callCount % RECENT_SAMPLE_COUNT] = (float)seconds;
+		c->callCount++;
+		c->totalTime += seconds;
+		c->maxTime = MAX(c->maxTime, seconds);
+	}
+	[lock unlock];
+}
+
+- (SCKPhaseStatistics*)statisticsForPhase: (SCKMetricPhase)aPhase
+{
+	NSParameterAssert(aPhase < SCKMetricPhaseCount);
+
+	[lock lock];
+	struct SCKPhaseHistogram *h = &histograms[aPhase];
+	SCKPhaseStatistics *stats = [[SCKPhaseStatistics alloc] initWithPhase: aPhase
+		callCount: h->callCount
+		totalTime: h->totalTime
+		  maxTime: h->maxTime
+		      p50: percentileFromHistogram(h, 0.50)
+		      p95: percentileFromHistogram(h, 0.95)
+		      p99: percentileFromHistogram(h, 0.99)];
+	[lock unlock];
+	return stats;
+}
+
+- (SCKPhaseStatistics*)statisticsForPhase: (SCKMetricPhase)aPhase
+                                     file: (NSString*)aFileName
+{
+	NSParameterAssert(aPhase < SCKMetricPhaseCount);
+	NILARG_EXCEPTION_TEST(aFileName);
+
+	[lock lock];
+	struct SCKPhaseCounters c;
+	NSData *data = [fileCounters objectForKey: aFileName];
+
+	memset(&c, 0, sizeof(c));
+	if (nil != data)
+	{
+		c = ((const struct SCKPhaseCounters *)[data bytes])[aPhase];
+	}
+	[lock unlock];
+
+	double p50, p95, p99;
+
+	percentilesFromCounters(&c, &p50, &p95, &p99);
+
+	return [[SCKPhaseStatistics alloc] initWithPhase: aPhase
+	                                       callCount: c.callCount
+	                                       totalTime: c.totalTime
+	                                         maxTime: c.maxTime
+	                                             p50: p50
+	                                             p95: p95
+	                                             p99: p99];
+}
+
+- (NSArray*)fileNames
+{
+	[lock lock];
+	NSArray *names = [fileCounters allKeys];
+	[lock unlock];
+	return names;
+}
+
+- (void)reset
+{
+	[lock lock];
+	memset(histograms, 0, SCKMetricPhaseCount * sizeof(struct SCKPhaseHistogram));
+	[fileCounters removeAllObjects];
+	[lock unlock];
+}
+
+- (NSString*)description
+{
+	NSMutableString *str = [NSMutableString stringWithString: [super description]];
+
+	for (int phase = 0; phase < SCKMetricPhaseCount; phase++)
+	{
+		[str appendFormat: @"\n\t%@", [self statisticsForPhase: phase]];
+	}
+	return str;
+}
+
+@end
@@ -0,0 +1,111 @@
+#import <Foundation/NSObject.h>
+#import <Foundation/NSRange.h>
+
+@class NSArray, NSString, SCKSourceLocation;
+
+/**
+ * Kinds of symbol occurrences.
+ */
+typedef enum
+{
+	/** A declaration that is not a definition (e.g. a method in @interface). */
+	SCKOccurrenceKindDeclaration,
+	/** A definition (e.g. a method in @implementation). */
+	SCKOccurrenceKindDefinition,
+	/**
+	 * A reference to a symbol declared elsewhere (e.g. a class name, a
+	 * variable in an expression or a message send).
+	 */
+	SCKOccurrenceKindReference
+} SCKOccurrenceKind;
+
+/**
+ * A declaration or a reference found in a source file by the last parse.
+ */
+@interface SCKSymbolOccurrence : NSObject
+- (id)initWithRange: (NSRange)aRange
+               kind: (SCKOccurrenceKind)aKind
+               name: (NSString *)aName
+                USR: (NSString *)aUSR
+        declaration: (SCKSourceLocation *)aDeclaration
+         definition: (SCKSourceLocation *)aDefinition;
+/**
+ * The extent of the occurrence in the file, in bytes as the offsets of
+ * SCKSourceLocation.
+ *
+ * For a declaration, the extent includes its body (e.g. a whole
+ * @implementation), and for a message send, its receiver and arguments.
+ */
+@property (nonatomic, readonly) NSRange range;
+@property (nonatomic, readonly) SCKOccurrenceKind kind;
+/**
+ * The name of the declared or referenced symbol.
+ */
+@property (nonatomic, readonly) NSString *name;
+/**
+ * The Unified Symbol Resolution of the declared or referenced symbol, which
+ * identifies it across files, or nil if it has none.
+ */
+@property (nonatomic, readonly) NSString *USR;
+/**
+ * The location of the declared or referenced symbol.
+ */
+@property (nonatomic, readonly) SCKSourceLocation *declaration;
+/**
+ * The location of the definition of the declared or referenced symbol, or
+ * nil if it wasn't visible to the parse.
+ */
+@property (nonatomic, readonly) SCKSourceLocation *definition;
+@end
+
+/**
+ * An immutable index of the symbol occurrences of a file, that answers which
+ * symbols are at a given offset in logarithmic time, without a translation
+ * unit.
+ *
+ * The occurrences are stored in an interval tree, laid out as a binary tree
+ * implicit in the array of the occurrences sorted by start offset, where
+ * each node records the greatest end offset of its subtree.
+ *
+ * An index can be used from several threads.
+ */
+@interface SCKOccurrenceIndex : NSObject
+/**
+ * <init />
+ * Initializes and returns an index of the given SCKSymbolOccurrence objects.
+ *
+ * Empty occurrences are ignored.
+ */
+- (id)initWithOccurrences: (NSArray *)someOccurrences;
+/**
+ * The occurrences sorted by start offset, then from the longest to the
+ * shortest.
+ */
+@property (nonatomic, readonly) NSArray *occurrences;
+/**
+ * Returns the innermost occurrence whose range contains the given offset,
+ * e.g. the reference under the mouse rather than the method that contains
+ * it, or nil if no occurrence contains the offset.
+ */
+- (SCKSymbolOccurrence *)occurrenceAtOffset: (NSUInteger)anOffset;
+/**
+ * Returns the occurrences whose range contains the given offset, sorted by
+ * start offset, so nested occurrences come after the ones that contain them.
+ * Occurrences with the same range are returned in the order they were 
+ * recorded.
+ *
+ * The cost is proportional to the logarithm of the number of occurrences
+ * plus the number of occurrences returned.
+ */
+- (NSArray *)occurrencesContainingOffset: (NSUInteger)anOffset;
+/**
+ * Returns the occurrences of the symbol with the given USR, sorted by start
+ * offset.
+ */
+- (NSArray *)occurrencesOfUSR: (NSString *)aUSR;
+/**
+ * Returns an estimation of the memory in bytes used by the index and its
+ * occurrences.
+ */
+@property (nonatomic, readonly) NSUInteger estimatedMemoryUsage;
+@end
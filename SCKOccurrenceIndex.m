@@ -0,0 +1,218 @@
+#import "SCKOccurrenceIndex.h"
+#import "SCKSourceFile.h"
+#import <EtoileFoundation/EtoileFoundation.h>
+#include <objc/runtime.h>
+
+@implementation SCKSymbolOccurrence
+
+@synthesize range, kind, name, USR, declaration, definition;
+
+- (id)initWithRange: (NSRange)aRange
+               kind: (SCKOccurrenceKind)aKind
+               name: (NSString *)aName
+                USR: (NSString *)aUSR
+        declaration: (SCKSourceLocation *)aDeclaration
+         definition: (SCKSourceLocation *)aDefinition
+{
+	SUPERINIT;
+	range = aRange;
+	kind = aKind;
+	name = aName;
+	USR = aUSR;
+	declaration = aDeclaration;
+	definition = aDefinition;
+	return self;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat: @"%@ %@ %@", [super description], name, NSStringFromRange(range)];
+}
+
+@end
+
+/**
+ * A node of the interval tree.
+ */
+typedef struct
+{
+	NSUInteger start;
+	NSUInteger end;
+	/** The greatest end offset in the subtree rooted at the node. */
+	NSUInteger maxEnd;
+} SCKIntervalNode;
+
+/**
+ * Computes the maxEnd of the nodes in [lo, hi), whose subtree root is the
+ * middle node, and returns the maxEnd of the root.
+ */
+static NSUInteger buildIntervalTree(SCKIntervalNode *nodes, NSUInteger lo, NSUInteger hi)
+{
+	if (lo >= hi)
+		return 0;
+
+	NSUInteger mid = lo + (hi - lo) / 2;
+	NSUInteger leftMaxEnd = buildIntervalTree(nodes, lo, mid);
+	NSUInteger rightMaxEnd = buildIntervalTree(nodes, mid + 1, hi);
+
+	nodes[mid].maxEnd = MAX(nodes[mid].end, MAX(leftMaxEnd, rightMaxEnd));
+	return nodes[mid].maxEnd;
+}
+
+/**
+ * Calls the block with the indexes of the nodes in [lo, hi) that contain the
+ * offset, in ascending order.
+ */
+static void searchIntervalTree(const SCKIntervalNode *nodes, NSUInteger lo, NSUInteger hi,
+	NSUInteger offset, void (^block)(NSUInteger))
+{
+	while (lo < hi)
+	{
+		NSUInteger mid = lo + (hi - lo) / 2;
+
+		// No interval of the subtree ends after the offset
+		if (nodes[mid].maxEnd <= offset)
+			return;
+
+		searchIntervalTree(nodes, lo, mid, offset, block);
+
+		// The nodes on the right start after the offset too
+		if (nodes[mid].start > offset)
+			return;
+
+		if (offset < nodes[mid].end)
+		{
+			block(mid);
+		}
+		lo = mid + 1;
+	}
+}
+
+@implementation SCKOccurrenceIndex
+{
+	NSArray *occurrences;
+	/** SCKIntervalNode array, in the order of the occurrences. */
+	NSData *nodes;
+	/** Occurrences (as a NSArray) by USR. */
+	NSDictionary *occurrencesByUSR;
+}
+
+@synthesize occurrences;
+
+- (id)initWithOccurrences: (NSArray *)someOccurrences
+{
+	SUPERINIT;
+	NSMutableArray *sortedOccurrences = [NSMutableArray arrayWithCapacity: [someOccurrences count]];
+	NSMutableDictionary *byUSR = [NSMutableDictionary dictionary];
+
+	for (SCKSymbolOccurrence *occurrence in someOccurrences)
+	{
+		if ([occurrence range].length > 0)
+		{
+			[sortedOccurrences addObject: occurrence];
+		}
+	}
+	// Occurrences with the same range keep the order they were recorded in
+	[sortedOccurrences sortWithOptions: NSSortStable
+	                   usingComparator: ^ NSComparisonResult (id lhs, id rhs)
+	{
+		NSRange r1 = [lhs range];
+		NSRange r2 = [rhs range];
+
+		if (r1.location != r2.location)
+			return (r1.location < r2.location ? NSOrderedAscending : NSOrderedDescending);
+		if (r1.length != r2.length)
+			return (r1.length > r2.length ? NSOrderedAscending : NSOrderedDescending);
+		return NSOrderedSame;
+	}];
+
+	NSUInteger count = [sortedOccurrences count];
+	NSMutableData *tree = [NSMutableData dataWithLength: count * sizeof(SCKIntervalNode)];
+	SCKIntervalNode *treeNodes = [tree mutableBytes];
+
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		SCKSymbolOccurrence *occurrence = [sortedOccurrences objectAtIndex: i];
+
+		treeNodes[i].start = [occurrence range].location;
+		treeNodes[i].end = NSMaxRange([occurrence range]);
+
+		if (nil != [occurrence USR])
+		{
+			NSMutableArray *occurrencesOfUSR = [byUSR objectForKey: [occurrence USR]];
+
+			if (nil == occurrencesOfUSR)
+			{
+				occurrencesOfUSR = [NSMutableArray array];
+				[byUSR setObject: occurrencesOfUSR forKey: [occurrence USR]];
+			}
+			[occurrencesOfUSR addObject: occurrence];
+		}
+	}
+	buildIntervalTree(treeNodes, 0, count);
+
+	occurrences = [sortedOccurrences copy];
+	nodes = tree;
+	occurrencesByUSR = [byUSR copy];
+	return self;
+}
+
+- (id)init
+{
+	return [self initWithOccurrences: [NSArray array]];
+}
+
+- (NSArray *)occurrencesContainingOffset: (NSUInteger)anOffset
+{
+	NSMutableArray *result = [NSMutableArray array];
+
+	searchIntervalTree([nodes bytes], 0, [occurrences count], anOffset, ^ (NSUInteger i)
+	{
+		[result addObject: [occurrences objectAtIndex: i]];
+	});
+	return result;
+}
+
+- (SCKSymbolOccurrence *)occurrenceAtOffset: (NSUInteger)anOffset
+{
+	const SCKIntervalNode *treeNodes = [nodes bytes];
+	__block NSUInteger innermost = NSNotFound;
+
+	searchIntervalTree(treeNodes, 0, [occurrences count], anOffset, ^ (NSUInteger i)
+	{
+		// The last of two occurrences with the same extent is the nested one
+		if (NSNotFound == innermost
+		 || treeNodes[i].end - treeNodes[i].start <= treeNodes[innermost].end - treeNodes[innermost].start)
+		{
+			innermost = i;
+		}
+	});
+	return (NSNotFound != innermost ? [occurrences objectAtIndex: innermost] : nil);
+}
+
+- (NSArray *)occurrencesOfUSR: (NSString *)aUSR
+{
+	NSArray *occurrencesOfUSR = [occurrencesByUSR objectForKey: aUSR];
+	return (nil != occurrencesOfUSR ? occurrencesOfUSR : [NSArray array]);
+}
+
+- (NSUInteger)estimatedMemoryUsage
+{
+	// Names, USRs and file paths are shared among the occurrences of a file
+	NSUInteger size = class_getInstanceSize([self class]) + [nodes length]
+		+ class_getInstanceSize([occurrences class]) + [occurrences count] * sizeof(id)
+		+ class_getInstanceSize([occurrencesByUSR class]) + [occurrencesByUSR count] * 2 * sizeof(id);
+
+	for (SCKSymbolOccurrence *occurrence in occurrences)
+	{
+		size += class_getInstanceSize([SCKSymbolOccurrence class])
+			+ class_getInstanceSize([SCKSourceLocation class]) * (nil != [occurrence definition] ? 2 : 1);
+	}
+	for (NSArray *occurrencesOfUSR in [occurrencesByUSR objectEnumerator])
+	{
+		size += class_getInstanceSize([occurrencesOfUSR class]) + [occurrencesOfUSR count] * sizeof(id);
+	}
+	return size;
+}
+
+@end
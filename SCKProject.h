@@ -1,7 +1,38 @@
 #import <Foundation/Foundation.h>
 #import <EtoileFoundation/EtoileFoundation.h>
 
-@class SCKSourceCollection;
+@class SCKSourceCollection, SCKProject, SCKIndexingScheduler;
+
+/**
+ * Posted when files are added to or removed from a project.
+ *
+ * The notification object is the project.
+ */
+extern NSString * const SCKProjectFilesDidChangeNotification;
+/**
+ * Posted when the program components declared in the project files change, 
+ * because a file was added, removed or reparsed.
+ *
+ * The notification object is the project. The user info contains the 
+ * components that appeared and disappeared for each kind of components (see 
+ * the keys below).
+ *
+ * Always posted on the thread that created the project, including for the 
+ * files reparsed on the indexing thread (in the default run loop mode).
+ */
+extern NSString * const SCKProjectSymbolsDidChangeNotification;
+/** Key for the SCKClass objects added to -[SCKProject classes]. */
+extern NSString * const SCKProjectInsertedClassesKey;
+/** Key for the SCKClass objects removed from -[SCKProject classes]. */
+extern NSString * const SCKProjectRemovedClassesKey;
+/** Key for the SCKFunction objects added to -[SCKProject functions]. */
+extern NSString * const SCKProjectInsertedFunctionsKey;
+/** Key for the SCKFunction objects removed from -[SCKProject functions]. */
+extern NSString * const SCKProjectRemovedFunctionsKey;
+/** Key for the SCKGlobal objects added to -[SCKProject globals]. */
+extern NSString * const SCKProjectInsertedGlobalsKey;
+/** Key for the SCKGlobal objects removed from -[SCKProject globals]. */
+extern NSString * const SCKProjectRemovedGlobalsKey;
 
 /**
  * SCKProject represents an IDE project that tracks several source files usually 
@@ -14,17 +45,27 @@
  * setting a custom project content class, that implements the collection 
  * protocols on the behalf of SCKProject instance. The collection returned by
  * -content depends on the class set with -setContentClass:.
+ *
+ * The files and program components are cached and kept up-to-date 
+ * incrementally when files are added, removed or reparsed, so accessing them 
+ * doesn't involve walking the whole project. Observe 
+ * SCKProjectFilesDidChangeNotification and 
+ * SCKProjectSymbolsDidChangeNotification to refresh a UI that presents them.
+ *
+ * The project keeps the SCKSourceFile objects it was given by the source 
+ * collection, so the project must be recreated after 
+ * -[SCKSourceCollection clear].
  */
 @interface SCKProject : NSObject //<ETCollection, ETCollectionMutation>
 
 /**
  * <init />
  * Initializes and returns a new project based on the directory URL (to resolve 
- * relative paths) and the provided source collection to retrieve the SCKFile 
- * objects.
+ * relative paths) and the provided source collection to retrieve the 
+ * SCKSourceFile objects.
  *
- * A source collection can be shared between several projects (it caches SCKFile 
- * objects).
+ * A source collection can be shared between several projects (it caches 
+ * SCKSourceFile objects).
  *
  * When aSourceCollection is nil, raises a NSInvalidArgumentException.
  */
@@ -54,14 +95,82 @@
 - (void)removeFileURL: (NSURL *)aURL;
 
 /**
- * The files that belong to the project.
+ * Crawls -directoryURL recursively and adds the files whose extensions are 
+ * supported by the source collection (see 
+ * +[SCKSourceCollection supportedFileExtensions]) with -addFileURL:.
  *
- * The returned array contains SCKFile objects.
+ * Hidden files and directories (e.g. .git) are skipped.
+ *
+ * Returns the URLs of the files that were not already in the project.
+ *
+ * When -directoryURL is nil, raises a NSInternalInconsistencyException.
+ */
+- (NSArray *)addFilesInDirectory;
+/**
+ * Crawls -directoryURL like -addFilesInDirectory, but queues the files that 
+ * are not already in the project in -indexingScheduler with 
+ * SCKIndexingPriorityBackground, and starts the scheduler.
+ *
+ * Each file is added to the project once the scheduler indexed it (even if it 
+ * was indexed early, e.g. by -[SCKIndexingScheduler indexOpenedFileAtPath:]), 
+ * and SCKProjectFilesDidChangeNotification is posted after each scheduler 
+ * slice that added files.
+ *
+ * Returns the URLs of the queued files.
+ *
+ * When -directoryURL is nil, raises a NSInternalInconsistencyException.
+ */
+- (NSArray *)scheduleFilesInDirectory;
+/**
+ * The scheduler that indexes the files queued by -scheduleFilesInDirectory.
+ *
+ * Call -[SCKIndexingScheduler indexOpenedFileAtPath:] on it when a file is 
+ * opened in an editor, so the file and its related files are indexed before 
+ * the rest of the project.
+ */
+@property (nonatomic, readonly) SCKIndexingScheduler *indexingScheduler;
+/**
+ * Starts watching -directoryURL and its subdirectories for changes, to keep 
+ * the project current without crawling it again.
+ *
+ * Changes are coalesced and processed on the thread that called this method 
+ * once its run loop is idle for a short delay: modified files that belong to 
+ * the project are reparsed, new supported files are added and deleted ones are 
+ * removed. The files that include a modified or deleted file are reparsed too 
+ * (see -[SCKSourceCollection reparseFilesIncludingFile:]). Unchanged files are 
+ * left untouched, so a branch switch costs work proportional to the files it 
+ * changes.
+ *
+ * Returns NO if the directory could not be watched (the current 
+ * implementation is based on inotify and is only available on Linux).
+ *
+ * When -directoryURL is nil, raises a NSInternalInconsistencyException.
+ */
+- (BOOL)startWatchingDirectory;
+/**
+ * Stops watching -directoryURL.
+ *
+ * Changes that were detected but not processed yet are discarded.
+ */
+- (void)stopWatchingDirectory;
+/**
+ * Whether -startWatchingDirectory was called and -stopWatchingDirectory wasn't 
+ * called since then.
+ */
+@property (nonatomic, readonly) BOOL isWatchingDirectory;
+
+/**
+ * The files that belong to the project, in the order they were added.
+ *
+ * The returned array contains SCKSourceFile objects.
  */ 
 @property (nonatomic, readonly) NSArray *files;
 /**
  * All the classes declared in the files that belong to the project.
  *
+ * A class declared in a header and defined in an implementation file appears 
+ * once.
+ *
  * The returned array contains SCKClass objects.
  */ 
 @property (nonatomic, readonly) NSArray *classes;
@@ -85,6 +194,10 @@
  * The content class must conform to SCKProjectContent protocol.
  */ 
 @property (nonatomic) Class contentClass;
+/**
+ * The collection built by the content class for the receiver.
+ */
+@property (nonatomic, readonly) id content;
 
 @end
 
@@ -94,7 +207,7 @@
  * See -[SCKProject setContentClass:].
  */
 @protocol SCKProjectContent
-- (id)content;
+- (id)contentForProject: (SCKProject *)aProject;
 @end
 
 /**
@@ -1,18 +1,191 @@
 #import "SCKProject.h"
+#import "SCKIndexingScheduler.h"
 #import "SCKSourceFile.h"
 #import "SCKSourceCollection.h"
+#include <fts.h>
+#ifdef __linux__
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
+NSString * const SCKProjectFilesDidChangeNotification = @"SCKProjectFilesDidChangeNotification";
+NSString * const SCKProjectSymbolsDidChangeNotification = @"SCKProjectSymbolsDidChangeNotification";
+NSString * const SCKProjectInsertedClassesKey = @"SCKProjectInsertedClassesKey";
+NSString * const SCKProjectRemovedClassesKey = @"SCKProjectRemovedClassesKey";
+NSString * const SCKProjectInsertedFunctionsKey = @"SCKProjectInsertedFunctionsKey";
+NSString * const SCKProjectRemovedFunctionsKey = @"SCKProjectRemovedFunctionsKey";
+NSString * const SCKProjectInsertedGlobalsKey = @"SCKProjectInsertedGlobalsKey";
+NSString * const SCKProjectRemovedGlobalsKey = @"SCKProjectRemovedGlobalsKey";
+
+/**
+ * Program components of a given kind contributed by the project files.
+ *
+ * A component can be contributed by several files (e.g. a class declared in a
+ * header and defined in an implementation file), so we count the contributions
+ * and the component stays in the view until the last one is removed.
+ */
+@interface SCKProjectSymbolView : NSObject
+{
+	@public
+	NSCountedSet *contributionCounts;
+	NSMutableOrderedSet *components;
+	/** Immutable array returned until the next change. */
+	NSArray *cachedComponents;
+}
+- (void)addComponents: (NSArray *)newComponents insertedComponents: (NSMutableArray *)inserted;
+- (void)removeComponents: (NSArray *)oldComponents removedComponents: (NSMutableArray *)removed;
+- (NSArray *)components;
+@end
+
+/**
+ * Visits the directories and files below aDirectory (included) with fts(3), 
+ * without stat'ing the files and skipping hidden entries.
+ *
+ * Either block can be nil.
+ */
+static void crawlDirectory(NSString *aDirectory,
+	void (^visitDirectory)(NSString *path), void (^visitFile)(NSString *path))
+{
+	NSFileManager *fileManager = [NSFileManager defaultManager];
+	char *roots[] = { (char *)[aDirectory fileSystemRepresentation], NULL };
+	FTS *fts = fts_open(roots, FTS_PHYSICAL | FTS_NOCHDIR | FTS_NOSTAT, NULL);
+	FTSENT *entry;
+
+	if (NULL == fts)
+		return;
+
+	while ((entry = fts_read(fts)) != NULL)
+	{
+		BOOL isHidden = (entry->fts_level > 0 && entry->fts_name[0] == '.');
+		void (^visit)(NSString *) = nil;
+
+		switch (entry->fts_info)
+		{
+			case FTS_D:
+				if (isHidden)
+				{
+					fts_set(fts, entry, FTS_SKIP);
+				}
+				visit = visitDirectory;
+				break;
+			case FTS_F:
+			case FTS_NSOK:
+				visit = visitFile;
+				break;
+			default:
+				break;
+		}
+
+		if (isHidden || nil == visit)
+			continue;
+
+		visit([fileManager stringWithFileSystemRepresentation: entry->fts_path
+		                                               length: entry->fts_pathlen]);
+	}
+	fts_close(fts);
+}
+
+/** Delay during which filesystem changes are coalesced before being processed. */
+static const NSTimeInterval changeCoalescingDelay = 0.2;
+
+@implementation SCKProjectSymbolView
+
+- (id)init
+{
+	SUPERINIT;
+	contributionCounts = [NSCountedSet new];
+	components = [NSMutableOrderedSet new];
+	return self;
+}
+
+- (void)addComponents: (NSArray *)newComponents insertedComponents: (NSMutableArray *)inserted
+{
+	for (id component in newComponents)
+	{
+		[contributionCounts addObject: component];
+
+		if ([contributionCounts countForObject: component] == 1)
+		{
+			[components addObject: component];
+			[inserted addObject: component];
+			cachedComponents = nil;
+		}
+	}
+}
+
+- (void)removeComponents: (NSArray *)oldComponents removedComponents: (NSMutableArray *)removed
+{
+	for (id component in oldComponents)
+	{
+		[contributionCounts removeObject: component];
+
+		if ([contributionCounts countForObject: component] == 0)
+		{
+			[components removeObject: component];
+			[removed addObject: component];
+			cachedComponents = nil;
+		}
+	}
+}
+
+- (NSArray *)components
+{
+	if (nil == cachedComponents)
+	{
+		cachedComponents = [[components array] copy];
+	}
+	return cachedComponents;
+}
+
+@end
 
 @implementation SCKProject
 {
 	NSURL *directoryURL;
 	SCKSourceCollection *sourceCollection;
+	/** The URLs as they were added, relative URLs included. */
 	NSMutableArray *fileURLs;
+	/**
+	 * The same URLs by standardized absolute path, so a relative URL and an 
+	 * absolute one for the same file are the same member.
+	 */
+	NSMutableDictionary *fileURLsByPath;
+	/** Source files in the order they were added. */
+	NSMutableArray *files;
+	/** Source files by standardized absolute path. */
+	NSMutableDictionary *filesByPath;
+	/**
+	 * The classes, functions and globals last contributed by each file, to be
+	 * retracted when the file is removed or reparsed.
+	 */
+	NSMapTable *componentsByFile;
+	SCKProjectSymbolView *classes;
+	SCKProjectSymbolView *functions;
+	SCKProjectSymbolView *globals;
 	id <SCKProjectContent> projectContent;
+	/** The inotify instance, or -1. */
+	int inotifyDescriptor;
+	NSFileHandle *inotifyHandle;
+	/** Watched directory paths by inotify watch descriptor. */
+	NSMutableDictionary *watchedDirectories;
+	/** Paths reported by inotify since changes were last processed. */
+	NSMutableOrderedSet *changedPaths;
+	/** Whether inotify lost events and the whole directory must be checked. */
+	BOOL needsRescan;
+	BOOL isWatchingDirectory;
+	SCKIndexingScheduler *indexingScheduler;
+	/** URLs of the files queued by -scheduleFilesInDirectory by path. */
+	NSMutableDictionary *scheduledURLs;
+	/**
+	 * The thread that created the project, where the symbol views are updated 
+	 * and SCKProjectSymbolsDidChangeNotification is posted.
+	 */
+	NSThread *ownerThread;
 }
 
-@synthesize directoryURL, fileURLs;
+@synthesize directoryURL, isWatchingDirectory, indexingScheduler;
 
-- (id) initWithDirectoryURL: (NSURL *)aURL 
+- (id) initWithDirectoryURL: (NSURL *)aURL
            sourceCollection: (SCKSourceCollection *)aSourceCollection;
 {
 	NILARG_EXCEPTION_TEST(aSourceCollection);
@@ -20,73 +193,638 @@
 	ASSIGN(directoryURL, aURL);
 	ASSIGN(sourceCollection, aSourceCollection);
 	fileURLs = [NSMutableArray new];
+	fileURLsByPath = [NSMutableDictionary new];
+	files = [NSMutableArray new];
+	filesByPath = [NSMutableDictionary new];
+	componentsByFile = [NSMapTable mapTableWithStrongToStrongObjects];
+	classes = [SCKProjectSymbolView new];
+	functions = [SCKProjectSymbolView new];
+	globals = [SCKProjectSymbolView new];
 	projectContent = [SCKFileBrowsingProjectContent new];
+	inotifyDescriptor = -1;
+	indexingScheduler = [[SCKIndexingScheduler alloc] initWithSourceCollection: aSourceCollection];
+	scheduledURLs = [NSMutableDictionary new];
+	ownerThread = [NSThread currentThread];
+	[[NSNotificationCenter defaultCenter] addObserver: self
+	                                         selector: @selector(schedulerDidIndexFiles:)
+	                                             name: SCKIndexingSchedulerDidIndexFilesNotification
+	                                           object: indexingScheduler];
 	return self;
 }
 
+- (void)dealloc
+{
+	[self stopWatchingDirectory];
+	[indexingScheduler stop];
+	[[NSNotificationCenter defaultCenter] removeObserver: self];
+}
+
+- (NSArray *)fileURLs
+{
+	return [fileURLs copy];
+}
+
+- (NSString *)directoryPath
+{
+	return [[directoryURL path] stringByStandardizingPath];
+}
+
+- (NSString *)pathForFileURL: (NSURL *)aURL
+{
+	NSString *resolvedFilePath = ((directoryURL == nil || [aURL baseURL] == nil) ? [aURL path] :
+		[[directoryURL path] stringByAppendingPathComponent: [aURL relativePath]]);
+
+	return [resolvedFilePath stringByStandardizingPath];
+}
+
+/**
+ * Returns a file URL for a path found in the directory.
+ */
+- (NSURL *)fileURLForPath: (NSString *)aPath
+{
+	return [NSURL fileURLWithPath: aPath];
+}
+
+/**
+ * Returns whether the file at the given path belongs to the project, whatever 
+ * URL it was added with.
+ */
+- (BOOL)containsFileAtPath: (NSString *)aPath
+{
+	return (nil != [fileURLsByPath objectForKey: [aPath stringByStandardizingPath]]);
+}
+
+- (SCKSourceFile *)sourceFileForURL: (NSURL *)aURL
+{
+	NSString *path = [self pathForFileURL: aURL];
+	__block SCKSourceFile *file = nil;
+
+	// The scheduler may be indexing with the collection on its own thread
+	[indexingScheduler performBlockAndWait: ^ () { file = [sourceCollection sourceFileForPath: path]; }];
+	return file;
+}
+
+- (NSArray *)componentsDeclaredInFile: (SCKSourceFile *)aFile
+{
+	__block NSArray *components = nil;
+
+	// Copied on the indexing thread, the file reuses its arrays when it is reparsed
+	[indexingScheduler performBlockAndWait: ^ ()
+	{
+		components = A([[aFile declaredClasses] copy], [[aFile declaredFunctions] copy],
+			[[aFile declaredGlobals] copy]);
+	}];
+	return components;
+}
+
+/**
+ * Replaces the components previously contributed by the file with the new ones
+ * and posts SCKProjectSymbolsDidChangeNotification if the views changed.
+ *
+ * New components are added before the old ones are removed, so the components
+ * that are still declared in the file are neither removed nor reinserted.
+ */
+- (void)replaceComponents: (NSArray *)oldComponents withComponents: (NSArray *)newComponents
+{
+	NSArray *views = A(classes, functions, globals);
+	NSMutableArray *inserted = [NSMutableArray array];
+	NSMutableArray *removed = [NSMutableArray array];
+	NSMutableDictionary *changes = [NSMutableDictionary dictionary];
+	NSArray *insertedKeys = A(SCKProjectInsertedClassesKey,
+		SCKProjectInsertedFunctionsKey, SCKProjectInsertedGlobalsKey);
+	NSArray *removedKeys = A(SCKProjectRemovedClassesKey,
+		SCKProjectRemovedFunctionsKey, SCKProjectRemovedGlobalsKey);
+
+	for (NSUInteger i = 0; i < [views count]; i++)
+	{
+		SCKProjectSymbolView *view = [views objectAtIndex: i];
+
+		[inserted removeAllObjects];
+		[removed removeAllObjects];
+
+		if (nil != newComponents)
+		{
+			[view addComponents: [newComponents objectAtIndex: i] insertedComponents: inserted];
+		}
+		if (nil != oldComponents)
+		{
+			[view removeComponents: [oldComponents objectAtIndex: i] removedComponents: removed];
+		}
+
+		if ([inserted count] > 0)
+		{
+			[changes setObject: [inserted copy] forKey: [insertedKeys objectAtIndex: i]];
+		}
+		if ([removed count] > 0)
+		{
+			[changes setObject: [removed copy] forKey: [removedKeys objectAtIndex: i]];
+		}
+	}
+
+	if ([changes count] == 0)
+		return;
+
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: SCKProjectSymbolsDidChangeNotification
+		              object: self
+		            userInfo: changes];
+}
+
+/**
+ * Replaces the components of the file given as the first element of the 
+ * array with the components given as the second one.
+ */
+- (void)replaceComponentsOfFile: (NSArray *)aFileAndComponents
+{
+	SCKSourceFile *file = [aFileAndComponents firstObject];
+	NSArray *newComponents = [aFileAndComponents lastObject];
+	NSArray *oldComponents = [componentsByFile objectForKey: file];
+
+	if (nil == oldComponents)
+		return;
+
+	[componentsByFile setObject: newComponents forKey: file];
+	[self replaceComponents: oldComponents withComponents: newComponents];
+}
+
+- (void)sourceFileDidReparse: (NSNotification *)aNotification
+{
+	SCKSourceFile *file = [aNotification object];
+	NSArray *fileAndComponents = A(file, [self componentsDeclaredInFile: file]);
+
+	if ([NSThread currentThread] == ownerThread)
+	{
+		[self replaceComponentsOfFile: fileAndComponents];
+		return;
+	}
+	// Reparsed on the indexing thread, the views belong to the owner thread
+	[self performSelector: @selector(replaceComponentsOfFile:)
+	             onThread: ownerThread
+	           withObject: fileAndComponents
+	        waitUntilDone: NO
+	                modes: A(NSDefaultRunLoopMode)];
+}
+
+/**
+ * Adds the file URL without posting SCKProjectFilesDidChangeNotification.
+ *
+ * Returns whether the URL was added.
+ */
+- (BOOL)insertFileURL: (NSURL *)aURL
+{
+	NSString *path = [self pathForFileURL: aURL];
+
+	if (nil != [fileURLsByPath objectForKey: path])
+		return NO;
+
+	[fileURLs addObject: aURL];
+	[fileURLsByPath setObject: aURL forKey: path];
+
+	SCKSourceFile *file = [self sourceFileForURL: aURL];
+
+	if (nil == file)
+		return YES;
+
+	[filesByPath setObject: file forKey: path];
+	[files addObject: file];
+
+	// Another URL can resolve to the same file
+	if (nil == [componentsByFile objectForKey: file])
+	{
+		NSArray *components = [self componentsDeclaredInFile: file];
+
+		[componentsByFile setObject: components forKey: file];
+		[[NSNotificationCenter defaultCenter] addObserver: self
+		                                         selector: @selector(sourceFileDidReparse:)
+		                                             name: SCKSourceFileDidReparseNotification
+		                                           object: file];
+		[self replaceComponents: nil withComponents: components];
+	}
+	return YES;
+}
+
+/**
+ * Removes the file URL without posting SCKProjectFilesDidChangeNotification.
+ *
+ * Returns whether the URL was removed.
+ */
+- (BOOL)deleteFileURL: (NSURL *)aURL
+{
+	NSString *path = [self pathForFileURL: aURL];
+	NSURL *addedURL = [fileURLsByPath objectForKey: path];
+
+	if (nil == addedURL)
+		return NO;
+
+	[fileURLs removeObjectAtIndex: [fileURLs indexOfObjectIdenticalTo: addedURL]];
+	[fileURLsByPath removeObjectForKey: path];
+
+	SCKSourceFile *file = [filesByPath objectForKey: path];
+
+	if (nil != file)
+	{
+		[filesByPath removeObjectForKey: path];
+		[files removeObjectAtIndex: [files indexOfObjectIdenticalTo: file]];
+
+		if ([files indexOfObjectIdenticalTo: file] == NSNotFound)
+		{
+			NSArray *components = [componentsByFile objectForKey: file];
+
+			[componentsByFile removeObjectForKey: file];
+			[[NSNotificationCenter defaultCenter] removeObserver: self
+			                                                name: SCKSourceFileDidReparseNotification
+			                                              object: file];
+			[self replaceComponents: components withComponents: nil];
+		}
+	}
+	return YES;
+}
+
 - (void)addFileURL: (NSURL *)aURL
 {
 	NILARG_EXCEPTION_TEST(aURL);
-	if ([fileURLs containsObject: aURL])
+	if (![self insertFileURL: aURL])
 		return;
 
-	[fileURLs addObject: aURL];
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: SCKProjectFilesDidChangeNotification object: self];
 }
 
 - (void)removeFileURL: (NSURL *)aURL
 {
 	NILARG_EXCEPTION_TEST(aURL);
-	[fileURLs removeObject: aURL];
+	if (![self deleteFileURL: aURL])
+		return;
+
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: SCKProjectFilesDidChangeNotification object: self];
 }
 
-- (NSArray *)files
+- (NSArray *)addFilesInDirectory
 {
-	NSMutableArray *files = [NSMutableArray new];
+	NSAssert(directoryURL != nil, @"The project has no directory to crawl");
+	NSSet *extensions = [SCKSourceCollection supportedFileExtensions];
+	NSMutableArray *addedURLs = [NSMutableArray array];
+	NSMutableArray *newURLs = [NSMutableArray array];
+	NSMutableArray *newPaths = [NSMutableArray array];
 
-	for (NSURL *url in fileURLs)
+	crawlDirectory([self directoryPath], nil, ^(NSString *path)
 	{
-		NSString *resolvedFilePath = (directoryURL == nil ? [url path] :
-			[[directoryURL path] stringByAppendingPathComponent: [url relativePath]]);
-		SCKFile *file = [sourceCollection sourceFileForPath: 
-			[resolvedFilePath stringByStandardizingPath]];
+		if (![extensions containsObject: [path pathExtension]])
+			return;
 
-		[files addObject: file];
+		if (![self containsFileAtPath: path])
+		{
+			[newURLs addObject: [self fileURLForPath: path]];
+			[newPaths addObject: path];
+		}
+	});
+
+	// Lets the collection parse the new files together (e.g. in worker processes)
+	[indexingScheduler performBlockAndWait: ^ () { [sourceCollection sourceFilesForPaths: newPaths]; }];
+
+	for (NSURL *url in newURLs)
+	{
+		if ([self insertFileURL: url])
+		{
+			[addedURLs addObject: url];
+		}
 	}
-	return files;
+
+	if ([addedURLs count] > 0)
+	{
+		[[NSNotificationCenter defaultCenter]
+			postNotificationName: SCKProjectFilesDidChangeNotification object: self];
+	}
+	return addedURLs;
 }
 
-- (NSArray *)programComponentsForKey: (NSString *)key
+- (NSArray *)scheduleFilesInDirectory
 {
-	// NOTE: We could write...
-	//NSDictionary *componentsByName = [[[self files] mappedCollection] valueForKey: key];
-	//return [[[componentsByName mappedCollection] allValues] flattenedCollection];
+	NSAssert(directoryURL != nil, @"The project has no directory to crawl");
+	NSSet *extensions = [SCKSourceCollection supportedFileExtensions];
+	NSMutableArray *scheduledURLsInDirectory = [NSMutableArray array];
 
-	NSMutableArray *components = [NSMutableArray new];
-	for (SCKSourceFile *file in [[self files]])
+	crawlDirectory([self directoryPath], nil, ^(NSString *path)
 	{
-		[components addObjectsFromArray: [[file valueForKey: key] allValues]];
+		if (![extensions containsObject: [path pathExtension]])
+			return;
+
+		NSURL *url = [self fileURLForPath: path];
+
+		NSString *scheduledPath = [path stringByStandardizingIntoAbsolutePath];
+
+		if ([self containsFileAtPath: path] || nil != [scheduledURLs objectForKey: scheduledPath])
+			return;
+
+		[scheduledURLs setObject: url forKey: scheduledPath];
+		[scheduledURLsInDirectory addObject: url];
+		[indexingScheduler scheduleFileAtPath: path priority: SCKIndexingPriorityBackground];
+	});
+
+	[indexingScheduler start];
+	return scheduledURLsInDirectory;
+}
+
+/**
+ * Adds the scheduled files that were indexed.
+ */
+- (void)schedulerDidIndexFiles: (NSNotification *)aNotification
+{
+	BOOL filesChanged = NO;
+
+	for (NSString *path in [[aNotification userInfo] objectForKey: SCKIndexedPathsKey])
+	{
+		NSURL *url = [scheduledURLs objectForKey: path];
+
+		if (nil == url)
+			continue;
+
+		[scheduledURLs removeObjectForKey: path];
+		filesChanged = ([self insertFileURL: url] || filesChanged);
+	}
+
+	if (filesChanged)
+	{
+		[[NSNotificationCenter defaultCenter]
+			postNotificationName: SCKProjectFilesDidChangeNotification object: self];
+	}
+}
+
+#ifdef __linux__
+
+/**
+ * Stops watching the directory and its subdirectories (e.g. when it is moved 
+ * out of a watched directory, the watches would report its old path).
+ */
+- (void)unwatchDirectoryAtPath: (NSString *)aPath
+{
+	NSString *prefix = [aPath stringByAppendingString: @"/"];
+
+	for (NSNumber *wd in [watchedDirectories allKeys])
+	{
+		NSString *watchedPath = [watchedDirectories objectForKey: wd];
+
+		if ([watchedPath isEqualToString: aPath] || [watchedPath hasPrefix: prefix])
+		{
+			inotify_rm_watch(inotifyDescriptor, [wd intValue]);
+			[watchedDirectories removeObjectForKey: wd];
+		}
+	}
+}
+
+- (void)watchDirectoryAtPath: (NSString *)aPath
+{
+	int wd = inotify_add_watch(inotifyDescriptor, [aPath fileSystemRepresentation],
+		IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+
+	if (wd >= 0)
+	{
+		[watchedDirectories setObject: aPath forKey: [NSNumber numberWithInt: wd]];
 	}
-	return components;
+}
+
+- (BOOL)startWatchingDirectory
+{
+	NSAssert(directoryURL != nil, @"The project has no directory to watch");
+	if (isWatchingDirectory)
+		return YES;
+
+	inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyDescriptor < 0)
+		return NO;
+
+	watchedDirectories = [NSMutableDictionary new];
+	changedPaths = [NSMutableOrderedSet new];
+	needsRescan = NO;
+	crawlDirectory([self directoryPath], ^(NSString *path)
+	{
+		[self watchDirectoryAtPath: path];
+	}, nil);
+
+	inotifyHandle = [[NSFileHandle alloc] initWithFileDescriptor: inotifyDescriptor
+	                                              closeOnDealloc: YES];
+	[[NSNotificationCenter defaultCenter] addObserver: self
+	                                         selector: @selector(inotifyDescriptorHasData:)
+	                                             name: NSFileHandleDataAvailableNotification
+	                                           object: inotifyHandle];
+	[inotifyHandle waitForDataInBackgroundAndNotify];
+	isWatchingDirectory = YES;
+	return YES;
+}
+
+/**
+ * Records the paths to check for an inotify event.
+ *
+ * For a new directory, we start watching it and its subdirectories, and record
+ * the files it contains, since they might have been created before the watches 
+ * were added. For a deleted directory, we record the project files it 
+ * contained.
+ */
+- (void)handleEvent: (const struct inotify_event *)event
+{
+	if (event->mask & IN_Q_OVERFLOW)
+	{
+		needsRescan = YES;
+		return;
+	}
+	if (event->mask & IN_IGNORED)
+	{
+		[watchedDirectories removeObjectForKey: [NSNumber numberWithInt: event->wd]];
+		return;
+	}
+
+	NSString *directory = [watchedDirectories objectForKey: [NSNumber numberWithInt: event->wd]];
+
+	if (nil == directory || event->len == 0 || event->name[0] == '.')
+		return;
+
+	NSString *path = [directory stringByAppendingPathComponent:
+		[[NSFileManager defaultManager] stringWithFileSystemRepresentation: event->name
+		                                                            length: strlen(event->name)]];
+
+	if (!(event->mask & IN_ISDIR))
+	{
+		[changedPaths addObject: path];
+	}
+	else if (event->mask & (IN_CREATE | IN_MOVED_TO))
+	{
+		crawlDirectory(path, ^(NSString *subpath)
+		{
+			[self watchDirectoryAtPath: subpath];
+		},
+		^(NSString *subpath)
+		{
+			[changedPaths addObject: subpath];
+		});
+	}
+	else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+	{
+		NSString *prefix = [path stringByAppendingString: @"/"];
+
+		/* A moved directory keeps its watches, which IN_MOVED_TO adds back 
+		   under the new path if it stays in the project */
+		if (event->mask & IN_MOVED_FROM)
+		{
+			[self unwatchDirectoryAtPath: path];
+		}
+
+		for (NSURL *url in fileURLs)
+		{
+			NSString *filePath = [self pathForFileURL: url];
+
+			if ([filePath hasPrefix: prefix])
+			{
+				[changedPaths addObject: filePath];
+			}
+		}
+	}
+}
+
+- (void)inotifyDescriptorHasData: (NSNotification *)aNotification
+{
+	char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t length;
+
+	while ((length = read(inotifyDescriptor, buffer, sizeof(buffer))) > 0)
+	{
+		char *p = buffer;
+
+		while (p < buffer + length)
+		{
+			const struct inotify_event *event = (const struct inotify_event *)p;
+
+			[self handleEvent: event];
+			p += sizeof(struct inotify_event) + event->len;
+		}
+	}
+	[inotifyHandle waitForDataInBackgroundAndNotify];
+
+	[NSObject cancelPreviousPerformRequestsWithTarget: self
+	                                         selector: @selector(processChangedPaths)
+	                                           object: nil];
+	[self performSelector: @selector(processChangedPaths)
+	           withObject: nil
+	           afterDelay: changeCoalescingDelay];
+}
+
+#else
+
+- (BOOL)startWatchingDirectory
+{
+	NSAssert(directoryURL != nil, @"The project has no directory to watch");
+	return NO;
+}
+
+#endif
+
+/**
+ * Reparses, adds or removes the files whose paths were reported since the last 
+ * call, each file being handled once.
+ *
+ * If events were lost, every file in the directory or in the project is checked.
+ */
+- (void)processChangedPaths
+{
+	NSSet *extensions = [SCKSourceCollection supportedFileExtensions];
+	NSFileManager *fileManager = [NSFileManager defaultManager];
+	NSString *directoryPrefix = [[self directoryPath] stringByAppendingString: @"/"];
+	BOOL filesChanged = NO;
+
+	if (needsRescan)
+	{
+		for (NSURL *url in fileURLs)
+		{
+			[changedPaths addObject: [self pathForFileURL: url]];
+		}
+		crawlDirectory([self directoryPath], nil, ^(NSString *path)
+		{
+			[changedPaths addObject: path];
+		});
+		needsRescan = NO;
+	}
+
+	NSArray *paths = [changedPaths array];
+	[changedPaths removeAllObjects];
+
+	for (NSString *path in paths)
+	{
+		if (![path hasPrefix: directoryPrefix] || ![extensions containsObject: [path pathExtension]])
+			continue;
+
+		NSURL *url = [self fileURLForPath: path];
+		BOOL exists = [fileManager fileExistsAtPath: path];
+
+		if (exists && [self containsFileAtPath: path])
+		{
+			SCKSourceFile *file = [filesByPath objectForKey: [path stringByStandardizingPath]];
+
+			[indexingScheduler performBlockAndWait: ^ ()
+			{
+				[file reparse];
+				[sourceCollection reparseFilesIncludingFile: path];
+			}];
+		}
+		else if (exists)
+		{
+			filesChanged = ([self insertFileURL: url] || filesChanged);
+		}
+		else
+		{
+			filesChanged = ([self deleteFileURL: url] || filesChanged);
+			[indexingScheduler performBlockAndWait: ^ () { [sourceCollection reparseFilesIncludingFile: path]; }];
+		}
+	}
+
+	if (filesChanged)
+	{
+		[[NSNotificationCenter defaultCenter]
+			postNotificationName: SCKProjectFilesDidChangeNotification object: self];
+	}
+}
+
+- (void)stopWatchingDirectory
+{
+	if (!isWatchingDirectory)
+		return;
+
+	[NSObject cancelPreviousPerformRequestsWithTarget: self
+	                                         selector: @selector(processChangedPaths)
+	                                           object: nil];
+	[[NSNotificationCenter defaultCenter] removeObserver: self
+	                                                name: NSFileHandleDataAvailableNotification
+	                                              object: inotifyHandle];
+	// Closes the inotify descriptor which removes all the watches
+	inotifyHandle = nil;
+	inotifyDescriptor = -1;
+	watchedDirectories = nil;
+	changedPaths = nil;
+	isWatchingDirectory = NO;
+}
+
+- (NSArray *)files
+{
+	return [files copy];
 }
 
 - (NSArray *)classes
 {
-	return [self programComponentsForKey: @"classes"];
+	return [classes components];
 }
 
 - (NSArray *)functions
 {
-	return [self programComponentsForKey: @"functions"];
+	return [functions components];
 }
 
 - (NSArray *)globals
 {
-	return [self programComponentsForKey: @"globals"];
+	return [globals components];
 }
 
 - (void)setContentClass: (Class)aClass
 {
-	INVALIDARG_EXCEPTION_TEST([aClass conformsToProtocol: @protocol(SCKProjectContent)]);
+	INVALIDARG_EXCEPTION_TEST(aClass, [aClass conformsToProtocol: @protocol(SCKProjectContent)]);
 	projectContent = [aClass new];
 }
 
@@ -97,25 +835,25 @@
 
 - (id)content
 {
-	return [projectContent content];
+	return [projectContent contentForProject: self];
 }
 
 @end
 
 @implementation SCKFileBrowsingProjectContent
 
-- (id)content
+- (id)contentForProject: (SCKProject *)aProject
 {
-	return [self files];
+	return [aProject files];
 }
 
 @end
 
 @implementation SCKSymbolBrowsingProjectContent
 
-- (id)content
+- (id)contentForProject: (SCKProject *)aProject
 {
-	return A([self classes], [self functions], [self globals]);
+	return A([aProject classes], [aProject functions], [aProject globals]);
 }
 
 @end
@@ -1,15 +1,94 @@
 #import <Foundation/NSObject.h>
 
-@class NSCache, NSDictionary, NSMutableDictionary, NSArray;
-@class SCKIndex, SCKSourceFile, SCKClass, SCKProtocol, SCKFunction, SCKGlobal;
-@class SCKEnumeration, SCKEnumerationValue;
+@class NSCache, NSDictionary, NSMutableDictionary, NSArray, NSSet;
+@class SCKIndex, SCKSourceFile, SCKProgramComponent, SCKClass, SCKProtocol, SCKFunction, SCKGlobal;
+@class SCKEnumeration, SCKEnumerationValue, SCKMetrics, SCKMemoryUsage, SCKIndexWorkerPool, SCKTypeTable;
+@class SCKSymbolDatabase;
+
+/**
+ * An immutable view of the symbol tables of a source collection, as they were 
+ * when the snapshot was published.
+ *
+ * Snapshots can be read from any thread, while the collection keeps indexing 
+ * on another one. Each dictionary maps names to program components, like the 
+ * SCKSourceCollection properties with the same names.
+ *
+ * The program components are shared with the collection rather than copied, 
+ * so the name tables are frozen but the attributes of a component (e.g. its 
+ * locations or methods) reflect the last indexing. These attributes must only 
+ * be read in -readComponentsUsingBlock:, the collection updates them with the 
+ * same lock held.
+ */
+@interface SCKSymbolSnapshot : NSObject
+/**
+ * The generation number of the snapshot, incremented each time the 
+ * collection publishes a snapshot whose symbol tables changed.
+ */
+@property (nonatomic, readonly) NSUInteger generation;
+@property (nonatomic, readonly) NSDictionary *classes;
+@property (nonatomic, readonly) NSDictionary *protocols;
+@property (nonatomic, readonly) NSDictionary *functions;
+@property (nonatomic, readonly) NSDictionary *globals;
+@property (nonatomic, readonly) NSDictionary *enumerations;
+@property (nonatomic, readonly) NSDictionary *enumerationValues;
+/**
+ * Runs the block while the collection can't update the program components, 
+ * so the block can read their attributes from any thread.
+ *
+ * The block must not parse or index files with the collection.
+ */
+- (void)readComponentsUsingBlock: (void (^)(void))aBlock;
+@end
 
 /**
  * A source collection encapsulates a group of (potentially cross-referenced)
  * source code files.  
+ *
+ * The collection and its symbol dictionaries (-classes, -functions etc.) must 
+ * be used on a single thread (the one that parses and indexes source files). 
+ * Other threads can read the symbol tables through -symbolSnapshot, and the 
+ * program components through -[SCKSymbolSnapshot readComponentsUsingBlock:].
+ *
+ * A collection can also be opened read-only on a symbol database exported by 
+ * another collection (see -initWithSymbolDatabaseAtPath:).
  */
 @interface SCKSourceCollection : NSObject
 
+/**
+ * Initializes and returns a read-only collection whose symbols are looked up 
+ * in the symbol database file at the given path (see SCKSymbolDatabase), or 
+ * nil if the file is not a valid symbol database.
+ *
+ * The file is memory-mapped, and its program components are created the 
+ * first time they are looked up, so opening a large database is cheap, and 
+ * several processes opening the same database share its memory.
+ *
+ * A read-only collection contains no source files, bundles or runtime 
+ * symbols. -sourceFileForPath: returns nil, methods such as -classForName: 
+ * return nil rather than new components for the names missing from the 
+ * database, and -clear raises a NSInternalInconsistencyException.
+ *
+ * When the path is nil, raises a NSInvalidArgumentException.
+ */
+- (id)initWithSymbolDatabaseAtPath: (NSString*)aPath;
+/**
+ * Writes the symbols of the receiver to a symbol database file at the given 
+ * path, that can be opened with -initWithSymbolDatabaseAtPath:, and returns 
+ * whether it succeeded.
+ *
+ * See +[SCKSymbolDatabase writeSymbolsOfCollection:toFile:].
+ */
+- (BOOL)writeSymbolDatabaseToFile: (NSString*)aPath;
+/**
+ * The database opened by -initWithSymbolDatabaseAtPath:, or nil.
+ */
+@property (nonatomic, readonly) SCKSymbolDatabase *symbolDatabase;
+/**
+ * Returns whether the receiver was opened with 
+ * -initWithSymbolDatabaseAtPath:.
+ */
+@property (nonatomic, readonly) BOOL isReadOnly;
+
 @property (nonatomic, readonly) NSDictionary *files;
 @property (nonatomic, readonly) NSDictionary *bundles;
 @property (nonatomic, readonly) NSDictionary *classes;
@@ -43,6 +122,47 @@
  */
 @property (nonatomic, readonly) NSDictionary *enumerationValues;
 
+/**
+ * Returns the last published snapshot of the symbol tables.
+ *
+ * This method is thread-safe and cheap, the returned snapshot doesn't change 
+ * and can be kept as long as needed.
+ *
+ * A new snapshot is published when -sourceFileForPath:, 
+ * -reparseFilesIncludingFile:, -[SCKSourceFile reparse] or -clear changed the 
+ * symbol tables.
+ */
+- (SCKSymbolSnapshot*)symbolSnapshot;
+/**
+ * Publishes a new symbol snapshot, if symbols were added to or removed from 
+ * the symbol tables since the last one was published.
+ *
+ * Source files call this method at the end of each reparse. Between 
+ * -beginSymbolUpdates and the matching -endSymbolUpdates, does nothing.
+ */
+- (void)publishSymbolSnapshot;
+/**
+ * Defers publishing symbol snapshots until the matching -endSymbolUpdates, so 
+ * indexing many files publishes a single snapshot rather than one per file.
+ *
+ * Calls can be nested.
+ */
+- (void)beginSymbolUpdates;
+/**
+ * Ends the symbol updates started by the matching -beginSymbolUpdates, and 
+ * publishes a snapshot once the outermost updates end.
+ */
+- (void)endSymbolUpdates;
+/**
+ * Locks the program components against the readers that use 
+ * -[SCKSymbolSnapshot readComponentsUsingBlock:].
+ *
+ * Source files walk their translation unit without the lock, and only lock 
+ * the components while they apply what the walk recorded, so readers are 
+ * blocked for a short time per parse. The lock is recursive.
+ */
+- (void)lockComponents;
+- (void)unlockComponents;
 /**
  * Returns an existing class if one was already parsed under the same name in 
  * some other files, otherwise returns a new one.
@@ -86,6 +206,30 @@
  */
 - (void)addEnumerationValue: (SCKEnumerationValue *)anEnumValue;
 
+/**
+ * Records that the class, category or protocol declares or defines a method 
+ * with the given selector.
+ *
+ * Source files call this method when they add a method to a class, category 
+ * or protocol.
+ */
+- (void)addImplementor: (SCKProgramComponent*)aComponent ofSelector: (NSString*)aSelector;
+/**
+ * Returns the classes, categories and protocols that declare or define a 
+ * method with the given selector, in the order they were first recorded.
+ *
+ * The classes collected by runtime introspection are included. A method 
+ * parsed in a category is reported for the category rather than its class.
+ *
+ * This is a single lookup, the methods of the classes are not searched.
+ */
+- (NSArray*)implementorsOfSelector: (NSString*)aSelector;
+/**
+ * Returns the selectors for which -implementorsOfSelector: returns 
+ * implementors, in no particular order.
+ */
+- (NSArray*)implementedSelectors;
+
 /**
  * Indicates whether -sourceFileForPath: should ignore symbols from included 
  * headers, or collect them as global symbols.
@@ -95,13 +239,142 @@
  * By default, returns NO.
  */
 @property (nonatomic, assign) BOOL ignoresIncludedSymbols;
+/**
+ * Indicates whether -sourceFileForPath: creates index-only source files, that 
+ * parse the file from disk, collect its program components and discard the 
+ * parser state right away (see -[SCKSourceFile isIndexOnly]).
+ *
+ * This mode is intended to index many files that are not open in an editor, 
+ * using memory for their program components rather than for their parser 
+ * states. A file that is opened later can be upgraded by setting its source.
+ *
+ * Files that were already created are not affected.
+ *
+ * By default, returns NO.
+ */
+@property (nonatomic, assign) BOOL createsIndexOnlyFiles;
 /**
  * Generates a new source file object corresponding to the specified on-disk
  * file.  The returned object is not guaranteed to be unique - subsequent calls
  * with the same argument will return the same object.
  */
 - (SCKSourceFile*)sourceFileForPath: (NSString*)aPath;
+/**
+ * Returns the source files for the given paths, as -sourceFileForPath: would 
+ * do for each path.
+ *
+ * When the receiver has an index worker pool and creates index-only files, 
+ * the new files are parsed concurrently in the worker processes, otherwise 
+ * they are parsed one after the other in the current process.
+ *
+ * Paths for which no source file can be created are skipped.
+ */
+- (NSArray*)sourceFilesForPaths: (NSArray*)paths;
+/**
+ * The pool of worker processes that parse the index-only files of the 
+ * receiver (see -createsIndexOnlyFiles), or nil to parse them in the current 
+ * process.
+ *
+ * Files whose -source is set are always parsed in the current process.
+ *
+ * By default, returns nil.
+ */
+@property (nonatomic, retain) SCKIndexWorkerPool *indexWorkerPool;
+/**
+ * Indicates whether the threads created by libclang to parse and index files 
+ * run at background priority (see 
+ * CXGlobalOpt_ThreadBackgroundPriorityForIndexing), so they don't compete 
+ * with interactive work.
+ *
+ * SCKIndexingScheduler sets it while it indexes background files.
+ *
+ * By default, returns NO.
+ */
+@property (nonatomic, assign) BOOL parsesWithBackgroundPriority;
+/**
+ * Indicates whether -clear keeps the discarded source files until the next 
+ * -clear, so -sourceFileForPath: only collects their program components 
+ * again without reparsing them, when neither the files nor their includes 
+ * changed.
+ *
+ * The kept files retain their parser state (e.g. a libclang translation 
+ * unit). Setting this property to NO releases them immediately.
+ *
+ * By default, returns NO.
+ */
+@property (nonatomic, assign) BOOL keepsFilesAcrossClear;
+/**
+ * Returns the file extensions (without a leading dot) for which 
+ * -sourceFileForPath: can create source files.
+ */
++ (NSSet*)supportedFileExtensions;
 - (SCKIndex*)indexForFileExtension: (NSString*)extension;
+/**
+ * Returns the contents of the files whose -source is set (e.g. the files open 
+ * in an editor) by path, encoded in UTF-8.
+ *
+ * Source files parse their includes from these unsaved contents rather than 
+ * from the disk.
+ */
+- (NSDictionary*)unsavedFileContents;
+/**
+ * Records the files included directly or indirectly by the translation unit 
+ * of the source file at the given path.
+ *
+ * Source files call this method each time they are parsed.
+ */
+- (void)setIncludedFiles: (NSSet*)includedPaths forFile: (NSString*)aPath;
+/**
+ * Returns the paths of the files included directly or indirectly by the source 
+ * file at the given path, when it was last parsed.
+ */
+- (NSSet*)includedFilesForFile: (NSString*)aPath;
+/**
+ * Returns the source files whose translation units include the file at the 
+ * given path directly or indirectly.
+ *
+ * The files whose -source is set (e.g. open in an editor) come first.
+ */
+- (NSArray*)filesIncludingFile: (NSString*)aPath;
+/**
+ * Tells the receiver the file at the given path changed on disk or in its 
+ * -source, and reparses the source files that include it (see 
+ * -filesIncludingFile:).
+ *
+ * The file itself is not reparsed.  If it was parsed by the receiver and its 
+ * -[SCKSourceFile interfaceFingerprint] didn't change since the including 
+ * files were last reparsed by this method (or since it was first parsed), 
+ * nothing is reparsed.  So the file must be reparsed before calling this 
+ * method.
+ *
+ * Returns the source files that were reparsed.
+ */
+- (NSArray*)reparseFilesIncludingFile: (NSString*)aPath;
+/**
+ * The table that interns and decodes the type encodings of the program 
+ * components parsed by the source files of the collection.
+ *
+ * Unlike parsing results, the table is not discarded by -clear, since the 
+ * components discarded by -clear can still refer to it.
+ */
+@property (nonatomic, readonly) SCKTypeTable *typeTable;
+/**
+ * Timing counters and latency histograms reported by the source files of the 
+ * collection.
+ *
+ * Unlike parsing results, metrics are not discarded by -clear. Use 
+ * -[SCKMetrics reset] to do so.
+ */
+@property (nonatomic, readonly) SCKMetrics *metrics;
+/**
+ * Returns the memory used by all the parsed files (see 
+ * -[SCKSourceFile memoryUsage]), the symbols shared accross them and the 
+ * symbols collected by runtime introspection.
+ *
+ * For a read-only collection, only the symbols created from the database 
+ * so far are accounted (see -[SCKSymbolDatabase estimatedMemoryUsage]).
+ */
+- (SCKMemoryUsage*)memoryUsage;
 /* 
  * Discards all the current parsing results.
  *
@@ -115,6 +388,9 @@
  * To parse source files without combining Clang parsing results and Runtime 
  * parsing results together, you can call -clear on a new SCKSourceCollection 
  * (before calling -sourceFileForPath: for the first time).
+ *
+ * The discarded source files and their parser state are released, unless 
+ * -keepsFilesAcrossClear is YES.
  */
 - (void)clear;
 
@@ -8,13 +8,74 @@
  */
 static NSDictionary *fileClasses;
 
-@interface SCKClangIndex : NSObject @end
+@interface SCKClangIndex : NSObject
+- (void)setUsesBackgroundPriority: (BOOL)flag;
+@end
+
+@implementation SCKSymbolSnapshot
+
+{
+	NSRecursiveLock *componentLock;
+}
+
+@synthesize generation, classes, protocols, functions, globals, enumerations, enumerationValues;
+
+- (id)initWithGeneration: (NSUInteger)aGeneration
+           componentLock: (NSRecursiveLock *)aLock
+                 classes: (NSDictionary *)someClasses
+               protocols: (NSDictionary *)someProtocols
+               functions: (NSDictionary *)someFunctions
+                 globals: (NSDictionary *)someGlobals
+            enumerations: (NSDictionary *)someEnumerations
+       enumerationValues: (NSDictionary *)someEnumerationValues
+{
+	SUPERINIT;
+	generation = aGeneration;
+	componentLock = aLock;
+	classes = [someClasses copy];
+	protocols = [someProtocols copy];
+	functions = [someFunctions copy];
+	globals = [someGlobals copy];
+	enumerations = [someEnumerations copy];
+	enumerationValues = [someEnumerationValues copy];
+	return self;
+}
+
+- (void)readComponentsUsingBlock: (void (^)(void))aBlock
+{
+	NILARG_EXCEPTION_TEST(aBlock);
+	[componentLock lock];
+	@try
+	{
+		aBlock();
+	}
+	@finally
+	{
+		[componentLock unlock];
+	}
+}
+
+@end
 
 @implementation SCKSourceCollection
 {
 	NSMutableDictionary *indexes;
 	/** Files that have already been created. */
 	NSMutableDictionary *files; //TODO: turn back into NSCache
+	/**
+	 * Files discarded by the last -clear when keepsFilesAcrossClear is YES, 
+	 * reused if they didn't change.
+	 */
+	NSMutableDictionary *reusableFiles;
+	/** Paths included by each parsed file (as a NSSet) by path. */
+	NSMutableDictionary *includedFiles;
+	/** Paths of the parsed files including each file (as a NSMutableSet) by path. */
+	NSMutableDictionary *includingFiles;
+	/**
+	 * Interface fingerprints of the parsed files, as they were when the files 
+	 * including them were last brought up-to-date, by path.
+	 */
+	NSMutableDictionary *propagatedFingerprints;
 	NSMutableDictionary *bundles;
 	NSMutableDictionary *bundleClasses;
 	NSMutableDictionary *classes;
@@ -23,10 +84,28 @@ static NSDictionary *fileClasses;
 	NSMutableDictionary *globals;
 	NSMutableDictionary *enumerations;
 	NSMutableDictionary *enumerationValues;
+	/** Classes, categories and protocols (as a NSMutableOrderedSet) by selector. */
+	NSMutableDictionary *implementorsBySelector;
 	BOOL ignoresIncludedSymbols;
+	BOOL createsIndexOnlyFiles;
+	BOOL parsesWithBackgroundPriority;
+	BOOL keepsFilesAcrossClear;
+	SCKIndexWorkerPool *indexWorkerPool;
+	SCKMetrics *metrics;
+	SCKTypeTable *typeTable;
+	SCKSymbolDatabase *symbolDatabase;
+	/** The last published snapshot, only accessed with snapshotLock. */
+	SCKSymbolSnapshot *symbolSnapshot;
+	NSLock *snapshotLock;
+	/** Whether names were added to the symbol tables since the last snapshot. */
+	BOOL symbolTablesChanged;
+	/** The nesting level of -beginSymbolUpdates. */
+	NSUInteger symbolUpdateDepth;
+	/** Held while the program components are updated or read by snapshots. */
+	NSRecursiveLock *componentLock;
 }
 
-@synthesize files, bundles, classes, protocols, globals, functions, enumerations, enumerationValues, ignoresIncludedSymbols;
+@synthesize files, bundles, classes, protocols, globals, functions, enumerations, enumerationValues, ignoresIncludedSymbols, createsIndexOnlyFiles, indexWorkerPool, metrics, typeTable, symbolDatabase;
 
 + (void)initialize
 {
@@ -55,8 +134,19 @@ static NSDictionary *fileClasses;
 
 - (void)clear
 {
+	if (nil != symbolDatabase)
+	{
+		[NSException raise: NSInternalInconsistencyException
+		            format: @"A read-only collection cannot be cleared"];
+	}
 	indexes = [self newIndexes];
+	typeTable = [SCKTypeTable new];
+	[self setParsesWithBackgroundPriority: parsesWithBackgroundPriority];
+	reusableFiles = (keepsFilesAcrossClear ? files : nil);
 	files = [NSMutableDictionary new];
+	includedFiles = [NSMutableDictionary new];
+	includingFiles = [NSMutableDictionary new];
+	propagatedFingerprints = [NSMutableDictionary new];
 	bundles = [NSMutableDictionary new];
 	bundleClasses = [NSMutableDictionary new];
 	classes = [NSMutableDictionary new];
@@ -65,12 +155,18 @@ static NSDictionary *fileClasses;
 	functions = [NSMutableDictionary new];
 	enumerations = [NSMutableDictionary new];
 	enumerationValues = [NSMutableDictionary new];
+	implementorsBySelector = [NSMutableDictionary new];
+	symbolTablesChanged = YES;
+	[self publishSymbolSnapshot];
 }
 
 - (id)init
 {
 	SUPERINIT
 	
+	metrics = [SCKMetrics new];
+	snapshotLock = [NSLock new];
+	componentLock = [NSRecursiveLock new];
 	[self clear];
 
 	int count = objc_getClassList(NULL, 0);
@@ -80,6 +176,10 @@ static NSDictionary *fileClasses;
 	{
 		STACK_SCOPED SCKClass *cls = [[SCKClass alloc] initWithClass: classList[i]];
 		[bundleClasses setObject: cls forKey: [cls name]];
+		for (NSString *selector in [cls methods])
+		{
+			[self addImplementor: cls ofSelector: selector];
+		}
 		NSBundle *b = [NSBundle bundleForClass: classList[i]];
 		if (nil == b)
 		{
@@ -94,15 +194,96 @@ static NSDictionary *fileClasses;
 		}
 		[bundle.classes addObject: cls];
 	}
+	for (int i=0 ; i<count ; i++)
+	{
+		Class superclass = class_getSuperclass(classList[i]);
+
+		if (Nil == superclass)
+		{
+			continue;
+		}
+		[[bundleClasses objectForKey: [NSString stringWithUTF8String: class_getName(classList[i])]]
+			setSuperclass: [bundleClasses objectForKey: [NSString stringWithUTF8String: class_getName(superclass)]]];
+	}
 	free(classList);
 	return self;
 }
 
+- (id)initWithSymbolDatabaseAtPath: (NSString*)aPath
+{
+	NILARG_EXCEPTION_TEST(aPath);
+	SUPERINIT;
+	metrics = [SCKMetrics new];
+	snapshotLock = [NSLock new];
+	componentLock = [NSRecursiveLock new];
+	typeTable = [SCKTypeTable new];
+	symbolDatabase = [[SCKSymbolDatabase alloc] initWithContentsOfFile: aPath typeTable: typeTable];
+
+	if (nil == symbolDatabase)
+		return nil;
+
+	indexes = [NSMutableDictionary new];
+	files = [NSMutableDictionary new];
+	includedFiles = [NSMutableDictionary new];
+	includingFiles = [NSMutableDictionary new];
+	propagatedFingerprints = [NSMutableDictionary new];
+	bundles = [NSMutableDictionary new];
+	bundleClasses = [NSMutableDictionary new];
+	// Immutable dictionaries backed by the database
+	classes = (id)[symbolDatabase componentsInTable: SCKSymbolTableClasses];
+	protocols = (id)[symbolDatabase componentsInTable: SCKSymbolTableProtocols];
+	functions = (id)[symbolDatabase componentsInTable: SCKSymbolTableFunctions];
+	globals = (id)[symbolDatabase componentsInTable: SCKSymbolTableGlobals];
+	enumerations = (id)[symbolDatabase componentsInTable: SCKSymbolTableEnumerations];
+	enumerationValues = (id)[symbolDatabase componentsInTable: SCKSymbolTableEnumerationValues];
+	symbolTablesChanged = YES;
+	[self publishSymbolSnapshot];
+	return self;
+}
+
+- (BOOL)isReadOnly
+{
+	return (nil != symbolDatabase);
+}
+
+- (BOOL)writeSymbolDatabaseToFile: (NSString*)aPath
+{
+	return [SCKSymbolDatabase writeSymbolsOfCollection: self toFile: aPath];
+}
+
+- (BOOL)parsesWithBackgroundPriority
+{
+	return parsesWithBackgroundPriority;
+}
+
+- (void)setParsesWithBackgroundPriority: (BOOL)flag
+{
+	parsesWithBackgroundPriority = flag;
+	for (SCKClangIndex *index in [indexes objectEnumerator])
+	{
+		[index setUsesBackgroundPriority: flag];
+	}
+}
+
+- (BOOL)keepsFilesAcrossClear
+{
+	return keepsFilesAcrossClear;
+}
+
+- (void)setKeepsFilesAcrossClear: (BOOL)flag
+{
+	keepsFilesAcrossClear = flag;
+	if (!flag)
+	{
+		reusableFiles = nil;
+	}
+}
+
 - (SCKClass*)classForName: (NSString*)aName
 {
 	SCKClass *class = [classes objectForKey: aName];
 	
-	if (nil != class)
+	if (nil != class || nil != symbolDatabase)
 	{
 		return class;
 	}
@@ -110,6 +291,7 @@ static NSDictionary *fileClasses;
 	class = [SCKClass new];
 	[class setName: aName];
 	[classes setObject: class forKey: aName];
+	symbolTablesChanged = YES;
 	
 	return class;
 }
@@ -118,7 +300,7 @@ static NSDictionary *fileClasses;
 {
 	SCKProtocol *protocol = [protocols objectForKey: aName];
 
-	if (nil != protocol)
+	if (nil != protocol || nil != symbolDatabase)
 	{
 		return protocol;
 	}
@@ -126,6 +308,7 @@ static NSDictionary *fileClasses;
 	protocol = [SCKProtocol new];
 	[protocol setName: aName];
 	[protocols setObject: protocol forKey: aName];
+	symbolTablesChanged = YES;
 	return protocol;
 }
 
@@ -133,7 +316,7 @@ static NSDictionary *fileClasses;
 {
 	SCKFunction *function = [functions objectForKey: aName];
 	
-	if (nil != function)
+	if (nil != function || nil != symbolDatabase)
 	{
 		return function;
 	}
@@ -141,6 +324,7 @@ static NSDictionary *fileClasses;
 	function = [SCKFunction new];
 	[function setName: aName];
 	[functions setObject: function forKey: aName];
+	symbolTablesChanged = YES;
 	return function;
 }
 
@@ -148,7 +332,7 @@ static NSDictionary *fileClasses;
 {
 	SCKGlobal *global = [globals objectForKey: aName];
 	
-	if (nil != global)
+	if (nil != global || nil != symbolDatabase)
 	{
 		return global;
 	}
@@ -156,25 +340,305 @@ static NSDictionary *fileClasses;
 	global = [SCKGlobal new];
 	[global setName: aName];
 	[globals setObject: global forKey: aName];
+	symbolTablesChanged = YES;
 	return global;
 }
 
 - (void)addEnumeration: (SCKEnumeration *)anEnum 
 {
 	[enumerations setObject: anEnum forKey: [anEnum name]];
+	symbolTablesChanged = YES;
 }
 
 - (void)addEnumerationValue: (SCKEnumerationValue *)anEnumValue
 {
 	[enumerationValues setObject: anEnumValue forKey: [anEnumValue name]];
+	symbolTablesChanged = YES;
+}
+
+- (void)addImplementor: (SCKProgramComponent*)aComponent ofSelector: (NSString*)aSelector
+{
+	NSMutableOrderedSet *implementors = [implementorsBySelector objectForKey: aSelector];
+
+	if (nil == implementors)
+	{
+		implementors = [NSMutableOrderedSet new];
+		[implementorsBySelector setObject: implementors forKey: aSelector];
+	}
+	[implementors addObject: aComponent];
+}
+
+- (NSArray*)implementorsOfSelector: (NSString*)aSelector
+{
+	if (nil != symbolDatabase)
+		return [symbolDatabase implementorsOfSelector: aSelector];
+
+	NSArray *implementors = [[implementorsBySelector objectForKey: aSelector] array];
+
+	return (nil != implementors ? implementors : [NSArray array]);
+}
+
+- (NSArray*)implementedSelectors
+{
+	if (nil != symbolDatabase)
+		return [[symbolDatabase componentsInTable: SCKSymbolTableSelectors] allKeys];
+
+	return [implementorsBySelector allKeys];
+}
+
+- (SCKSymbolSnapshot*)symbolSnapshot
+{
+	[snapshotLock lock];
+	SCKSymbolSnapshot *snapshot = symbolSnapshot;
+	[snapshotLock unlock];
+	return snapshot;
+}
+
+- (void)publishSymbolSnapshot
+{
+	if (!symbolTablesChanged || symbolUpdateDepth > 0)
+		return;
+
+	/* The copies are made on the indexing thread, so readers never see the 
+	   mutable tables */
+	SCKSymbolSnapshot *snapshot =
+		[[SCKSymbolSnapshot alloc] initWithGeneration: [symbolSnapshot generation] + 1
+		                                componentLock: componentLock
+		                                      classes: classes
+		                                    protocols: protocols
+		                                    functions: functions
+		                                      globals: globals
+		                                 enumerations: enumerations
+		                            enumerationValues: enumerationValues];
+
+	[snapshotLock lock];
+	symbolSnapshot = snapshot;
+	[snapshotLock unlock];
+	symbolTablesChanged = NO;
+}
+
+- (void)beginSymbolUpdates
+{
+	symbolUpdateDepth++;
+}
+
+- (void)endSymbolUpdates
+{
+	if (symbolUpdateDepth == 0)
+	{
+		[NSException raise: NSInternalInconsistencyException
+		            format: @"-endSymbolUpdates without a matching -beginSymbolUpdates"];
+	}
+	symbolUpdateDepth--;
+	[self publishSymbolSnapshot];
+}
+
+- (void)lockComponents
+{
+	[componentLock lock];
+}
+
+- (void)unlockComponents
+{
+	[componentLock unlock];
+}
+
+- (SCKMemoryUsage*)memoryUsage
+{
+	SCKMemoryUsage *usage = [SCKMemoryUsage new];
+	NSUInteger symbolsSize = 0;
+	NSUInteger runtimeSymbolsSize = 0;
+
+	for (SCKSourceFile *file in [files objectEnumerator])
+	{
+		[usage addMemoryUsage: [file memoryUsage]];
+	}
+	// Enumerating the database tables would create all their components
+	if (nil != symbolDatabase)
+	{
+		[usage addBytes: [symbolDatabase estimatedMemoryUsage] + [typeTable estimatedMemoryUsage]
+		    forCategory: SCKMemoryUsageSymbolsCategory];
+		return usage;
+	}
+	// Enumerations are owned and accounted by the files
+	for (NSDictionary *symbols in A(classes, protocols, functions, globals))
+	{
+		for (SCKProgramComponent *component in [symbols objectEnumerator])
+		{
+			symbolsSize += [component estimatedMemoryUsage];
+		}
+	}
+	for (NSOrderedSet *implementors in [implementorsBySelector objectEnumerator])
+	{
+		symbolsSize += class_getInstanceSize([implementors class]) + [implementors count] * 2 * sizeof(id);
+	}
+	for (SCKClass *class in [bundleClasses objectEnumerator])
+	{
+		runtimeSymbolsSize += [class estimatedMemoryUsage];
+	}
+	symbolsSize += [typeTable estimatedMemoryUsage];
+	[usage addBytes: symbolsSize forCategory: SCKMemoryUsageSymbolsCategory];
+	[usage addBytes: runtimeSymbolsSize forCategory: SCKMemoryUsageRuntimeSymbolsCategory];
+	return usage;
+}
+
++ (NSSet*)supportedFileExtensions
+{
+	return [NSSet setWithArray: [fileClasses allKeys]];
+}
+
+- (NSDictionary*)unsavedFileContents
+{
+	NSMutableDictionary *contents = [NSMutableDictionary new];
+
+	for (NSString *path in files)
+	{
+		NSData *sourceContents = [[files objectForKey: path] sourceContents];
+
+		if (nil != sourceContents)
+		{
+			[contents setObject: sourceContents forKey: path];
+		}
+	}
+	return contents;
+}
+
+- (void)setIncludedFiles: (NSSet*)unstandardizedPaths forFile: (NSString*)aPath
+{
+	NSSet *oldIncludedPaths = [includedFiles objectForKey: aPath];
+	NSMutableSet *includedPaths = [NSMutableSet setWithCapacity: [unstandardizedPaths count]];
+
+	for (NSString *includedPath in unstandardizedPaths)
+	{
+		[includedPaths addObject: [includedPath stringByStandardizingPath]];
+	}
+
+	for (NSString *includedPath in oldIncludedPaths)
+	{
+		if ([includedPaths containsObject: includedPath])
+			continue;
+
+		NSMutableSet *dependents = [includingFiles objectForKey: includedPath];
+
+		[dependents removeObject: aPath];
+		if ([dependents count] == 0)
+		{
+			[includingFiles removeObjectForKey: includedPath];
+		}
+	}
+	for (NSString *includedPath in includedPaths)
+	{
+		if ([oldIncludedPaths containsObject: includedPath])
+			continue;
+
+		NSMutableSet *dependents = [includingFiles objectForKey: includedPath];
+
+		if (nil == dependents)
+		{
+			dependents = [NSMutableSet new];
+			[includingFiles setObject: dependents forKey: includedPath];
+		}
+		[dependents addObject: aPath];
+	}
+	if ([includedPaths count] > 0)
+	{
+		[includedFiles setObject: [includedPaths copy] forKey: aPath];
+	}
+	else
+	{
+		[includedFiles removeObjectForKey: aPath];
+	}
+}
+
+- (NSSet*)includedFilesForFile: (NSString*)aPath
+{
+	return [includedFiles objectForKey: [aPath stringByStandardizingIntoAbsolutePath]];
+}
+
+- (NSArray*)filesIncludingFile: (NSString*)aPath
+{
+	NSString *path = [aPath stringByStandardizingIntoAbsolutePath];
+	NSArray *dependentPaths = [[[includingFiles objectForKey: path] allObjects]
+		sortedArrayUsingSelector: @selector(compare:)];
+	NSMutableArray *openFiles = [NSMutableArray array];
+	NSMutableArray *otherFiles = [NSMutableArray array];
+
+	for (NSString *dependentPath in dependentPaths)
+	{
+		SCKSourceFile *file = [files objectForKey: dependentPath];
+
+		if (nil == file)
+			continue;
+
+		[(nil != [file source] ? openFiles : otherFiles) addObject: file];
+	}
+	return [openFiles arrayByAddingObjectsFromArray: otherFiles];
+}
+
+/**
+ * Records the interface fingerprint of a file parsed for the first time, 
+ * against which the files including it were parsed too.
+ */
+- (void)recordInitialFingerprintOfFile: (SCKSourceFile*)aFile
+{
+	if ([aFile interfaceFingerprint] == 0 || nil != [propagatedFingerprints objectForKey: [aFile fileName]])
+		return;
+
+	[propagatedFingerprints setObject: [NSNumber numberWithUnsignedLongLong: [aFile interfaceFingerprint]]
+	                           forKey: [aFile fileName]];
+}
+
+- (NSArray*)reparseFilesIncludingFile: (NSString*)aPath
+{
+	NSString *path = [aPath stringByStandardizingIntoAbsolutePath];
+	unsigned long long fingerprint = [[files objectForKey: path] interfaceFingerprint];
+	NSNumber *propagatedFingerprint = [propagatedFingerprints objectForKey: path];
+
+	// Only comments, whitespace or function bodies changed
+	if (fingerprint != 0 && [propagatedFingerprint unsignedLongLongValue] == fingerprint)
+	{
+		return [NSArray array];
+	}
+
+	NSArray *dependents = [self filesIncludingFile: path];
+
+	[self beginSymbolUpdates];
+	for (SCKSourceFile *file in dependents)
+	{
+		[file reparse];
+	}
+	if (fingerprint != 0)
+	{
+		[propagatedFingerprints setObject: [NSNumber numberWithUnsignedLongLong: fingerprint]
+		                           forKey: path];
+	}
+	[self endSymbolUpdates];
+	return dependents;
 }
 
 - (SCKIndex*)indexForFileExtension: (NSString*)extension
 {
 	return [indexes objectForKey: extension];
 }
+/**
+ * Returns a new source file for the standardized path, that is not parsed yet.
+ */
+- (SCKSourceFile*)newSourceFileForPath: (NSString*)path
+{
+	NSString *extension = [path pathExtension];
+	SCKSourceFile *file = [[fileClasses objectForKey: extension] fileUsingIndex: [indexes objectForKey: extension]];
+
+	file.fileName = path;
+	file.collection = self;
+	file.isIndexOnly = createsIndexOnlyFiles;
+	return file;
+}
+
 - (SCKSourceFile*)sourceFileForPath: (NSString*)aPath
 {
+	if (nil != symbolDatabase)
+		return nil;
+
 	NSString *path = [aPath stringByStandardizingIntoAbsolutePath];
 
 	SCKSourceFile *file = [files objectForKey: path];
@@ -183,14 +647,25 @@ static NSDictionary *fileClasses;
 		return file;
 	}
 
-	NSString *extension = [path pathExtension];
-	file = [[fileClasses objectForKey: extension] fileUsingIndex: [indexes objectForKey: extension]];
-	file.fileName = path;
-	file.collection = self;
+	file = [reusableFiles objectForKey: path];
+	if (nil != file)
+	{
+		[reusableFiles removeObjectForKey: path];
+		[file invalidateIndex];
+		[file reparse];
+		[files setObject: file forKey: path];
+		[self recordInitialFingerprintOfFile: file];
+		[self publishSymbolSnapshot];
+		return file;
+	}
+
+	file = [self newSourceFileForPath: path];
 	[file reparse];
 	if (nil != file)
 	{
 		[files setObject: file forKey: path];
+		[self recordInitialFingerprintOfFile: file];
+		[self publishSymbolSnapshot];
 	}
 	else
 	{
@@ -198,4 +673,49 @@ static NSDictionary *fileClasses;
 	}
 	return file;
 }
+
+- (NSArray*)sourceFilesForPaths: (NSArray*)paths
+{
+	NSMutableArray *sourceFiles = [NSMutableArray arrayWithCapacity: [paths count]];
+	NSMutableArray *newFiles = [NSMutableArray array];
+	BOOL parsesInWorkers = (nil != indexWorkerPool && createsIndexOnlyFiles && nil == symbolDatabase);
+
+	[self beginSymbolUpdates];
+	for (NSString *aPath in paths)
+	{
+		NSString *path = [aPath stringByStandardizingIntoAbsolutePath];
+		BOOL isNew = (nil == [files objectForKey: path] && nil == [reusableFiles objectForKey: path]);
+		SCKSourceFile *file = nil;
+
+		if (isNew && parsesInWorkers)
+		{
+			file = [self newSourceFileForPath: path];
+			if (nil != file)
+			{
+				[files setObject: file forKey: path];
+				[newFiles addObject: file];
+			}
+		}
+		else
+		{
+			file = [self sourceFileForPath: path];
+		}
+
+		if (nil != file)
+		{
+			[sourceFiles addObject: file];
+		}
+	}
+
+	if ([newFiles count] > 0)
+	{
+		[indexWorkerPool reparseFiles: newFiles];
+		for (SCKSourceFile *file in newFiles)
+		{
+			[self recordInitialFingerprintOfFile: file];
+		}
+	}
+	[self endSymbolUpdates];
+	return sourceFiles;
+}
 @end
@@ -7,6 +7,18 @@
 @class NSMutableAttributedString;
 @class SCKSourceCollection;
 @class SCKCodeCompletionResult;
+@class SCKDiagnosticSet;
+@class SCKMemoryUsage;
+@class SCKOccurrenceIndex;
+@class NSArray, NSString;
+
+/**
+ * Posted by a source file at the end of -reparse, once its program components 
+ * have been collected again.
+ *
+ * The notification object is the source file.
+ */
+extern NSString * const SCKSourceFileDidReparseNotification;
 
 /**
  * The SCKSyntaxHighlighter class is responsible for performing lexical and
@@ -29,6 +41,9 @@
 {
 	NSMutableAttributedString *source;
 	NSString *fileName;
+	BOOL isIndexOnly;
+	/** The cached UTF-8 encoding of the source text. */
+	NSData *sourceContents;
 }
 /**
  * Text storage object representing the source file.
@@ -42,14 +57,57 @@
  * The source collection containing this file.
  */
 @property (nonatomic, unsafe_unretained) SCKSourceCollection *collection;
+/**
+ * Returns the -source text encoded in UTF-8, or nil when -source is nil.
+ *
+ * When -source is a NSTextStorage, the encoded text is cached until its 
+ * characters are edited, otherwise the text is encoded on each call.
+ */
+@property (nonatomic, readonly) NSData *sourceContents;
+/**
+ * Tells the receiver its -source was edited, when -source is a NSTextStorage.
+ *
+ * Subclasses overriding this method must call the superclass implementation.
+ */
+- (void)sourceDidProcessEditing: (NSNotification *)aNotification;
 + (SCKSourceFile*)fileUsingIndex: (SCKIndex*)anIndex;
 /**
  * Parses the contents of the file.  Must be called before reapplying
  * highlighting after the file has changed.
+ *
+ * If neither the source nor the files it includes changed since the last 
+ * parse, the parsing results are kept as is.
  */
 - (void)reparse;
+/**
+ * Whether the receiver only collects its program components, and discards 
+ * its parser state at the end of each -reparse.
+ *
+ * Index-only files don't keep a source attributed string, so highlighting, 
+ * diagnostics and code completion are not available. They are usually created 
+ * to index files that are not open in an editor (see 
+ * -[SCKSourceCollection createsIndexOnlyFiles]).
+ *
+ * Setting -source to a non-nil value upgrades the receiver to a regular file, 
+ * whose next -reparse keeps the parser state. Setting this property to YES 
+ * discards the parser state immediately.
+ *
+ * When set to YES while -source is not nil, raises a 
+ * NSInvalidArgumentException.
+ *
+ * By default, returns NO.
+ */
+@property (nonatomic, assign) BOOL isIndexOnly;
+/**
+ * Tells the receiver the program components it collected were discarded (e.g.
+ * by -[SCKSourceCollection clear]), so the next -reparse must collect them 
+ * again even if the file didn't change.
+ */
+- (void)invalidateIndex;
 /**
  * Performs lexical highlighting on the entire file.
+ *
+ * The source is lexed with SCKLexer, so the file doesn't need to be parsed.
  */
 - (void)lexicalHighlightFile;
 /**
@@ -67,12 +125,76 @@
 /**
  * Checks for errors and adds kSCKDiagnostic attributes to ranges in the source
  * attributed string which contain them.
+ *
+ * Only the ranges of the diagnostics that changed since the last call are
+ * updated, and kSCKDiagnostic attributes of fixed diagnostics are removed.
  */
 - (void)collectDiagnostics;
+/**
+ * Returns the diagnostics reported by the last parse, and the changes since
+ * the snapshot returned for the previous parse.
+ *
+ * Calling this method several times without reparsing returns the same
+ * snapshot.
+ */
+- (SCKDiagnosticSet*)diagnosticSet;
 /**
  * Returns completion result at the location
+ *
+ * A location beyond the end of the source is treated as the end.
  */
 - (SCKCodeCompletionResult*)completeAtLocation: (NSUInteger) location;
+/**
+ * Returns the memory used by the parser state, the symbols owned by this file 
+ * and the source attributed string.
+ *
+ * Symbols shared through the collection (classes, global functions etc.) are 
+ * accounted by -[SCKSourceCollection memoryUsage].
+ */
+- (SCKMemoryUsage*)memoryUsage;
+/**
+ * The classes declared or defined in this file (rather than in the headers it 
+ * includes) by the last parse.
+ *
+ * The returned array contains SCKClass objects.
+ */
+@property (nonatomic, readonly) NSArray *declaredClasses;
+/**
+ * The functions (global and static) declared or defined in this file by the 
+ * last parse.
+ *
+ * The returned array contains SCKFunction objects.
+ */
+@property (nonatomic, readonly) NSArray *declaredFunctions;
+/**
+ * The global variables declared or defined in this file by the last parse.
+ *
+ * The returned array contains SCKGlobal objects.
+ */
+@property (nonatomic, readonly) NSArray *declaredGlobals;
+/**
+ * A hash of the declarations in this file (names, types, superclasses, 
+ * enumeration values, macro definitions etc.) computed by the last parse.
+ *
+ * Comments, whitespace and function bodies don't contribute to the 
+ * fingerprint, so files including this one don't need to be reparsed when 
+ * the fingerprint doesn't change.
+ *
+ * Returns 0 when unknown.
+ */
+@property (nonatomic, readonly) unsigned long long interfaceFingerprint;
+/**
+ * The declarations and references in this file (rather than in the headers 
+ * it includes) found by the last parse, indexed by their extent.
+ *
+ * The index answers which symbol is at an offset (e.g. for hover, go to 
+ * definition or highlighting the occurrences of a symbol) without querying 
+ * the parser, so it is available for index-only files too. Its offsets are 
+ * the ones of the parsed contents, until the file is reparsed.
+ *
+ * Returns nil when the file wasn't parsed.
+ */
+@property (nonatomic, readonly) SCKOccurrenceIndex *occurrenceIndex;
 @end
 
 @interface SCKSourceLocation : NSObject
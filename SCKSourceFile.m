@@ -2,11 +2,62 @@
 #import <Cocoa/Cocoa.h>
 #import <EtoileFoundation/EtoileFoundation.h>
 #import "SCKTextTypes.h"
+#import "SCKMemoryUsage.h"
+#import "SCKMetrics.h"
+#import "SCKLexer.h"
+#import "SCKSourceCollection.h"
 #include <time.h>
 
+NSString * const SCKSourceFileDidReparseNotification = @"SCKSourceFileDidReparseNotification";
 
 @implementation SCKSourceFile
-@synthesize fileName, source, collection;
+@synthesize fileName, source, collection, isIndexOnly;
+- (void)dealloc
+{
+	[[NSNotificationCenter defaultCenter] removeObserver: self];
+}
+- (void)setSource: (NSMutableAttributedString *)aSource
+{
+	NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+
+	if ([source isKindOfClass: [NSTextStorage class]])
+	{
+		[center removeObserver: self
+		                  name: NSTextStorageDidProcessEditingNotification
+		                object: source];
+	}
+	source = aSource;
+	sourceContents = nil;
+	if ([source isKindOfClass: [NSTextStorage class]])
+	{
+		[center addObserver: self
+		           selector: @selector(sourceDidProcessEditing:)
+		               name: NSTextStorageDidProcessEditingNotification
+		             object: source];
+	}
+}
+- (void)sourceDidProcessEditing: (NSNotification *)aNotification
+{
+	// Highlighting only edits attributes
+	if ([(NSTextStorage *)source editedMask] & NSTextStorageEditedCharacters)
+	{
+		sourceContents = nil;
+	}
+}
+- (NSData *)sourceContents
+{
+	if (nil == source || nil != sourceContents)
+		return sourceContents;
+
+	NSData *contents = [[source string] dataUsingEncoding: NSUTF8StringEncoding];
+
+	// Other attributed strings can be edited without notice
+	if ([source isKindOfClass: [NSTextStorage class]])
+	{
+		sourceContents = contents;
+	}
+	return contents;
+}
 - (id)initUsingIndex: (SCKIndex*)anIndex
 {
 	return nil;
@@ -16,11 +67,40 @@
 	return [[self alloc] initUsingIndex: (SCKIndex*)anIndex];
 }
 - (void)reparse {}
-- (void)lexicalHighlightFile {}
+- (void)invalidateIndex {}
+- (void)lexicalHighlightFile
+{
+	if (nil == source)
+	{
+		return;
+	}
+
+	double startTime = SCKMetricsNow();
+	BOOL isCPlusPlus = [S(@"mm", @"cc", @"cp", @"cpp", @"cxx", @"c++", @"C", @"hh", @"hpp", @"hxx")
+		containsObject: [fileName pathExtension]];
+
+	[SCKLexer lexicalHighlightString: source cPlusPlus: isCPlusPlus];
+	[[[self collection] metrics] recordDuration: SCKMetricsNow() - startTime
+	                                   forPhase: SCKMetricPhaseLexicalHighlight
+	                                       file: fileName];
+}
 - (void)syntaxHighlightFile {}
 - (void)syntaxHighlightRange: (NSRange)r {}
 - (void)addIncludePath: (NSString*)includePath {}
 - (void)collectDiagnostics {}
+- (SCKDiagnosticSet*)diagnosticSet { return nil; }
 - (SCKCodeCompletionResult*)completeAtLocation: (NSUInteger) location { return nil; }
+- (SCKMemoryUsage*)memoryUsage
+{
+	SCKMemoryUsage *usage = [SCKMemoryUsage new];
+	[usage addBytes: SCKEstimatedMemoryUsageOfAttributedString(source)
+	    forCategory: SCKMemoryUsageSourceTextCategory];
+	return usage;
+}
+- (NSArray*)declaredClasses { return [NSArray array]; }
+- (NSArray*)declaredFunctions { return [NSArray array]; }
+- (NSArray*)declaredGlobals { return [NSArray array]; }
+- (unsigned long long)interfaceFingerprint { return 0; }
+- (SCKOccurrenceIndex*)occurrenceIndex { return nil; }
 @end
 
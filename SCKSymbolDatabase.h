@@ -0,0 +1,98 @@
+#import <Foundation/NSObject.h>
+
+@class NSArray, NSDictionary, NSString, SCKSourceCollection, SCKTypeTable;
+
+/**
+ * The symbol tables stored in a symbol database.
+ */
+typedef enum
+{
+	SCKSymbolTableClasses,
+	SCKSymbolTableProtocols,
+	SCKSymbolTableFunctions,
+	SCKSymbolTableGlobals,
+	SCKSymbolTableEnumerations,
+	SCKSymbolTableEnumerationValues,
+	/** Selectors, for -[SCKSourceCollection implementorsOfSelector:]. */
+	SCKSymbolTableSelectors,
+	SCKSymbolTableCount
+} SCKSymbolTable;
+
+/**
+ * A read-only symbol database file exported from a source collection, that
+ * several processes (e.g. an editor, a documentation generator and a code
+ * review tool) can open without parsing the source files again.
+ *
+ * The file contains a string table, fixed-size symbol records and a hash
+ * index per symbol table. It is memory-mapped rather than read, so opening
+ * a database costs the same time whatever its size, and the processes that
+ * open the same file share its pages in the page cache.
+ *
+ * The program components are created from their records the first time they
+ * are looked up, then cached. Looking up a class creates its methods, ivars,
+ * properties and categories, its superclasses and the protocols it adopts.
+ *
+ * A database is usually opened through
+ * -[SCKSourceCollection initWithSymbolDatabaseAtPath:]. Its methods can be
+ * called from several threads.
+ */
+@interface SCKSymbolDatabase : NSObject
+/**
+ * Writes the symbols of the collection to a symbol database file at the
+ * given path, and returns whether it succeeded.
+ *
+ * The classes, protocols, functions, globals, enumerations and enumeration
+ * values are exported with their locations, type encodings and comment
+ * locations, along with the selector index. Runtime symbols (the classes
+ * collected from the loaded bundles) and the per-file symbols (e.g. static
+ * functions and macros) are not exported.
+ *
+ * The file is replaced atomically, so the processes that mapped the previous
+ * file keep reading it until they open the new one. Returns NO without
+ * writing the file when the symbols exceed the 4 GB that the 32-bit offsets of
+ * the format can address.
+ *
+ * When the collection or the path is nil, raises a NSInvalidArgumentException.
+ */
++ (BOOL)writeSymbolsOfCollection: (SCKSourceCollection *)aCollection toFile: (NSString *)aPath;
+/**
+ * <init />
+ * Maps the symbol database file at the given path, and returns a database
+ * that interns the type encodings of its components with the given table.
+ *
+ * Returns nil if the file cannot be mapped, or is not a symbol database
+ * written by the current version on a machine with the same byte order.
+ *
+ * When the path or the table is nil, raises a NSInvalidArgumentException.
+ */
+- (id)initWithContentsOfFile: (NSString *)aPath typeTable: (SCKTypeTable *)aTable;
+/**
+ * The path of the mapped file.
+ */
+@property (nonatomic, readonly) NSString *path;
+/**
+ * Returns a dictionary that maps the names of the given table to their
+ * program components.
+ *
+ * The dictionary is immutable and creates the components on demand,
+ * enumerating its values creates all the components of the table.
+ *
+ * For SCKSymbolTableSelectors, the values are arrays of implementors (see
+ * -implementorsOfSelector:).
+ */
+- (NSDictionary *)componentsInTable: (SCKSymbolTable)aTable;
+/**
+ * Returns the classes, categories and protocols that declare or define a
+ * method with the given selector, in the order they were recorded by the
+ * exported collection.
+ */
+- (NSArray *)implementorsOfSelector: (NSString *)aSelector;
+/**
+ * Returns an estimation of the memory in bytes used by the components
+ * created so far.
+ *
+ * The mapped file is not included, since its pages are shared and can be
+ * evicted by the system.
+ */
+@property (nonatomic, readonly) NSUInteger estimatedMemoryUsage;
+@end
@@ -0,0 +1,1236 @@
+#import "SCKSymbolDatabase.h"
+#import "SCKIntrospection.h"
+#import "SCKSourceCollection.h"
+#import "SCKSourceFile.h"
+#import "SCKTypeTable.h"
+#import <EtoileFoundation/EtoileFoundation.h>
+#include <objc/runtime.h>
+#include <string.h>
+
+/** 'SCKD' */
+#define SCKSymbolDatabaseMagic 0x53434b44
+#define SCKSymbolDatabaseVersion 1
+
+/** Marks a missing record or string. */
+static const uint32_t SCKNone = UINT32_MAX;
+
+enum SCKSymbolRecordKind
+{
+	SCKSymbolRecordClass = 1,
+	SCKSymbolRecordCategory,
+	SCKSymbolRecordMethod,
+	SCKSymbolRecordIvar,
+	SCKSymbolRecordProperty,
+	SCKSymbolRecordProtocol,
+	SCKSymbolRecordFunction,
+	SCKSymbolRecordGlobal,
+	SCKSymbolRecordEnumeration,
+	SCKSymbolRecordEnumerationValue,
+	/** A selector whose children are its implementors. */
+	SCKSymbolRecordSelector
+};
+
+enum SCKSymbolRecordFlags
+{
+	SCKSymbolRecordIsClassMethod = 1,
+	SCKSymbolRecordIsIBOutlet = 2,
+	/** For the methods and properties of a protocol. */
+	SCKSymbolRecordIsRequired = 4
+};
+
+/**
+ * The header at the start of the file. Offsets are in bytes from the start
+ * of the file, and all values are in host byte order.
+ */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	/** NUL-terminated UTF-8 strings, referenced by their offset in the table. */
+	uint32_t stringsOffset;
+	uint32_t stringsLength;
+	/** SCKSymbolRecord array. */
+	uint32_t recordsOffset;
+	uint32_t recordCount;
+	/** uint32_t array that stores the children and protocol lists. */
+	uint32_t listsOffset;
+	uint32_t listLength;
+	/**
+	 * Open-addressing hash tables (linear probing) whose buckets contain a
+	 * record index + 1, or 0 when empty. Bucket counts are powers of two.
+	 */
+	uint32_t tableOffsets[SCKSymbolTableCount];
+	uint32_t tableBucketCounts[SCKSymbolTableCount];
+	uint32_t tableEntryCounts[SCKSymbolTableCount];
+} SCKSymbolDatabaseHeader;
+
+typedef struct
+{
+	int64_t value;
+	uint32_t kind;
+	uint32_t flags;
+	uint32_t name;
+	/** The record of the class, protocol or enumeration, or SCKNone. */
+	uint32_t parent;
+	uint32_t typeEncoding;
+	/** The superclass name, property attributes or enumeration name. */
+	uint32_t extra;
+	/** Record indexes in the lists. */
+	uint32_t children;
+	uint32_t childCount;
+	/** Adopted protocol names in the lists. */
+	uint32_t protocols;
+	uint32_t protocolCount;
+	uint32_t declarationFile;
+	uint32_t declarationOffset;
+	uint32_t definitionFile;
+	uint32_t definitionOffset;
+	uint32_t commentFile;
+	uint32_t commentOffset;
+	uint32_t commentLength;
+	uint32_t reserved;
+} SCKSymbolRecord;
+
+/**
+ * 32-bit FNV-1a hash of a NUL-terminated string.
+ */
+static uint32_t hashString(const char *aString)
+{
+	uint32_t hash = 2166136261U;
+
+	for (const unsigned char *p = (const unsigned char *)aString; *p != '\0'; p++)
+	{
+		hash = (hash ^ *p) * 16777619U;
+	}
+	return hash;
+}
+
+static NSUInteger bucketCountForEntryCount(NSUInteger count)
+{
+	NSUInteger bucketCount = 1;
+
+	// Keep the load factor under 0.5 so probe sequences stay short
+	while (bucketCount < count * 2)
+	{
+		bucketCount *= 2;
+	}
+	return bucketCount;
+}
+
+static NSArray *sortedKeys(NSDictionary *aDictionary)
+{
+	return [[aDictionary allKeys] sortedArrayUsingSelector: @selector(compare:)];
+}
+
+/**
+ * Builds the sections of a symbol database file from a source collection.
+ */
+@interface SCKSymbolDatabaseWriter : NSObject
+/**
+ * Returns the file contents, or nil when the sections don't fit in the 32-bit
+ * offsets of the format.
+ */
+- (NSData *)dataWithSymbolsOfCollection: (SCKSourceCollection *)aCollection;
+@end
+
+@implementation SCKSymbolDatabaseWriter
+{
+	NSMutableData *strings;
+	/** String offsets by string. */
+	NSMutableDictionary *stringOffsets;
+	NSMutableData *records;
+	NSMutableData *lists;
+	/** Component to record index + 1. */
+	NSMapTable *recordIndexes;
+}
+
+- (id)init
+{
+	SUPERINIT;
+	strings = [NSMutableData new];
+	stringOffsets = [NSMutableDictionary new];
+	records = [NSMutableData new];
+	lists = [NSMutableData new];
+	recordIndexes = [[NSMapTable alloc] initWithKeyOptions: NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+	                                          valueOptions: NSPointerFunctionsOpaqueMemory | NSPointerFunctionsIntegerPersonality
+	                                              capacity: 1024];
+	return self;
+}
+
+- (uint32_t)offsetOfString: (NSString *)aString
+{
+	if (nil == aString)
+		return SCKNone;
+
+	NSNumber *offset = [stringOffsets objectForKey: aString];
+
+	if (nil == offset)
+	{
+		const char *bytes = [aString UTF8String];
+
+		offset = [NSNumber numberWithUnsignedInt: (uint32_t)[strings length]];
+		[strings appendBytes: bytes length: strlen(bytes) + 1];
+		[stringOffsets setObject: offset forKey: aString];
+	}
+	return [offset unsignedIntValue];
+}
+
+- (uint32_t)appendList: (NSData *)aList
+{
+	uint32_t offset = (uint32_t)([lists length] / sizeof(uint32_t));
+
+	[lists appendData: aList];
+	return offset;
+}
+
+- (uint32_t)appendStringList: (NSArray *)someStrings
+{
+	NSMutableData *list = [NSMutableData dataWithCapacity: [someStrings count] * sizeof(uint32_t)];
+
+	for (NSString *string in someStrings)
+	{
+		uint32_t offset = [self offsetOfString: string];
+		[list appendBytes: &offset length: sizeof(offset)];
+	}
+	return [self appendList: list];
+}
+
+- (uint32_t)recordIndexOfComponent: (id)aComponent
+{
+	uintptr_t indexPlusOne = (uintptr_t)NSMapGet(recordIndexes, (__bridge void *)aComponent);
+	return (0 == indexPlusOne ? SCKNone : (uint32_t)(indexPlusOne - 1));
+}
+
+- (SCKSymbolRecord *)recordAtIndex: (uint32_t)anIndex
+{
+	return (SCKSymbolRecord *)[records mutableBytes] + anIndex;
+}
+
+- (void)setLocation: (SCKSourceLocation *)aLocation file: (uint32_t *)aFile offset: (uint32_t *)anOffset
+{
+	*aFile = [self offsetOfString: [aLocation file]];
+	*anOffset = (uint32_t)[aLocation offset];
+}
+
+/**
+ * Appends a record for the component, or returns the index of the record
+ * appended for it previously.
+ */
+- (uint32_t)recordIndexForComponent: (SCKProgramComponent *)aComponent
+                               kind: (enum SCKSymbolRecordKind)aKind
+                              flags: (uint32_t)someFlags
+                             parent: (uint32_t)aParent
+{
+	uint32_t index = [self recordIndexOfComponent: aComponent];
+
+	if (SCKNone != index)
+		return index;
+
+	SCKSymbolRecord record;
+
+	memset(&record, 0, sizeof(record));
+	record.kind = aKind;
+	record.flags = someFlags;
+	record.name = [self offsetOfString: [aComponent name]];
+	record.parent = aParent;
+	record.typeEncoding = SCKNone;
+	record.extra = SCKNone;
+	if ([aComponent isKindOfClass: [SCKTypedProgramComponent class]])
+	{
+		record.typeEncoding = [self offsetOfString: [(SCKTypedProgramComponent *)aComponent typeEncoding]];
+	}
+	[self setLocation: [aComponent declaration] file: &record.declarationFile offset: &record.declarationOffset];
+	[self setLocation: [aComponent definition] file: &record.definitionFile offset: &record.definitionOffset];
+	[self setLocation: [aComponent commentLocation] file: &record.commentFile offset: &record.commentOffset];
+	record.commentLength = (uint32_t)[aComponent commentLength];
+
+	index = (uint32_t)([records length] / sizeof(SCKSymbolRecord));
+	[records appendBytes: &record length: sizeof(record)];
+	NSMapInsert(recordIndexes, (__bridge void *)aComponent, (void *)(uintptr_t)(index + 1));
+	return index;
+}
+
+- (void)setChildren: (NSData *)someChildren ofRecordAtIndex: (uint32_t)anIndex
+{
+	uint32_t children = [self appendList: someChildren];
+	SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+
+	record->children = children;
+	record->childCount = (uint32_t)([someChildren length] / sizeof(uint32_t));
+}
+
+- (void)setProtocols: (NSArray *)someProtocols ofRecordAtIndex: (uint32_t)anIndex
+{
+	NSMutableArray *names = [NSMutableArray arrayWithCapacity: [someProtocols count]];
+
+	for (SCKProtocol *protocol in someProtocols)
+	{
+		[names addObject: [protocol name]];
+	}
+
+	uint32_t protocols = [self appendStringList: names];
+	SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+
+	record->protocols = protocols;
+	record->protocolCount = (uint32_t)[someProtocols count];
+}
+
+- (void)appendIndex: (uint32_t)anIndex toList: (NSMutableData *)aList
+{
+	[aList appendBytes: &anIndex length: sizeof(anIndex)];
+}
+
+- (uint32_t)recordIndexForMethod: (SCKMethod *)aMethod flags: (uint32_t)someFlags parent: (uint32_t)aParent
+{
+	if ([aMethod isClassMethod])
+	{
+		someFlags |= SCKSymbolRecordIsClassMethod;
+	}
+	return [self recordIndexForComponent: aMethod
+	                                kind: SCKSymbolRecordMethod
+	                               flags: someFlags
+	                              parent: aParent];
+}
+
+- (uint32_t)recordIndexForProperty: (SCKProperty *)aProperty flags: (uint32_t)someFlags parent: (uint32_t)aParent
+{
+	uint32_t index = [self recordIndexForComponent: aProperty
+	                                          kind: SCKSymbolRecordProperty
+	                                         flags: someFlags | ([aProperty isIBOutlet] ? SCKSymbolRecordIsIBOutlet : 0)
+	                                        parent: aParent];
+
+	[self recordAtIndex: index]->extra = [self offsetOfString: [aProperty attributes]];
+	return index;
+}
+
+- (uint32_t)recordIndexForCategory: (SCKCategory *)aCategory parent: (uint32_t)aParent
+{
+	uint32_t index = [self recordIndexForComponent: aCategory
+	                                          kind: SCKSymbolRecordCategory
+	                                         flags: 0
+	                                        parent: aParent];
+	NSMutableData *children = [NSMutableData data];
+
+	// The methods and properties are shared with the class
+	for (SCKMethod *method in [[aCategory methods] orderedMethods])
+	{
+		[self appendIndex: [self recordIndexForMethod: method flags: 0 parent: aParent] toList: children];
+	}
+	for (SCKProperty *property in [aCategory properties])
+	{
+		[self appendIndex: [self recordIndexForProperty: property flags: 0 parent: aParent] toList: children];
+	}
+	[self setChildren: children ofRecordAtIndex: index];
+	[self setProtocols: [aCategory adoptedProtocols] ofRecordAtIndex: index];
+	return index;
+}
+
+- (uint32_t)recordIndexForClass: (SCKClass *)aClass
+{
+	uint32_t index = [self recordIndexForComponent: aClass
+	                                          kind: SCKSymbolRecordClass
+	                                         flags: 0
+	                                        parent: SCKNone];
+	NSMutableData *children = [NSMutableData data];
+
+	for (SCKMethod *method in [[aClass methods] orderedMethods])
+	{
+		[self appendIndex: [self recordIndexForMethod: method flags: 0 parent: index] toList: children];
+	}
+	for (SCKIvar *ivar in [aClass ivars])
+	{
+		[self appendIndex: [self recordIndexForComponent: ivar
+		                                            kind: SCKSymbolRecordIvar
+		                                           flags: ([ivar isIBOutlet] ? SCKSymbolRecordIsIBOutlet : 0)
+		                                          parent: index]
+		           toList: children];
+	}
+	for (SCKProperty *property in [aClass properties])
+	{
+		[self appendIndex: [self recordIndexForProperty: property flags: 0 parent: index] toList: children];
+	}
+	// Categories come last, so their methods are created with the class ones
+	for (NSString *categoryName in sortedKeys([aClass categories]))
+	{
+		[self appendIndex: [self recordIndexForCategory: [[aClass categories] objectForKey: categoryName]
+		                                         parent: index]
+		           toList: children];
+	}
+	[self setChildren: children ofRecordAtIndex: index];
+	[self setProtocols: [aClass adoptedProtocols] ofRecordAtIndex: index];
+	[self recordAtIndex: index]->extra = [self offsetOfString: [[aClass superclass] name]];
+	return index;
+}
+
+- (uint32_t)recordIndexForProtocol: (SCKProtocol *)aProtocol
+{
+	uint32_t index = [self recordIndexForComponent: aProtocol
+	                                          kind: SCKSymbolRecordProtocol
+	                                         flags: 0
+	                                        parent: SCKNone];
+	NSMutableData *children = [NSMutableData data];
+
+	for (SCKMethod *method in [[aProtocol requiredMethods] orderedMethods])
+	{
+		[self appendIndex: [self recordIndexForMethod: method flags: SCKSymbolRecordIsRequired parent: index]
+		           toList: children];
+	}
+	for (SCKMethod *method in [[aProtocol optionalMethods] orderedMethods])
+	{
+		[self appendIndex: [self recordIndexForMethod: method flags: 0 parent: index] toList: children];
+	}
+	for (SCKProperty *property in [aProtocol requiredProperties])
+	{
+		[self appendIndex: [self recordIndexForProperty: property flags: SCKSymbolRecordIsRequired parent: index]
+		           toList: children];
+	}
+	for (SCKProperty *property in [aProtocol optionalProperties])
+	{
+		[self appendIndex: [self recordIndexForProperty: property flags: 0 parent: index] toList: children];
+	}
+	[self setChildren: children ofRecordAtIndex: index];
+	[self setProtocols: [aProtocol adoptedProtocols] ofRecordAtIndex: index];
+	return index;
+}
+
+- (uint32_t)recordIndexForEnumerationValue: (SCKEnumerationValue *)aValue parent: (uint32_t)aParent
+{
+	uint32_t index = [self recordIndexForComponent: aValue
+	                                          kind: SCKSymbolRecordEnumerationValue
+	                                         flags: 0
+	                                        parent: aParent];
+	SCKSymbolRecord *record = [self recordAtIndex: index];
+
+	record->value = [aValue longLongValue];
+	record->extra = [self offsetOfString: [aValue enumerationName]];
+	return index;
+}
+
+- (uint32_t)recordIndexForEnumeration: (SCKEnumeration *)anEnumeration
+{
+	uint32_t index = [self recordIndexForComponent: anEnumeration
+	                                          kind: SCKSymbolRecordEnumeration
+	                                         flags: 0
+	                                        parent: SCKNone];
+	NSMutableData *children = [NSMutableData data];
+
+	for (NSString *valueName in sortedKeys([anEnumeration values]))
+	{
+		[self appendIndex: [self recordIndexForEnumerationValue: [[anEnumeration values] objectForKey: valueName]
+		                                                 parent: index]
+		           toList: children];
+	}
+	[self setChildren: children ofRecordAtIndex: index];
+	return index;
+}
+
+- (uint32_t)recordIndexForSelector: (NSString *)aSelector implementors: (NSArray *)implementors
+{
+	NSMutableData *children = [NSMutableData data];
+
+	for (SCKProgramComponent *implementor in implementors)
+	{
+		uint32_t implementorIndex = [self recordIndexOfComponent: implementor];
+
+		// Skip the classes collected by runtime introspection
+		if (SCKNone != implementorIndex)
+		{
+			[self appendIndex: implementorIndex toList: children];
+		}
+	}
+	if ([children length] == 0)
+		return SCKNone;
+
+	SCKSymbolRecord record;
+	uint32_t index = (uint32_t)([records length] / sizeof(SCKSymbolRecord));
+
+	memset(&record, 0, sizeof(record));
+	record.kind = SCKSymbolRecordSelector;
+	record.name = [self offsetOfString: aSelector];
+	record.parent = SCKNone;
+	record.typeEncoding = SCKNone;
+	record.extra = SCKNone;
+	record.declarationFile = SCKNone;
+	record.definitionFile = SCKNone;
+	record.commentFile = SCKNone;
+	[records appendBytes: &record length: sizeof(record)];
+	[self setChildren: children ofRecordAtIndex: index];
+	return index;
+}
+
+/**
+ * Returns the hash table of the given record indexes, keyed by the names of
+ * the records.
+ */
+- (NSData *)hashTableWithRecordIndexes: (NSData *)someIndexes
+{
+	const uint32_t *indexes = [someIndexes bytes];
+	NSUInteger count = [someIndexes length] / sizeof(uint32_t);
+	NSUInteger bucketCount = bucketCountForEntryCount(count);
+	NSMutableData *table = [NSMutableData dataWithLength: bucketCount * sizeof(uint32_t)];
+	uint32_t *buckets = [table mutableBytes];
+	const char *stringBytes = [strings bytes];
+
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		uint32_t name = [self recordAtIndex: indexes[i]]->name;
+
+		if (SCKNone == name)
+			continue;
+
+		uint32_t bucket = hashString(stringBytes + name) & (bucketCount - 1);
+
+		while (buckets[bucket] != 0)
+		{
+			bucket = (bucket + 1) & (bucketCount - 1);
+		}
+		buckets[bucket] = indexes[i] + 1;
+	}
+	return table;
+}
+
+- (NSData *)dataWithSymbolsOfCollection: (SCKSourceCollection *)aCollection
+{
+	NSMutableArray *tableIndexes = [NSMutableArray array];
+
+	for (int i = 0; i < SCKSymbolTableCount; i++)
+	{
+		[tableIndexes addObject: [NSMutableData data]];
+	}
+
+	for (NSString *name in sortedKeys([aCollection classes]))
+	{
+		[self appendIndex: [self recordIndexForClass: [[aCollection classes] objectForKey: name]]
+		           toList: [tableIndexes objectAtIndex: SCKSymbolTableClasses]];
+	}
+	for (NSString *name in sortedKeys([aCollection protocols]))
+	{
+		[self appendIndex: [self recordIndexForProtocol: [[aCollection protocols] objectForKey: name]]
+		           toList: [tableIndexes objectAtIndex: SCKSymbolTableProtocols]];
+	}
+	for (NSString *name in sortedKeys([aCollection functions]))
+	{
+		[self appendIndex: [self recordIndexForComponent: [[aCollection functions] objectForKey: name]
+		                                            kind: SCKSymbolRecordFunction
+		                                           flags: 0
+		                                          parent: SCKNone]
+		           toList: [tableIndexes objectAtIndex: SCKSymbolTableFunctions]];
+	}
+	for (NSString *name in sortedKeys([aCollection globals]))
+	{
+		[self appendIndex: [self recordIndexForComponent: [[aCollection globals] objectForKey: name]
+		                                            kind: SCKSymbolRecordGlobal
+		                                           flags: 0
+		                                          parent: SCKNone]
+		           toList: [tableIndexes objectAtIndex: SCKSymbolTableGlobals]];
+	}
+	for (NSString *name in sortedKeys([aCollection enumerations]))
+	{
+		[self appendIndex: [self recordIndexForEnumeration: [[aCollection enumerations] objectForKey: name]]
+		           toList: [tableIndexes objectAtIndex: SCKSymbolTableEnumerations]];
+	}
+	// Values that belong to an exported enumeration reuse its records
+	for (NSString *name in sortedKeys([aCollection enumerationValues]))
+	{
+		[self appendIndex: [self recordIndexForEnumerationValue: [[aCollection enumerationValues] objectForKey: name]
+		                                                 parent: SCKNone]
+		           toList: [tableIndexes objectAtIndex: SCKSymbolTableEnumerationValues]];
+	}
+	for (NSString *selector in [[aCollection implementedSelectors] sortedArrayUsingSelector: @selector(compare:)])
+	{
+		uint32_t index = [self recordIndexForSelector: selector
+		                                 implementors: [aCollection implementorsOfSelector: selector]];
+
+		if (SCKNone != index)
+		{
+			[self appendIndex: index toList: [tableIndexes objectAtIndex: SCKSymbolTableSelectors]];
+		}
+	}
+
+	SCKSymbolDatabaseHeader header;
+	NSMutableData *tables = [NSMutableData data];
+
+	memset(&header, 0, sizeof(header));
+	header.magic = SCKSymbolDatabaseMagic;
+	header.version = SCKSymbolDatabaseVersion;
+	// Records are 8-byte aligned, and come first so the others don't need padding
+	header.recordsOffset = (uint32_t)((sizeof(header) + 7) & ~(size_t)7);
+	header.recordCount = (uint32_t)([records length] / sizeof(SCKSymbolRecord));
+	header.listsOffset = header.recordsOffset + (uint32_t)[records length];
+	header.listLength = (uint32_t)([lists length] / sizeof(uint32_t));
+
+	if ((uint64_t)header.recordsOffset + [records length] + [lists length] >= SCKNone)
+		return nil;
+
+	uint32_t tableOffset = header.listsOffset + (uint32_t)[lists length];
+
+	for (int i = 0; i < SCKSymbolTableCount; i++)
+	{
+		NSData *indexes = [tableIndexes objectAtIndex: i];
+		NSData *table = [self hashTableWithRecordIndexes: indexes];
+
+		header.tableOffsets[i] = tableOffset + (uint32_t)[tables length];
+		header.tableBucketCounts[i] = (uint32_t)([table length] / sizeof(uint32_t));
+		header.tableEntryCounts[i] = (uint32_t)([indexes length] / sizeof(uint32_t));
+		[tables appendData: table];
+	}
+	// The offsets are 32-bit, and SCKNone must remain out of range
+	if ((uint64_t)tableOffset + [tables length] + [strings length] >= SCKNone)
+		return nil;
+
+	header.stringsOffset = tableOffset + (uint32_t)[tables length];
+	header.stringsLength = (uint32_t)[strings length];
+
+	NSMutableData *data = [NSMutableData dataWithBytes: &header length: sizeof(header)];
+
+	[data setLength: header.recordsOffset];
+	[data appendData: records];
+	[data appendData: lists];
+	[data appendData: tables];
+	[data appendData: strings];
+	return data;
+}
+
+@end
+
+/**
+ * Immutable dictionary that looks up the components of a symbol table in a
+ * database.
+ */
+@interface SCKSymbolDatabaseDictionary : NSDictionary
+- (id)initWithDatabase: (SCKSymbolDatabase *)aDatabase table: (SCKSymbolTable)aTable;
+@end
+
+@interface SCKSymbolDatabase ()
+- (id)componentInTable: (SCKSymbolTable)aTable named: (NSString *)aName;
+- (NSArray *)namesInTable: (SCKSymbolTable)aTable;
+- (NSUInteger)countOfTable: (SCKSymbolTable)aTable;
+@end
+
+@implementation SCKSymbolDatabaseDictionary
+{
+	SCKSymbolDatabase *database;
+	SCKSymbolTable table;
+}
+
+- (id)initWithObjects: (const id [])objects forKeys: (const id <NSCopying> [])someKeys count: (NSUInteger)count
+{
+	// Called by -[NSDictionary init] on GNUstep, the contents come from the database
+	return self;
+}
+
+- (id)initWithDatabase: (SCKSymbolDatabase *)aDatabase table: (SCKSymbolTable)aTable
+{
+	SUPERINIT;
+	database = aDatabase;
+	table = aTable;
+	return self;
+}
+
+- (id)copyWithZone: (NSZone *)aZone
+{
+	return self;
+}
+
+- (NSUInteger)count
+{
+	return [database countOfTable: table];
+}
+
+- (id)objectForKey: (id)aKey
+{
+	if (![aKey isKindOfClass: [NSString class]])
+		return nil;
+
+	return [database componentInTable: table named: aKey];
+}
+
+- (NSEnumerator *)keyEnumerator
+{
+	return [[database namesInTable: table] objectEnumerator];
+}
+
+@end
+
+@implementation SCKSymbolDatabase
+{
+	NSString *path;
+	SCKTypeTable *typeTable;
+	/** The mapped file. */
+	NSData *data;
+	const SCKSymbolDatabaseHeader *header;
+	const SCKSymbolRecord *records;
+	const uint32_t *lists;
+	const char *strings;
+	/** Components created from the records, by record index. */
+	NSMutableDictionary *components;
+	/** Interned file paths by string offset. */
+	NSMutableDictionary *files;
+	/** Components are created recursively (e.g. a class and its superclass). */
+	NSRecursiveLock *lock;
+}
+
+@synthesize path;
+
++ (BOOL)writeSymbolsOfCollection: (SCKSourceCollection *)aCollection toFile: (NSString *)aPath
+{
+	NILARG_EXCEPTION_TEST(aCollection);
+	NILARG_EXCEPTION_TEST(aPath);
+	NSData *fileData = [[SCKSymbolDatabaseWriter new] dataWithSymbolsOfCollection: aCollection];
+
+	if (nil == fileData)
+		return NO;
+
+	// Written to a temporary file then renamed, the mapped file is not modified
+	return [fileData writeToFile: aPath atomically: YES];
+}
+
+static BOOL isSectionInFile(uint32_t anOffset, uint64_t aLength, NSUInteger aFileLength)
+{
+	return ((uint64_t)anOffset + aLength <= aFileLength);
+}
+
+- (BOOL)isValidFileData
+{
+	NSUInteger length = [data length];
+
+	if (length < sizeof(SCKSymbolDatabaseHeader))
+		return NO;
+
+	header = [data bytes];
+	if (header->magic != SCKSymbolDatabaseMagic || header->version != SCKSymbolDatabaseVersion)
+		return NO;
+
+	if (header->recordsOffset % 8 != 0 || header->listsOffset % 4 != 0
+	 || !isSectionInFile(header->recordsOffset, (uint64_t)header->recordCount * sizeof(SCKSymbolRecord), length)
+	 || !isSectionInFile(header->listsOffset, (uint64_t)header->listLength * sizeof(uint32_t), length)
+	 || !isSectionInFile(header->stringsOffset, header->stringsLength, length))
+	{
+		return NO;
+	}
+	for (int i = 0; i < SCKSymbolTableCount; i++)
+	{
+		uint32_t bucketCount = header->tableBucketCounts[i];
+
+		if (header->tableOffsets[i] % 4 != 0 || bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0
+		 || !isSectionInFile(header->tableOffsets[i], (uint64_t)bucketCount * sizeof(uint32_t), length))
+		{
+			return NO;
+		}
+	}
+	// Lookups rely on the last string being terminated
+	if (header->stringsLength > 0 && ((const char *)[data bytes])[header->stringsOffset + header->stringsLength - 1] != '\0')
+		return NO;
+
+	return YES;
+}
+
+- (id)initWithContentsOfFile: (NSString *)aPath typeTable: (SCKTypeTable *)aTable
+{
+	NILARG_EXCEPTION_TEST(aPath);
+	NILARG_EXCEPTION_TEST(aTable);
+	SUPERINIT;
+	path = [aPath copy];
+	typeTable = aTable;
+	data = [NSData dataWithContentsOfFile: aPath options: NSDataReadingMappedAlways error: NULL];
+
+	if (nil == data || ![self isValidFileData])
+		return nil;
+
+	records = (const SCKSymbolRecord *)((const char *)[data bytes] + header->recordsOffset);
+	lists = (const uint32_t *)((const char *)[data bytes] + header->listsOffset);
+	strings = (const char *)[data bytes] + header->stringsOffset;
+	components = [NSMutableDictionary new];
+	files = [NSMutableDictionary new];
+	lock = [NSRecursiveLock new];
+	return self;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat: @"%@ %@", [super description], path];
+}
+
+#pragma mark - Decoding Records
+
+- (const char *)UTF8StringAtOffset: (uint32_t)anOffset
+{
+	return (anOffset < header->stringsLength ? strings + anOffset : NULL);
+}
+
+- (NSString *)stringAtOffset: (uint32_t)anOffset
+{
+	const char *string = [self UTF8StringAtOffset: anOffset];
+	return (NULL != string ? [NSString stringWithUTF8String: string] : nil);
+}
+
+- (const SCKSymbolRecord *)recordAtIndex: (uint32_t)anIndex
+{
+	return (anIndex < header->recordCount ? records + anIndex : NULL);
+}
+
+/**
+ * Returns the list elements at the given offset, or NULL if the list is
+ * outside the lists section.
+ */
+- (const uint32_t *)listAtOffset: (uint32_t)anOffset count: (uint32_t)aCount
+{
+	if ((uint64_t)anOffset + aCount > header->listLength)
+		return NULL;
+
+	return lists + anOffset;
+}
+
+- (SCKSourceLocation *)locationWithFile: (uint32_t)aFile offset: (uint32_t)anOffset
+{
+	NSNumber *key = [NSNumber numberWithUnsignedInt: aFile];
+	NSString *file = [files objectForKey: key];
+
+	if (nil == file)
+	{
+		file = [self stringAtOffset: aFile];
+		if (nil == file)
+			return nil;
+
+		[files setObject: file forKey: key];
+	}
+
+	SCKSourceLocation *location = [SCKSourceLocation new];
+
+	location->file = file;
+	location->offset = anOffset;
+	return location;
+}
+
+- (NSArray *)protocolsOfRecord: (const SCKSymbolRecord *)aRecord
+{
+	const uint32_t *names = [self listAtOffset: aRecord->protocols count: aRecord->protocolCount];
+	NSMutableArray *protocols = [NSMutableArray array];
+
+	for (uint32_t i = 0; NULL != names && i < aRecord->protocolCount; i++)
+	{
+		SCKProtocol *protocol = [self componentInTable: SCKSymbolTableProtocols
+		                                         named: [self stringAtOffset: names[i]]];
+
+		if (nil != protocol)
+		{
+			[protocols addObject: protocol];
+		}
+	}
+	return protocols;
+}
+
+/**
+ * Creates a component from the attributes shared by all the records, and
+ * caches it before its children are created.
+ *
+ * Returns nil for a record without a valid name, so the malformed records
+ * are skipped instead of being inserted under a nil key.
+ */
+- (id)newComponentOfClass: (Class)aClass atIndex: (uint32_t)anIndex
+{
+	const SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+	NSString *name = [self stringAtOffset: record->name];
+
+	if (nil == name)
+		return nil;
+
+	SCKProgramComponent *component = [aClass new];
+
+	[component setName: name];
+	[component setDeclaration: [self locationWithFile: record->declarationFile offset: record->declarationOffset]];
+	[component setDefinition: [self locationWithFile: record->definitionFile offset: record->definitionOffset]];
+	if (record->commentLength > 0)
+	{
+		// Without a documentation source, the raw comment is read from the file
+		[component setCommentLocation: [self locationWithFile: record->commentFile offset: record->commentOffset]
+		                       length: record->commentLength
+		                  declaration: [component declaration]
+		                       source: nil];
+	}
+	if (SCKNone != record->typeEncoding)
+	{
+		[typeTable setTypeEncoding: [self stringAtOffset: record->typeEncoding]
+		               ofComponent: (SCKTypedProgramComponent *)component];
+	}
+	[components setObject: component forKey: [NSNumber numberWithUnsignedInt: anIndex]];
+	return component;
+}
+
+- (SCKMethod *)newMethodAtIndex: (uint32_t)anIndex parent: (SCKProgramComponent *)aParent
+{
+	SCKMethod *method = [self newComponentOfClass: [SCKMethod class] atIndex: anIndex];
+
+	if (nil == method)
+		return nil;
+
+	[method setIsClassMethod: ([self recordAtIndex: anIndex]->flags & SCKSymbolRecordIsClassMethod) != 0];
+	[method setParent: aParent];
+	return method;
+}
+
+- (SCKProperty *)newPropertyAtIndex: (uint32_t)anIndex parent: (SCKProgramComponent *)aParent
+{
+	const SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+	SCKProperty *property = [self newComponentOfClass: [SCKProperty class] atIndex: anIndex];
+
+	if (nil == property)
+		return nil;
+
+	[property setAttributes: [self stringAtOffset: record->extra]];
+	[property setIsIBOutlet: (record->flags & SCKSymbolRecordIsIBOutlet) != 0];
+	[property setParent: aParent];
+	return property;
+}
+
+static void addMethod(SCKMethod *aMethod, SCKMethodDictionary *methods)
+{
+	if (nil == aMethod)
+		return;
+
+	[methods setObject: aMethod forKey: [aMethod name]];
+	if (nil != [aMethod declaration])
+	{
+		[methods didParseDeclarationOfMethod: aMethod];
+	}
+	if (nil != [aMethod definition])
+	{
+		[methods didParseDefinitionOfMethod: aMethod];
+	}
+}
+
+- (SCKCategory *)newCategoryAtIndex: (uint32_t)anIndex parent: (SCKClass *)aClass
+{
+	const SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+	const uint32_t *children = [self listAtOffset: record->children count: record->childCount];
+	SCKCategory *category = [self newComponentOfClass: [SCKCategory class] atIndex: anIndex];
+
+	if (nil == category)
+		return nil;
+
+	[category setParent: aClass];
+	for (uint32_t i = 0; NULL != children && i < record->childCount; i++)
+	{
+		// Created with the class
+		id child = [components objectForKey: [NSNumber numberWithUnsignedInt: children[i]]];
+
+		if ([child isKindOfClass: [SCKMethod class]])
+		{
+			addMethod(child, [category methods]);
+		}
+		else if ([child isKindOfClass: [SCKProperty class]])
+		{
+			[[category properties] addObject: child];
+		}
+	}
+	[category setAdoptedProtocols: [self protocolsOfRecord: record]];
+	return category;
+}
+
+- (SCKClass *)newClassAtIndex: (uint32_t)anIndex
+{
+	const SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+	const uint32_t *children = [self listAtOffset: record->children count: record->childCount];
+	SCKClass *class = [self newComponentOfClass: [SCKClass class] atIndex: anIndex];
+
+	if (nil == class)
+		return nil;
+
+	if (SCKNone != record->extra)
+	{
+		[class setSuperclass: [self componentInTable: SCKSymbolTableClasses
+		                                       named: [self stringAtOffset: record->extra]]];
+	}
+	for (uint32_t i = 0; NULL != children && i < record->childCount; i++)
+	{
+		const SCKSymbolRecord *child = [self recordAtIndex: children[i]];
+
+		switch (NULL != child ? child->kind : 0)
+		{
+			case SCKSymbolRecordMethod:
+				addMethod([self newMethodAtIndex: children[i] parent: class], [class methods]);
+				break;
+			case SCKSymbolRecordIvar:
+			{
+				SCKIvar *ivar = [self newComponentOfClass: [SCKIvar class] atIndex: children[i]];
+
+				if (nil == ivar)
+					break;
+
+				[ivar setIsIBOutlet: (child->flags & SCKSymbolRecordIsIBOutlet) != 0];
+				[ivar setParent: class];
+				[[class ivars] addObject: ivar];
+				break;
+			}
+			case SCKSymbolRecordProperty:
+			{
+				SCKProperty *property = [self newPropertyAtIndex: children[i] parent: class];
+
+				if (nil != property)
+				{
+					[[class properties] addObject: property];
+				}
+				break;
+			}
+			case SCKSymbolRecordCategory:
+			{
+				SCKCategory *category = [self newCategoryAtIndex: children[i] parent: class];
+
+				if (nil == category)
+					break;
+
+				[[class categories] setObject: category forKey: [category name]];
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	[class setAdoptedProtocols: [self protocolsOfRecord: record]];
+	return class;
+}
+
+- (SCKProtocol *)newProtocolAtIndex: (uint32_t)anIndex
+{
+	const SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+	const uint32_t *children = [self listAtOffset: record->children count: record->childCount];
+	SCKProtocol *protocol = [self newComponentOfClass: [SCKProtocol class] atIndex: anIndex];
+
+	if (nil == protocol)
+		return nil;
+
+	for (uint32_t i = 0; NULL != children && i < record->childCount; i++)
+	{
+		const SCKSymbolRecord *child = [self recordAtIndex: children[i]];
+		BOOL isRequired = (NULL != child && (child->flags & SCKSymbolRecordIsRequired) != 0);
+
+		switch (NULL != child ? child->kind : 0)
+		{
+			case SCKSymbolRecordMethod:
+				addMethod([self newMethodAtIndex: children[i] parent: protocol],
+				          (isRequired ? [protocol requiredMethods] : [protocol optionalMethods]));
+				break;
+			case SCKSymbolRecordProperty:
+			{
+				SCKProperty *property = [self newPropertyAtIndex: children[i] parent: protocol];
+
+				if (nil != property)
+				{
+					[(isRequired ? [protocol requiredProperties] : [protocol optionalProperties]) addObject: property];
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+	[protocol setAdoptedProtocols: [self protocolsOfRecord: record]];
+	return protocol;
+}
+
+- (SCKEnumerationValue *)newEnumerationValueAtIndex: (uint32_t)anIndex
+{
+	const SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+	SCKEnumerationValue *value = [self newComponentOfClass: [SCKEnumerationValue class] atIndex: anIndex];
+
+	if (nil == value)
+		return nil;
+
+	[value setLongLongValue: record->value];
+	[value setEnumerationName: [self stringAtOffset: record->extra]];
+	return value;
+}
+
+- (SCKEnumeration *)newEnumerationAtIndex: (uint32_t)anIndex
+{
+	const SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+	const uint32_t *children = [self listAtOffset: record->children count: record->childCount];
+	SCKEnumeration *enumeration = [self newComponentOfClass: [SCKEnumeration class] atIndex: anIndex];
+
+	if (nil == enumeration)
+		return nil;
+
+	[enumeration setValues: [NSMutableDictionary dictionaryWithCapacity: record->childCount]];
+	for (uint32_t i = 0; NULL != children && i < record->childCount; i++)
+	{
+		const SCKSymbolRecord *child = [self recordAtIndex: children[i]];
+
+		if (NULL == child || child->kind != SCKSymbolRecordEnumerationValue)
+			continue;
+
+		SCKEnumerationValue *value = [self newEnumerationValueAtIndex: children[i]];
+
+		if (nil == value)
+			continue;
+
+		[value setParent: enumeration];
+		[[enumeration values] setObject: value forKey: [value name]];
+	}
+	return enumeration;
+}
+
+/**
+ * Returns the component of the record at the given index, created the first
+ * time it is requested.
+ *
+ * Nested components (e.g. methods) are created with their parent.
+ */
+- (id)componentAtIndex: (uint32_t)anIndex
+{
+	NSNumber *key = [NSNumber numberWithUnsignedInt: anIndex];
+	id component = [components objectForKey: key];
+	const SCKSymbolRecord *record = [self recordAtIndex: anIndex];
+
+	if (nil != component || NULL == record)
+		return component;
+
+	if (SCKNone != record->parent)
+	{
+		const SCKSymbolRecord *parent = [self recordAtIndex: record->parent];
+
+		// Only top-level components are parents
+		if (NULL == parent || SCKNone != parent->parent)
+			return nil;
+
+		[self componentAtIndex: record->parent];
+		return [components objectForKey: key];
+	}
+
+	switch (record->kind)
+	{
+		case SCKSymbolRecordClass:
+			return [self newClassAtIndex: anIndex];
+		case SCKSymbolRecordProtocol:
+			return [self newProtocolAtIndex: anIndex];
+		case SCKSymbolRecordFunction:
+			return [self newComponentOfClass: [SCKFunction class] atIndex: anIndex];
+		case SCKSymbolRecordGlobal:
+			return [self newComponentOfClass: [SCKGlobal class] atIndex: anIndex];
+		case SCKSymbolRecordEnumeration:
+			return [self newEnumerationAtIndex: anIndex];
+		case SCKSymbolRecordEnumerationValue:
+			return [self newEnumerationValueAtIndex: anIndex];
+		default:
+			return nil;
+	}
+}
+
+#pragma mark - Looking Up Symbols
+
+- (uint32_t)recordIndexInTable: (SCKSymbolTable)aTable named: (NSString *)aName
+{
+	const char *name = [aName UTF8String];
+
+	if (NULL == name)
+		return SCKNone;
+
+	uint32_t bucketCount = header->tableBucketCounts[aTable];
+	const uint32_t *buckets = (const uint32_t *)((const char *)[data bytes] + header->tableOffsets[aTable]);
+	uint32_t bucket = hashString(name) & (bucketCount - 1);
+
+	// A malformed table can be full, so the probe sequence is bounded
+	for (uint32_t probe = 0; probe < bucketCount && buckets[bucket] != 0; probe++)
+	{
+		const SCKSymbolRecord *record = [self recordAtIndex: buckets[bucket] - 1];
+		const char *recordName = (NULL != record ? [self UTF8StringAtOffset: record->name] : NULL);
+
+		if (NULL != recordName && strcmp(recordName, name) == 0)
+		{
+			return buckets[bucket] - 1;
+		}
+		bucket = (bucket + 1) & (bucketCount - 1);
+	}
+	return SCKNone;
+}
+
+- (id)componentInTable: (SCKSymbolTable)aTable named: (NSString *)aName
+{
+	if (SCKSymbolTableSelectors == aTable)
+	{
+		NSArray *implementors = [self implementorsOfSelector: aName];
+		return ([implementors count] > 0 ? implementors : nil);
+	}
+
+	uint32_t index = [self recordIndexInTable: aTable named: aName];
+
+	if (SCKNone == index)
+		return nil;
+
+	[lock lock];
+	id component = [self componentAtIndex: index];
+	[lock unlock];
+	return component;
+}
+
+- (NSArray *)implementorsOfSelector: (NSString *)aSelector
+{
+	const SCKSymbolRecord *record = [self recordAtIndex: [self recordIndexInTable: SCKSymbolTableSelectors
+	                                                                       named: aSelector]];
+	const uint32_t *children = (NULL != record ? [self listAtOffset: record->children count: record->childCount] : NULL);
+	NSMutableArray *implementors = [NSMutableArray array];
+
+	if (NULL == children)
+		return implementors;
+
+	[lock lock];
+	for (uint32_t i = 0; i < record->childCount; i++)
+	{
+		id implementor = [self componentAtIndex: children[i]];
+
+		if (nil != implementor)
+		{
+			[implementors addObject: implementor];
+		}
+	}
+	[lock unlock];
+	return implementors;
+}
+
+- (NSDictionary *)componentsInTable: (SCKSymbolTable)aTable
+{
+	INVALIDARG_EXCEPTION_TEST(aTable, aTable < SCKSymbolTableCount);
+	return [[SCKSymbolDatabaseDictionary alloc] initWithDatabase: self table: aTable];
+}
+
+- (NSUInteger)countOfTable: (SCKSymbolTable)aTable
+{
+	return header->tableEntryCounts[aTable];
+}
+
+- (NSArray *)namesInTable: (SCKSymbolTable)aTable
+{
+	uint32_t bucketCount = header->tableBucketCounts[aTable];
+	const uint32_t *buckets = (const uint32_t *)((const char *)[data bytes] + header->tableOffsets[aTable]);
+	NSMutableArray *names = [NSMutableArray arrayWithCapacity: header->tableEntryCounts[aTable]];
+
+	for (uint32_t i = 0; i < bucketCount; i++)
+	{
+		const SCKSymbolRecord *record = (buckets[i] != 0 ? [self recordAtIndex: buckets[i] - 1] : NULL);
+		NSString *name = (NULL != record ? [self stringAtOffset: record->name] : nil);
+
+		if (nil != name)
+		{
+			[names addObject: name];
+		}
+	}
+	return names;
+}
+
+- (NSUInteger)estimatedMemoryUsage
+{
+	[lock lock];
+	NSUInteger size = class_getInstanceSize([components class]) + [components count] * 2 * sizeof(id);
+
+	for (NSNumber *index in components)
+	{
+		// Nested components are accounted by their parent
+		if (SCKNone != [self recordAtIndex: [index unsignedIntValue]]->parent)
+			continue;
+
+		size += [[components objectForKey: index] estimatedMemoryUsage];
+	}
+	[lock unlock];
+	return size;
+}
+
+@end
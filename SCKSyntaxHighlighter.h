@@ -3,6 +3,7 @@
 
 @class NSMutableDictionary;
 @class NSMutableAttributedString;
+@class SCKMetrics;
 
 /**
  * The SCKSyntaxHighlighter class is responsible for mapping from the semantic
@@ -18,6 +19,11 @@
  * Attributes to be applied to semantic types.
  */
 @property (retain, nonatomic) NSMutableDictionary *semanticAttributes;
+/**
+ * Metrics to which the time spent in -transformString: is reported, usually 
+ * -[SCKSourceCollection metrics].  Can be nil.
+ */
+@property (retain, nonatomic) SCKMetrics *metrics;
 /**
  * Transforms a source string, replacing the semantic attributes with
  * presentation attributes.
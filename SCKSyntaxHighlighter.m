@@ -2,12 +2,12 @@
 #import <Cocoa/Cocoa.h>
 #import <EtoileFoundation/EtoileFoundation.h>
 #import "SCKTextTypes.h"
-#include <time.h>
+#import "SCKMetrics.h"
 
 static NSDictionary *noAttributes;
 
 @implementation SCKSyntaxHighlighter
-@synthesize tokenAttributes, semanticAttributes;
+@synthesize tokenAttributes, semanticAttributes, metrics;
 + (void)initialize
 {
 	noAttributes = [NSDictionary dictionary];
@@ -37,11 +37,9 @@ static NSDictionary *noAttributes;
 	return self;
 }
 
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wunused"
 - (void)transformString: (NSMutableAttributedString*)source;
 {
-	clock_t c1 = clock();
+	double start = SCKMetricsNow();
 	NSUInteger end = [source length];
 	NSUInteger i = 0;
 	NSRange r;
@@ -90,11 +88,10 @@ static NSDictionary *noAttributes;
 			               range: r];
 		}
 	} while (i < end);
-	clock_t c2 = clock();
-	//NSLog(@"Generating presentation markup took %f seconds.  .",
-//		((double)c2 - (double)c1) / (double)CLOCKS_PER_SEC);
+	[metrics recordDuration: SCKMetricsNow() - start
+	               forPhase: SCKMetricPhasePresentation
+	                   file: nil];
 }
-#pragma clang diagnostic pop
 
 @end
 
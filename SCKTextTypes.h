@@ -74,3 +74,9 @@ EMIT_STRING(kSCKDiagnosticSeverity);
  * display.
  */
 EMIT_STRING(kSCKDiagnosticText);
+/**
+ * An NSNumber unique to the diagnostic (and shared with the equal diagnostics 
+ * of the next parses), so the ranges of distinct diagnostics with the same 
+ * severity and text are not merged or confused.
+ */
+EMIT_STRING(kSCKDiagnosticToken);
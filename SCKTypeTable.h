@@ -0,0 +1,101 @@
+#import <Foundation/NSObject.h>
+
+@class NSArray, NSLock, NSMutableDictionary, NSString, SCKTypedProgramComponent;
+
+/**
+ * A single decoded Objective-C type.
+ *
+ * Types are immutable and interned by their type table, so identical types
+ * are represented by the same object and can be compared with ==.
+ */
+@interface SCKType : NSObject
+/**
+ * The encoding of the type, without type qualifiers (e.g. const or in) and
+ * offsets, e.g. @"NSString" or {_NSRange=QQ}.
+ */
+@property (nonatomic, readonly) NSString *encoding;
+/**
+ * Returns whether the type is an object type (id, a class pointer or a block).
+ */
+@property (nonatomic, readonly) BOOL isObject;
+/**
+ * The class name of an object type such as NSString *, or nil for other types
+ * and for id.
+ */
+@property (nonatomic, readonly) NSString *className;
+/**
+ * The size in bytes of a value of the type on the current platform, or 0
+ * when it is unknown (e.g. void or an incomplete structure).
+ */
+@property (nonatomic, readonly) NSUInteger size;
+@end
+
+/**
+ * A decoded type encoding, as returned by
+ * -[SCKTypedProgramComponent typeSignature].
+ *
+ * For a method or function, the signature contains the return type followed
+ * by the argument types (for a method, the receiver and the selector come
+ * first, as in NSMethodSignature). For other components, the signature
+ * contains the type of the component.
+ *
+ * For a property encoding (the attribute string that starts with T), only
+ * the property type is decoded.
+ */
+@interface SCKTypeSignature : NSObject
+/**
+ * The type encoding that was decoded.
+ */
+@property (nonatomic, readonly) NSString *encoding;
+/**
+ * The decoded SCKType objects in the order they appear in the encoding.
+ */
+@property (nonatomic, readonly) NSArray *types;
+/**
+ * The first type: the return type of a method or function, otherwise the
+ * type of the component.
+ *
+ * Returns nil if the encoding could not be decoded.
+ */
+@property (nonatomic, readonly) SCKType *type;
+/**
+ * The types that follow -type.
+ */
+@property (nonatomic, readonly) NSArray *argumentTypes;
+@end
+
+/**
+ * A table that interns the type encodings of the program components parsed
+ * by a source collection, and decodes them lazily.
+ *
+ * Identical encodings share one string and one decoded signature, and the
+ * decoded types are shared among the signatures, so a signature-based search
+ * compares types without parsing encodings again.
+ *
+ * The table can be used from several threads.
+ */
+@interface SCKTypeTable : NSObject
+/**
+ * Sets the type encoding of the component to the interned copy of the given
+ * encoding, and makes the component decode its signature with the receiver.
+ */
+- (void)setTypeEncoding: (NSString *)anEncoding ofComponent: (SCKTypedProgramComponent *)aComponent;
+/**
+ * Returns the interned copy of the given encoding.
+ */
+- (NSString *)internedEncoding: (NSString *)anEncoding;
+/**
+ * Returns the signature decoded from the given encoding, that is decoded the
+ * first time it is requested.
+ */
+- (SCKTypeSignature *)signatureForEncoding: (NSString *)anEncoding;
+/**
+ * The number of distinct encodings in the table.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+/**
+ * Returns an estimation of the memory in bytes used by the interned encodings
+ * and the decoded signatures.
+ */
+@property (nonatomic, readonly) NSUInteger estimatedMemoryUsage;
+@end
@@ -0,0 +1,328 @@
+#import "SCKTypeTable.h"
+#import "SCKIntrospection.h"
+#import <EtoileFoundation/EtoileFoundation.h>
+#include <objc/runtime.h>
+#include <ctype.h>
+#include <string.h>
+
+/** Characters of the encodings that consist of a single character. */
+static const char *simpleTypes = "cislqCISLQfdDBv*#:?tT";
+
+/**
+ * Returns the first character after the type qualifiers (const, in, out etc.).
+ */
+static const char *skipQualifiers(const char *p)
+{
+	while (*p != '\0' && strchr("rnNoORV", *p) != NULL)
+	{
+		p++;
+	}
+	return p;
+}
+
+/**
+ * Returns the first character after the type that starts at p, or NULL if the
+ * encoding is malformed.
+ */
+static const char *skipType(const char *p)
+{
+	switch (*p)
+	{
+		case '\0':
+			return NULL;
+		case '@':
+			p++;
+			if (*p == '?')
+				return p + 1;
+			if (*p == '"')
+			{
+				const char *end = strchr(p + 1, '"');
+				return (end != NULL ? end + 1 : NULL);
+			}
+			return p;
+		case '^':
+		case 'A':
+		case 'j':
+			return skipType(skipQualifiers(p + 1));
+		case 'b':
+			// Either b<size>, or b<offset><type><size> with the GNU runtime
+			p++;
+			while (isdigit(*p))
+				p++;
+			if (*p != '\0' && strchr(simpleTypes, *p) != NULL && isdigit(p[1]))
+			{
+				p++;
+				while (isdigit(*p))
+					p++;
+			}
+			return p;
+		case '[':
+			p++;
+			while (isdigit(*p))
+				p++;
+			p = skipType(skipQualifiers(p));
+			return ((p != NULL && *p == ']') ? p + 1 : NULL);
+		case '{':
+		case '(':
+		{
+			char close = (*p == '{' ? '}' : ')');
+
+			p++;
+			while (*p != '\0' && *p != '=' && *p != close)
+				p++;
+
+			if (*p == '=')
+			{
+				p++;
+				while (p != NULL && *p != close)
+				{
+					// Field names
+					if (*p == '"')
+					{
+						p = strchr(p + 1, '"');
+						if (p == NULL)
+							return NULL;
+						p++;
+						continue;
+					}
+					p = skipType(skipQualifiers(p));
+				}
+			}
+			return ((p != NULL && *p == close) ? p + 1 : NULL);
+		}
+		default:
+			return (strchr(simpleTypes, *p) != NULL ? p + 1 : NULL);
+	}
+}
+
+@implementation SCKType
+
+@synthesize encoding, isObject, className, size;
+
+- (id)initWithEncoding: (NSString *)anEncoding
+{
+	SUPERINIT;
+	const char *type = [anEncoding UTF8String];
+
+	encoding = [anEncoding copy];
+	isObject = (type[0] == '@');
+
+	if (isObject)
+	{
+		size = sizeof(id);
+		if (type[1] == '"')
+		{
+			NSString *name = [anEncoding substringWithRange: NSMakeRange(2, [anEncoding length] - 3)];
+			NSRange protocolRange = [name rangeOfString: @"<"];
+
+			if (protocolRange.location != NSNotFound)
+			{
+				name = [name substringToIndex: protocolRange.location];
+			}
+			className = ([name length] > 0 ? name : nil);
+		}
+	}
+	else if (type[0] == '^' || type[0] == '*' || type[0] == '#' || type[0] == ':')
+	{
+		size = sizeof(void *);
+	}
+	else if (type[0] != 'v' && type[0] != 'b' && strchr(type, '?') == NULL)
+	{
+		@try
+		{
+			NSGetSizeAndAlignment(type, &size, NULL);
+		}
+		@catch (NSException *exception)
+		{
+			size = 0;
+		}
+	}
+	return self;
+}
+
+- (NSString *)description
+{
+	return encoding;
+}
+
+@end
+
+@implementation SCKTypeSignature
+
+@synthesize encoding, types;
+
+- (id)initWithEncoding: (NSString *)anEncoding types: (NSArray *)someTypes
+{
+	SUPERINIT;
+	encoding = anEncoding;
+	types = [someTypes copy];
+	return self;
+}
+
+- (SCKType *)type
+{
+	return ([types count] > 0 ? [types objectAtIndex: 0] : nil);
+}
+
+- (NSArray *)argumentTypes
+{
+	if ([types count] < 2)
+		return [NSArray array];
+
+	return [types subarrayWithRange: NSMakeRange(1, [types count] - 1)];
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat: @"%@ %@", [super description], types];
+}
+
+@end
+
+@implementation SCKTypeTable
+{
+	NSLock *lock;
+	/** Interned encodings. */
+	NSMutableSet *encodings;
+	/** Decoded signatures by encoding. */
+	NSMutableDictionary *signatures;
+	/** Decoded types by single type encoding. */
+	NSMutableDictionary *types;
+}
+
+- (id)init
+{
+	SUPERINIT;
+	lock = [NSLock new];
+	encodings = [NSMutableSet new];
+	signatures = [NSMutableDictionary new];
+	types = [NSMutableDictionary new];
+	return self;
+}
+
+- (NSString *)unlockedInternedEncoding: (NSString *)anEncoding
+{
+	NSString *encoding = [encodings member: anEncoding];
+
+	if (nil == encoding)
+	{
+		encoding = [anEncoding copy];
+		[encodings addObject: encoding];
+	}
+	return encoding;
+}
+
+- (NSString *)internedEncoding: (NSString *)anEncoding
+{
+	if (nil == anEncoding)
+		return nil;
+
+	[lock lock];
+	NSString *encoding = [self unlockedInternedEncoding: anEncoding];
+	[lock unlock];
+	return encoding;
+}
+
+- (void)setTypeEncoding: (NSString *)anEncoding ofComponent: (SCKTypedProgramComponent *)aComponent
+{
+	[aComponent setTypeEncoding: [self internedEncoding: anEncoding]];
+	[aComponent setTypeTable: self];
+}
+
+- (SCKType *)typeForEncoding: (const char *)start length: (NSUInteger)length
+{
+	NSString *encoding = [[NSString alloc] initWithBytes: start
+	                                              length: length
+	                                            encoding: NSUTF8StringEncoding];
+	SCKType *type = [types objectForKey: encoding];
+
+	if (nil == type)
+	{
+		type = [[SCKType alloc] initWithEncoding: encoding];
+		[types setObject: type forKey: encoding];
+	}
+	return type;
+}
+
+- (SCKTypeSignature *)decodeEncoding: (NSString *)anEncoding
+{
+	NSMutableArray *decodedTypes = [NSMutableArray array];
+	const char *p = [anEncoding UTF8String];
+	// Property attributes start with the type after T
+	BOOL isProperty = (p[0] == 'T');
+
+	if (isProperty)
+	{
+		p++;
+	}
+
+	while (*p != '\0')
+	{
+		const char *start = skipQualifiers(p);
+		const char *end = skipType(start);
+
+		if (NULL == end)
+			break;
+
+		[decodedTypes addObject: [self typeForEncoding: start length: end - start]];
+		if (isProperty)
+			break;
+
+		// Skip the argument offsets
+		p = end;
+		while (*p == '-' || isdigit(*p))
+			p++;
+	}
+	return [[SCKTypeSignature alloc] initWithEncoding: anEncoding types: decodedTypes];
+}
+
+- (SCKTypeSignature *)signatureForEncoding: (NSString *)anEncoding
+{
+	if (nil == anEncoding)
+		return nil;
+
+	[lock lock];
+	SCKTypeSignature *signature = [signatures objectForKey: anEncoding];
+
+	if (nil == signature)
+	{
+		signature = [self decodeEncoding: [self unlockedInternedEncoding: anEncoding]];
+		[signatures setObject: signature forKey: [signature encoding]];
+	}
+	[lock unlock];
+	return signature;
+}
+
+- (NSUInteger)count
+{
+	[lock lock];
+	NSUInteger count = [encodings count];
+	[lock unlock];
+	return count;
+}
+
+- (NSUInteger)estimatedMemoryUsage
+{
+	[lock lock];
+	NSUInteger size = class_getInstanceSize([encodings class]) + [encodings count] * 2 * sizeof(id)
+		+ class_getInstanceSize([signatures class]) + [signatures count] * 2 * sizeof(id)
+		+ class_getInstanceSize([types class]) + [types count] * 2 * sizeof(id);
+
+	for (NSString *encoding in encodings)
+	{
+		size += class_getInstanceSize([encoding class]) + [encoding length] * sizeof(unichar);
+	}
+	for (SCKTypeSignature *signature in [signatures objectEnumerator])
+	{
+		size += class_getInstanceSize([SCKTypeSignature class]) + [[signature types] count] * sizeof(id);
+	}
+	for (SCKType *type in [types objectEnumerator])
+	{
+		size += class_getInstanceSize([SCKType class])
+			+ class_getInstanceSize([[type encoding] class]) + [[type encoding] length] * sizeof(unichar);
+	}
+	[lock unlock];
+	return size;
+}
+
+@end
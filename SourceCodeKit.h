@@ -1,7 +1,17 @@
 #import "SCKSourceCollection.h"
 #import "SCKCodeCompletionResult.h"
+#import "SCKDiagnostic.h"
+#import "SCKIndexWorkerPool.h"
+#import "SCKIndexingScheduler.h"
+#import "SCKLexer.h"
+#import "SCKMemoryUsage.h"
+#import "SCKMetrics.h"
+#import "SCKOccurrenceIndex.h"
+#import "SCKProject.h"
 #import "SCKSourceFile.h"
 #import "SCKClangSourceFile.h"
+#import "SCKSymbolDatabase.h"
 #import "SCKSyntaxHighlighter.h"
 #import "SCKTextTypes.h"
+#import "SCKTypeTable.h"
 #import "SCKIntrospection.h"
@@ -34,6 +34,7 @@ enum enum2 {value4, value5, value6};
 @end
 
 
+/** Dummy Class Description */
 @interface A : NSObject
 {
 	NSString *text;
@@ -70,7 +71,7 @@ enum enum2 {value4, value5, value6};
 @end
 
 
-@interface C : B
+@interface C : B <Protocol3>
 {
 	NSString *ivar1;
 	IBOutlet NSString *ivar2;
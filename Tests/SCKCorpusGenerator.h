@@ -0,0 +1,65 @@
+#import <Foundation/Foundation.h>
+
+/**
+ * Generates synthetic Objective-C source trees to exercise SourceCodeKit at
+ * scale.
+ *
+ * The generated corpus contains:
+ *
+ * - classes named SCKGenClass0, SCKGenClass1 etc. with ivars, properties and
+ *   methods; each class inherits from the previous one, except every
+ *   -hierarchyDepth classes that inherit from NSObject
+ * - categories named SCKGenClassNCategoryM with extra methods
+ * - a chain of protocols where each protocol adopts the previous one, and that
+ *   the classes which inherit from NSObject adopt through the last protocol
+ * - an enumeration with many values and many macros in a common header
+ */
+@interface SCKCorpusGenerator : NSObject
+/** Number of classes.  By default, 10. */
+@property (nonatomic, assign) NSUInteger classCount;
+/** Number of methods declared and implemented per class.  By default, 10. */
+@property (nonatomic, assign) NSUInteger methodCount;
+/** Number of ivars per class.  By default, 5. */
+@property (nonatomic, assign) NSUInteger ivarCount;
+/** Number of properties per class.  By default, 2. */
+@property (nonatomic, assign) NSUInteger propertyCount;
+/** Number of categories per class.  By default, 1. */
+@property (nonatomic, assign) NSUInteger categoryCount;
+/** Number of methods per category.  By default, 3. */
+@property (nonatomic, assign) NSUInteger categoryMethodCount;
+/** Maximum length of the superclass chains.  By default, 10. */
+@property (nonatomic, assign) NSUInteger hierarchyDepth;
+/** Length of the protocol adoption chain.  By default, 5. */
+@property (nonatomic, assign) NSUInteger protocolDepth;
+/** Number of values in the generated enumeration.  By default, 100. */
+@property (nonatomic, assign) NSUInteger enumValueCount;
+/** Number of macros in the common header.  By default, 100. */
+@property (nonatomic, assign) NSUInteger macroCount;
+/**
+ * Whether the whole corpus is generated into a single implementation file
+ * rather than a header and an implementation file per class.  By default, NO.
+ */
+@property (nonatomic, assign) BOOL singleFile;
+
+/**
+ * Writes the corpus into the directory (created if needed) and returns the
+ * paths of the generated files.
+ */
+- (NSArray*)writeCorpusToDirectory: (NSString*)aDirectory;
+/**
+ * Returns a new unique temporary directory path to write a corpus into.
+ */
++ (NSString*)temporaryDirectory;
+
+- (NSString*)classNameAtIndex: (NSUInteger)i;
+- (NSString*)superclassNameForClassAtIndex: (NSUInteger)i;
+/**
+ * Returns the name of the protocol adopted by the class, or nil if it adopts
+ * none.
+ */
+- (NSString*)adoptedProtocolNameForClassAtIndex: (NSUInteger)i;
+- (NSString*)selectorAtIndex: (NSUInteger)j;
+- (NSString*)ivarNameAtIndex: (NSUInteger)j;
+- (NSString*)protocolNameAtIndex: (NSUInteger)k;
+- (NSString*)enumValueNameAtIndex: (NSUInteger)k;
+@end
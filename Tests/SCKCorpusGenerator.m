@@ -0,0 +1,251 @@
+#import "SCKCorpusGenerator.h"
+#import <EtoileFoundation/EtoileFoundation.h>
+
+@implementation SCKCorpusGenerator
+
+@synthesize classCount, methodCount, ivarCount, propertyCount, categoryCount,
+	categoryMethodCount, hierarchyDepth, protocolDepth, enumValueCount, macroCount,
+	singleFile;
+
++ (NSString*)temporaryDirectory
+{
+	NSString *name = [NSString stringWithFormat: @"SCKCorpus-%@",
+		[[NSProcessInfo processInfo] globallyUniqueString]];
+	return [NSTemporaryDirectory() stringByAppendingPathComponent: name];
+}
+
+- (id)init
+{
+	SUPERINIT;
+	classCount = 10;
+	methodCount = 10;
+	ivarCount = 5;
+	propertyCount = 2;
+	categoryCount = 1;
+	categoryMethodCount = 3;
+	hierarchyDepth = 10;
+	protocolDepth = 5;
+	enumValueCount = 100;
+	macroCount = 100;
+	return self;
+}
+
+- (NSString*)classNameAtIndex: (NSUInteger)i
+{
+	return [NSString stringWithFormat: @"SCKGenClass%lu", (unsigned long)i];
+}
+
+- (NSString*)superclassNameForClassAtIndex: (NSUInteger)i
+{
+	if (hierarchyDepth == 0 || i % hierarchyDepth == 0)
+	{
+		return @"NSObject";
+	}
+	return [self classNameAtIndex: i - 1];
+}
+
+- (NSString*)adoptedProtocolNameForClassAtIndex: (NSUInteger)i
+{
+	if (protocolDepth == 0 || ![[self superclassNameForClassAtIndex: i] isEqualToString: @"NSObject"])
+	{
+		return nil;
+	}
+	return [self protocolNameAtIndex: protocolDepth - 1];
+}
+
+- (NSString*)selectorAtIndex: (NSUInteger)j
+{
+	return [NSString stringWithFormat: @"method%luWithObject:count:", (unsigned long)j];
+}
+
+- (NSString*)ivarNameAtIndex: (NSUInteger)j
+{
+	return [NSString stringWithFormat: @"ivar%lu", (unsigned long)j];
+}
+
+- (NSString*)protocolNameAtIndex: (NSUInteger)k
+{
+	return [NSString stringWithFormat: @"SCKGenProtocol%lu", (unsigned long)k];
+}
+
+- (NSString*)enumValueNameAtIndex: (NSUInteger)k
+{
+	return [NSString stringWithFormat: @"SCKGenValue%lu", (unsigned long)k];
+}
+
+- (NSString*)categoryNameAtIndex: (NSUInteger)c ofClassAtIndex: (NSUInteger)i
+{
+	return [NSString stringWithFormat: @"%@Category%lu", [self classNameAtIndex: i], (unsigned long)c];
+}
+
+- (void)appendCommonDeclarationsTo: (NSMutableString*)str
+{
+	for (NSUInteger k = 0; k < macroCount; k++)
+	{
+		[str appendFormat: @"#define SCK_GEN_MACRO%lu(x) ((x) + %lu)\n", (unsigned long)k, (unsigned long)k];
+	}
+	[str appendString: @"\nenum SCKGenEnumeration\n{\n"];
+	for (NSUInteger k = 0; k < enumValueCount; k++)
+	{
+		[str appendFormat: @"\t%@ = %lu,\n", [self enumValueNameAtIndex: k], (unsigned long)k];
+	}
+	[str appendString: @"};\n\n"];
+
+	for (NSUInteger k = 0; k < protocolDepth; k++)
+	{
+		NSString *adopted = (k == 0 ? @"NSObject" : [self protocolNameAtIndex: k - 1]);
+
+		[str appendFormat: @"@protocol %@ <%@>\n- (void)protocolMethod%lu;\n@optional\n"
+			"- (id)optionalProtocolMethod%lu;\n@end\n\n",
+			[self protocolNameAtIndex: k], adopted, (unsigned long)k, (unsigned long)k];
+	}
+}
+
+- (void)appendInterfaceOfClassAtIndex: (NSUInteger)i to: (NSMutableString*)str
+{
+	NSString *className = [self classNameAtIndex: i];
+	NSString *protocolName = [self adoptedProtocolNameForClassAtIndex: i];
+	NSString *protocolList = (nil != protocolName ? [NSString stringWithFormat: @" <%@>", protocolName] : @"");
+
+	[str appendFormat: @"@interface %@ : %@%@\n{\n", className, [self superclassNameForClassAtIndex: i], protocolList];
+	for (NSUInteger j = 0; j < ivarCount; j++)
+	{
+		[str appendFormat: @"\tid %@;\n", [self ivarNameAtIndex: j]];
+	}
+	[str appendString: @"}\n\n"];
+	for (NSUInteger j = 0; j < propertyCount; j++)
+	{
+		[str appendFormat: @"@property (nonatomic, retain) id property%lu;\n", (unsigned long)j];
+	}
+	for (NSUInteger j = 0; j < methodCount; j++)
+	{
+		[str appendFormat: @"- (int)method%luWithObject: (id)anObject count: (int)aCount;\n", (unsigned long)j];
+	}
+	[str appendString: @"@end\n\n"];
+
+	for (NSUInteger c = 0; c < categoryCount; c++)
+	{
+		[str appendFormat: @"@interface %@ (%@)\n", className, [self categoryNameAtIndex: c ofClassAtIndex: i]];
+		for (NSUInteger j = 0; j < categoryMethodCount; j++)
+		{
+			[str appendFormat: @"- (void)category%luMethod%lu;\n", (unsigned long)c, (unsigned long)j];
+		}
+		[str appendString: @"@end\n\n"];
+	}
+}
+
+- (void)appendImplementationOfClassAtIndex: (NSUInteger)i to: (NSMutableString*)str
+{
+	NSString *className = [self classNameAtIndex: i];
+
+	[str appendFormat: @"@implementation %@\n\n", className];
+	for (NSUInteger j = 0; j < propertyCount; j++)
+	{
+		[str appendFormat: @"@synthesize property%lu;\n", (unsigned long)j];
+	}
+	if (nil != [self adoptedProtocolNameForClassAtIndex: i])
+	{
+		for (NSUInteger k = 0; k < protocolDepth; k++)
+		{
+			[str appendFormat: @"- (void)protocolMethod%lu\n{\n}\n", (unsigned long)k];
+		}
+	}
+	for (NSUInteger j = 0; j < methodCount; j++)
+	{
+		NSString *initialValue = (macroCount > 0 ? [NSString stringWithFormat:
+			@"SCK_GEN_MACRO%lu(aCount)", (unsigned long)(j % macroCount)] : @"aCount");
+		NSString *defaultValue = (enumValueCount > 0 ?
+			[self enumValueNameAtIndex: j % enumValueCount] : @"0");
+
+		[str appendFormat: @"\n- (int)method%luWithObject: (id)anObject count: (int)aCount\n{\n"
+			"\tint total = %@;\n"
+			"\tfor (int k = 0; k < aCount; k++)\n\t{\n\t\ttotal += k * %lu;\n\t}\n"
+			"\treturn (anObject != nil ? total : %@);\n}\n",
+			(unsigned long)j, initialValue, (unsigned long)j, defaultValue];
+	}
+	[str appendString: @"\n@end\n\n"];
+
+	for (NSUInteger c = 0; c < categoryCount; c++)
+	{
+		[str appendFormat: @"@implementation %@ (%@)\n", className, [self categoryNameAtIndex: c ofClassAtIndex: i]];
+		for (NSUInteger j = 0; j < categoryMethodCount; j++)
+		{
+			[str appendFormat: @"- (void)category%luMethod%lu\n{\n}\n", (unsigned long)c, (unsigned long)j];
+		}
+		[str appendString: @"@end\n\n"];
+	}
+}
+
+- (void)writeString: (NSString*)aString toPath: (NSString*)aPath
+{
+	BOOL written = [aString writeToFile: aPath
+	                         atomically: NO
+	                           encoding: NSUTF8StringEncoding
+	                              error: NULL];
+	ETAssert(written);
+}
+
+- (NSArray*)writeCorpusToDirectory: (NSString*)aDirectory
+{
+	NSMutableArray *paths = [NSMutableArray array];
+
+	[[NSFileManager defaultManager] createDirectoryAtPath: aDirectory
+	                          withIntermediateDirectories: YES
+	                                           attributes: nil
+	                                                error: NULL];
+
+	if (singleFile)
+	{
+		NSMutableString *str = [NSMutableString stringWithString: @"#import <Foundation/NSObject.h>\n\n"];
+		NSString *path = [aDirectory stringByAppendingPathComponent: @"SCKGenCorpus.m"];
+
+		[self appendCommonDeclarationsTo: str];
+		for (NSUInteger i = 0; i < classCount; i++)
+		{
+			[self appendInterfaceOfClassAtIndex: i to: str];
+		}
+		for (NSUInteger i = 0; i < classCount; i++)
+		{
+			[self appendImplementationOfClassAtIndex: i to: str];
+		}
+		[self writeString: str toPath: path];
+		[paths addObject: path];
+		return paths;
+	}
+
+	NSMutableString *common = [NSMutableString stringWithString: @"#import <Foundation/NSObject.h>\n\n"];
+	NSString *commonPath = [aDirectory stringByAppendingPathComponent: @"SCKGenCommon.h"];
+
+	[self appendCommonDeclarationsTo: common];
+	[self writeString: common toPath: commonPath];
+	[paths addObject: commonPath];
+
+	for (NSUInteger i = 0; i < classCount; i++)
+	{
+		NSString *className = [self classNameAtIndex: i];
+		NSString *superclassName = [self superclassNameForClassAtIndex: i];
+		NSMutableString *header = [NSMutableString stringWithString: @"#import \"SCKGenCommon.h\"\n"];
+		NSMutableString *implementation = [NSMutableString stringWithFormat: @"#import \"%@.h\"\n\n", className];
+
+		if (![superclassName isEqualToString: @"NSObject"])
+		{
+			[header appendFormat: @"#import \"%@.h\"\n", superclassName];
+		}
+		[header appendString: @"\n"];
+		[self appendInterfaceOfClassAtIndex: i to: header];
+		[self appendImplementationOfClassAtIndex: i to: implementation];
+
+		NSString *headerPath = [aDirectory stringByAppendingPathComponent:
+			[className stringByAppendingPathExtension: @"h"]];
+		NSString *implementationPath = [aDirectory stringByAppendingPathComponent:
+			[className stringByAppendingPathExtension: @"m"]];
+
+		[self writeString: header toPath: headerPath];
+		[self writeString: implementation toPath: implementationPath];
+		[paths addObject: headerPath];
+		[paths addObject: implementationPath];
+	}
+	return paths;
+}
+
+@end
@@ -1,10 +1,42 @@
 #import "TestCommon.h"
+#import <Cocoa/Cocoa.h>
 #import "SCKClangSourceFile.h"
+#import "SCKDiagnostic.h"
 #import "SCKIntrospection.h"
+#import "SCKMemoryUsage.h"
+#import "SCKMetrics.h"
+#import "SCKTextTypes.h"
+#import "SCKTypeTable.h"
+#import "SCKIndexWorkerPool.h"
 
 @interface TestClangParsing : TestCommon
 @end
 
+/**
+ * Documentation source that can't parse comments, but holds unsaved contents.
+ */
+@interface TestUnsavedDocumentationSource : NSObject <SCKDocumentationSource>
+@property (nonatomic, retain) NSData *contents;
+@end
+
+@implementation TestUnsavedDocumentationSource
+
+@synthesize contents;
+
+- (NSAttributedString *)documentationForCommentAtLocation: (SCKSourceLocation *)aCommentLocation
+                                                   length: (NSUInteger)aLength
+                                              declaration: (SCKSourceLocation *)aDeclarationLocation
+{
+	return nil;
+}
+
+- (NSData *)contentsOfFile: (NSString *)aPath
+{
+	return contents;
+}
+
+@end
+
 @implementation TestClangParsing
 
 static SCKSourceCollection *sourceCollection = nil;
@@ -85,7 +117,9 @@ static SCKSourceCollection *sourceCollection = nil;
 	UKStringsEqual(@"NSObject", [[classA superclass] name]);
 	UKObjectsEqual([[classB superclass] name], [classA name]);
 
-	// FIXME:UKStringsEqual(@"Dummy Class Description", [[class documentation] string]);
+	UKStringsEqual(@"Dummy Class Description", [[[classA documentation] string]
+		stringByTrimmingCharactersInSet: [NSCharacterSet whitespaceAndNewlineCharacterSet]]);
+	UKNil([classB documentation]);
 	
 	UKStringsEqual(@"AB.h", [[[classA declaration] file] lastPathComponent]);
 	UKTrue([[function2 declaration] offset] < [[classA declaration] offset]);
@@ -96,6 +130,20 @@ static SCKSourceCollection *sourceCollection = nil;
 	UKTrue([[classB definition] offset] > [[classA definition] offset]);
 }
 
+- (void)testRawCommentFromUnsavedContents
+{
+	TestUnsavedDocumentationSource *source = [TestUnsavedDocumentationSource new];
+	SCKSourceLocation *commentLocation = [SCKSourceLocation new];
+	SCKFunction *function = [SCKFunction new];
+
+	[source setContents: [@"int /** Unsaved comment */ x;" dataUsingEncoding: NSUTF8StringEncoding]];
+	commentLocation->file = @"/nonexistent/Unsaved.h";
+	commentLocation->offset = 4;
+	[function setCommentLocation: commentLocation length: 22 declaration: nil source: source];
+
+	UKStringsEqual(@"Unsaved comment", [[function documentation] string]);
+}
+
 - (void)testProtocol
 {
 	SCKProtocol *protocol1 = [self parsedProtocolForName: @"Protocol1"];
@@ -120,6 +168,168 @@ static SCKSourceCollection *sourceCollection = nil;
 	UKTrue([[protocol3 definition] offset] > [[protocol1 definition] offset]);
 }
 
+- (void)testClassHierarchy
+{
+	SCKClass *classA = [self parsedClassForName: @"A"];
+	SCKClass *classB = [self parsedClassForName: @"B"];
+	SCKClass *classC = [self parsedClassForName: @"C"];
+
+	UKObjectsEqual(A(classB), [classA subclasses]);
+	UKObjectsEqual(A(classC), [classB subclasses]);
+	UKObjectsEqual(A(classB, classC), [classA allSubclasses]);
+	UKObjectsEqual([NSArray array], [classC allSubclasses]);
+	UKTrue([[[classA superclass] subclasses] containsObject: classA]);
+}
+
+- (void)testProtocolConformance
+{
+	SCKClass *classB = [self parsedClassForName: @"B"];
+	SCKClass *classC = [self parsedClassForName: @"C"];
+	SCKProtocol *protocol1 = [self parsedProtocolForName: @"Protocol1"];
+	SCKProtocol *protocol2 = [self parsedProtocolForName: @"Protocol2"];
+	SCKProtocol *protocol3 = [self parsedProtocolForName: @"Protocol3"];
+
+	UKObjectsEqual(A(protocol3), [classC adoptedProtocols]);
+	UKObjectsEqual(A(protocol1, protocol2), [protocol3 adoptedProtocols]);
+	UKObjectsEqual(A(protocol3), [protocol1 adoptingComponents]);
+	UKObjectsEqual(A(classC), [protocol3 adoptingComponents]);
+
+	UKTrue([[classC allAdoptedProtocols] containsObject: protocol1]);
+	UKTrue([[classC allAdoptedProtocols] containsObject: protocol2]);
+	UKFalse([[classB allAdoptedProtocols] containsObject: protocol3]);
+	UKObjectsEqual(A(classC), [protocol1 allConformingClasses]);
+	UKObjectsEqual(A(classC), [protocol3 allConformingClasses]);
+}
+
+- (void)testImplementorsOfSelector
+{
+	SCKClass *classA = [self parsedClassForName: @"A"];
+	SCKProtocol *protocol1 = [self parsedProtocolForName: @"Protocol1"];
+
+	UKObjectsEqual(A(classA), [sourceCollection implementorsOfSelector: @"wakeUpAtDate:"]);
+	UKObjectsEqual(A([[classA categories] objectForKey: @"AExtension"]),
+		[sourceCollection implementorsOfSelector: @"methodInCategory"]);
+	UKObjectsEqual(A(protocol1), [sourceCollection implementorsOfSelector: @"hi"]);
+	UKObjectsEqual([NSArray array], [sourceCollection implementorsOfSelector: @"unknownSelector:"]);
+}
+
+- (void)testMethodResolution
+{
+	SCKClass *classA = [self parsedClassForName: @"A"];
+	SCKClass *classC = [self parsedClassForName: @"C"];
+	SCKCategory *category = [[classA categories] objectForKey: @"AExtension"];
+
+	UKObjectsSame([[classA methods] objectForKey: @"wakeUpAtDate:"],
+		[classC resolvedMethodForSelector: @"wakeUpAtDate:"]);
+	UKObjectsSame([[category methods] objectForKey: @"methodInCategory"],
+		[classC resolvedMethodForSelector: @"methodInCategory"]);
+	UKObjectsSame([[classC methods] objectForKey: @"hello"],
+		[classC resolvedMethodForSelector: @"hello"]);
+	UKNil([classA resolvedMethodForSelector: @"hello"]);
+	UKObjectsSame([[classA methods] objectForKey: @"sleepNow"],
+		[classC resolvedMethodForSelector: @"sleepNow" isClassMethod: YES]);
+	UKNil([classC resolvedMethodForSelector: @"sleepNow"]);
+	UKNil([classC resolvedMethodForSelector: @"hello" isClassMethod: YES]);
+}
+
+- (void)testResolvedMethodInvalidation
+{
+	SCKClass *root = [SCKClass new];
+	SCKClass *subclass = [SCKClass new];
+	SCKMethod *method = [SCKMethod new];
+
+	[method setName: @"run"];
+	[subclass setSuperclass: root];
+	UKNil([subclass resolvedMethodForSelector: @"run"]);
+
+	[[root methods] setObject: method forKey: @"run"];
+	UKNil([subclass resolvedMethodForSelector: @"run"]);
+
+	[root invalidateResolvedMethods];
+	UKObjectsSame(method, [subclass resolvedMethodForSelector: @"run"]);
+
+	[subclass setSuperclass: nil];
+	UKNil([subclass resolvedMethodForSelector: @"run"]);
+}
+
+- (void)testResolvedMethodInvalidationKeepsUnrelatedClasses
+{
+	SCKClass *root = [SCKClass new];
+	SCKClass *unrelated = [SCKClass new];
+	SCKMethod *method = [SCKMethod new];
+
+	[method setName: @"run"];
+	UKNil([unrelated resolvedMethodForSelector: @"run"]);
+
+	/* Not invalidated, so the cached result is still returned */
+	[[unrelated methods] setObject: method forKey: @"run"];
+	[root invalidateResolvedMethods];
+	UKNil([unrelated resolvedMethodForSelector: @"run"]);
+
+	[unrelated invalidateResolvedMethods];
+	UKObjectsSame(method, [unrelated resolvedMethodForSelector: @"run"]);
+}
+
+- (void)testResolvedMethodInHierarchyCycle
+{
+	SCKClass *a = [SCKClass new];
+	SCKClass *b = [SCKClass new];
+
+	[a setSuperclass: b];
+	[b setSuperclass: a];
+	UKNil([a resolvedMethodForSelector: @"run"]);
+	UKNil([a resolvedMethodForSelector: @"run"]);
+}
+
+- (void)testTypeSignature
+{
+	SCKClass *classA = [self parsedClassForName: @"A"];
+	SCKClass *classB = [self parsedClassForName: @"B"];
+	SCKClass *classC = [self parsedClassForName: @"C"];
+	SCKTypeSignature *sleepLater = [[[classA methods] objectForKey: @"sleepLater:"] typeSignature];
+	SCKProperty *button = [[classB properties] firstObject];
+	SCKIvar *ivar1 = [classC ivarForName: @"ivar1"];
+	SCKIvar *ivar3 = [classC ivarForName: @"ivar3"];
+
+	UKStringsEqual(@"v", [[sleepLater type] encoding]);
+	UKIntsEqual(3, [[sleepLater argumentTypes] count]);
+	UKTrue([[[sleepLater argumentTypes] firstObject] isObject]);
+	UKIntsEqual(sizeof(NSUInteger), [[[sleepLater argumentTypes] lastObject] size]);
+
+	UKStringsEqual(@"NSButton", [[[button typeSignature] type] className]);
+	UKTrue([[[button typeSignature] type] isObject]);
+	UKIntsEqual(1, [[[button typeSignature] types] count]);
+
+	/* Identical encodings are interned */
+	UKObjectsSame([ivar1 typeEncoding], [ivar3 typeEncoding]);
+	UKObjectsSame([ivar1 typeSignature], [ivar3 typeSignature]);
+}
+
+- (void)testTypeTable
+{
+	SCKTypeTable *table = [SCKTypeTable new];
+	SCKTypeSignature *signature = [table signatureForEncoding: @"{_NSRange=QQ}16@0:8"];
+
+	UKIntsEqual(3, [[signature types] count]);
+	UKStringsEqual(@"{_NSRange=QQ}", [[signature type] encoding]);
+	UKIntsEqual(16, [[signature type] size]);
+	UKObjectsSame(signature, [table signatureForEncoding: @"{_NSRange=QQ}16@0:8"]);
+	UKObjectsSame([[signature argumentTypes] firstObject],
+	              [[[table signatureForEncoding: @"v16@0:8"] argumentTypes] firstObject]);
+}
+
+- (void)testTypeTableBitfields
+{
+	SCKTypeTable *table = [SCKTypeTable new];
+	SCKTypeSignature *gnuSignature = [table signatureForEncoding: @"v20@0:8{Flags=b0I3b3I5i}16"];
+	SCKTypeSignature *appleSignature = [table signatureForEncoding: @"v20@0:8{Flags=b3b5i}16"];
+
+	UKIntsEqual(4, [[gnuSignature types] count]);
+	UKStringsEqual(@"{Flags=b0I3b3I5i}", [[[gnuSignature types] lastObject] encoding]);
+	UKIntsEqual(4, [[appleSignature types] count]);
+	UKStringsEqual(@"{Flags=b3b5i}", [[[appleSignature types] lastObject] encoding]);
+}
+
 // NOTE: libclang versions prior to 21 parse all protocol methods as required.
 - (void)testMethodInProtocol
 {
@@ -310,6 +520,57 @@ static SCKSourceCollection *sourceCollection = nil;
 	UKTrue([[classB definition] offset] > [[sleepNow definition] offset]);
 }
 
+- (void)testMethodOrder
+{
+	SCKClass *classA = [self parsedClassForName: @"A"];
+	NSArray *selectors = A(@"wakeUpAtDate:", @"sleepLater:", @"sleepNow");
+	BOOL (^isExplicitMethod)(id) = ^ (id method)
+	{
+		return [selectors containsObject: [method name]];
+	};
+	NSArray *declaredMethods = [[[classA methods] methodsInDeclarationOrder]
+		filteredCollectionWithBlock: isExplicitMethod];
+	NSArray *definedMethods = [[[classA methods] methodsInDefinitionOrder]
+		filteredCollectionWithBlock: isExplicitMethod];
+
+	UKObjectsEqual(selectors, (id)[[declaredMethods mappedCollection] name]);
+	UKObjectsEqual(selectors, (id)[[definedMethods mappedCollection] name]);
+	UKIntsEqual([[classA methods] count], [[[classA methods] orderedMethods] count]);
+	UKObjectsEqual(A(@"methodInCategory"),
+		(id)[[[[[classA categories] objectForKey: @"AExtension"] methods] methodsInDeclarationOrder] mappedCollection] name]);
+}
+
+- (void)testMethodDictionary
+{
+	SCKMethodDictionary *methods = [SCKMethodDictionary new];
+	NSMutableArray *insertedMethods = [NSMutableArray array];
+
+	for (int i = 0; i < 20; i++)
+	{
+		SCKMethod *method = [SCKMethod new];
+
+		[method setName: [NSString stringWithFormat: @"method%d", i]];
+		[methods setObject: method forKey: [method name]];
+		[insertedMethods addObject: method];
+	}
+	[methods didParseDeclarationOfMethod: [insertedMethods objectAtIndex: 3]];
+	[methods didParseDeclarationOfMethod: [insertedMethods objectAtIndex: 1]];
+	[methods removeObjectForKey: @"method2"];
+	[methods removeObjectForKey: @"method1"];
+
+	UKIntsEqual(18, [methods count]);
+	UKNil([methods objectForKey: @"method2"]);
+	UKObjectsSame([insertedMethods objectAtIndex: 19], [methods objectForKey: @"method19"]);
+	UKObjectsEqual(A(@"method0", @"method3"), [[methods allKeys] subarrayWithRange: NSMakeRange(0, 2)]);
+	UKObjectsEqual(A([insertedMethods objectAtIndex: 3]), [methods methodsInDeclarationOrder]);
+
+	[methods setObject: [insertedMethods objectAtIndex: 2] forKey: @"method2"];
+
+	UKIntsEqual(19, [methods count]);
+	UKObjectsSame([insertedMethods objectAtIndex: 2], [methods objectForKey: @"method2"]);
+	UKStringsEqual(@"method2", [[methods allKeys] lastObject]);
+}
+
 - (void)testIVar
 {
 	SCKClass *classC = [self parsedClassForName: @"C"];
@@ -435,4 +696,766 @@ static SCKSourceCollection *sourceCollection = nil;
 	UKTrue([[kGlobal2 definition] offset] > [[kGlobal1 definition] offset]);
 }
 
+- (void)testReparseUnchangedFile
+{
+	SCKClangSourceFile *sourceFile = [self parsedFileForName: @"AB.m"];
+	NSUInteger version = [sourceFile translationUnitVersion];
+
+	[sourceFile reparse];
+
+	UKIntsEqual(version, [sourceFile translationUnitVersion]);
+}
+
+- (void)testReparseHeaderModifiedInSameSecond
+{
+	NSFileManager *fm = [NSFileManager defaultManager];
+	NSString *dir = [NSTemporaryDirectory() stringByAppendingPathComponent: @"TestRacyHeader"];
+	NSString *headerPath = [dir stringByAppendingPathComponent: @"Racy.h"];
+	NSString *path = [dir stringByAppendingPathComponent: @"Racy.m"];
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+
+	[fm createDirectoryAtPath: dir withIntermediateDirectories: YES attributes: nil error: NULL];
+	[@"int racyA;\n" writeToFile: headerPath atomically: NO encoding: NSUTF8StringEncoding error: NULL];
+	[@"#include \"Racy.h\"\nint racyMain;\n" writeToFile: path atomically: NO encoding: NSUTF8StringEncoding error: NULL];
+	/* Not older than the parse, as if it was written in the same second */
+	NSDate *modificationDate = [NSDate dateWithTimeIntervalSinceNow: 10];
+	[fm setAttributes: D(modificationDate, NSFileModificationDate) ofItemAtPath: headerPath error: NULL];
+
+	SCKClangSourceFile *sourceFile = (id)[collection sourceFileForPath: path];
+	NSUInteger version = [sourceFile translationUnitVersion];
+
+	UKNotNil([[collection globals] objectForKey: @"racyA"]);
+
+	/* Same size and same modification time, only the contents tell */
+	[@"int racyB;\n" writeToFile: headerPath atomically: NO encoding: NSUTF8StringEncoding error: NULL];
+	[fm setAttributes: D(modificationDate, NSFileModificationDate) ofItemAtPath: headerPath error: NULL];
+	[sourceFile reparse];
+
+	UKIntsEqual(version + 1, [sourceFile translationUnitVersion]);
+	UKNotNil([[collection globals] objectForKey: @"racyB"]);
+
+	[fm removeItemAtPath: dir error: NULL];
+}
+
+/**
+ * The file doesn't retain its collection, so the caller must keep it.
+ */
+- (SCKSourceFile *)sourceFileForDiagnosticsTestInCollection: (SCKSourceCollection *)aCollection
+{
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent: @"TestDiagnostics.m"];
+
+	[@"" writeToFile: path atomically: NO encoding: NSUTF8StringEncoding error: NULL];
+
+	SCKSourceFile *file = [aCollection sourceFileForPath: path];
+
+	[file setSource: [[NSMutableAttributedString alloc] initWithString: @""]];
+	return file;
+}
+
+/**
+ * Edits the source in place, as an editor would, so the diagnostic attributes 
+ * move with the text.
+ */
+- (void)editFile: (SCKSourceFile *)aFile replacingRange: (NSRange)aRange withString: (NSString *)aString
+{
+	[[aFile source] replaceCharactersInRange: aRange withString: aString];
+	[aFile reparse];
+	[aFile collectDiagnostics];
+}
+
+- (NSSet *)diagnosticTokensInFile: (SCKSourceFile *)aFile
+{
+	NSMutableSet *tokens = [NSMutableSet set];
+
+	[[aFile source] enumerateAttribute: kSCKDiagnostic
+	                           inRange: NSMakeRange(0, [[aFile source] length])
+	                           options: 0
+	                        usingBlock: ^ (id value, NSRange r, BOOL *stop)
+	{
+		if (nil != value)
+		{
+			[tokens addObject: [value objectForKey: kSCKDiagnosticToken]];
+		}
+	}];
+	return tokens;
+}
+
+- (void)testDiagnosticSetChanges
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	SCKSourceFile *file = [self sourceFileForDiagnosticsTestInCollection: collection];
+	NSString *f = @"int f(void) { return undeclared1; }\n";
+	NSString *g = @"int g(void) { return undeclared2; }\n";
+
+	[self editFile: file replacingRange: NSMakeRange(0, 0) withString: f];
+	SCKDiagnosticSet *first = [file diagnosticSet];
+
+	UKIntsEqual(1, [[first diagnostics] count]);
+	UKObjectsEqual([first diagnostics], [first addedDiagnostics]);
+	UKIntsEqual(0, [[first removedDiagnostics] count]);
+	UKObjectsSame(first, [file diagnosticSet]);
+
+	[self editFile: file replacingRange: NSMakeRange([f length], 0) withString: g];
+	SCKDiagnosticSet *second = [file diagnosticSet];
+
+	UKIntsEqual(2, [[second diagnostics] count]);
+	UKObjectsEqual(A([[second diagnostics] lastObject]), [second addedDiagnostics]);
+	UKIntsEqual(0, [[second removedDiagnostics] count]);
+	UKObjectsSame([[first diagnostics] firstObject], [[second diagnostics] firstObject]);
+	UKIntsEqual(2, [[self diagnosticTokensInFile: file] count]);
+
+	[self editFile: file replacingRange: NSMakeRange(0, [f length]) withString: @""];
+	SCKDiagnosticSet *third = [file diagnosticSet];
+
+	UKIntsEqual(1, [[third diagnostics] count]);
+	UKIntsEqual(0, [[third addedDiagnostics] count]);
+	UKObjectsEqual(A([[first diagnostics] firstObject]), [third removedDiagnostics]);
+	/* Moved by the edit, but still the same diagnostic */
+	UKObjectsSame([[[second diagnostics] lastObject] attributeValue],
+		[[[third diagnostics] firstObject] attributeValue]);
+	UKObjectsEqual(S([[[[third diagnostics] firstObject] attributeValue] objectForKey: kSCKDiagnosticToken]),
+		[self diagnosticTokensInFile: file]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: [file fileName] error: NULL];
+}
+
+- (void)testEqualDiagnosticsHaveDistinctAttributes
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	SCKSourceFile *file = [self sourceFileForDiagnosticsTestInCollection: collection];
+	NSString *f = @"int f(void) { return undeclared; }\n";
+	NSString *g = @"int g(void) { return undeclared; }\n";
+
+	[self editFile: file replacingRange: NSMakeRange(0, 0) withString: [f stringByAppendingString: g]];
+	NSArray *diagnostics = [[file diagnosticSet] diagnostics];
+
+	UKIntsEqual(2, [diagnostics count]);
+	UKObjectsEqual([[diagnostics firstObject] text], [[diagnostics lastObject] text]);
+	UKFalse([[[diagnostics firstObject] attributeValue] isEqual: [[diagnostics lastObject] attributeValue]]);
+	UKIntsEqual(2, [[self diagnosticTokensInFile: file] count]);
+
+	/* The remaining error is matched with the first one, whose text was 
+	   deleted, so its attribute must be applied again */
+	[self editFile: file replacingRange: NSMakeRange(0, [f length]) withString: @""];
+
+	UKIntsEqual(1, [[[file diagnosticSet] diagnostics] count]);
+	UKIntsEqual(1, [[self diagnosticTokensInFile: file] count]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: [file fileName] error: NULL];
+}
+
+/**
+ * Returns a parsed file whose source is a NSTextStorage, so the edits are
+ * notified to the file as in an editor.
+ */
+- (SCKClangSourceFile *)sourceFileForCompletionTestWithText: (NSString *)aText
+                                               inCollection: (SCKSourceCollection *)aCollection
+{
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent: @"TestCompletion.m"];
+
+	[aText writeToFile: path atomically: NO encoding: NSUTF8StringEncoding error: NULL];
+
+	SCKClangSourceFile *file = (id)[aCollection sourceFileForPath: path];
+
+	[file setSource: [[NSTextStorage alloc] initWithString: aText]];
+	[file reparse];
+	return file;
+}
+
+- (void)testCompletionSessionReuse
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	NSString *text = @"int counter;\nint f(void) { return coun; }\n";
+	SCKClangSourceFile *file = [self sourceFileForCompletionTestWithText: text inCollection: collection];
+	NSMutableAttributedString *source = [file source];
+	NSUInteger location = NSMaxRange([text rangeOfString: @"coun;"]) - 1;
+
+	[file completeAtLocation: location];
+	id session = [file completionSession];
+
+	UKNotNil(session);
+
+	/* Typing the completed identifier keeps the results */
+	[source replaceCharactersInRange: NSMakeRange(location, 0) withString: @"t"];
+	[file completeAtLocation: location + 1];
+
+	UKObjectsSame(session, [file completionSession]);
+
+	/* Editing after the identifier doesn't change the completion context */
+	[source replaceCharactersInRange: NSMakeRange([source length], 0) withString: @"int g;\n"];
+	[file completeAtLocation: location + 1];
+
+	UKObjectsSame(session, [file completionSession]);
+
+	/* Same length edit before the identifier, which doesn't move */
+	[source replaceCharactersInRange: NSMakeRange(4, 1) withString: @"k"];
+	[file completeAtLocation: location + 1];
+
+	UKNotNil([file completionSession]);
+	UKFalse(session == [file completionSession]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: [file fileName] error: NULL];
+}
+
+- (void)testSpeculativeCompletionReplacesStaleSession
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	NSString *text = @"struct point { int x; } p;\nint f(void) { return p.; }\n";
+	SCKClangSourceFile *file = [self sourceFileForCompletionTestWithText: text inCollection: collection];
+	NSMutableAttributedString *source = [file source];
+	NSUInteger location = NSMaxRange([text rangeOfString: @"p."]);
+
+	[file setCompletesSpeculatively: YES];
+	[file completeAtLocation: location];
+	id session = [file completionSession];
+
+	/* The current session would be reused */
+	UKFalse([file textDidChangeAtLocation: location]);
+
+	/* The session at the same location is now stale */
+	[source replaceCharactersInRange: NSMakeRange(7, 1) withString: @"P"];
+
+	UKTrue([file textDidChangeAtLocation: location]);
+
+	/* -completeAtLocation: would cancel a speculation not started yet */
+	NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow: 10];
+
+	while (nil == [file valueForKey: @"speculativeSession"] && [deadline timeIntervalSinceNow] > 0)
+	{
+		[NSThread sleepForTimeInterval: 0.01];
+	}
+	NSUInteger completionCount =
+		[[[collection metrics] statisticsForPhase: SCKMetricPhaseCompletion] callCount];
+
+	[file completeAtLocation: location];
+
+	/* The speculative results were used rather than computed again */
+	UKIntsEqual(completionCount, [[[collection metrics] statisticsForPhase: SCKMetricPhaseCompletion] callCount]);
+	UKNotNil([file completionSession]);
+	UKFalse(session == [file completionSession]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: [file fileName] error: NULL];
+}
+
+- (void)testSourceContents
+{
+	SCKSourceFile *sourceFile = [SCKSourceFile new];
+	NSTextStorage *storage = [[NSTextStorage alloc] initWithString: @"int a;"];
+
+	[sourceFile setSource: storage];
+	NSData *contents = [sourceFile sourceContents];
+
+	UKObjectsEqual([@"int a;" dataUsingEncoding: NSUTF8StringEncoding], contents);
+	UKObjectsSame(contents, [sourceFile sourceContents]);
+
+	[storage addAttribute: @"test" value: @"test" range: NSMakeRange(0, 3)];
+
+	UKObjectsSame(contents, [sourceFile sourceContents]);
+
+	[storage replaceCharactersInRange: NSMakeRange(4, 1) withString: @"b"];
+
+	UKObjectsEqual([@"int b;" dataUsingEncoding: NSUTF8StringEncoding], [sourceFile sourceContents]);
+
+	[sourceFile setSource: nil];
+
+	UKNil([sourceFile sourceContents]);
+}
+
+- (void)testUnchangedFileReusedAfterClear
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	[collection setKeepsFilesAcrossClear: YES];
+	[self parseSourceFilesIntoCollection: collection];
+	SCKClangSourceFile *sourceFile = (id)[[[collection files] objectEnumerator] nextObject];
+	NSUInteger version = [sourceFile translationUnitVersion];
+
+	[self parseSourceFilesIntoCollection: collection];
+
+	UKObjectsSame(sourceFile, [[collection files] objectForKey: [sourceFile fileName]]);
+	UKIntsEqual(version, [sourceFile translationUnitVersion]);
+	UKNotNil([[collection classes] objectForKey: @"A"]);
+
+	[collection setKeepsFilesAcrossClear: NO];
+	[self parseSourceFilesIntoCollection: collection];
+
+	UKFalse(sourceFile == [[collection files] objectForKey: [sourceFile fileName]]);
+}
+
+- (void)testClearResetsTypeTable
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	[self parseSourceFilesIntoCollection: collection];
+
+	UKTrue([[collection typeTable] count] > 0);
+
+	[collection clear];
+
+	UKIntsEqual(0, [[collection typeTable] count]);
+}
+
+- (NSUInteger)libclangMemoryOfFile: (SCKSourceFile *)aFile
+{
+	NSDictionary *bytesByCategory = [[aFile memoryUsage] bytesByCategory];
+	NSUInteger bytes = 0;
+
+	for (NSString *category in bytesByCategory)
+	{
+		if ([category hasPrefix: @"libclang: "])
+		{
+			bytes += [[bytesByCategory objectForKey: category] unsignedIntegerValue];
+		}
+	}
+	return bytes;
+}
+
+- (void)testIndexOnlyFiles
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	[collection setCreatesIndexOnlyFiles: YES];
+	[self parseSourceFilesIntoCollection: collection];
+	SCKClangSourceFile *sourceFile = (id)[[[collection files] objectEnumerator] nextObject];
+	NSUInteger version = [sourceFile translationUnitVersion];
+
+	UKTrue([sourceFile isIndexOnly]);
+	UKNil([sourceFile source]);
+	UKIntsEqual(0, [self libclangMemoryOfFile: sourceFile]);
+	UKNotNil([[collection classes] objectForKey: @"A"]);
+	UKNotNil([[[collection classes] objectForKey: @"A"] declaration]);
+
+	[sourceFile reparse];
+
+	UKIntsEqual(version, [sourceFile translationUnitVersion]);
+
+	NSString *text = [NSString stringWithContentsOfFile: [sourceFile fileName]
+	                                           encoding: NSUTF8StringEncoding
+	                                              error: NULL];
+
+	[sourceFile setSource: [[NSMutableAttributedString alloc] initWithString: text]];
+	[sourceFile reparse];
+
+	UKFalse([sourceFile isIndexOnly]);
+	UKIntsEqual(version + 1, [sourceFile translationUnitVersion]);
+	UKTrue([self libclangMemoryOfFile: sourceFile] > 0);
+}
+
+- (void)testIndexWorkerResponseReplay
+{
+	SCKSourceCollection *workerCollection = [SCKSourceCollection new];
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	NSString *path = [[[self parsingTestFiles] filteredCollectionWithBlock: ^ (id aPath)
+	{
+		return [[aPath lastPathComponent] isEqual: @"AB.h"];
+	}] firstObject];
+
+	[workerCollection clear];
+	[collection clear];
+
+	SCKClangSourceFile *sourceFile = (id)[SCKClangSourceFile fileUsingIndex: [collection indexForFileExtension: @"h"]];
+
+	[sourceFile setFileName: path];
+	[sourceFile setCollection: collection];
+	[sourceFile setIsIndexOnly: YES];
+
+	NSData *response = [SCKClangSourceFile indexWorkerResponseForRequest: [sourceFile indexWorkerRequest]
+	                                                        inCollection: workerCollection];
+
+	UKNotNil(response);
+	UKNil([[workerCollection classes] objectForKey: @"A"]);
+	UKNil([workerCollection includedFilesForFile: path]);
+
+	[sourceFile reparseWithIndexWorkerResponse: response];
+
+	SCKClass *classA = [[collection classes] objectForKey: @"A"];
+
+	UKIntsEqual(1, [sourceFile translationUnitVersion]);
+	UKStringsEqual(path, [[classA declaration] file]);
+	UKStringsEqual(@"NSObject", [[classA superclass] name]);
+	UKNotNil([[classA methods] objectForKey: @"wakeUpAtDate:"]);
+	UKStringsEqual(@"Dummy Class Description", [[[classA documentation] string]
+		stringByTrimmingCharactersInSet: [NSCharacterSet whitespaceAndNewlineCharacterSet]]);
+	UKTrue([sourceFile interfaceFingerprint] != 0);
+
+	[sourceFile reparse];
+
+	UKIntsEqual(1, [sourceFile translationUnitVersion]);
+}
+
+/**
+ * Returns the sckindexworker tool built with 'make worker=yes', or nil if it 
+ * wasn't built.
+ */
+- (NSString *)builtIndexWorkerPath
+{
+	NSString *path = [[[NSProcessInfo processInfo] environment] objectForKey: @"SCK_INDEX_WORKER"];
+
+	if (nil == path)
+	{
+		path = [[[NSFileManager defaultManager] currentDirectoryPath]
+			stringByAppendingPathComponent: @"obj/sckindexworker"];
+	}
+	return ([[NSFileManager defaultManager] isExecutableFileAtPath: path] ? path : nil);
+}
+
+- (void)testIndexWorkerRoundTrip
+{
+	NSString *workerPath = [self builtIndexWorkerPath];
+
+	if (nil == workerPath)
+	{
+		NSLog(@"Skipping %@, sckindexworker wasn't built", NSStringFromSelector(_cmd));
+		return;
+	}
+
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	SCKIndexWorkerPool *pool = [[SCKIndexWorkerPool alloc] initWithWorkerPath: workerPath
+	                                                              workerCount: 2];
+
+	[collection setIgnoresIncludedSymbols: YES];
+	[collection setCreatesIndexOnlyFiles: YES];
+	[collection setIndexWorkerPool: pool];
+	[collection clear];
+
+	NSArray *files = [collection sourceFilesForPaths: [self parsingTestFiles]];
+	SCKClass *classA = [[collection classes] objectForKey: @"A"];
+
+	UKIntsEqual([[self parsingTestFiles] count], [files count]);
+	UKIntsEqual(0, [pool failureCount]);
+	UKStringsEqual(@"NSObject", [[classA superclass] name]);
+	UKNotNil([[classA methods] objectForKey: @"wakeUpAtDate:"]);
+	UKObjectsEqual(SA([[sourceCollection classes] allKeys]), SA([[collection classes] allKeys]));
+	UKObjectsEqual(SA([[sourceCollection functions] allKeys]), SA([[collection functions] allKeys]));
+	UKObjectsEqual(SA([[sourceCollection enumerationValues] allKeys]), SA([[collection enumerationValues] allKeys]));
+
+	for (SCKSourceFile *file in files)
+	{
+		NSUInteger version = [(SCKClangSourceFile *)file translationUnitVersion];
+
+		UKTrue([file interfaceFingerprint] != 0);
+		[file reparse];
+		UKIntsEqual(version, [(SCKClangSourceFile *)file translationUnitVersion]);
+	}
+}
+
+- (void)testIndexWorkerFailure
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	SCKIndexWorkerPool *pool = [[SCKIndexWorkerPool alloc] initWithWorkerPath: @"/bin/false"
+	                                                              workerCount: 2];
+
+	[collection setCreatesIndexOnlyFiles: YES];
+	[collection setIndexWorkerPool: pool];
+	[collection clear];
+
+	NSArray *files = [collection sourceFilesForPaths: [self parsingTestFiles]];
+
+	UKIntsEqual([[self parsingTestFiles] count], [files count]);
+	UKIntsEqual([files count], [pool failureCount]);
+	UKNil([[collection classes] objectForKey: @"A"]);
+}
+
+- (void)testIndexWorkerTimeout
+{
+	NSString *workerPath = [NSTemporaryDirectory() stringByAppendingPathComponent: @"TestHungIndexWorker"];
+
+	[@"#!/bin/sh\nexec sleep 600\n" writeToFile: workerPath
+	                                 atomically: NO
+	                                   encoding: NSUTF8StringEncoding
+	                                      error: NULL];
+	[[NSFileManager defaultManager] setAttributes: D([NSNumber numberWithShort: 0755], NSFilePosixPermissions)
+	                                 ofItemAtPath: workerPath
+	                                        error: NULL];
+
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	SCKIndexWorkerPool *pool = [[SCKIndexWorkerPool alloc] initWithWorkerPath: workerPath
+	                                                              workerCount: 2];
+
+	[pool setParseTimeout: 0.5];
+	[collection setCreatesIndexOnlyFiles: YES];
+	[collection setIndexWorkerPool: pool];
+	[collection clear];
+
+	double start = SCKMetricsNow();
+	NSArray *files = [collection sourceFilesForPaths: [self parsingTestFiles]];
+
+	UKIntsEqual([[self parsingTestFiles] count], [files count]);
+	UKIntsEqual([files count], [pool failureCount]);
+	UKTrue(SCKMetricsNow() - start < 60);
+
+	[[NSFileManager defaultManager] removeItemAtPath: workerPath error: NULL];
+}
+
+- (void)testSymbolSnapshots
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	[collection clear];
+	SCKSymbolSnapshot *emptySnapshot = [collection symbolSnapshot];
+
+	[self parseSourceFilesIntoCollection: collection];
+	SCKSymbolSnapshot *snapshot = [collection symbolSnapshot];
+
+	UKIntsEqual(0, [[emptySnapshot classes] count]);
+	UKTrue([snapshot generation] > [emptySnapshot generation]);
+	UKObjectsSame([[collection classes] objectForKey: @"A"], [[snapshot classes] objectForKey: @"A"]);
+	UKObjectsEqual([NSSet setWithArray: [[collection functions] allKeys]],
+		[NSSet setWithArray: [[snapshot functions] allKeys]]);
+
+	[[[[collection files] objectEnumerator] nextObject] reparse];
+
+	UKObjectsSame(snapshot, [collection symbolSnapshot]);
+
+	[collection clear];
+
+	UKIntsEqual(0, [[[collection symbolSnapshot] classes] count]);
+	UKNotNil([[snapshot classes] objectForKey: @"A"]);
+
+	__block NSUInteger methodCount = 0;
+
+	[snapshot readComponentsUsingBlock: ^ ()
+	{
+		methodCount = [[[[snapshot classes] objectForKey: @"A"] methods] count];
+	}];
+	UKTrue(methodCount > 0);
+}
+
+- (void)testSymbolUpdatesPublishOneSnapshot
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	[collection clear];
+	SCKSymbolSnapshot *emptySnapshot = [collection symbolSnapshot];
+
+	[collection beginSymbolUpdates];
+	[self parseSourceFilesIntoCollection: collection];
+
+	UKObjectsSame(emptySnapshot, [collection symbolSnapshot]);
+
+	[collection endSymbolUpdates];
+
+	UKIntsEqual([emptySnapshot generation] + 1, [[collection symbolSnapshot] generation]);
+	UKNotNil([[[collection symbolSnapshot] classes] objectForKey: @"A"]);
+}
+
+- (void)testSymbolDatabase
+{
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent: @"TestSymbolDatabase.sckdb"];
+
+	UKTrue([sourceCollection writeSymbolDatabaseToFile: path]);
+
+	SCKSourceCollection *collection = [[SCKSourceCollection alloc] initWithSymbolDatabaseAtPath: path];
+	SCKClass *classA = [[collection classes] objectForKey: @"A"];
+	SCKClass *classC = [[collection classes] objectForKey: @"C"];
+	SCKCategory *category = [[classA categories] objectForKey: @"AExtension"];
+	SCKProtocol *protocol3 = [[collection protocols] objectForKey: @"Protocol3"];
+
+	UKTrue([collection isReadOnly]);
+	UKNil([collection sourceFileForPath: [[self parsingTestFiles] firstObject]]);
+	UKObjectsEqual(SA([[sourceCollection classes] allKeys]), SA([[collection classes] allKeys]));
+	UKNil([collection classForName: @"Unknown"]);
+
+	UKStringsEqual(@"B", [[classC superclass] name]);
+	UKObjectsSame(classA, [[classC superclass] superclass]);
+	UKObjectsEqual(A(@"Protocol3"), (id)[[[classC adoptedProtocols] mappedCollection] name]);
+	UKObjectsEqual(A(@"Protocol1", @"Protocol2"), (id)[[[protocol3 adoptedProtocols] mappedCollection] name]);
+	UKObjectsEqual(A(@"ivar1", @"ivar2", @"ivar3"), (id)[[[classC ivars] mappedCollection] name]);
+
+	SCKMethod *sleepLater = [[classA methods] objectForKey: @"sleepLater:"];
+	SCKMethod *parsedSleepLater = [[[self parsedClassForName: @"A"] methods] objectForKey: @"sleepLater:"];
+
+	UKObjectsSame(classA, [sleepLater parent]);
+	UKStringsEqual([parsedSleepLater typeEncoding], [sleepLater typeEncoding]);
+	UKStringsEqual(@"AB.h", [[[sleepLater declaration] file] lastPathComponent]);
+	UKIntsEqual([[parsedSleepLater declaration] offset], [[sleepLater declaration] offset]);
+	UKObjectsSame([[category methods] objectForKey: @"methodInCategory"],
+		[[classA methods] objectForKey: @"methodInCategory"]);
+	UKObjectsSame([[category methods] objectForKey: @"methodInCategory"],
+		[classC resolvedMethodForSelector: @"methodInCategory"]);
+
+	UKObjectsEqual(A(category), [collection implementorsOfSelector: @"methodInCategory"]);
+	UKObjectsEqual(A([[collection protocols] objectForKey: @"Protocol1"]), [collection implementorsOfSelector: @"hi"]);
+	UKNotNil([[collection functions] objectForKey: @"function1"]);
+	UKNotNil([[collection globals] objectForKey: @"kGlobal1"]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+}
+
+- (void)testSymbolDatabaseSkipsInvalidNames
+{
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent: @"TestSymbolDatabaseInvalidNames.sckdb"];
+
+	UKTrue([sourceCollection writeSymbolDatabaseToFile: path]);
+
+	NSMutableData *fileData = [NSMutableData dataWithContentsOfFile: path];
+	const char name[] = "\0methodInCategory";
+	NSRange range = [fileData rangeOfData: [NSData dataWithBytes: name length: sizeof(name)]
+	                              options: 0
+	                                range: NSMakeRange(0, [fileData length])];
+	const unsigned char invalidUTF8 = 0xFF;
+
+	UKTrue(range.location != NSNotFound);
+	[fileData replaceBytesInRange: NSMakeRange(range.location + 1, 1) withBytes: &invalidUTF8];
+	UKTrue([fileData writeToFile: path atomically: YES]);
+
+	SCKSourceCollection *collection = [[SCKSourceCollection alloc] initWithSymbolDatabaseAtPath: path];
+	SCKClass *classA = [[collection classes] objectForKey: @"A"];
+
+	UKNotNil(classA);
+	UKNotNil([[classA categories] objectForKey: @"AExtension"]);
+	UKNotNil([[classA methods] objectForKey: @"sleepLater:"]);
+	UKNil([[classA methods] objectForKey: @"methodInCategory"]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+}
+
+- (void)testOccurrenceIndex
+{
+	SCKClangSourceFile *file = [self parsedFileForName: @"AB.m"];
+	SCKOccurrenceIndex *index = [file occurrenceIndex];
+	NSString *source = [NSString stringWithContentsOfFile: [file fileName]
+	                                             encoding: NSUTF8StringEncoding
+	                                                error: NULL];
+	NSUInteger argOffset = [source rangeOfString: @"arg1 + arg2"].location;
+	NSUInteger sleepLaterOffset = [source rangeOfString: @"sleepLater"].location;
+	SCKSymbolOccurrence *arg1 = [index occurrenceAtOffset: argOffset];
+	SCKSymbolOccurrence *sleepLater = [index occurrenceAtOffset: sleepLaterOffset];
+
+	UKIntsEqual(SCKOccurrenceKindReference, [arg1 kind]);
+	UKStringsEqual(@"arg1", [arg1 name]);
+	UKStringsEqual(@"AB.m", [[[arg1 declaration] file] lastPathComponent]);
+	UKTrue([[arg1 declaration] offset] < argOffset);
+	UKTrue([[index occurrencesOfUSR: [arg1 USR]] count] >= 2);
+	UKStringsEqual(@"function1", [[[index occurrencesContainingOffset: argOffset] firstObject] name]);
+
+	UKIntsEqual(SCKOccurrenceKindDefinition, [sleepLater kind]);
+	UKStringsEqual(@"sleepLater:", [sleepLater name]);
+	UKStringsEqual(@"AB.m", [[[sleepLater declaration] file] lastPathComponent]);
+	UKNil([index occurrenceAtOffset: 0]);
+}
+
+- (void)testOccurrenceIndexKeepsRecordingOrder
+{
+	NSMutableArray *occurrences = [NSMutableArray array];
+	NSArray *names = A(@"first", @"second", @"third", @"fourth", @"fifth");
+
+	for (NSString *name in names)
+	{
+		[occurrences addObject: [[SCKSymbolOccurrence alloc] initWithRange: NSMakeRange(10, 4)
+		                                                              kind: SCKOccurrenceKindReference
+		                                                              name: name
+		                                                               USR: @"c:@F@f"
+		                                                       declaration: nil
+		                                                        definition: nil]];
+	}
+	[occurrences addObject: [[SCKSymbolOccurrence alloc] initWithRange: NSMakeRange(0, 20)
+	                                                              kind: SCKOccurrenceKindDefinition
+	                                                              name: @"container"
+	                                                               USR: @"c:@F@g"
+	                                                       declaration: nil
+	                                                        definition: nil]];
+
+	SCKOccurrenceIndex *index = [[SCKOccurrenceIndex alloc] initWithOccurrences: occurrences];
+	NSArray *containing = [index occurrencesContainingOffset: 12];
+
+	UKIntsEqual(6, [containing count]);
+	UKStringsEqual(@"container", [[containing firstObject] name]);
+	UKObjectsEqual(names, [[index occurrencesOfUSR: @"c:@F@f"] valueForKey: @"name"]);
+}
+
+- (void)testHeaderChangeReparsesIncludingFiles
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	[self parseSourceFilesIntoCollection: collection];
+	NSArray *headerPaths = [[self parsingTestFiles] filteredCollectionWithBlock: ^ (id path)
+	{
+		return [[path lastPathComponent] isEqual: @"AB.h"];
+	}];
+	SCKSourceFile *header = [collection sourceFileForPath: [headerPaths firstObject]];
+	NSArray *implementationPaths = [[self parsingTestFiles] filteredCollectionWithBlock: ^ (id path)
+	{
+		return [[path lastPathComponent] isEqual: @"AB.m"];
+	}];
+	SCKClangSourceFile *implementation =
+		(id)[collection sourceFileForPath: [implementationPaths firstObject]];
+	NSUInteger version = [implementation translationUnitVersion];
+
+	UKObjectsEqual(A(implementation), [collection filesIncludingFile: [header fileName]]);
+	UKTrue([[collection includedFilesForFile: [implementation fileName]] containsObject: [header fileName]]);
+
+	NSString *text = [NSString stringWithContentsOfFile: [header fileName]
+	                                           encoding: NSUTF8StringEncoding
+	                                              error: NULL];
+	[header setSource: [[NSMutableAttributedString alloc] initWithString:
+		[text stringByAppendingString: @"\n@interface D : C\n@end\n"]]];
+	[header reparse];
+
+	UKObjectsEqual(A(implementation), [collection reparseFilesIncludingFile: [header fileName]]);
+	UKIntsEqual(version + 1, [implementation translationUnitVersion]);
+
+	[collection reparseFilesIncludingFile: [header fileName]];
+	UKIntsEqual(version + 1, [implementation translationUnitVersion]);
+}
+
+- (void)testHeaderCommentChangeDoesNotReparseIncludingFiles
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	[self parseSourceFilesIntoCollection: collection];
+	NSArray *headerPaths = [[self parsingTestFiles] filteredCollectionWithBlock: ^ (id path)
+	{
+		return [[path lastPathComponent] isEqual: @"AB.h"];
+	}];
+	SCKSourceFile *header = [collection sourceFileForPath: [headerPaths firstObject]];
+	unsigned long long fingerprint = [header interfaceFingerprint];
+	NSString *text = [NSString stringWithContentsOfFile: [header fileName]
+	                                           encoding: NSUTF8StringEncoding
+	                                              error: NULL];
+
+	[header setSource: [[NSMutableAttributedString alloc] initWithString:
+		[@"/* New comment */\n\n" stringByAppendingString: text]]];
+	[header reparse];
+
+	UKTrue(fingerprint != 0);
+	UKTrue(fingerprint == [header interfaceFingerprint]);
+	UKIntsEqual(0, [[collection reparseFilesIncludingFile: [header fileName]] count]);
+
+	[header setSource: [[NSMutableAttributedString alloc] initWithString:
+		[text stringByReplacingOccurrencesOfString: @"@interface C : B" withString: @"@interface C : A"]]];
+	[header reparse];
+
+	UKFalse(fingerprint == [header interfaceFingerprint]);
+	UKIntsEqual(1, [[collection reparseFilesIncludingFile: [header fileName]] count]);
+}
+
+- (void)testHeaderMacroChangeReparsesIncludingFiles
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	[self parseSourceFilesIntoCollection: collection];
+	NSArray *headerPaths = [[self parsingTestFiles] filteredCollectionWithBlock: ^ (id path)
+	{
+		return [[path lastPathComponent] isEqual: @"AB.h"];
+	}];
+	SCKSourceFile *header = [collection sourceFileForPath: [headerPaths firstObject]];
+	NSString *text = [NSString stringWithContentsOfFile: [header fileName]
+	                                           encoding: NSUTF8StringEncoding
+	                                              error: NULL];
+
+	[header setSource: [[NSMutableAttributedString alloc] initWithString:
+		[@"#define AB_VALUE 1\n" stringByAppendingString: text]]];
+	[header reparse];
+	[collection reparseFilesIncludingFile: [header fileName]];
+
+	unsigned long long fingerprint = [header interfaceFingerprint];
+
+	[header setSource: [[NSMutableAttributedString alloc] initWithString:
+		[@"#define AB_VALUE   1 /* Same value */\n" stringByAppendingString: text]]];
+	[header reparse];
+
+	UKTrue(fingerprint == [header interfaceFingerprint]);
+	UKIntsEqual(0, [[collection reparseFilesIncludingFile: [header fileName]] count]);
+
+	[header setSource: [[NSMutableAttributedString alloc] initWithString:
+		[@"#define AB_VALUE 2\n" stringByAppendingString: text]]];
+	[header reparse];
+
+	UKFalse(fingerprint == [header interfaceFingerprint]);
+	UKIntsEqual(1, [[collection reparseFilesIncludingFile: [header fileName]] count]);
+}
+
 @end
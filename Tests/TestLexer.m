@@ -0,0 +1,133 @@
+#import "TestCommon.h"
+#import "SCKLexer.h"
+#import "SCKTextTypes.h"
+#import "SCKMetrics.h"
+
+@interface TestLexer : TestCommon
+@end
+
+@implementation TestLexer
+
+- (NSArray *)tokensOfString: (NSString *)aString cPlusPlus: (BOOL)isCPlusPlus
+{
+	SCKLexer *lexer = [[SCKLexer alloc] initWithString: aString];
+	NSMutableArray *tokens = [NSMutableArray array];
+	SCKToken token;
+
+	[lexer setLexesCPlusPlus: isCPlusPlus];
+	while ([lexer nextToken: &token])
+	{
+		[tokens addObject: A([aString substringWithRange: token.range],
+			SCKTextTokenTypeForTokenKind(token.kind))];
+	}
+	return tokens;
+}
+
+- (void)testObjectiveCTokens
+{
+	NSString *code = @"#import <Foundation/Foundation.h>\n"
+		"@interface A : NSObject // comment\n"
+		"- (id)self: (int)class;\n"
+		"@end\n"
+		"static char *s = @\"a \\\"b\\\"\"; /* x * y */ return 0x1Fu;";
+	NSArray *tokens = [self tokensOfString: code cPlusPlus: NO];
+
+	UKObjectsEqual(A(@"#", SCKTextTokenTypePunctuation), [tokens objectAtIndex: 0]);
+	UKObjectsEqual(A(@"import", SCKTextTokenTypeIdentifier), [tokens objectAtIndex: 1]);
+	UKObjectsEqual(A(@"<Foundation/Foundation.h>", SCKTextTokenTypeLiteral), [tokens objectAtIndex: 2]);
+	UKObjectsEqual(A(@"@interface", SCKTextTokenTypeKeyword), [tokens objectAtIndex: 3]);
+	UKObjectsEqual(A(@"// comment", SCKTextTokenTypeComment), [tokens objectAtIndex: 7]);
+	UKTrue([tokens containsObject: A(@"self", SCKTextTokenTypeIdentifier)]);
+	UKTrue([tokens containsObject: A(@"class", SCKTextTokenTypeIdentifier)]);
+	UKTrue([tokens containsObject: A(@"@end", SCKTextTokenTypeKeyword)]);
+	UKTrue([tokens containsObject: A(@"static", SCKTextTokenTypeKeyword)]);
+	UKTrue([tokens containsObject: A(@"@\"a \\\"b\\\"\"", SCKTextTokenTypeLiteral)]);
+	UKTrue([tokens containsObject: A(@"/* x * y */", SCKTextTokenTypeComment)]);
+	UKObjectsEqual(A(@"0x1Fu", SCKTextTokenTypeLiteral), [tokens objectAtIndex: [tokens count] - 2]);
+}
+
+- (void)testCPlusPlusTokens
+{
+	NSString *code = @"template <class T> auto s = R\"x(a)\" b)x\";";
+	NSArray *tokens = [self tokensOfString: code cPlusPlus: YES];
+
+	UKObjectsEqual(A(@"template", SCKTextTokenTypeKeyword), [tokens objectAtIndex: 0]);
+	UKObjectsEqual(A(@"class", SCKTextTokenTypeKeyword), [tokens objectAtIndex: 2]);
+	UKTrue([tokens containsObject: A(@"R\"x(a)\" b)x\"", SCKTextTokenTypeLiteral)]);
+	UKObjectsEqual(A(@"template", SCKTextTokenTypeIdentifier),
+		[[self tokensOfString: code cPlusPlus: NO] objectAtIndex: 0]);
+}
+
+- (void)testLexicalHighlightString
+{
+	NSMutableAttributedString *source =
+		[[NSMutableAttributedString alloc] initWithString: @"int x;\n// done"];
+
+	[SCKLexer lexicalHighlightString: source cPlusPlus: NO];
+
+	NSRange range;
+	id type = [source attribute: kSCKTextTokenType atIndex: 0 effectiveRange: &range];
+
+	UKObjectsSame(SCKTextTokenTypeKeyword, type);
+	UKIntsEqual(3, range.length);
+	UKObjectsSame(SCKTextTokenTypeIdentifier, [source attribute: kSCKTextTokenType atIndex: 4 effectiveRange: NULL]);
+	UKObjectsSame(SCKTextTokenTypePunctuation, [source attribute: kSCKTextTokenType atIndex: 5 effectiveRange: NULL]);
+	UKNil([source attribute: kSCKTextTokenType atIndex: 6 effectiveRange: NULL]);
+	UKObjectsSame(SCKTextTokenTypeComment, [source attribute: kSCKTextTokenType atIndex: 7 effectiveRange: NULL]);
+}
+
+- (void)testDirectiveAfterComment
+{
+	NSArray *tokens = [self tokensOfString: @"/* x */ #import <a.h>\n#include /* y */ <b.h>" cPlusPlus: NO];
+
+	UKObjectsEqual(A(@"/* x */", SCKTextTokenTypeComment), [tokens objectAtIndex: 0]);
+	UKObjectsEqual(A(@"<a.h>", SCKTextTokenTypeLiteral), [tokens objectAtIndex: 3]);
+	UKObjectsEqual(A(@"/* y */", SCKTextTokenTypeComment), [tokens objectAtIndex: 6]);
+	UKObjectsEqual(A(@"<b.h>", SCKTextTokenTypeLiteral), [tokens objectAtIndex: 7]);
+	UKObjectsEqual(A(@"<", SCKTextTokenTypePunctuation),
+		[[self tokensOfString: @"x /* y */ #import <a.h>" cPlusPlus: NO] objectAtIndex: 4]);
+}
+
+/**
+ * Highlights a 50k-line file twice and logs the time taken, so regressions 
+ * are visible in the test output. The second pass leaves the unchanged runs 
+ * untouched.
+ */
+- (void)testLexicalHighlightLargeString
+{
+	NSArray *lines = A(@"#import <Foundation/Foundation.h>",
+	                   @"/* A comment */ static int counter = 0x1F;",
+	                   @"- (void)sleepLater: (NSUInteger)seconds { [self wait: @\"later\"]; }",
+	                   @"// done");
+	NSMutableString *code = [NSMutableString string];
+
+	for (NSUInteger i = 0; i < 50000; i++)
+	{
+		[code appendString: [lines objectAtIndex: i % [lines count]]];
+		[code appendString: @"\n"];
+	}
+
+	NSMutableAttributedString *source = [[NSMutableAttributedString alloc] initWithString: code];
+	double start = SCKMetricsNow();
+
+	[SCKLexer lexicalHighlightString: source cPlusPlus: NO];
+
+	double highlightTime = SCKMetricsNow() - start;
+
+	start = SCKMetricsNow();
+	[SCKLexer lexicalHighlightString: source cPlusPlus: NO];
+
+	double rehighlightTime = SCKMetricsNow() - start;
+	NSUInteger lastLine = [code length] - [@"// done\n" length];
+
+	UKObjectsSame(SCKTextTokenTypePunctuation, [source attribute: kSCKTextTokenType atIndex: 0 effectiveRange: NULL]);
+	UKObjectsSame(SCKTextTokenTypeComment, [source attribute: kSCKTextTokenType atIndex: lastLine effectiveRange: NULL]);
+	UKNil([source attribute: kSCKTextTokenType atIndex: [code length] - 1 effectiveRange: NULL]);
+	/* Generous bounds that only a quadratic lexer or attribute update misses */
+	UKTrue(highlightTime < 5);
+	UKTrue(rehighlightTime < 5);
+	NSLog(@"Lexical highlighting of 50000 lines took %.3fms (%.3fms unchanged)",
+		highlightTime * 1000, rehighlightTime * 1000);
+}
+
+@end
@@ -0,0 +1,71 @@
+#import "TestCommon.h"
+#import "SCKMemoryUsage.h"
+
+@interface TestMemoryUsage : TestCommon
+@end
+
+@implementation TestMemoryUsage
+
+- (void)testAddBytes
+{
+	SCKMemoryUsage *usage = [SCKMemoryUsage new];
+
+	UKIntsEqual(0, [usage totalBytes]);
+	UKIntsEqual(0, [[usage bytesByCategory] count]);
+
+	[usage addBytes: 100 forCategory: SCKMemoryUsageSymbolsCategory];
+	[usage addBytes: 20 forCategory: SCKMemoryUsageSourceTextCategory];
+	[usage addBytes: 5 forCategory: SCKMemoryUsageSymbolsCategory];
+
+	UKIntsEqual(125, [usage totalBytes]);
+	UKIntsEqual(105, [[[usage bytesByCategory] objectForKey: SCKMemoryUsageSymbolsCategory] unsignedIntegerValue]);
+	UKIntsEqual(20, [[[usage bytesByCategory] objectForKey: SCKMemoryUsageSourceTextCategory] unsignedIntegerValue]);
+}
+
+- (void)testBytesByCategoryIsSnapshot
+{
+	SCKMemoryUsage *usage = [SCKMemoryUsage new];
+
+	[usage addBytes: 10 forCategory: SCKMemoryUsageSymbolsCategory];
+	NSDictionary *bytesByCategory = [usage bytesByCategory];
+	[usage addBytes: 10 forCategory: SCKMemoryUsageSymbolsCategory];
+
+	UKIntsEqual(10, [[bytesByCategory objectForKey: SCKMemoryUsageSymbolsCategory] unsignedIntegerValue]);
+}
+
+- (void)testAddMemoryUsage
+{
+	SCKMemoryUsage *usage = [SCKMemoryUsage new];
+	SCKMemoryUsage *other = [SCKMemoryUsage new];
+
+	[usage addBytes: 100 forCategory: SCKMemoryUsageSymbolsCategory];
+	[other addBytes: 50 forCategory: SCKMemoryUsageSymbolsCategory];
+	[other addBytes: 30 forCategory: @"libclang: AST: ASTContext (memory)"];
+
+	[usage addMemoryUsage: other];
+
+	UKIntsEqual(180, [usage totalBytes]);
+	UKIntsEqual(150, [[[usage bytesByCategory] objectForKey: SCKMemoryUsageSymbolsCategory] unsignedIntegerValue]);
+	UKIntsEqual(30, [[[usage bytesByCategory] objectForKey: @"libclang: AST: ASTContext (memory)"] unsignedIntegerValue]);
+	/* The other usage is left as is */
+	UKIntsEqual(80, [other totalBytes]);
+}
+
+- (void)testEstimatedMemoryUsageOfAttributedString
+{
+	NSMutableAttributedString *string = [[NSMutableAttributedString alloc] initWithString: @"abcdef"];
+
+	UKIntsEqual(0, SCKEstimatedMemoryUsageOfAttributedString([NSAttributedString new]));
+
+	NSUInteger characterSize = 6 * sizeof(unichar);
+	NSUInteger runSize = SCKEstimatedMemoryUsageOfAttributedString(string) - characterSize;
+
+	UKTrue(runSize > 0);
+
+	/* Splits the single run in three */
+	[string addAttribute: @"attribute" value: @"value" range: NSMakeRange(2, 2)];
+
+	UKIntsEqual(characterSize + 3 * runSize, SCKEstimatedMemoryUsageOfAttributedString(string));
+}
+
+@end
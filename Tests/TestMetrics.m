@@ -0,0 +1,120 @@
+#import "TestCommon.h"
+#import "SCKMetrics.h"
+#include <math.h>
+
+@interface TestMetrics : TestCommon
+{
+	SCKMetrics *metrics;
+}
+@end
+
+/**
+ * Returns whether the value is within the precision of the histograms (about
+ * 10%) of the expected value.
+ */
+static BOOL isApproximately(double value, double expected)
+{
+	return (fabs(value - expected) <= 0.1 * expected);
+}
+
+@implementation TestMetrics
+
+- (id)init
+{
+	SUPERINIT;
+	metrics = [SCKMetrics new];
+	return self;
+}
+
+- (void)testNoRecordedDuration
+{
+	SCKPhaseStatistics *stats = [metrics statisticsForPhase: SCKMetricPhaseParse];
+
+	UKIntsEqual(0, [stats callCount]);
+	UKTrue(0 == [stats meanTime]);
+	UKTrue(0 == [stats p50]);
+	UKTrue(0 == [stats p99]);
+	UKIntsEqual(0, [[metrics statisticsForPhase: SCKMetricPhaseParse file: @"a.m"] callCount]);
+	UKIntsEqual(0, [[metrics fileNames] count]);
+}
+
+- (void)testHistogramPercentiles
+{
+	for (NSUInteger i = 1; i <= 100; i++)
+	{
+		[metrics recordDuration: i / 1000.0 forPhase: SCKMetricPhaseParse file: nil];
+	}
+	SCKPhaseStatistics *stats = [metrics statisticsForPhase: SCKMetricPhaseParse];
+
+	UKIntsEqual(100, [stats callCount]);
+	UKTrue(isApproximately([stats totalTime], 5.05));
+	UKTrue(isApproximately([stats meanTime], 0.0505));
+	UKTrue(0.1 == [stats maxTime]);
+	UKTrue(isApproximately([stats p50], 0.050));
+	UKTrue(isApproximately([stats p95], 0.095));
+	UKTrue(isApproximately([stats p99], 0.099));
+	UKTrue([stats p99] <= [stats maxTime]);
+
+	/* Other phases are counted separately */
+	UKIntsEqual(0, [[metrics statisticsForPhase: SCKMetricPhaseIndex] callCount]);
+}
+
+- (void)testHistogramBucketsOutOfRange
+{
+	for (NSUInteger i = 0; i < 999; i++)
+	{
+		[metrics recordDuration: 1e-6 forPhase: SCKMetricPhaseCompletion file: nil];
+	}
+	/* Beyond the last bucket */
+	[metrics recordDuration: 1000 forPhase: SCKMetricPhaseCompletion file: nil];
+	/* Before the first bucket */
+	[metrics recordDuration: 0 forPhase: SCKMetricPhaseCompletionFiltering file: nil];
+
+	SCKPhaseStatistics *stats = [metrics statisticsForPhase: SCKMetricPhaseCompletion];
+
+	UKTrue(isApproximately([stats p50], 1e-6));
+	UKTrue(isApproximately([stats p99], 1e-6));
+	UKTrue(1000 == [stats maxTime]);
+	/* A percentile never exceeds the longest duration */
+	UKTrue(0 == [[metrics statisticsForPhase: SCKMetricPhaseCompletionFiltering] p99]);
+}
+
+- (void)testFilePercentilesFromRecentDurations
+{
+	for (NSUInteger i = 1; i <= 40; i++)
+	{
+		[metrics recordDuration: i / 1000.0 forPhase: SCKMetricPhaseDiagnostics file: @"a.m"];
+	}
+	[metrics recordDuration: 1 forPhase: SCKMetricPhaseDiagnostics file: @"b.m"];
+
+	SCKPhaseStatistics *stats = [metrics statisticsForPhase: SCKMetricPhaseDiagnostics file: @"a.m"];
+
+	UKIntsEqual(40, [stats callCount]);
+	UKTrue(isApproximately([stats maxTime], 0.040));
+	/* Only the last 32 durations (9ms to 40ms) are kept */
+	UKTrue(isApproximately([stats p50], 0.024));
+	UKTrue(isApproximately([stats p99], 0.040));
+	UKObjectsEqual(S(@"a.m", @"b.m"), SA([metrics fileNames]));
+	UKIntsEqual(41, [[metrics statisticsForPhase: SCKMetricPhaseDiagnostics] callCount]);
+}
+
+- (void)testReset
+{
+	[metrics recordDuration: 0.01 forPhase: SCKMetricPhaseParse file: @"a.m"];
+	[metrics reset];
+
+	SCKPhaseStatistics *stats = [metrics statisticsForPhase: SCKMetricPhaseParse];
+
+	UKIntsEqual(0, [stats callCount]);
+	UKTrue(0 == [stats totalTime]);
+	UKTrue(0 == [stats maxTime]);
+	UKTrue(0 == [stats p50]);
+	UKIntsEqual(0, [[metrics statisticsForPhase: SCKMetricPhaseParse file: @"a.m"] callCount]);
+	UKIntsEqual(0, [[metrics fileNames] count]);
+
+	[metrics recordDuration: 0.02 forPhase: SCKMetricPhaseParse file: nil];
+
+	UKTrue(isApproximately([[metrics statisticsForPhase: SCKMetricPhaseParse] p50], 0.02));
+}
+
+@end
@@ -0,0 +1,298 @@
+#import "TestCommon.h"
+#import "SCKProject.h"
+#import "SCKSourceFile.h"
+#import "SCKCorpusGenerator.h"
+#import "SCKIndexingScheduler.h"
+
+@interface TestProject : TestCommon
+{
+	SCKSourceCollection *sourceCollection;
+	SCKProject *project;
+	NSURL *headerURL;
+	NSURL *implementationURL;
+	NSNotification *lastSymbolsNotification;
+	NSThread *lastSymbolsNotificationThread;
+}
+@end
+
+@implementation TestProject
+
+- (id)init
+{
+	SUPERINIT;
+	sourceCollection = [SCKSourceCollection new];
+	[sourceCollection clear];
+	[sourceCollection setIgnoresIncludedSymbols: YES];
+	project = [[SCKProject alloc] initWithDirectoryURL: nil sourceCollection: sourceCollection];
+
+	for (NSString *path in [self parsingTestFiles])
+	{
+		if ([[path lastPathComponent] isEqual: @"AB.h"])
+		{
+			headerURL = [NSURL fileURLWithPath: path];
+		}
+		else if ([[path lastPathComponent] isEqual: @"AB.m"])
+		{
+			implementationURL = [NSURL fileURLWithPath: path];
+		}
+	}
+
+	[[NSNotificationCenter defaultCenter] addObserver: self
+	                                         selector: @selector(projectSymbolsDidChange:)
+	                                             name: SCKProjectSymbolsDidChangeNotification
+	                                           object: project];
+	return self;
+}
+
+- (void)dealloc
+{
+	[[NSNotificationCenter defaultCenter] removeObserver: self];
+}
+
+- (void)projectSymbolsDidChange: (NSNotification *)aNotification
+{
+	lastSymbolsNotification = aNotification;
+	lastSymbolsNotificationThread = [NSThread currentThread];
+}
+
+- (NSSet *)namesOfComponents: (NSArray *)components
+{
+	return SA((id)[[components mappedCollection] name]);
+}
+
+- (void)testAddFile
+{
+	[project addFileURL: headerURL];
+
+	UKIntsEqual(1, [[project files] count]);
+	UKObjectsEqual(S(@"A", @"B", @"C"), [self namesOfComponents: [project classes]]);
+	UKObjectsEqual(S(@"function1", @"function2"), [self namesOfComponents: [project functions]]);
+	UKObjectsEqual(S(@"kGlobal1", @"kGlobal2"), [self namesOfComponents: [project globals]]);
+	UKObjectsEqual(S(@"A", @"B", @"C"), [self namesOfComponents:
+		[[lastSymbolsNotification userInfo] objectForKey: SCKProjectInsertedClassesKey]]);
+}
+
+- (void)testComponentsDeclaredInSeveralFilesAppearOnce
+{
+	[project addFileURL: headerURL];
+	[project addFileURL: implementationURL];
+
+	UKIntsEqual(2, [[project files] count]);
+	UKIntsEqual(3, [[project classes] count]);
+	UKObjectsEqual(S(@"function1", @"function2", @"function3"),
+		[self namesOfComponents: [project functions]]);
+	UKIntsEqual(2, [[project globals] count]);
+	UKObjectsEqual(S(@"function3"), [self namesOfComponents:
+		[[lastSymbolsNotification userInfo] objectForKey: SCKProjectInsertedFunctionsKey]]);
+	UKNil([[lastSymbolsNotification userInfo] objectForKey: SCKProjectInsertedClassesKey]);
+}
+
+- (void)testRemoveFile
+{
+	[project addFileURL: headerURL];
+	[project addFileURL: implementationURL];
+	[project removeFileURL: headerURL];
+
+	UKIntsEqual(1, [[project files] count]);
+	UKIntsEqual(3, [[project classes] count]);
+
+	[project removeFileURL: implementationURL];
+
+	UKIntsEqual(0, [[project files] count]);
+	UKIntsEqual(0, [[project classes] count]);
+	UKIntsEqual(0, [[project functions] count]);
+	UKIntsEqual(0, [[project globals] count]);
+	UKIntsEqual(3, [[[lastSymbolsNotification userInfo] objectForKey: SCKProjectRemovedClassesKey] count]);
+}
+
+- (void)testReparseWithoutChangesPostsNoNotification
+{
+	[project addFileURL: implementationURL];
+	lastSymbolsNotification = nil;
+
+	[[[project files] firstObject] reparse];
+
+	UKNil(lastSymbolsNotification);
+	UKIntsEqual(3, [[project classes] count]);
+}
+
+- (void)testPerformBlockAndWait
+{
+	SCKIndexingScheduler *scheduler = [project indexingScheduler];
+	NSThread *callerThread = [NSThread currentThread];
+	__block NSThread *blockThread = nil;
+	__block BOOL nestedBlockRan = NO;
+	__block BOOL nestedBlockRanFirst = NO;
+
+	[scheduler performBlockAndWait: ^ ()
+	{
+		blockThread = [NSThread currentThread];
+		[scheduler performBlockAndWait: ^ () { nestedBlockRan = YES; }];
+		nestedBlockRanFirst = nestedBlockRan;
+	}];
+
+	UKNotNil(blockThread);
+	UKFalse(blockThread == callerThread);
+	UKTrue(nestedBlockRanFirst);
+}
+
+- (void)testReparseOnIndexingThreadNotifiesOwnerThread
+{
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent: @"TestReparseThread.m"];
+
+	[@"@interface Before @end" writeToFile: path atomically: NO encoding: NSUTF8StringEncoding error: NULL];
+	[project addFileURL: [NSURL fileURLWithPath: path]];
+	[@"@interface After @end" writeToFile: path atomically: NO encoding: NSUTF8StringEncoding error: NULL];
+	lastSymbolsNotification = nil;
+
+	SCKSourceFile *file = [[project files] firstObject];
+
+	[[project indexingScheduler] performBlockAndWait: ^ () { [file reparse]; }];
+
+	UKNil(lastSymbolsNotification);
+
+	[[NSRunLoop currentRunLoop] runUntilDate: [NSDate dateWithTimeIntervalSinceNow: 0.2]];
+
+	UKObjectsSame([NSThread currentThread], lastSymbolsNotificationThread);
+	UKObjectsEqual(S(@"After"), [self namesOfComponents:
+		[[lastSymbolsNotification userInfo] objectForKey: SCKProjectInsertedClassesKey]]);
+	UKObjectsEqual(S(@"After"), [self namesOfComponents: [project classes]]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+}
+
+- (void)testSymbolBrowsingContent
+{
+	[project addFileURL: headerURL];
+	[project setContentClass: [SCKSymbolBrowsingProjectContent class]];
+
+	UKObjectsEqual(A([project classes], [project functions], [project globals]), [project content]);
+}
+
+- (SCKProject *)projectForGeneratedCorpus: (SCKCorpusGenerator *)generator
+{
+	NSString *directory = [SCKCorpusGenerator temporaryDirectory];
+	NSString *hiddenDirectory = [directory stringByAppendingPathComponent: @".git"];
+
+	[generator writeCorpusToDirectory: directory];
+	[[NSFileManager defaultManager] createDirectoryAtPath: hiddenDirectory
+	                          withIntermediateDirectories: YES
+	                                           attributes: nil
+	                                                error: NULL];
+	[@"@interface Hidden @end" writeToFile: [hiddenDirectory stringByAppendingPathComponent: @"Hidden.m"]
+	                            atomically: NO
+	                              encoding: NSUTF8StringEncoding
+	                                 error: NULL];
+
+	return [[SCKProject alloc] initWithDirectoryURL: [NSURL fileURLWithPath: directory]
+	                               sourceCollection: sourceCollection];
+}
+
+- (void)testAddFilesInDirectory
+{
+	SCKCorpusGenerator *generator = [SCKCorpusGenerator new];
+	[generator setClassCount: 3];
+	SCKProject *directoryProject = [self projectForGeneratedCorpus: generator];
+
+	UKIntsEqual(7, [[directoryProject addFilesInDirectory] count]);
+	UKIntsEqual(7, [[directoryProject files] count]);
+	UKIntsEqual(3, [[directoryProject classes] count]);
+	UKIntsEqual(0, [[directoryProject addFilesInDirectory] count]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: [[directoryProject directoryURL] path] error: NULL];
+}
+
+- (void)testRelativeURLsAreMatchedByPath
+{
+	SCKCorpusGenerator *generator = [SCKCorpusGenerator new];
+	[generator setClassCount: 3];
+	SCKProject *directoryProject = [self projectForGeneratedCorpus: generator];
+	NSURL *directoryURL = [directoryProject directoryURL];
+	NSURL *relativeURL = [NSURL URLWithString: @"SCKGenClass1.m" relativeToURL: directoryURL];
+	NSURL *absoluteURL = [NSURL fileURLWithPath:
+		[[directoryURL path] stringByAppendingPathComponent: @"SCKGenClass1.m"]];
+
+	[directoryProject addFileURL: relativeURL];
+	[directoryProject addFileURL: absoluteURL];
+
+	UKObjectsEqual(A(relativeURL), [directoryProject fileURLs]);
+	UKIntsEqual(6, [[directoryProject addFilesInDirectory] count]);
+	UKIntsEqual(7, [[directoryProject files] count]);
+
+	[directoryProject removeFileURL: absoluteURL];
+
+	UKFalse([[directoryProject fileURLs] containsObject: relativeURL]);
+	UKIntsEqual(6, [[directoryProject files] count]);
+
+	[[NSFileManager defaultManager] removeItemAtPath: [directoryURL path] error: NULL];
+}
+
+- (void)testScheduleFilesInDirectory
+{
+	SCKCorpusGenerator *generator = [SCKCorpusGenerator new];
+	[generator setClassCount: 3];
+	SCKProject *directoryProject = [self projectForGeneratedCorpus: generator];
+	SCKIndexingScheduler *scheduler = [directoryProject indexingScheduler];
+	NSString *directory = [[[directoryProject directoryURL] path] stringByStandardizingIntoAbsolutePath];
+	NSString *openedPath = [directory stringByAppendingPathComponent: @"SCKGenClass2.m"];
+
+	UKIntsEqual(7, [[directoryProject scheduleFilesInDirectory] count]);
+	UKIntsEqual(0, [[directoryProject files] count]);
+	UKIntsEqual(7, [scheduler pendingFileCount]);
+
+	SCKSourceFile *openedFile = [scheduler indexOpenedFileAtPath: openedPath];
+
+	UKObjectsEqual(A(openedFile), [directoryProject files]);
+	UKIntsEqual(6, [scheduler pendingFileCount]);
+	UKTrue([[scheduler pendingPathsWithPriority: SCKIndexingPriorityRelatedFile] containsObject:
+		[directory stringByAppendingPathComponent: @"SCKGenClass2.h"]]);
+	UKTrue([[scheduler pendingPathsWithPriority: SCKIndexingPriorityRelatedFile] containsObject:
+		[directory stringByAppendingPathComponent: @"SCKGenCommon.h"]]);
+
+	NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow: 30];
+
+	while ([scheduler pendingFileCount] > 0 && [timeout timeIntervalSinceNow] > 0)
+	{
+		[[NSRunLoop currentRunLoop] runUntilDate: [NSDate dateWithTimeIntervalSinceNow: 0.1]];
+	}
+
+	UKIntsEqual(7, [[directoryProject files] count]);
+	UKIntsEqual(3, [[directoryProject classes] count]);
+	UKIntsEqual(0, [[directoryProject scheduleFilesInDirectory] count]);
+
+	[scheduler stop];
+	[[NSFileManager defaultManager] removeItemAtPath: directory error: NULL];
+}
+
+#ifdef __linux__
+- (void)testWatchDirectory
+{
+	SCKCorpusGenerator *generator = [SCKCorpusGenerator new];
+	[generator setClassCount: 2];
+	SCKProject *directoryProject = [self projectForGeneratedCorpus: generator];
+	NSString *directory = [[directoryProject directoryURL] path];
+
+	[directoryProject addFilesInDirectory];
+	UKTrue([directoryProject startWatchingDirectory]);
+
+	[@"@interface Watched : NSObject @end" writeToFile: [directory stringByAppendingPathComponent: @"Watched.m"]
+	                                        atomically: NO
+	                                          encoding: NSUTF8StringEncoding
+	                                             error: NULL];
+	[[NSFileManager defaultManager] removeItemAtPath: [directory stringByAppendingPathComponent: @"SCKGenClass1.m"]
+	                                           error: NULL];
+	[[NSRunLoop currentRunLoop] runUntilDate: [NSDate dateWithTimeIntervalSinceNow: 1]];
+
+	NSSet *fileNames = SA((id)[[[directoryProject files] mappedCollection] fileName]);
+
+	UKIntsEqual(5, [fileNames count]);
+	UKTrue([fileNames containsObject: [directory stringByAppendingPathComponent: @"Watched.m"]]);
+	UKFalse([fileNames containsObject: [directory stringByAppendingPathComponent: @"SCKGenClass1.m"]]);
+
+	[directoryProject stopWatchingDirectory];
+	UKFalse([directoryProject isWatchingDirectory]);
+	[[NSFileManager defaultManager] removeItemAtPath: directory error: NULL];
+}
+#endif
+
+@end
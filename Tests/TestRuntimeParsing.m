@@ -41,6 +41,15 @@
 	UKStringsEqual(@"v@:Q", sleepLaterTypeEncoding);
 }
 
+- (void)testImplementorsOfSelector
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+	NSArray *implementors = [collection implementorsOfSelector: @"sleepLater:"];
+
+	UKIntsEqual(1, [implementors count]);
+	UKStringsEqual(@"A", [[implementors firstObject] name]);
+}
+
 - (void)testProperty
 {
 	SCKClass *classB = [self parsedClassForName: @"B"];
@@ -0,0 +1,154 @@
+#import "TestCommon.h"
+#import "SCKCorpusGenerator.h"
+#import "SCKSourceFile.h"
+#import "SCKMetrics.h"
+#import <Cocoa/Cocoa.h>
+
+/**
+ * Parses generated corpora of increasing sizes, checks the indexing results
+ * and logs the time spent in each phase, so scaling regressions are visible
+ * in the test output.
+ */
+@interface TestScaling : TestCommon
+@end
+
+@implementation TestScaling
+
+/**
+ * Writes the corpus into the directory and parses it. The caller removes the
+ * directory once it is done with the collection.
+ */
+- (SCKSourceCollection*)parseCorpusGeneratedBy: (SCKCorpusGenerator*)generator
+                                   inDirectory: (NSString*)directory
+{
+	SCKSourceCollection *collection = [SCKSourceCollection new];
+
+	[collection clear];
+	[collection setIgnoresIncludedSymbols: YES];
+
+	for (NSString *path in [generator writeCorpusToDirectory: directory])
+	{
+		[collection sourceFileForPath: path];
+	}
+	return collection;
+}
+
+- (void)checkIndexedCorpus: (SCKSourceCollection*)collection
+               generatedBy: (SCKCorpusGenerator*)generator
+{
+	for (NSUInteger i = 0; i < [generator classCount]; i++)
+	{
+		SCKClass *class = [[collection classes] objectForKey: [generator classNameAtIndex: i]];
+		NSUInteger lastIvar = [generator ivarCount] - 1;
+
+		UKNotNil(class);
+		UKStringsEqual([generator superclassNameForClassAtIndex: i], [[class superclass] name]);
+		UKIntsEqual([generator categoryCount], [[class categories] count]);
+		UKTrue([[class methods] count] >= [generator methodCount]
+			+ [generator categoryCount] * [generator categoryMethodCount]);
+		UKNotNil([[class methods] objectForKey: [generator selectorAtIndex: [generator methodCount] - 1]]);
+		UKNotNil([class ivarForName: [generator ivarNameAtIndex: lastIvar]]);
+		UKIntsEqual([generator ivarCount], [[class ivars] count]);
+		UKIntsEqual([generator propertyCount], [[class properties] count]);
+
+		NSString *protocolName = [generator adoptedProtocolNameForClassAtIndex: i];
+
+		if (nil != protocolName)
+		{
+			UKStringsEqual(protocolName, [[[class adoptedProtocols] firstObject] name]);
+			UKTrue([[class allAdoptedProtocols] containsObject:
+				[[collection protocols] objectForKey: [generator protocolNameAtIndex: 0]]]);
+		}
+	}
+	for (NSUInteger k = 0; k < [generator protocolDepth]; k++)
+	{
+		UKNotNil([[collection protocols] objectForKey: [generator protocolNameAtIndex: k]]);
+	}
+	UKNotNil([[collection enumerationValues] objectForKey:
+		[generator enumValueNameAtIndex: [generator enumValueCount] - 1]]);
+}
+
+- (void)logMetricsOfCollection: (SCKSourceCollection*)collection
+                   description: (NSString*)aDescription
+{
+	SCKMetrics *metrics = [collection metrics];
+
+	NSLog(@"%@", aDescription);
+	for (int phase = 0; phase < SCKMetricPhaseCount; phase++)
+	{
+		if ([[metrics statisticsForPhase: phase] callCount] > 0)
+		{
+			NSLog(@"\t%@", [metrics statisticsForPhase: phase]);
+		}
+	}
+}
+
+- (void)testMultipleFileCorpora
+{
+	for (NSNumber *size in A([NSNumber numberWithInt: 5], [NSNumber numberWithInt: 25]))
+	{
+		SCKCorpusGenerator *generator = [SCKCorpusGenerator new];
+
+		[generator setClassCount: [size unsignedIntegerValue]];
+
+		NSString *directory = [SCKCorpusGenerator temporaryDirectory];
+		SCKSourceCollection *collection = [self parseCorpusGeneratedBy: generator inDirectory: directory];
+
+		[self checkIndexedCorpus: collection generatedBy: generator];
+		[self logMetricsOfCollection: collection
+		                 description: [NSString stringWithFormat: @"%@ classes in %@ files",
+		                               size, [NSNumber numberWithUnsignedInteger: [[collection files] count]]]];
+		[[NSFileManager defaultManager] removeItemAtPath: directory error: NULL];
+	}
+}
+
+- (void)testSingleFileCorpora
+{
+	for (NSNumber *size in A([NSNumber numberWithInt: 50], [NSNumber numberWithInt: 200], [NSNumber numberWithInt: 800]))
+	{
+		SCKCorpusGenerator *generator = [SCKCorpusGenerator new];
+
+		[generator setClassCount: [size unsignedIntegerValue]];
+		[generator setMethodCount: 20];
+		[generator setIvarCount: 20];
+		[generator setProtocolDepth: 50];
+		[generator setEnumValueCount: 1000];
+		[generator setMacroCount: 1000];
+		[generator setSingleFile: YES];
+
+		NSString *directory = [SCKCorpusGenerator temporaryDirectory];
+		SCKSourceCollection *collection = [self parseCorpusGeneratedBy: generator inDirectory: directory];
+		SCKSourceFile *file = [[[collection files] objectEnumerator] nextObject];
+
+		[self checkIndexedCorpus: collection generatedBy: generator];
+
+		double start = SCKMetricsNow();
+		for (NSUInteger i = 0; i < [generator classCount]; i++)
+		{
+			SCKClass *class = [[collection classes] objectForKey: [generator classNameAtIndex: i]];
+
+			for (NSUInteger j = 0; j < [generator ivarCount]; j++)
+			{
+				[class ivarForName: [generator ivarNameAtIndex: j]];
+			}
+		}
+		double ivarLookupTime = SCKMetricsNow() - start;
+
+		NSString *text = [NSString stringWithContentsOfFile: [file fileName]
+		                                           encoding: NSUTF8StringEncoding
+		                                              error: NULL];
+		UKNotNil(text);
+
+		[file setSource: [[NSMutableAttributedString alloc] initWithString: text]];
+		[file reparse];
+		[file lexicalHighlightFile];
+		[file syntaxHighlightFile];
+
+		[self logMetricsOfCollection: collection
+		                 description: [NSString stringWithFormat: @"%@ classes in a single file "
+		                               "(ivarForName: lookups took %.3fms)", size, ivarLookupTime * 1000]];
+		[[NSFileManager defaultManager] removeItemAtPath: directory error: NULL];
+	}
+}
+
+@end